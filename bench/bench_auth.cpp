@@ -0,0 +1,248 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <openssl/hmac.h>
+#include "../inc/gnss_payload.h"
+#include "../inc/gnss_auth.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_SENTENCE          "$GPRMC,123519.00,A,4807.038000,N,01131.000000,E,0.0,0.0,230394,0.0,W,A*6A"
+#define BENCH_DEVICES           (1000U)           /* Devices with a key, the payloads are spread over them */
+#define BENCH_KEY_FILE          "bench_auth_keys.conf"
+#define BENCH_BATCH_CHECKS      (512U)            /* Payloads per verify() call, as a busy receiver loop collects */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static std::string deviceKey(size_t device);
+static bool writeKeyFile();
+static std::vector<std::string> makePayloads(size_t count, size_t batchSize);
+static double runVerifier(PayloadVerifier& verifier, const std::vector<std::string>& payloads, uint64_t& accepted);
+static double runDecode(const std::vector<std::string>& payloads);
+static double runOneShot(const std::vector<std::string>& payloads);
+static void report(const char* name, size_t count, double seconds, double baseline);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief The 32-byte key of a bench device.
+ **********************************************************************************************************************/
+static std::string deviceKey (size_t device)
+{
+    std::string key(32, '\0');
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        key[i] = (char)(device * 31 + i * 7);
+    }
+    return key;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes the key file of the bench devices, in the format of gnss_keys.conf.
+ **********************************************************************************************************************/
+static bool writeKeyFile ()
+{
+    FILE* file = std::fopen(BENCH_KEY_FILE, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    for (size_t device = 0; device < BENCH_DEVICES; ++device)
+    {
+        std::fprintf(file, "vehicle-%zu ", device);
+        for (unsigned char c : deviceKey(device))
+        {
+            std::fprintf(file, "%02x", c);
+        }
+        std::fprintf(file, "\n");
+    }
+    return std::fclose(file) == 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Builds signed sequenced batches, round-robin over the devices.
+ **********************************************************************************************************************/
+static std::vector<std::string> makePayloads (size_t count, size_t batchSize)
+{
+    std::vector<std::string> payloads(count);
+    PayloadBatch batch;
+    batch.sentences.assign(batchSize, BENCH_SENTENCE);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t device = i % BENCH_DEVICES;
+        batch.deviceId = "vehicle-" + std::to_string(device);
+        batch.firstSequence = 1 + (i / BENCH_DEVICES) * batchSize;
+        encodeBatch(batch, payloads[i]);
+        signPayload(payloads[i], deviceKey(device));
+    }
+    return payloads;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Verifies all payloads in groups of BENCH_BATCH_CHECKS, as the receiver does per network loop.
+ **********************************************************************************************************************/
+static double runVerifier (PayloadVerifier& verifier, const std::vector<std::string>& payloads, uint64_t& accepted)
+{
+    std::vector<AuthCheck> checks;
+    accepted = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < payloads.size(); first += BENCH_BATCH_CHECKS)
+    {
+        size_t last = std::min<size_t>(first + BENCH_BATCH_CHECKS, payloads.size());
+        checks.resize(last - first);
+        for (size_t i = first; i < last; ++i)
+        {
+            checks[i - first].data = payloads[i].data();
+            checks[i - first].size = payloads[i].size();
+        }
+        verifier.verify(checks);
+        for (const AuthCheck& check : checks)
+        {
+            accepted += authAccepted(check.result);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Decodes all payloads, the work the receiver does on every message anyway.
+ **********************************************************************************************************************/
+static double runDecode (const std::vector<std::string>& payloads)
+{
+    PayloadBatch batch;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& payload : payloads)
+    {
+        decodeBatch(payload.data(), payload.size(), batch);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Computes every tag with the one-shot HMAC(), which derives the key pads again for each payload.
+ **********************************************************************************************************************/
+static double runOneShot (const std::vector<std::string>& payloads)
+{
+    unsigned char tag[EVP_MAX_MD_SIZE];
+    unsigned int tagSize;
+    std::vector<std::string> keys;
+    for (size_t device = 0; device < BENCH_DEVICES; ++device)
+    {
+        keys.push_back(deviceKey(device));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < payloads.size(); ++i)
+    {
+        const std::string& key = keys[i % BENCH_DEVICES];
+        HMAC(EVP_sha256(), key.data(), (int)key.size(), reinterpret_cast<const unsigned char*>(payloads[i].data()),
+             payloads[i].size() - PAYLOAD_TAG_SIZE, tag, &tagSize);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints one result line, with its cost relative to decoding.
+ **********************************************************************************************************************/
+static void report (const char* name, size_t count, double seconds, double baseline)
+{
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << (seconds > 0.0 ? count / seconds : 0.0) << " payloads/s " << std::setprecision(2)
+              << std::setw(8) << seconds * 1e6 / count << " us each";
+    if (baseline > 0.0)
+    {
+        std::cout << " (" << std::setprecision(0) << 100.0 * seconds / baseline << "% of decoding)";
+    }
+    std::cout << std::endl;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Measures the cost of checking HMAC tags on the receiver.
+ *
+ * "bench_auth [payloads] [batch] [workers]" signs the given number of batches of the given number of fixes for 1000
+ * devices, then verifies them with the given number of worker threads besides the caller (all cores by default), once
+ * on first arrival and once more as replays served from the verified cache, and compares both with decoding the same
+ * payloads.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t batchSize = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1;
+    unsigned int cores = std::thread::hardware_concurrency();
+    size_t workers = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : ((cores > 1) ? cores - 1 : 0);
+    if ((count == 0) || (batchSize == 0) || (batchSize > PAYLOAD_MAX_SENTENCES))
+    {
+        std::cerr << "Usage: " << argv[0] << " [payloads] [batch] [workers]" << std::endl;
+        return 1;
+    }
+
+    std::string error;
+    PayloadVerifier verifier;
+    if (!writeKeyFile() || !verifier.loadKeys(BENCH_KEY_FILE, error) || !verifier.start(workers))
+    {
+        std::cerr << "Unable to set up the verifier: " << error << std::endl;
+        return 1;
+    }
+    std::remove(BENCH_KEY_FILE);
+
+    std::vector<std::string> payloads = makePayloads(count, batchSize);
+    std::cout << count << " signed payloads of " << payloads.front().size() << " bytes (" << batchSize
+              << " fixes), " << BENCH_DEVICES << " device keys, " << workers << " workers, SHA extensions "
+              << (shaExtensions() ? "available" : "not available") << std::endl;
+
+    double decode = runDecode(payloads);
+    report("decode", count, decode, 0.0);
+    report("hmac one-shot", count, runOneShot(payloads), decode);
+
+    uint64_t accepted;
+    double seconds = runVerifier(verifier, payloads, accepted);
+    report("verify", count, seconds, decode);
+    if (accepted != count)
+    {
+        std::cerr << count - accepted << " payloads rejected!" << std::endl;
+        return 1;
+    }
+
+    // The cache holds the latest AUTH_CACHE_SIZE payloads, replay those as a broker redelivering after a reconnect
+    std::vector<std::string> replays(payloads.end() - std::min<size_t>(count, AUTH_CACHE_SIZE), payloads.end());
+    report("verify replay (cached)", replays.size(), runVerifier(verifier, replays, accepted), 0.0);
+
+    // A single flipped bit must be caught
+    payloads[0][payloads[0].size() / 2] ^= 1;
+    std::vector<std::string> forged(1, payloads[0]);
+    runVerifier(verifier, forged, accepted);
+    std::cout << "forged payload " << (accepted == 0 ? "rejected" : "ACCEPTED") << std::endl;
+
+    verifier.stop();
+    return (accepted == 0) ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "../inc/gnss_impair.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_SENTENCE          "$GPRMC,123519.00,A,4807.038000,N,01131.000000,E,0.0,0.0,230394,0.0,W,A*6A"
+#define BENCH_TOPIC             "gnss/data/bench"
+#define BENCH_RATE              (100000U)         /* Messages per emulated second */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool runSpec(const char* spec, size_t count);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Pushes messages through a layer as the sender does, at BENCH_RATE on an emulated clock, and prints the cost.
+ *
+ * The emulated clock lets the delays and outages play out as at full rate, without the bench waiting for them.
+ **********************************************************************************************************************/
+static bool runSpec (const char* spec, size_t count)
+{
+    ImpairmentLayer layer;
+    std::string error;
+    if (!layer.configure(spec, error))
+    {
+        std::cerr << "Invalid impairment " << error << std::endl;
+        return false;
+    }
+
+    std::vector<ImpairedMessage> released;
+    uint64_t out = 0;
+    uint64_t inversions = 0;
+    uint64_t lastNumber = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int64_t nowUs = (int64_t)(i * 1000000 / BENCH_RATE);
+        std::string topic = BENCH_TOPIC;
+        std::string payload = BENCH_SENTENCE;
+        payload.append(std::to_string(i + 1));
+
+        if (layer.submit(topic, payload, nowUs))
+        {
+            released.emplace_back();
+            released.back().payload.swap(payload);
+        }
+        layer.release(nowUs, released);
+
+        for (const ImpairedMessage& message : released)
+        {
+            uint64_t number = std::strtoull(message.payload.c_str() + sizeof(BENCH_SENTENCE) - 1, nullptr, 10);
+            inversions += (number < lastNumber) ? 1 : 0;
+            lastNumber = number;
+        }
+        out += released.size();
+        released.clear();
+    }
+    layer.release(INT64_MAX, released);
+    out += released.size();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ImpairStats stats = layer.stats();
+    std::cout << std::left << std::setw(50) << spec << std::right << std::fixed << std::setprecision(2)
+              << std::setw(7) << count / seconds / 1e6 << " M msgs/s " << std::setw(7) << out << " out "
+              << std::setw(6) << stats.lost + stats.outageDropped << " lost " << std::setw(6) << inversions
+              << " out of order " << std::setw(7) << stats.maxQueued << " held at most" << std::endl;
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Measures the messages per second the impairment layer of gnss_sender sustains with typical impairments.
+ *
+ * "bench_impair [messages]" submits the given number of messages (1 million by default) per specification, each a
+ * fix with its number, and counts the messages that come out, the lost ones and the ones overtaken by a later one.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if (count == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [messages]" << std::endl;
+        return 1;
+    }
+
+    static const char* specs[] = {
+        "loss=1",
+        "loss=burst:0.5:20",
+        "delay=20",
+        "delay=normal:50:10",
+        "delay=pareto:5:1.5,dup=1",
+        "loss=1,delay=exp:20,dup=0.5,reorder=2:30",
+        "outage=1:0.2",
+        "outage=exp:2:0.5:drop,delay=uniform:1:10,seed=7",
+    };
+
+    for (const char* spec : specs)
+    {
+        if (!runSpec(spec, count))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
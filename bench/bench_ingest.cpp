@@ -0,0 +1,275 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <mosquitto.h>
+#include "../inc/gnss_payload.h"
+#include "../inc/gnss_udp.h"
+#include "../inc/gnss_broker.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_SENTENCE          "$GPRMC,123519.00,A,4807.038000,N,01131.000000,E,0.0,0.0,230394,0.0,W,A*6A"
+#define IDLE_TIMEOUT_MS         (2000)            /* A path is finished when nothing arrives for this long */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+struct BenchResult
+{
+    uint64_t fixes;             /* Fixes that arrived */
+    uint64_t lost;              /* Fixes detected as lost from the sequence numbers */
+    double seconds;             /* From the first send to the last arrival */
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static std::vector<std::string> makePayloads(size_t fixes, size_t batchSize);
+static BenchResult runUdp(const std::vector<std::string>& payloads, size_t fixes);
+static BenchResult runMqtt(const std::vector<std::string>& payloads, size_t fixes, int qos);
+static void on_bench_message(struct mosquitto* mosq, void* obj, const struct mosquitto_message* message);
+static uint64_t countFixes(const char* data, size_t size, SequenceTracker* tracker);
+static void report(const char* name, const BenchResult& result);
+
+static std::atomic<uint64_t> mqttFixes(0);
+static std::atomic<int64_t> mqttLastNs(0);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Builds the sequenced batches sent by both paths.
+ **********************************************************************************************************************/
+static std::vector<std::string> makePayloads (size_t fixes, size_t batchSize)
+{
+    std::vector<std::string> payloads;
+    PayloadBatch batch;
+    batch.deviceId = "bench";
+
+    for (size_t first = 0; first < fixes; first += batchSize)
+    {
+        batch.firstSequence = first + 1;
+        batch.sentences.assign(std::min(batchSize, fixes - first), BENCH_SENTENCE);
+        payloads.push_back(std::string());
+        encodeBatch(batch, payloads.back());
+    }
+
+    return payloads;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of a payload and records its sequence numbers.
+ **********************************************************************************************************************/
+static uint64_t countFixes (const char* data, size_t size, SequenceTracker* tracker)
+{
+    PayloadBatch batch;
+    if (!decodeBatch(data, size, batch))
+    {
+        return 0;
+    }
+    if (tracker != nullptr)
+    {
+        tracker->observe(batch.deviceId, batch.firstSequence, batch.sentences.size());
+    }
+    return batch.sentences.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sends all payloads as datagrams with sendmmsg and receives them with recvmmsg on another thread.
+ **********************************************************************************************************************/
+static BenchResult runUdp (const std::vector<std::string>& payloads, size_t fixes)
+{
+    BenchResult result = { 0, 0, 0.0 };
+    UdpReceiver receiver;
+    UdpSender sender;
+    if (!receiver.open(0) || !sender.open("127.0.0.1", receiver.port()))
+    {
+        return result;
+    }
+
+    std::atomic<bool> ready(false);
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    SequenceTracker tracker;
+
+    std::thread consumer([&]()
+    {
+        std::vector<std::string> datagrams;
+        struct pollfd pfd = { receiver.fd(), POLLIN, 0 };
+        ready = true;
+        while ((result.fixes < fixes) && (poll(&pfd, 1, IDLE_TIMEOUT_MS) > 0))
+        {
+            datagrams.clear();
+            receiver.receive(datagrams);
+            for (const std::string& datagram : datagrams)
+            {
+                result.fixes += countFixes(datagram.data(), datagram.size(), &tracker);
+            }
+            last = std::chrono::steady_clock::now();
+        }
+    });
+
+    while (!ready)
+    {
+        std::this_thread::yield();
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (const std::string& payload : payloads)
+    {
+        sender.queue(payload);
+    }
+    sender.flush();
+    consumer.join();
+
+    SequenceStats st = tracker.stats();
+    result.lost = st.lost + (fixes - std::min<uint64_t>(fixes, st.received + st.lost));
+    result.seconds = std::chrono::duration<double>(last - start).count();
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Message callback of the MQTT subscriber.
+ **********************************************************************************************************************/
+static void on_bench_message (struct mosquitto* mosq, void* obj, const struct mosquitto_message* message)
+{
+    mqttFixes += countFixes(static_cast<const char*>(message->payload), message->payloadlen, nullptr);
+    mqttLastNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes all payloads through the embedded broker to a subscriber, both with libmosquitto.
+ **********************************************************************************************************************/
+static BenchResult runMqtt (const std::vector<std::string>& payloads, size_t fixes, int qos)
+{
+    BenchResult result = { 0, 0, 0.0 };
+    MqttBroker broker;
+    if (!broker.start(0))
+    {
+        return result;
+    }
+
+    mosquitto_lib_init();
+    struct mosquitto* subscriber = mosquitto_new(NULL, true, NULL);
+    struct mosquitto* publisher = mosquitto_new(NULL, true, NULL);
+    mosquitto_message_callback_set(subscriber, on_bench_message);
+
+    if ((mosquitto_connect(subscriber, "127.0.0.1", broker.port(), 60) == MOSQ_ERR_SUCCESS) &&
+        (mosquitto_connect(publisher, "127.0.0.1", broker.port(), 60) == MOSQ_ERR_SUCCESS) &&
+        (mosquitto_subscribe(subscriber, NULL, "gnss/data/#", qos) == MOSQ_ERR_SUCCESS))
+    {
+        mosquitto_loop_start(subscriber);
+        mosquitto_loop_start(publisher);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));    // Let the subscription settle
+
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& payload : payloads)
+        {
+            while (mosquitto_publish(publisher, NULL, "gnss/data/bench", payload.size(), payload.data(), qos,
+                                     false) == MOSQ_ERR_NOMEM)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        uint64_t seen = 0;
+        auto lastProgress = std::chrono::steady_clock::now();
+        while (mqttFixes < fixes)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (mqttFixes != seen)
+            {
+                seen = mqttFixes;
+                lastProgress = std::chrono::steady_clock::now();
+            }
+            else if (std::chrono::steady_clock::now() - lastProgress > std::chrono::milliseconds(IDLE_TIMEOUT_MS))
+            {
+                break;
+            }
+        }
+
+        int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+        result.fixes = mqttFixes;
+        result.lost = fixes - std::min<uint64_t>(fixes, result.fixes);
+        result.seconds = (mqttLastNs - startNs) / 1e9;
+
+        mosquitto_loop_stop(publisher, true);
+        mosquitto_loop_stop(subscriber, true);
+    }
+    else
+    {
+        std::cerr << "Unable to connect to the embedded broker!" << std::endl;
+    }
+
+    mosquitto_destroy(publisher);
+    mosquitto_destroy(subscriber);
+    mosquitto_lib_cleanup();
+    broker.stop();
+
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints one result line.
+ **********************************************************************************************************************/
+static void report (const char* name, const BenchResult& result)
+{
+    std::cout << std::left << std::setw(6) << name << std::right << std::setw(10) << result.fixes << " fixes "
+              << std::setw(8) << result.lost << " lost " << std::fixed << std::setprecision(3) << std::setw(8)
+              << result.seconds << " s " << std::setprecision(0) << std::setw(12)
+              << (result.seconds > 0.0 ? result.fixes / result.seconds : 0.0) << " fixes/s" << std::endl;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Compares the UDP input with the MQTT path on loopback.
+ *
+ * "bench_ingest [fixes] [batch] [qos]" sends the same sequenced batches once as datagrams (sendmmsg/recvmmsg) and
+ * once through the embedded broker between two libmosquitto clients, and reports the end-to-end rate of each path.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t fixes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t batchSize = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1;
+    int qos = (argc > 3) ? std::atoi(argv[3]) : 0;
+    if ((fixes == 0) || (batchSize == 0) || (batchSize > PAYLOAD_MAX_SENTENCES) || (qos < 0) || (qos > 1))
+    {
+        std::cerr << "Usage: " << argv[0] << " [fixes] [batch] [qos 0|1]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> payloads = makePayloads(fixes, batchSize);
+    std::cout << fixes << " fixes in " << payloads.size() << " messages of " << payloads.front().size()
+              << " bytes, QoS " << qos << " on the MQTT path" << std::endl;
+
+    report("udp", runUdp(payloads, fixes));
+    report("mqtt", runMqtt(payloads, fixes, qos));
+
+    return 0;
+}
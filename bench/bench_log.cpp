@@ -0,0 +1,172 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "../inc/gnss_log.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_SENTENCE          "$GPRMC,123519.00,A,4807.038000,N,01131.000000,E,0.0,0.0,230394,0.0,W,A*6A"
+#define BENCH_LOG_FILE          "bench_log.binlog"
+#define BENCH_BURST             (4000U)           /* Calls that fit in the staging buffer without waiting */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static double runBinary(size_t count, const std::string& sentence);
+static double runBinaryNumbers(size_t count);
+static double runStream(size_t count, const std::string& sentence, std::ostream& out);
+static double runPrintf(size_t count, const std::string& sentence, FILE* out);
+static void report(const char* name, size_t count, double seconds);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Logs the receiver's per-message line through the binary log.
+ **********************************************************************************************************************/
+static double runBinary (size_t count, const std::string& sentence)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        LOG_TRACE("GNSS Data Received: {}", sentence);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs a statistics line of numbers through the binary log.
+ **********************************************************************************************************************/
+static double runBinaryNumbers (size_t count)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        LOG_INFO("Tenant {}: {} fixes stored, latency p99 {.1} ms", "bench", i, i * 0.001);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Formats the same line as logGNSSData did before the binary log, with a timestamp per line.
+ **********************************************************************************************************************/
+static double runStream (size_t count, const std::string& sentence, std::ostream& out)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm* now_tm = std::localtime(&now);
+        out << "[INFO] " << std::put_time(now_tm, "%Y-%m-%d %H:%M:%S") << " - GNSS Data Received: " << sentence
+            << std::endl;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Formats the same line with stdio, buffered.
+ **********************************************************************************************************************/
+static double runPrintf (size_t count, const std::string& sentence, FILE* out)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm local;
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&now, &local));
+        std::fprintf(out, "[INFO] %s - GNSS Data Received: %s\n", stamp, sentence.c_str());
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints one result line.
+ **********************************************************************************************************************/
+static void report (const char* name, size_t count, double seconds)
+{
+    std::cout << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << seconds * 1e9 / count << " ns/call " << std::setprecision(2) << std::setw(8)
+              << count / seconds / 1e6 << " M calls/s" << std::endl;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Measures the cost of a log call with the binary log and with text formatting.
+ *
+ * "bench_log [calls]" logs the receiver's per-message line the given number of times (2 million by default) into a
+ * binary log, sustained and in bursts that fit in the staging buffer, and compares it with formatting the same line
+ * with iostreams, as the receiver did, and with stdio, both written to /dev/null.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    if (count == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [calls]" << std::endl;
+        return 1;
+    }
+
+    std::string sentence = BENCH_SENTENCE;
+    std::remove(BENCH_LOG_FILE);
+    if (!logOpen(BENCH_LOG_FILE))
+    {
+        return 1;
+    }
+
+    // Warm up: the first call of a thread allocates its staging buffer
+    runBinary(1, sentence);
+
+    double burst = 0.0;
+    size_t bursts = 0;
+    for (size_t done = 0; done < count; done += BENCH_BURST, ++bursts)
+    {
+        burst += runBinary(BENCH_BURST, sentence);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));       // Let the writer thread empty the buffer
+    }
+    report("binary log, burst", bursts * BENCH_BURST, burst);
+    report("binary log, sustained", count, runBinary(count, sentence));
+    report("binary log, 3 numbers", count, runBinaryNumbers(count));
+    logClose();
+
+    std::ifstream written(BENCH_LOG_FILE, std::ios::binary | std::ios::ate);
+    double bytes = (double)written.tellg();
+    std::cout << "binary log: " << std::setprecision(1) << bytes / 1e6 << " MB, " << bytes / (bursts * BENCH_BURST +
+              2 * count + 1) << " bytes/record; render with gnss_logdecode " << BENCH_LOG_FILE << std::endl;
+
+    std::ofstream devNull("/dev/null");
+    report("iostream text, std::endl", count, runStream(count, sentence, devNull));
+    FILE* devNullFile = std::fopen("/dev/null", "w");
+    report("stdio text, buffered", count, runPrintf(count, sentence, devNullFile));
+    std::fclose(devNullFile);
+
+    return (logDropped() == 0) ? 0 : 1;
+}
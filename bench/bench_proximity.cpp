@@ -0,0 +1,214 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "../inc/gnss_proximity.h"
+#include "../inc/gnss_random.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_CITY_DEG          (0.3)             /* Side of the square each city's vehicles stay in, about 30 km */
+#define BENCH_STEP_MS           (1000)            /* Simulated time between steps, one fix per vehicle each */
+#define BENCH_CONVOY_EVERY      (20U)             /* Every so many vehicles follow the one before */
+#define BENCH_BRUTE_MAX         (20000U)          /* Largest fleet also checked against all pairs */
+#define METRES_PER_DEGREE       (111320.0)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+struct BenchVehicle
+{
+    double lat, lon;
+    double heading;             /* Radians from north */
+    double speed;               /* Metres per second */
+    double homeLat, homeLon;    /* South-west corner of its city */
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void moveFleet(std::vector<BenchVehicle>& fleet, FastRandom& random);
+static size_t countNearPairs(const std::vector<GNSSFix>& fixes, double nearM);
+static double percentile(std::vector<double> values, double p);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Moves the fleet by one step: each vehicle turns a little and drives on, bouncing off the edges of its city;
+ *        followers take the position of their leader a few tens of metres back.
+ **********************************************************************************************************************/
+static void moveFleet (std::vector<BenchVehicle>& fleet, FastRandom& random)
+{
+    const double seconds = BENCH_STEP_MS / 1000.0;
+    for (size_t i = 0; i < fleet.size(); ++i)
+    {
+        BenchVehicle& v = fleet[i];
+        double metresPerDegLon = METRES_PER_DEGREE * std::cos(v.lat * M_PI / 180.0);
+        if ((i % BENCH_CONVOY_EVERY == 1) && (i > 0))
+        {
+            const BenchVehicle& leader = fleet[i - 1];
+            double back = 30.0 + 5.0 * random.normal();
+            v.lat = leader.lat - std::cos(leader.heading) * back / METRES_PER_DEGREE;
+            v.lon = leader.lon - std::sin(leader.heading) * back / metresPerDegLon;
+            v.heading = leader.heading;
+            continue;
+        }
+
+        v.heading += 0.1 * random.normal();
+        v.speed = std::clamp(v.speed + random.normal(), 0.0, 25.0);
+        v.lat += std::cos(v.heading) * v.speed * seconds / METRES_PER_DEGREE;
+        v.lon += std::sin(v.heading) * v.speed * seconds / metresPerDegLon;
+        if ((v.lat < v.homeLat) || (v.lat > v.homeLat + BENCH_CITY_DEG) || (v.lon < v.homeLon) ||
+            (v.lon > v.homeLon + BENCH_CITY_DEG))
+        {
+            v.lat = std::clamp(v.lat, v.homeLat, v.homeLat + BENCH_CITY_DEG);
+            v.lon = std::clamp(v.lon, v.homeLon, v.homeLon + BENCH_CITY_DEG);
+            v.heading += M_PI;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the pairs within a distance by testing all of them, for comparison.
+ **********************************************************************************************************************/
+static size_t countNearPairs (const std::vector<GNSSFix>& fixes, double nearM)
+{
+    size_t pairs = 0;
+    for (size_t i = 0; i < fixes.size(); ++i)
+    {
+        double latA = fixes[i].latitude * M_PI / 180.0;
+        for (size_t j = i + 1; j < fixes.size(); ++j)
+        {
+            double latB = fixes[j].latitude * M_PI / 180.0;
+            double dLat = latB - latA;
+            double dLon = (fixes[j].longitude - fixes[i].longitude) * M_PI / 180.0;
+            double h = std::sin(dLat / 2) * std::sin(dLat / 2) +
+                       std::cos(latA) * std::cos(latB) * std::sin(dLon / 2) * std::sin(dLon / 2);
+            pairs += (2.0 * 6371008.8 * std::asin(std::sqrt(h)) <= nearM) ? 1 : 0;
+        }
+    }
+    return pairs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The p-th percentile of the values.
+ **********************************************************************************************************************/
+static double percentile (std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0.0 : values[std::min(values.size() - 1, (size_t)(p / 100.0 * values.size()))];
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Runs the proximity steps of the receiver over a simulated fleet and prints the time per step.
+ *
+ * "bench_proximity [vehicles] [steps] [near-m] [cities]" spreads the fleet over the cities (8 by default), every
+ * BENCH_CONVOY_EVERY vehicles with a follower, and feeds one fix per vehicle per step before each step. Fleets of up to
+ * BENCH_BRUTE_MAX vehicles are also checked against all pairs at the first step.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t vehicles = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t steps = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 120;
+    double nearM = (argc > 3) ? std::strtod(argv[3], nullptr) : 50.0;
+    size_t cities = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 8;
+    if ((vehicles < 2) || (steps == 0) || (nearM < 1.0) || (nearM > PROXIMITY_MAX_M / 1.5) || (cities == 0) ||
+        (cities > 20))
+    {
+        std::cerr << "Usage: " << argv[0] << " [vehicles] [steps] [near-m] [cities]" << std::endl;
+        return 1;
+    }
+
+    FastRandom random(42);
+    std::vector<BenchVehicle> fleet(vehicles);
+    std::vector<GNSSFix> fixes(vehicles);
+    for (size_t i = 0; i < vehicles; ++i)
+    {
+        BenchVehicle& v = fleet[i];
+        v.homeLat = 40.0 + 2.0 * (double)(i % cities);
+        v.homeLon = -5.0 + 3.0 * (double)(i % cities);
+        v.lat = v.homeLat + BENCH_CITY_DEG * random.uniform();
+        v.lon = v.homeLon + BENCH_CITY_DEG * random.uniform();
+        v.heading = 2.0 * M_PI * random.uniform();
+        v.speed = 25.0 * random.uniform();
+        fixes[i].deviceId = "veh" + std::to_string(i);
+    }
+
+    ProximityEngine engine;
+    engine.configure(ProximityConfig{ nearM, 1.5 * nearM, 60000, 30000 });
+    std::vector<ProximityEvent> events;
+    std::vector<double> stepMs;
+    size_t counts[4] = { 0, 0, 0, 0 };
+    double updateSeconds = 0.0;
+    int64_t nowMs = 1767225600000LL;
+
+    for (size_t s = 0; s < steps; ++s, nowMs += BENCH_STEP_MS)
+    {
+        moveFleet(fleet, random);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < vehicles; ++i)
+        {
+            fixes[i].timestampMs = nowMs;
+            fixes[i].latitude = fleet[i].lat;
+            fixes[i].longitude = fleet[i].lon;
+            engine.update(fixes[i]);
+        }
+        auto updated = std::chrono::steady_clock::now();
+        events.clear();
+        size_t near = engine.step(nowMs, events);
+        auto stepped = std::chrono::steady_clock::now();
+        updateSeconds += std::chrono::duration<double>(updated - start).count();
+        stepMs.push_back(std::chrono::duration<double, std::milli>(stepped - updated).count());
+        for (const ProximityEvent& event : events)
+        {
+            ++counts[event.type];
+        }
+
+        if ((s == 0) && (vehicles <= BENCH_BRUTE_MAX))
+        {
+            auto bruteStart = std::chrono::steady_clock::now();
+            size_t expected = countNearPairs(fixes, nearM);
+            double bruteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bruteStart)
+                                 .count();
+            std::cout << "all pairs: " << expected << " within " << nearM << " m in " << std::fixed
+                      << std::setprecision(1) << bruteMs << " ms, grid step found " << near << std::endl;
+            if (expected != near)
+            {
+                std::cerr << "Mismatch against all pairs" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    ProximityStats st = engine.stats();
+    std::cout << std::fixed << std::setprecision(2) << vehicles << " vehicles, " << steps << " steps, near " << nearM
+              << " m: step p50 " << percentile(stepMs, 50) << " ms, p99 " << percentile(stepMs, 99) << " ms, max "
+              << percentile(stepMs, 100) << " ms; update " << std::setprecision(0)
+              << updateSeconds * 1e9 / (double)(vehicles * steps) << " ns/fix; " << st.cells << " cells, "
+              << std::setprecision(1) << (double)st.tested / (double)(vehicles * steps) << " distances/vehicle; "
+              << counts[PROXIMITY_NEAR] << " near, " << counts[PROXIMITY_CLEAR] << " clear, "
+              << counts[PROXIMITY_CONVOY] << " convoy, " << counts[PROXIMITY_CONVOY_END] << " convoy end events; "
+              << st.pairs << " pairs near at the end, " << st.convoys << " convoys" << std::endl;
+    return 0;
+}
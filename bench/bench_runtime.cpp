@@ -0,0 +1,418 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstdlib>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "../inc/gnss_runtime.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_DEVICES           (10000U)          /* Per-device tasks, one per tracked vehicle */
+#define BENCH_YIELD_EVERY       (64U)             /* Queue pushes between two yields of the producer */
+#define BENCH_TIMER_ROUNDS      (20)              /* Sleeps of 1 ms per timer task */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* What a per-device consumer keeps about its vehicle */
+struct DeviceTrack
+{
+    uint64_t fixes;
+    int64_t lastMs;
+    int64_t maxGapMs;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static std::atomic<bool> running(true);
+static volatile uint64_t sink;                  // Keeps the results of the loops from being optimized away
+
+static double cpuSeconds();
+static size_t heapBytes();
+static void track(DeviceTrack& device, int64_t timeMs);
+static Task eventfdTask(EventLoop& loop, int fd, size_t count);
+static Task producerTask(EventLoop& loop, AsyncQueue<uint64_t>& queue, size_t count);
+static Task consumerTask(AsyncQueue<uint64_t>& queue);
+static Task deviceTask(AsyncQueue<int64_t>& queue, DeviceTrack& device);
+static Task dispatchTask(EventLoop& loop, std::vector<std::unique_ptr<AsyncQueue<int64_t>>>& queues, size_t count);
+static Task timerTask(EventLoop& loop, int rounds);
+static double runEventfdLoop(size_t count);
+static double runEventfdTask(size_t count);
+static double runQueueLoop(size_t count);
+static double runQueueTask(size_t count);
+static double runDevicesLoop(size_t count);
+static double runDevicesTask(size_t count, size_t& bytes);
+static double runTimersLoop(size_t tasks);
+static double runTimersTask(size_t tasks);
+static void report(const char* name, size_t count, double seconds);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief CPU time of the process, which unlike wall time leaves out the time spent sleeping on timers.
+ **********************************************************************************************************************/
+static double cpuSeconds ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bytes allocated on the heap.
+ **********************************************************************************************************************/
+static size_t heapBytes ()
+{
+    return mallinfo2().uordblks;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The work done per fix in both versions of the per-device benchmark.
+ **********************************************************************************************************************/
+static void track (DeviceTrack& device, int64_t timeMs)
+{
+    if (device.fixes++ > 0)
+    {
+        device.maxGapMs = std::max(device.maxGapMs, timeMs - device.lastMs);
+    }
+    device.lastMs = timeMs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Signals an eventfd and waits on the loop for it to become readable, count times.
+ **********************************************************************************************************************/
+static Task eventfdTask (EventLoop& loop, int fd, size_t count)
+{
+    uint64_t value = 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        (void)!write(fd, &value, sizeof(value));
+        co_await loop.readable(fd, -1);
+        (void)!read(fd, &value, sizeof(value));
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Pushes count values, letting the consumer run every BENCH_YIELD_EVERY values.
+ **********************************************************************************************************************/
+static Task producerTask (EventLoop& loop, AsyncQueue<uint64_t>& queue, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        queue.push(i);
+        if ((i % BENCH_YIELD_EVERY) == (BENCH_YIELD_EVERY - 1))
+        {
+            co_await loop.yield();
+        }
+    }
+    queue.close();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sums the values of a queue until it is closed.
+ **********************************************************************************************************************/
+static Task consumerTask (AsyncQueue<uint64_t>& queue)
+{
+    uint64_t value;
+    uint64_t sum = 0;
+    while (co_await queue.pop(value))
+    {
+        sum += value;
+    }
+    sink = sum;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tracks the fixes of one device as they are queued for it.
+ **********************************************************************************************************************/
+static Task deviceTask (AsyncQueue<int64_t>& queue, DeviceTrack& device)
+{
+    int64_t timeMs;
+    while (co_await queue.pop(timeMs))
+    {
+        track(device, timeMs);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands count fixes to the device tasks in turn, yielding every BENCH_YIELD_EVERY fixes, then closes the queues.
+ **********************************************************************************************************************/
+static Task dispatchTask (EventLoop& loop, std::vector<std::unique_ptr<AsyncQueue<int64_t>>>& queues, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        queues[i % queues.size()]->push((int64_t)(i / queues.size()) * 1000);
+        if ((i % BENCH_YIELD_EVERY) == (BENCH_YIELD_EVERY - 1))
+        {
+            co_await loop.yield();
+        }
+    }
+    for (std::unique_ptr<AsyncQueue<int64_t>>& queue : queues)
+    {
+        queue->close();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sleeps 1 ms the given number of times.
+ **********************************************************************************************************************/
+static Task timerTask (EventLoop& loop, int rounds)
+{
+    for (int i = 0; i < rounds; ++i)
+    {
+        co_await loop.sleep(1);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Eventfd round trips through a hand-written epoll loop.
+ **********************************************************************************************************************/
+static double runEventfdLoop (size_t count)
+{
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t value = 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        (void)!write(fd, &value, sizeof(value));
+        epoll_wait(epollFd, &ev, 1, -1);
+        (void)!read(fd, &value, sizeof(value));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(epollFd);
+    close(fd);
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Eventfd round trips through a task awaiting readable().
+ **********************************************************************************************************************/
+static double runEventfdTask (size_t count)
+{
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    double seconds;
+    {
+        EventLoop loop;
+        loop.spawn(eventfdTask(loop, fd, count));
+        auto start = std::chrono::steady_clock::now();
+        loop.run(running);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    close(fd);
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Values passed through a deque in batches of BENCH_YIELD_EVERY by a hand-written loop.
+ **********************************************************************************************************************/
+static double runQueueLoop (size_t count)
+{
+    std::deque<uint64_t> queue;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        queue.push_back(i);
+        if (((i % BENCH_YIELD_EVERY) == (BENCH_YIELD_EVERY - 1)) || (i + 1 == count))
+        {
+            while (!queue.empty())
+            {
+                sum += queue.front();
+                queue.pop_front();
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = sum;
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Values passed from a producer task to a consumer task through an AsyncQueue.
+ **********************************************************************************************************************/
+static double runQueueTask (size_t count)
+{
+    EventLoop loop;
+    AsyncQueue<uint64_t> queue(loop);
+    loop.spawn(consumerTask(queue));
+    loop.spawn(producerTask(loop, queue, count));
+    auto start = std::chrono::steady_clock::now();
+    loop.run(running);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Fixes spread over BENCH_DEVICES devices, tracked by a hand-written loop over a table of devices.
+ **********************************************************************************************************************/
+static double runDevicesLoop (size_t count)
+{
+    std::vector<DeviceTrack> devices(BENCH_DEVICES, DeviceTrack{ 0, 0, 0 });
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        track(devices[i % devices.size()], (int64_t)(i / devices.size()) * 1000);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = devices[0].fixes;
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Fixes spread over BENCH_DEVICES devices, each tracked by its own task fed through its own queue.
+ *
+ * @param bytes Output heap bytes per device: its task frame, queue and track.
+ **********************************************************************************************************************/
+static double runDevicesTask (size_t count, size_t& bytes)
+{
+    EventLoop loop;
+    std::vector<std::unique_ptr<AsyncQueue<int64_t>>> queues;
+    std::vector<DeviceTrack> devices(BENCH_DEVICES, DeviceTrack{ 0, 0, 0 });
+    queues.reserve(BENCH_DEVICES);
+
+    size_t before = heapBytes();
+    for (size_t i = 0; i < BENCH_DEVICES; ++i)
+    {
+        queues.push_back(std::make_unique<AsyncQueue<int64_t>>(loop));
+        loop.spawn(deviceTask(*queues.back(), devices[i]));
+    }
+    bytes = (heapBytes() - before) / BENCH_DEVICES + sizeof(DeviceTrack);
+
+    // The first turn starts every device task, which then waits on its queue
+    loop.spawn(dispatchTask(loop, queues, count));
+    auto start = std::chrono::steady_clock::now();
+    loop.run(running);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = devices[0].fixes;
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief CPU time of tasks sleeping 1 ms BENCH_TIMER_ROUNDS times each, kept by a hand-written timer list.
+ **********************************************************************************************************************/
+static double runTimersLoop (size_t tasks)
+{
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::multimap<int64_t, size_t> timers;
+    std::vector<int> rounds(tasks, 0);
+    for (size_t i = 0; i < tasks; ++i)
+    {
+        timers.emplace(EventLoop::nowUs() + 1000, i);
+    }
+
+    double start = cpuSeconds();
+    struct epoll_event ev;
+    while (!timers.empty())
+    {
+        int timeoutMs = (int)std::max<int64_t>((timers.begin()->first - EventLoop::nowUs() + 999) / 1000, 0);
+        epoll_wait(epollFd, &ev, 1, timeoutMs);
+        int64_t now = EventLoop::nowUs();
+        while (!timers.empty() && (timers.begin()->first <= now))
+        {
+            size_t task = timers.begin()->second;
+            timers.erase(timers.begin());
+            if (++rounds[task] < BENCH_TIMER_ROUNDS)
+            {
+                timers.emplace(EventLoop::nowUs() + 1000, task);
+            }
+        }
+    }
+    double seconds = cpuSeconds() - start;
+    close(epollFd);
+    return seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief CPU time of as many tasks sleeping on the loop.
+ **********************************************************************************************************************/
+static double runTimersTask (size_t tasks)
+{
+    EventLoop loop;
+    for (size_t i = 0; i < tasks; ++i)
+    {
+        loop.spawn(timerTask(loop, BENCH_TIMER_ROUNDS));
+    }
+    double start = cpuSeconds();
+    loop.run(running);
+    return cpuSeconds() - start;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints one result line.
+ **********************************************************************************************************************/
+static void report (const char* name, size_t count, double seconds)
+{
+    std::cout << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << seconds * 1e9 / count << " ns/op " << std::setprecision(2) << std::setw(8)
+              << count / seconds / 1e6 << " M ops/s" << std::endl;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Compares the coroutine runtime of the receiver with the hand-written loop it replaced.
+ *
+ * "bench_runtime [operations]" runs each case with the given number of operations (1 million by default): eventfd
+ * wakeups through epoll, values handed over through a queue, fixes spread over BENCH_DEVICES per-device tasks, and
+ * BENCH_DEVICES timers of 1 ms, the last measured in CPU time. Each case runs on a hand-written loop and on the
+ * EventLoop; the per-device case also prints the heap bytes a device costs in either form.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if (count == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [operations]" << std::endl;
+        return 1;
+    }
+
+    report("eventfd wakeup, epoll loop", count, runEventfdLoop(count));
+    report("eventfd wakeup, task", count, runEventfdTask(count));
+    report("queue handoff, deque loop", count, runQueueLoop(count));
+    report("queue handoff, AsyncQueue tasks", count, runQueueTask(count));
+
+    size_t taskBytes;
+    report("per-device fixes, table loop", count, runDevicesLoop(count));
+    report("per-device fixes, device tasks", count, runDevicesTask(count, taskBytes));
+    std::cout << "per-device state: " << sizeof(DeviceTrack) << " bytes in the table, " << taskBytes
+              << " bytes per task with its frame and queue, " << BENCH_DEVICES << " devices" << std::endl;
+
+    size_t expiries = (size_t)BENCH_DEVICES * BENCH_TIMER_ROUNDS;
+    report("1 ms timers, CPU, timer list loop", expiries, runTimersLoop(BENCH_DEVICES));
+    report("1 ms timers, CPU, sleeping tasks", expiries, runTimersTask(BENCH_DEVICES));
+    return 0;
+}
@@ -0,0 +1,1157 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sqlite3.h>
+#include "../inc/gnss_trajectory.h"
+#include "../inc/gnss_hot_store.h"
+#include "../inc/gnss_archive.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_SEED              (1U)              /* Seed of the fleet and of the queries */
+#define BENCH_START_MS          (1767225600000LL) /* 2026-01-01T00:00:00Z */
+#define BENCH_INTERVAL_MS       (1000)            /* Time between two fixes of a vehicle */
+#define BENCH_BATCH_FIXES       (1000U)           /* Fixes per commit of a batched ingest */
+#define BENCH_UNBATCHED_FIXES   (2000U)           /* Fixes timed one commit each; the rest is loaded batched */
+#define BENCH_QUERIES           (4096U)           /* Distinct queries, repeated while a workload runs */
+#define BENCH_MIN_RUNS          (3U)              /* Queries run at least, even past the time budget */
+#define BENCH_MAX_RUNS          (100000U)         /* Queries run at most, bounding the latencies kept in memory */
+#define BENCH_RANGE_MS          (10 * 60 * 1000)  /* Time range of the per-device query */
+#define BENCH_WINDOW_MS         (5 * 60 * 1000)   /* Half the time window of the bounding box query */
+#define BENCH_BOX_DEGREES       (0.02)            /* Half the side of the bounding box, about 2 km */
+#define BENCH_DB_FILE           "bench_storage.db"
+#define BENCH_LOG_FILE          "bench_storage.log"
+#define BENCH_ARCHIVE_FILE      "bench_storage.arc"
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A generated fix, in the order a fleet reports them: all vehicles at one time, then the next time */
+struct BenchFix
+{
+    uint32_t vehicle;
+    uint32_t sequence;
+    GNSSFix fix;                /* Device ID left empty, see BenchData::devices */
+};
+
+struct BenchBox
+{
+    double minLat, maxLat, minLon, maxLon;
+};
+
+/* Parameters of the n-th query of each workload */
+struct BenchQuery
+{
+    uint32_t vehicle;
+    int64_t fromMs;             /* Per-device range */
+    int64_t toMs;
+    BenchBox box;               /* Around a fix of the fleet, within [windowFromMs, windowToMs] */
+    int64_t windowFromMs;
+    int64_t windowToMs;
+};
+
+struct BenchData
+{
+    std::vector<BenchFix> fixes;
+    std::vector<std::string> devices;
+    std::vector<BenchQuery> queries;
+    double seconds;             /* Time budget of each workload */
+};
+
+/* Per-device totals of the full-scan aggregation */
+struct BenchAggregate
+{
+    uint64_t count;
+    double speedSum;
+};
+
+/* One record of the binary log: a fix in fixed point, as in the hot store, with the number of its vehicle */
+struct LogRecord
+{
+    int64_t timestampMs;
+    int32_t latE7;
+    int32_t lonE7;
+    uint32_t vehicle;
+    uint16_t speedCentiKnots;
+    uint16_t courseCentiDeg;
+};
+
+/*
+ * SQLite with the schema of gnss_receiver, the raw sentence per row, or with a typed schema, one column per field
+ * and indexes on device and time. Pragmas are the defaults the receiver runs with.
+ */
+class SqliteBackend
+{
+public:
+    explicit SqliteBackend(bool typed);
+    ~SqliteBackend();
+
+    bool open();
+    bool append(const BenchData& data, size_t begin, size_t end);
+    bool finish() { return true; }
+    size_t latest(const BenchData& data, uint32_t vehicle);
+    size_t range(const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs);
+    size_t box(const BenchBox& box, int64_t fromMs, int64_t toMs);
+    size_t aggregate();
+    std::vector<std::string> files() const;
+
+private:
+    bool prepare(const char* sql, sqlite3_stmt*& statement);
+
+    bool typed;
+    sqlite3* db;
+    sqlite3_stmt* insert;
+    sqlite3_stmt* latestQuery;
+    sqlite3_stmt* rangeQuery;
+    sqlite3_stmt* boxQuery;
+    sqlite3_stmt* aggregateQuery;
+};
+
+/*
+ * Append-only file of fixed-size records in arrival order, memory mapped for the queries. The writer keeps the last
+ * record of each vehicle; everything else is found by binary search on time and a scan.
+ */
+class LogBackend
+{
+public:
+    LogBackend();
+    ~LogBackend();
+
+    bool open();
+    bool append(const BenchData& data, size_t begin, size_t end);
+    bool finish();
+    size_t latest(const BenchData& data, uint32_t vehicle);
+    size_t range(const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs);
+    size_t box(const BenchBox& box, int64_t fromMs, int64_t toMs);
+    size_t aggregate();
+    std::vector<std::string> files() const;
+
+private:
+    const LogRecord* lowerBound(int64_t fromMs) const;
+
+    int fd;
+    std::vector<LogRecord> buffer;
+    std::vector<uint64_t> lastRecord;       /* Per vehicle */
+    uint64_t records;
+    const LogRecord* mapped;
+};
+
+/*
+ * The archive of gnss_datagen, gnss_zonejoin and gnss_similar (inc/gnss_archive.h): per-device chunks of
+ * HOT_STORE_CHUNK_FIXES fixes in the compressed format of the hot store, then a directory of the time range and
+ * bounding box of each chunk, queried through the memory mapped reader.
+ */
+class ArchiveBackend
+{
+public:
+    bool open();
+    bool append(const BenchData& data, size_t begin, size_t end);
+    bool finish();
+    size_t latest(const BenchData& data, uint32_t vehicle);
+    size_t range(const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs);
+    size_t box(const BenchBox& box, int64_t fromMs, int64_t toMs);
+    size_t aggregate();
+    std::vector<std::string> files() const;
+
+private:
+    ArchiveWriter writer;
+    ArchiveReader reader;
+    std::vector<uint32_t> deviceOf;                 /* Archive device per vehicle, UINT32_MAX until its first fix */
+    std::vector<FixSample> samples;
+};
+
+/* The in-memory hot store of gnss_receiver, for reference; nothing is written to disk. */
+class HotStoreBackend
+{
+public:
+    bool open() { return true; }
+    bool append(const BenchData& data, size_t begin, size_t end);
+    bool finish();
+    size_t latest(const BenchData& data, uint32_t vehicle);
+    size_t range(const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs);
+    size_t box(const BenchBox& box, int64_t fromMs, int64_t toMs);
+    size_t aggregate();
+    std::vector<std::string> files() const { return std::vector<std::string>(); }
+
+private:
+    HotStore store;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void generateData(size_t vehicles, size_t fixes, double seconds, BenchData& data);
+static bool inBox(const BenchBox& box, double latitude, double longitude);
+static bool inBoxE7(const BenchBox& box, int32_t latE7, int32_t lonE7);
+static bool writeAll(int fd, const void* data, size_t size);
+static long statusKb(const char* field);
+static uint64_t diskBytes(const std::vector<std::string>& paths);
+static void removeFiles();
+static void report(const char* workload, const std::vector<double>& latenciesUs, size_t ops, size_t rows,
+                   double seconds, const char* unit);
+template <typename Query>
+static void runWorkload(const char* workload, const BenchData& data, size_t minRuns, Query query);
+template <typename Backend>
+static bool runBackend(const char* name, Backend& backend, const BenchData& data, bool batched);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an unopened backend with the receiver's schema or the typed schema.
+ **********************************************************************************************************************/
+SqliteBackend::SqliteBackend (bool typed)
+    : typed(typed), db(nullptr), insert(nullptr), latestQuery(nullptr), rangeQuery(nullptr), boxQuery(nullptr),
+      aggregateQuery(nullptr)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Finalizes the statements and closes the database.
+ **********************************************************************************************************************/
+SqliteBackend::~SqliteBackend ()
+{
+    sqlite3_finalize(insert);
+    sqlite3_finalize(latestQuery);
+    sqlite3_finalize(rangeQuery);
+    sqlite3_finalize(boxQuery);
+    sqlite3_finalize(aggregateQuery);
+    sqlite3_close(db);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the database and prepares the statements of all workloads.
+ **********************************************************************************************************************/
+bool SqliteBackend::open ()
+{
+    if (sqlite3_open(BENCH_DB_FILE, &db) != SQLITE_OK)
+    {
+        std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    if (!typed)
+    {
+        // As initDatabase() of the receiver; time and position are only in the sentence
+        return (sqlite3_exec(db, "CREATE TABLE GNSS_DATA(ID INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                 "NMEA_DATA TEXT NOT NULL, DEVICE TEXT, SEQ INTEGER);"
+                                 "CREATE UNIQUE INDEX GNSS_DATA_DEVICE_SEQ ON GNSS_DATA(DEVICE, SEQ);",
+                             nullptr, nullptr, nullptr) == SQLITE_OK) &&
+               prepare("INSERT OR IGNORE INTO GNSS_DATA (NMEA_DATA, DEVICE, SEQ) VALUES (?1, ?2, ?3);", insert) &&
+               prepare("SELECT NMEA_DATA FROM GNSS_DATA WHERE DEVICE = ?1 ORDER BY SEQ DESC LIMIT 1;", latestQuery) &&
+               prepare("SELECT NMEA_DATA FROM GNSS_DATA WHERE DEVICE = ?1;", rangeQuery) &&
+               prepare("SELECT NMEA_DATA FROM GNSS_DATA;", boxQuery) &&
+               prepare("SELECT DEVICE, NMEA_DATA FROM GNSS_DATA;", aggregateQuery);
+    }
+
+    return (sqlite3_exec(db, "CREATE TABLE GNSS_FIX(ID INTEGER PRIMARY KEY, DEVICE TEXT NOT NULL, SEQ INTEGER,"
+                             "TS INTEGER NOT NULL, LAT REAL, LON REAL, SPEED REAL, COURSE REAL);"
+                             "CREATE INDEX GNSS_FIX_DEVICE_TS ON GNSS_FIX(DEVICE, TS);"
+                             "CREATE INDEX GNSS_FIX_TS ON GNSS_FIX(TS);",
+                         nullptr, nullptr, nullptr) == SQLITE_OK) &&
+           prepare("INSERT INTO GNSS_FIX (DEVICE, SEQ, TS, LAT, LON, SPEED, COURSE) "
+                   "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);", insert) &&
+           prepare("SELECT TS, LAT, LON FROM GNSS_FIX WHERE DEVICE = ?1 ORDER BY TS DESC LIMIT 1;", latestQuery) &&
+           prepare("SELECT TS, LAT, LON FROM GNSS_FIX WHERE DEVICE = ?1 AND TS BETWEEN ?2 AND ?3;", rangeQuery) &&
+           prepare("SELECT DEVICE, TS FROM GNSS_FIX WHERE TS BETWEEN ?1 AND ?2 AND LAT BETWEEN ?3 AND ?4 "
+                   "AND LON BETWEEN ?5 AND ?6;", boxQuery) &&
+           prepare("SELECT DEVICE, COUNT(*), AVG(SPEED) FROM GNSS_FIX GROUP BY DEVICE;", aggregateQuery);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Inserts fixes [begin, end) in one transaction.
+ **********************************************************************************************************************/
+bool SqliteBackend::append (const BenchData& data, size_t begin, size_t end)
+{
+    char sentence[GPRMC_MAX_LENGTH];
+    bool ok = (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+    for (size_t i = begin; ok && (i < end); ++i)
+    {
+        const BenchFix& fix = data.fixes[i];
+        const std::string& device = data.devices[fix.vehicle];
+        if (typed)
+        {
+            sqlite3_bind_text(insert, 1, device.data(), (int)device.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(insert, 2, fix.sequence);
+            sqlite3_bind_int64(insert, 3, fix.fix.timestampMs);
+            sqlite3_bind_double(insert, 4, fix.fix.latitude);
+            sqlite3_bind_double(insert, 5, fix.fix.longitude);
+            sqlite3_bind_double(insert, 6, fix.fix.speedKnots);
+            sqlite3_bind_double(insert, 7, fix.fix.course);
+        }
+        else
+        {
+            sqlite3_bind_text(insert, 1, sentence, (int)formatGPRMC(fix.fix, sentence), SQLITE_STATIC);
+            sqlite3_bind_text(insert, 2, device.data(), (int)device.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(insert, 3, fix.sequence);
+        }
+        ok = (sqlite3_step(insert) == SQLITE_DONE);
+        sqlite3_reset(insert);
+    }
+
+    ok = (sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr) == SQLITE_OK) && ok;
+    if (!ok)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+    }
+    return ok;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Looks up the newest fix of a vehicle.
+ *
+ * @return 1 if the vehicle has a fix, 0 otherwise.
+ **********************************************************************************************************************/
+size_t SqliteBackend::latest (const BenchData& data, uint32_t vehicle)
+{
+    const std::string& device = data.devices[vehicle];
+    GNSSFix fix;
+    size_t rows = 0;
+
+    sqlite3_bind_text(latestQuery, 1, device.data(), (int)device.size(), SQLITE_STATIC);
+    if (sqlite3_step(latestQuery) == SQLITE_ROW)
+    {
+        rows = typed ? 1 : parseGPRMC(reinterpret_cast<const char*>(sqlite3_column_text(latestQuery, 0)), fix);
+    }
+    sqlite3_reset(latestQuery);
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of a vehicle in a time range; the receiver's schema has to parse all fixes of the vehicle.
+ **********************************************************************************************************************/
+size_t SqliteBackend::range (const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs)
+{
+    const std::string& device = data.devices[vehicle];
+    GNSSFix fix;
+    size_t rows = 0;
+
+    sqlite3_bind_text(rangeQuery, 1, device.data(), (int)device.size(), SQLITE_STATIC);
+    if (typed)
+    {
+        sqlite3_bind_int64(rangeQuery, 2, fromMs);
+        sqlite3_bind_int64(rangeQuery, 3, toMs);
+    }
+    while (sqlite3_step(rangeQuery) == SQLITE_ROW)
+    {
+        if (typed)
+        {
+            ++rows;
+        }
+        else if (parseGPRMC(reinterpret_cast<const char*>(sqlite3_column_text(rangeQuery, 0)), fix) &&
+                 (fix.timestampMs >= fromMs) && (fix.timestampMs <= toMs))
+        {
+            ++rows;
+        }
+    }
+    sqlite3_reset(rangeQuery);
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of all vehicles inside a box and a time window.
+ **********************************************************************************************************************/
+size_t SqliteBackend::box (const BenchBox& box, int64_t fromMs, int64_t toMs)
+{
+    GNSSFix fix;
+    size_t rows = 0;
+
+    if (typed)
+    {
+        sqlite3_bind_int64(boxQuery, 1, fromMs);
+        sqlite3_bind_int64(boxQuery, 2, toMs);
+        sqlite3_bind_double(boxQuery, 3, box.minLat);
+        sqlite3_bind_double(boxQuery, 4, box.maxLat);
+        sqlite3_bind_double(boxQuery, 5, box.minLon);
+        sqlite3_bind_double(boxQuery, 6, box.maxLon);
+    }
+    while (sqlite3_step(boxQuery) == SQLITE_ROW)
+    {
+        if (typed)
+        {
+            ++rows;
+        }
+        else if (parseGPRMC(reinterpret_cast<const char*>(sqlite3_column_text(boxQuery, 0)), fix) &&
+                 (fix.timestampMs >= fromMs) && (fix.timestampMs <= toMs) &&
+                 inBox(box, fix.latitude, fix.longitude))
+        {
+            ++rows;
+        }
+    }
+    sqlite3_reset(boxQuery);
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes and averages the speed of every vehicle.
+ *
+ * @return Number of fixes aggregated.
+ **********************************************************************************************************************/
+size_t SqliteBackend::aggregate ()
+{
+    std::unordered_map<std::string, BenchAggregate> totals;
+    GNSSFix fix;
+    size_t rows = 0;
+
+    while (sqlite3_step(aggregateQuery) == SQLITE_ROW)
+    {
+        std::string device = reinterpret_cast<const char*>(sqlite3_column_text(aggregateQuery, 0));
+        BenchAggregate& total = totals[device];
+        if (typed)
+        {
+            total.count = sqlite3_column_int64(aggregateQuery, 1);
+            total.speedSum = sqlite3_column_double(aggregateQuery, 2) * total.count;
+            rows += total.count;
+        }
+        else if (parseGPRMC(reinterpret_cast<const char*>(sqlite3_column_text(aggregateQuery, 1)), fix))
+        {
+            ++total.count;
+            total.speedSum += fix.speedKnots;
+            ++rows;
+        }
+    }
+    sqlite3_reset(aggregateQuery);
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Files the database may take on disk.
+ **********************************************************************************************************************/
+std::vector<std::string> SqliteBackend::files () const
+{
+    return std::vector<std::string>{BENCH_DB_FILE, BENCH_DB_FILE "-journal", BENCH_DB_FILE "-wal"};
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prepares a statement, reporting errors.
+ **********************************************************************************************************************/
+bool SqliteBackend::prepare (const char* sql, sqlite3_stmt*& statement)
+{
+    if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates an unopened log.
+ **********************************************************************************************************************/
+LogBackend::LogBackend ()
+    : fd(-1), records(0), mapped(nullptr)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Unmaps and closes the log.
+ **********************************************************************************************************************/
+LogBackend::~LogBackend ()
+{
+    if (mapped != nullptr)
+    {
+        munmap(const_cast<LogRecord*>(mapped), records * sizeof(LogRecord));
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the log file.
+ **********************************************************************************************************************/
+bool LogBackend::open ()
+{
+    fd = ::open(BENCH_LOG_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Unable to create " << BENCH_LOG_FILE << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends fixes [begin, end) in one write and makes them durable.
+ **********************************************************************************************************************/
+bool LogBackend::append (const BenchData& data, size_t begin, size_t end)
+{
+    buffer.clear();
+    for (size_t i = begin; i < end; ++i)
+    {
+        const BenchFix& fix = data.fixes[i];
+        FixSample sample = toFixSample(fix.fix);
+        buffer.push_back(LogRecord{sample.timestampMs, sample.latE7, sample.lonE7, fix.vehicle,
+                                   sample.speedCentiKnots, sample.courseCentiDeg});
+        if (fix.vehicle >= lastRecord.size())
+        {
+            lastRecord.resize(fix.vehicle + 1, UINT64_MAX);
+        }
+        lastRecord[fix.vehicle] = records + (i - begin);
+    }
+    records += buffer.size();
+    return writeAll(fd, buffer.data(), buffer.size() * sizeof(LogRecord)) && (fdatasync(fd) == 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Maps the log for reading.
+ **********************************************************************************************************************/
+bool LogBackend::finish ()
+{
+    void* address = mmap(nullptr, records * sizeof(LogRecord), PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        std::cerr << "Unable to map " << BENCH_LOG_FILE << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mapped = static_cast<const LogRecord*>(address);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Looks up the newest fix of a vehicle through the last record the writer kept.
+ **********************************************************************************************************************/
+size_t LogBackend::latest (const BenchData&, uint32_t vehicle)
+{
+    return ((vehicle < lastRecord.size()) && (lastRecord[vehicle] != UINT64_MAX) &&
+            (mapped[lastRecord[vehicle]].vehicle == vehicle)) ? 1 : 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of a vehicle in a time range, scanning the records of all vehicles in that range.
+ **********************************************************************************************************************/
+size_t LogBackend::range (const BenchData&, uint32_t vehicle, int64_t fromMs, int64_t toMs)
+{
+    size_t rows = 0;
+    for (const LogRecord* record = lowerBound(fromMs);
+         (record < mapped + records) && (record->timestampMs <= toMs); ++record)
+    {
+        rows += (record->vehicle == vehicle) ? 1 : 0;
+    }
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of all vehicles inside a box and a time window.
+ **********************************************************************************************************************/
+size_t LogBackend::box (const BenchBox& box, int64_t fromMs, int64_t toMs)
+{
+    size_t rows = 0;
+    for (const LogRecord* record = lowerBound(fromMs);
+         (record < mapped + records) && (record->timestampMs <= toMs); ++record)
+    {
+        rows += inBoxE7(box, record->latE7, record->lonE7) ? 1 : 0;
+    }
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes and sums the speed of every vehicle.
+ **********************************************************************************************************************/
+size_t LogBackend::aggregate ()
+{
+    std::vector<BenchAggregate> totals(lastRecord.size(), BenchAggregate{0, 0.0});
+    for (const LogRecord* record = mapped; record < mapped + records; ++record)
+    {
+        ++totals[record->vehicle].count;
+        totals[record->vehicle].speedSum += record->speedCentiKnots / 100.0;
+    }
+    return records;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Files the log takes on disk.
+ **********************************************************************************************************************/
+std::vector<std::string> LogBackend::files () const
+{
+    return std::vector<std::string>{BENCH_LOG_FILE};
+}
+
+/*******************************************************************************************************************//**
+ * @brief First record at or after a time; the log is in arrival order, which is time order for a live fleet.
+ **********************************************************************************************************************/
+const LogRecord* LogBackend::lowerBound (int64_t fromMs) const
+{
+    return std::lower_bound(mapped, mapped + records, fromMs,
+                            [](const LogRecord& record, int64_t timeMs) { return record.timestampMs < timeMs; });
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the archive file.
+ **********************************************************************************************************************/
+bool ArchiveBackend::open ()
+{
+    return writer.open(BENCH_ARCHIVE_FILE);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds fixes [begin, end) to the open chunks and makes the chunks that filled up durable.
+ *
+ * As in the hot store, the fixes of the open chunks are only in memory until their chunk is full.
+ **********************************************************************************************************************/
+bool ArchiveBackend::append (const BenchData& data, size_t begin, size_t end)
+{
+    uint64_t written = writer.size();
+    for (size_t i = begin; i < end; ++i)
+    {
+        const BenchFix& fix = data.fixes[i];
+        if (fix.vehicle >= deviceOf.size())
+        {
+            deviceOf.resize(fix.vehicle + 1, UINT32_MAX);
+        }
+        if (deviceOf[fix.vehicle] == UINT32_MAX)
+        {
+            deviceOf[fix.vehicle] = writer.device(data.devices[fix.vehicle]);
+        }
+        if (!writer.append(deviceOf[fix.vehicle], toFixSample(fix.fix)))
+        {
+            return false;
+        }
+    }
+    return (writer.size() == written) || writer.sync();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Seals the partial chunks, writes the directory durably and maps the archive for the queries.
+ **********************************************************************************************************************/
+bool ArchiveBackend::finish ()
+{
+    return writer.close() && reader.open(BENCH_ARCHIVE_FILE);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Looks up the newest fix of a vehicle, decompressing its last chunk.
+ **********************************************************************************************************************/
+size_t ArchiveBackend::latest (const BenchData&, uint32_t vehicle)
+{
+    if ((vehicle >= deviceOf.size()) || (deviceOf[vehicle] == UINT32_MAX))
+    {
+        return 0;
+    }
+    size_t last = reader.firstChunk(deviceOf[vehicle] + 1);
+    return ((last > reader.firstChunk(deviceOf[vehicle])) && reader.read(reader.chunks()[last - 1], samples) &&
+            !samples.empty()) ? 1 : 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of a vehicle in a time range, decompressing only the chunks that overlap it.
+ **********************************************************************************************************************/
+size_t ArchiveBackend::range (const BenchData&, uint32_t vehicle, int64_t fromMs, int64_t toMs)
+{
+    size_t rows = 0;
+    if ((vehicle >= deviceOf.size()) || (deviceOf[vehicle] == UINT32_MAX))
+    {
+        return 0;
+    }
+
+    const std::vector<ArchiveChunk>& directory = reader.chunks();
+    for (size_t index = reader.firstChunk(deviceOf[vehicle]); index < reader.firstChunk(deviceOf[vehicle] + 1);
+         ++index)
+    {
+        const ArchiveChunk& chunk = directory[index];
+        if ((chunk.lastMs < fromMs) || (chunk.firstMs > toMs) || !reader.read(chunk, samples))
+        {
+            continue;
+        }
+        for (const FixSample& sample : samples)
+        {
+            rows += ((sample.timestampMs >= fromMs) && (sample.timestampMs <= toMs)) ? 1 : 0;
+        }
+    }
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes inside a box and a time window, skipping the chunks whose time range or bounding box
+ *        misses them.
+ **********************************************************************************************************************/
+size_t ArchiveBackend::box (const BenchBox& box, int64_t fromMs, int64_t toMs)
+{
+    size_t rows = 0;
+    for (const ArchiveChunk& chunk : reader.chunks())
+    {
+        if ((chunk.lastMs < fromMs) || (chunk.firstMs > toMs) ||
+            (chunk.maxLatE7 * 1e-7 < box.minLat) || (chunk.minLatE7 * 1e-7 > box.maxLat) ||
+            (chunk.maxLonE7 * 1e-7 < box.minLon) || (chunk.minLonE7 * 1e-7 > box.maxLon) ||
+            !reader.read(chunk, samples))
+        {
+            continue;
+        }
+        for (const FixSample& sample : samples)
+        {
+            rows += ((sample.timestampMs >= fromMs) && (sample.timestampMs <= toMs) &&
+                     inBoxE7(box, sample.latE7, sample.lonE7)) ? 1 : 0;
+        }
+    }
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes and sums the speed of every vehicle, decompressing every chunk.
+ **********************************************************************************************************************/
+size_t ArchiveBackend::aggregate ()
+{
+    std::vector<BenchAggregate> totals(reader.devices().size(), BenchAggregate{0, 0.0});
+    size_t rows = 0;
+    for (const ArchiveChunk& chunk : reader.chunks())
+    {
+        if (reader.read(chunk, samples))
+        {
+            for (const FixSample& sample : samples)
+            {
+                totals[chunk.device].speedSum += sample.speedCentiKnots / 100.0;
+            }
+            totals[chunk.device].count += samples.size();
+            rows += samples.size();
+        }
+    }
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Files the archive takes on disk.
+ **********************************************************************************************************************/
+std::vector<std::string> ArchiveBackend::files () const
+{
+    return std::vector<std::string>{BENCH_ARCHIVE_FILE};
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends fixes [begin, end), as the receiver does for every stored fix.
+ **********************************************************************************************************************/
+bool HotStoreBackend::append (const BenchData& data, size_t begin, size_t end)
+{
+    GNSSFix fix;
+    for (size_t i = begin; i < end; ++i)
+    {
+        fix = data.fixes[i].fix;
+        fix.deviceId = data.devices[data.fixes[i].vehicle];
+        store.append(fix);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Waits until the sealer has compressed all full chunks, so the queries see the steady state.
+ **********************************************************************************************************************/
+bool HotStoreBackend::finish ()
+{
+    store.drain();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Looks up the newest fix of a vehicle; the store has no index for it, so all its chunks are visited.
+ **********************************************************************************************************************/
+size_t HotStoreBackend::latest (const BenchData& data, uint32_t vehicle)
+{
+    size_t rows = 0;
+    store.scan(data.devices[vehicle], INT64_MIN, INT64_MAX, [&rows](const GNSSFix&) { rows = 1; });
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes of a vehicle in a time range.
+ **********************************************************************************************************************/
+size_t HotStoreBackend::range (const BenchData& data, uint32_t vehicle, int64_t fromMs, int64_t toMs)
+{
+    return store.scan(data.devices[vehicle], fromMs, toMs, [](const GNSSFix&) {});
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes inside a box and a time window, visiting the time window of every vehicle.
+ **********************************************************************************************************************/
+size_t HotStoreBackend::box (const BenchBox& box, int64_t fromMs, int64_t toMs)
+{
+    size_t rows = 0;
+    store.scanAll(fromMs, toMs, [&box, &rows](const GNSSFix& fix) {
+        rows += inBox(box, fix.latitude, fix.longitude) ? 1 : 0;
+    });
+    return rows;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts the fixes and sums the speed of every vehicle.
+ **********************************************************************************************************************/
+size_t HotStoreBackend::aggregate ()
+{
+    std::unordered_map<std::string, BenchAggregate> totals;
+    return store.scanAll(INT64_MIN, INT64_MAX, [&totals](const GNSSFix& fix) {
+        BenchAggregate& total = totals[fix.deviceId];
+        ++total.count;
+        total.speedSum += fix.speedKnots;
+    });
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Simulates the fleet with the trajectory model of gnss_datagen and draws the queries.
+ **********************************************************************************************************************/
+static void generateData (size_t vehicles, size_t fixes, double seconds, BenchData& data)
+{
+    std::vector<TrajectoryModel> models;
+    models.reserve(vehicles);
+    data.devices.resize(vehicles);
+    for (size_t v = 0; v < vehicles; ++v)
+    {
+        models.emplace_back(BENCH_SEED, v, BENCH_START_MS);
+        char name[32];
+        std::snprintf(name, sizeof(name), "veh%06zu", v);
+        data.devices[v] = name;
+    }
+
+    data.fixes.resize(vehicles * fixes);
+    for (size_t s = 0; s < fixes; ++s)
+    {
+        for (size_t v = 0; v < vehicles; ++v)
+        {
+            BenchFix& fix = data.fixes[s * vehicles + v];
+            fix.vehicle = (uint32_t)v;
+            fix.sequence = (uint32_t)(s + 1);
+            models[v].step((s == 0) ? 0 : BENCH_INTERVAL_MS, fix.fix);
+        }
+    }
+
+    FastRandom random(BENCH_SEED);
+    int64_t spanMs = (int64_t)(fixes - 1) * BENCH_INTERVAL_MS;
+    data.queries.resize(BENCH_QUERIES);
+    for (BenchQuery& query : data.queries)
+    {
+        query.vehicle = (uint32_t)(random.next() % vehicles);
+        query.fromMs = BENCH_START_MS + (int64_t)(random.uniform() * std::max<int64_t>(0, spanMs - BENCH_RANGE_MS));
+        query.toMs = query.fromMs + BENCH_RANGE_MS;
+
+        // A box around where some vehicle was at some time, so that it is not empty
+        const GNSSFix& centre = data.fixes[random.next() % data.fixes.size()].fix;
+        query.box = BenchBox{centre.latitude - BENCH_BOX_DEGREES, centre.latitude + BENCH_BOX_DEGREES,
+                             centre.longitude - BENCH_BOX_DEGREES, centre.longitude + BENCH_BOX_DEGREES};
+        query.windowFromMs = centre.timestampMs - BENCH_WINDOW_MS;
+        query.windowToMs = centre.timestampMs + BENCH_WINDOW_MS;
+    }
+    data.seconds = seconds;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a position is inside a box.
+ **********************************************************************************************************************/
+static bool inBox (const BenchBox& box, double latitude, double longitude)
+{
+    return (latitude >= box.minLat) && (latitude <= box.maxLat) && (longitude >= box.minLon) &&
+           (longitude <= box.maxLon);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a fixed-point position is inside a box.
+ **********************************************************************************************************************/
+static bool inBoxE7 (const BenchBox& box, int32_t latE7, int32_t lonE7)
+{
+    return inBox(box, latE7 * 1e-7, lonE7 * 1e-7);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a whole buffer, retrying short writes.
+ **********************************************************************************************************************/
+static bool writeAll (int fd, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "Write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief A memory figure of this process from /proc/self/status, in kB, or -1 if there is none.
+ **********************************************************************************************************************/
+static long statusKb (const char* field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t length = std::strlen(field);
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, length, field) == 0)
+        {
+            return std::strtol(line.c_str() + length, nullptr, 10);
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bytes allocated on disk for the files that exist.
+ **********************************************************************************************************************/
+static uint64_t diskBytes (const std::vector<std::string>& paths)
+{
+    uint64_t bytes = 0;
+    for (const std::string& path : paths)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0)
+        {
+            bytes += (uint64_t)info.st_blocks * 512;
+        }
+    }
+    return bytes;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes the files of all backends.
+ **********************************************************************************************************************/
+static void removeFiles ()
+{
+    static const char* paths[] = {BENCH_DB_FILE, BENCH_DB_FILE "-journal", BENCH_DB_FILE "-wal", BENCH_LOG_FILE,
+                                  BENCH_ARCHIVE_FILE};
+    for (const char* path : paths)
+    {
+        unlink(path);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints one result line: operations, throughput in operations and rows, latency percentiles, rows per
+ *        operation.
+ **********************************************************************************************************************/
+static void report (const char* workload, const std::vector<double>& latenciesUs, size_t ops, size_t rows,
+                    double seconds, const char* unit)
+{
+    std::vector<double> sorted(latenciesUs);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+    };
+
+    std::cout << "  " << std::left << std::setw(14) << workload << std::right << std::fixed << std::setprecision(0)
+              << std::setw(8) << ops << " " << std::left << std::setw(8) << unit << std::right << std::setw(10)
+              << ops / seconds << " /s " << std::setw(11) << rows / seconds << " fixes/s  p50 " << std::setprecision(1)
+              << std::setw(9) << percentile(0.5) << "  p99 " << std::setw(9) << percentile(0.99) << "  p99.9 "
+              << std::setw(9) << percentile(0.999) << " us " << std::setw(9) << (double)rows / ops << " fixes each"
+              << std::endl;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Runs the queries of a workload in turn until the time budget is spent or BENCH_MAX_RUNS ran, and reports
+ *        them.
+ **********************************************************************************************************************/
+template <typename Query>
+static void runWorkload (const char* workload, const BenchData& data, size_t minRuns, Query query)
+{
+    std::vector<double> latenciesUs;
+    latenciesUs.reserve(BENCH_MAX_RUNS);
+    size_t rows = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(data.seconds);
+    auto now = start;
+
+    for (size_t i = 0; (i < minRuns) || ((now < deadline) && (i < BENCH_MAX_RUNS)); ++i)
+    {
+        auto before = now;
+        rows += query(data.queries[i % data.queries.size()]);
+        now = std::chrono::steady_clock::now();
+        latenciesUs.push_back(std::chrono::duration<double, std::micro>(now - before).count());
+    }
+    report(workload, latenciesUs, latenciesUs.size(), rows, std::chrono::duration<double>(now - start).count(),
+           "queries");
+}
+
+/*******************************************************************************************************************//**
+ * @brief Ingests the fleet into a backend, runs the workloads on it and reports them with its size on disk and the
+ *        memory it took.
+ *
+ * A batched ingest commits BENCH_BATCH_FIXES fixes at a time; an unbatched one commits every fix, for the first
+ * BENCH_UNBATCHED_FIXES fixes only, and loads the rest batched for the queries. Latencies are per commit.
+ **********************************************************************************************************************/
+template <typename Backend>
+static bool runBackend (const char* name, Backend& backend, const BenchData& data, bool batched)
+{
+    long startKb = statusKb("VmRSS:");
+    std::cout << name << std::endl;
+    if (!backend.open())
+    {
+        return false;
+    }
+
+    std::vector<double> latenciesUs;
+    size_t total = data.fixes.size();
+    size_t timed = batched ? total : std::min<size_t>(total, BENCH_UNBATCHED_FIXES);
+    size_t step = batched ? BENCH_BATCH_FIXES : 1;
+    auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    for (size_t begin = 0; begin < timed; begin += step)
+    {
+        auto before = now;
+        if (!backend.append(data, begin, std::min(begin + step, timed)))
+        {
+            return false;
+        }
+        now = std::chrono::steady_clock::now();
+        latenciesUs.push_back(std::chrono::duration<double, std::micro>(now - before).count());
+    }
+    report("ingest", latenciesUs, latenciesUs.size(), timed, std::chrono::duration<double>(now - start).count(),
+           "commits");
+
+    for (size_t begin = timed; begin < total; begin += BENCH_BATCH_FIXES)
+    {
+        if (!backend.append(data, begin, std::min<size_t>(begin + BENCH_BATCH_FIXES, total)))
+        {
+            return false;
+        }
+    }
+    if (!backend.finish())
+    {
+        return false;
+    }
+
+    runWorkload("latest", data, BENCH_MIN_RUNS, [&backend, &data](const BenchQuery& query) {
+        return backend.latest(data, query.vehicle);
+    });
+    runWorkload("device range", data, BENCH_MIN_RUNS, [&backend, &data](const BenchQuery& query) {
+        return backend.range(data, query.vehicle, query.fromMs, query.toMs);
+    });
+    runWorkload("box x window", data, BENCH_MIN_RUNS, [&backend](const BenchQuery& query) {
+        return backend.box(query.box, query.windowFromMs, query.windowToMs);
+    });
+    runWorkload("full scan", data, BENCH_MIN_RUNS, [&backend](const BenchQuery&) { return backend.aggregate(); });
+
+    uint64_t bytes = diskBytes(backend.files());
+    std::cout << "  " << std::left << std::setw(14) << "footprint" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << bytes / 1e6 << " MB on disk, " << (double)bytes / total << " bytes per fix, RSS "
+              << (statusKb("VmHWM:") - startKb) / 1e3 << " MB over the fleet data" << std::endl;
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Compares the ways fixes can be stored on the same fleet and the same queries.
+ *
+ * "bench_storage [vehicles] [fixes] [seconds]" simulates the given number of vehicles (200 by default) for the given
+ * number of fixes each (1800, half an hour at 1 Hz), then for each backend in a fresh child process ingests them and
+ * runs every workload for the given number of seconds (1 by default):
+ *   latest        newest fix of a vehicle
+ *   device range  fixes of a vehicle within 10 minutes
+ *   box x window  fixes of all vehicles within about 2 km of a point and 5 minutes of a time
+ *   full scan     fix count and mean speed per vehicle
+ * Files are created in the working directory and removed afterwards; the disk has to be a real one for the commit
+ * latencies to mean anything.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t vehicles = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+    size_t fixes = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1800;
+    double seconds = (argc > 3) ? std::strtod(argv[3], nullptr) : 1.0;
+    if ((vehicles == 0) || (fixes == 0) || !(seconds > 0.0))
+    {
+        std::cerr << "Usage: " << argv[0] << " [vehicles] [fixes] [seconds]" << std::endl;
+        return 1;
+    }
+
+    BenchData data;
+    generateData(vehicles, fixes, seconds, data);
+    std::cout << vehicles << " vehicles x " << fixes << " fixes = " << data.fixes.size() << " fixes" << std::endl;
+
+    static const char* names[] = {
+        "sqlite, receiver schema, unbatched",
+        "sqlite, receiver schema, batched",
+        "sqlite, typed schema, unbatched",
+        "sqlite, typed schema, batched",
+        "mmap binary log",
+        "compressed archive",
+        "hot store (memory)",
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        // Each backend runs in its own process, so that its memory is measured alone
+        removeFiles();
+        std::cout.flush();
+        pid_t child = fork();
+        if (child == 0)
+        {
+            bool done = false;
+            if (i < 4)
+            {
+                SqliteBackend backend(i >= 2);
+                done = runBackend(names[i], backend, data, (i % 2) == 1);
+            }
+            else if (i == 4)
+            {
+                LogBackend backend;
+                done = runBackend(names[i], backend, data, true);
+            }
+            else if (i == 5)
+            {
+                ArchiveBackend backend;
+                done = runBackend(names[i], backend, data, true);
+            }
+            else
+            {
+                HotStoreBackend backend;
+                done = runBackend(names[i], backend, data, true);
+            }
+            std::cout.flush();
+            _exit(done ? 0 : 1);
+        }
+
+        int status = 0;
+        if ((child < 0) || (waitpid(child, &status, 0) != child) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        {
+            std::cerr << "Backend " << names[i] << " failed" << std::endl;
+            ok = false;
+        }
+    }
+    removeFiles();
+
+    return ok ? 0 : 1;
+}
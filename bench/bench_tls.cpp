@@ -0,0 +1,394 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/rsa.h>
+#include "../inc/gnss_tls.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BENCH_TOPIC             "gnss/data/bench"
+#define BENCH_SENTENCE          "$GPRMC,123519.00,A,4807.038000,N,01131.000000,E,0.0,0.0,230394,0.0,W,A*6A"
+#define SERVER_KEY_BITS         (2048)            /* RSA key of the in-process broker, the usual size of broker certs */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+struct HandshakeResult
+{
+    uint64_t handshakes;        /* Completed on the client */
+    uint64_t resumed;           /* Of which resumed a previous session */
+    double seconds;             /* Wall time of all connections */
+    double serverCpuUs;         /* Server thread CPU time per handshake */
+};
+
+struct MessageResult
+{
+    double seconds;             /* From the first write to the last byte read by the server */
+    uint64_t wireBytes;         /* Bytes the client wrote to the socket */
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static SSL_CTX* makeServerContext();
+static int listenLoopback(uint16_t& port);
+static int connectLoopback(uint16_t port);
+static double threadCpuUs();
+static std::string makePublishPacket();
+static HandshakeResult runHandshakes(SSL_CTX* server, int listener, uint16_t port, int version, bool resume,
+                                     size_t count);
+static MessageResult runMessages(SSL_CTX* server, int listener, uint16_t port, int version, size_t count);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates the broker side context with a self-signed certificate generated in memory.
+ *
+ * It keeps the OpenSSL defaults of a broker: a server session cache for TLS 1.2 and session tickets for both versions.
+ **********************************************************************************************************************/
+static SSL_CTX* makeServerContext ()
+{
+    EVP_PKEY* key = EVP_RSA_gen(SERVER_KEY_BITS);
+    X509* cert = X509_new();
+    if ((key == NULL) || (cert == NULL))
+    {
+        return NULL;
+    }
+
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    if ((ctx != NULL) && ((SSL_CTX_use_certificate(ctx, cert) != 1) || (SSL_CTX_use_PrivateKey(ctx, key) != 1)))
+    {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Opens a listening socket on an ephemeral loopback port.
+ **********************************************************************************************************************/
+static int listenLoopback (uint16_t& port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if ((fd < 0) || (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(fd, 128) != 0) ||
+        (getsockname(fd, (struct sockaddr*)&addr, &len) != 0))
+    {
+        std::cerr << "Unable to listen on loopback: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Connects a TCP socket to the loopback port, without Nagle like libmosquitto.
+ **********************************************************************************************************************/
+static int connectLoopback (uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*******************************************************************************************************************//**
+ * @brief CPU time of the calling thread in microseconds.
+ **********************************************************************************************************************/
+static double threadCpuUs ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*******************************************************************************************************************//**
+ * @brief A QoS 0 PUBLISH packet carrying one fix, as the sender writes it.
+ **********************************************************************************************************************/
+static std::string makePublishPacket ()
+{
+    std::string topic = BENCH_TOPIC;
+    std::string payload = BENCH_SENTENCE;
+    size_t remaining = 2 + topic.size() + payload.size();
+
+    std::string packet;
+    packet += (char)0x30;
+    packet += (char)remaining;      // Below 128, one length byte
+    packet += (char)(topic.size() >> 8);
+    packet += (char)(topic.size() & 0xFF);
+    packet += topic;
+    packet += payload;
+    return packet;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Connects, handshakes and disconnects count times, as a fleet reconnecting to a restarted broker.
+ *
+ * The client side is a TlsSession, so the resumed handshakes go through the same new-session and handshake-start
+ * callbacks as the sender and the receiver. The server writes one byte after each handshake; reading it makes the
+ * client process the TLS 1.3 tickets, which arrive after the handshake.
+ **********************************************************************************************************************/
+static HandshakeResult runHandshakes (SSL_CTX* server, int listener, uint16_t port, int version, bool resume,
+                                      size_t count)
+{
+    HandshakeResult result = { 0, 0, 0.0, 0.0 };
+    TlsConfig config;
+    initTlsConfig(config);
+    config.caFile = "-";        // Enables TLS; the bench does not verify the self-signed certificate
+    config.resume = resume;
+    TlsSession client;
+    if (!client.init(config))
+    {
+        return result;
+    }
+    SSL_CTX_set_min_proto_version(client.context(), version);
+    SSL_CTX_set_max_proto_version(client.context(), version);
+
+    double serverCpuUs = 0.0;
+    std::thread acceptor([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            int fd = accept(listener, NULL, NULL);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            SSL* ssl = SSL_new(server);
+            SSL_set_fd(ssl, fd);
+            double cpu = threadCpuUs();
+            if (SSL_accept(ssl) == 1)
+            {
+                serverCpuUs += threadCpuUs() - cpu;
+                char byte = 0;
+                SSL_write(ssl, &byte, 1);
+                while (SSL_read(ssl, &byte, 1) > 0)
+                {
+                }
+            }
+            SSL_free(ssl);
+            close(fd);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        int fd = connectLoopback(port);
+        SSL* ssl = SSL_new(client.context());
+        SSL_set_fd(ssl, fd);
+        char byte;
+        if ((SSL_connect(ssl) == 1) && (SSL_read(ssl, &byte, 1) == 1))
+        {
+            SSL_shutdown(ssl);
+        }
+        SSL_free(ssl);
+        close(fd);
+    }
+    acceptor.join();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.handshakes = client.handshakes();
+    result.resumed = client.resumed();
+    result.serverCpuUs = (count > 0) ? serverCpuUs / count : 0.0;
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes count PUBLISH packets over one connection, TLS when version is non-zero, and times their delivery.
+ *
+ * Each packet is a write of its own, as libmosquitto does without batching, so each one costs a TLS record.
+ **********************************************************************************************************************/
+static MessageResult runMessages (SSL_CTX* server, int listener, uint16_t port, int version, size_t count)
+{
+    MessageResult result = { 0.0, 0 };
+    std::string packet = makePublishPacket();
+    size_t expected = packet.size() * count;
+
+    TlsConfig config;
+    initTlsConfig(config);
+    config.caFile = "-";
+    TlsSession client;
+    if ((version != 0) && !client.init(config))
+    {
+        return result;
+    }
+
+    std::atomic<bool> done(false);
+    std::thread reader([&]()
+    {
+        int fd = accept(listener, NULL, NULL);
+        SSL* ssl = NULL;
+        if (version != 0)
+        {
+            ssl = SSL_new(server);
+            SSL_set_fd(ssl, fd);
+            SSL_accept(ssl);
+        }
+        char buffer[16384];
+        size_t received = 0;
+        while (received < expected)
+        {
+            int n = (ssl != NULL) ? SSL_read(ssl, buffer, sizeof(buffer)) : (int)read(fd, buffer, sizeof(buffer));
+            if (n <= 0)
+            {
+                break;
+            }
+            received += n;
+        }
+        done = true;
+        SSL_free(ssl);
+        close(fd);
+    });
+
+    int fd = connectLoopback(port);
+    SSL* ssl = NULL;
+    if (version != 0)
+    {
+        SSL_CTX_set_min_proto_version(client.context(), version);
+        SSL_CTX_set_max_proto_version(client.context(), version);
+        ssl = SSL_new(client.context());
+        SSL_set_fd(ssl, fd);
+        SSL_connect(ssl);
+    }
+
+    uint64_t before = (ssl != NULL) ? BIO_number_written(SSL_get_wbio(ssl)) : 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ssl != NULL)
+        {
+            SSL_write(ssl, packet.data(), packet.size());
+        }
+        else if (write(fd, packet.data(), packet.size()) != (ssize_t)packet.size())
+        {
+            break;
+        }
+    }
+    reader.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.wireBytes = (ssl != NULL) ? BIO_number_written(SSL_get_wbio(ssl)) - before : expected;
+
+    SSL_free(ssl);
+    close(fd);
+    return result;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Measures the handshake and per-message cost of TLS between a client and an in-process server on loopback.
+ *
+ * "bench_tls [handshakes] [messages]" reconnects the given number of times with full and then with resumed
+ * handshakes, for TLS 1.2 and TLS 1.3, and reports the rate and the server CPU time of each handshake. It then sends
+ * the given number of MQTT PUBLISH packets of one fix over TLS and over plain TCP and compares their rate and their
+ * size on the wire.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    size_t handshakes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 500;
+    size_t messages = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    if ((handshakes == 0) || (messages == 0))
+    {
+        std::cerr << "Usage: " << argv[0] << " [handshakes] [messages]" << std::endl;
+        return 1;
+    }
+
+    uint16_t port = 0;
+    SSL_CTX* server = makeServerContext();
+    int listener = listenLoopback(port);
+    if ((server == NULL) || (listener < 0))
+    {
+        std::cerr << "Unable to set up the TLS server!" << std::endl;
+        return 1;
+    }
+
+    const struct { const char* name; int version; } versions[] = { { "tls1.2", TLS1_2_VERSION },
+                                                                   { "tls1.3", TLS1_3_VERSION } };
+    std::cout << handshakes << " handshakes against an RSA-" << SERVER_KEY_BITS << " server" << std::endl;
+    for (const auto& v : versions)
+    {
+        for (bool resume : { false, true })
+        {
+            HandshakeResult r = runHandshakes(server, listener, port, v.version, resume, handshakes);
+            std::cout << std::left << std::setw(7) << v.name << std::setw(8) << (resume ? "resumed" : "full")
+                      << std::right << std::setw(6) << r.handshakes << " handshakes " << std::setw(6) << r.resumed
+                      << " resumed " << std::fixed << std::setprecision(0) << std::setw(8)
+                      << (r.seconds > 0.0 ? r.handshakes / r.seconds : 0.0) << " /s " << std::setw(6)
+                      << r.serverCpuUs << " us server CPU each" << std::endl;
+        }
+    }
+
+    size_t packetSize = makePublishPacket().size();
+    std::cout << messages << " PUBLISH packets of " << packetSize << " bytes" << std::endl;
+    MessageResult plain = runMessages(server, listener, port, 0, messages);
+    for (const auto& v : versions)
+    {
+        MessageResult r = runMessages(server, listener, port, v.version, messages);
+        double perMessage = (double)r.wireBytes / messages;
+        std::cout << std::left << std::setw(7) << v.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(7) << perMessage << " bytes/msg (+" << std::setw(4) << perMessage - packetSize
+                  << ") " << std::setprecision(0) << std::setw(9) << messages / r.seconds << " msgs/s" << std::endl;
+    }
+    std::cout << std::left << std::setw(7) << "tcp" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(7) << (double)plain.wireBytes / messages << " bytes/msg          " << std::setprecision(0)
+              << std::setw(9) << messages / plain.seconds << " msgs/s" << std::endl;
+
+    close(listener);
+    SSL_CTX_free(server);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_ARCHIVE_H__
+#define __GNSS_ARCHIVE_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include "gnss_hot_store.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define ARCHIVE_MAGIC           "GNSSARC1"        /* First and last eight bytes of an archive file */
+#define ARCHIVE_MAGIC_SIZE      (8U)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Directory entry of one compressed chunk of the archive: what a query needs to decide whether to read it. */
+struct ArchiveChunk
+{
+    uint32_t device;            /* Index into the device names */
+    uint32_t count;
+    int64_t firstMs, lastMs;
+    int32_t minLatE7, minLonE7, maxLatE7, maxLonE7;
+    uint64_t offset;            /* Of the compressed bytes in the file */
+    uint64_t size;
+};
+
+/*
+ * Writes an archive file: per-device chunks of HOT_STORE_CHUNK_FIXES fixes in the compressed format of the hot store,
+ * appended as they fill up, then the device names, the directory sorted by device and time, and a trailer locating
+ * both. The fixes of each device must be appended in time order; devices may be interleaved freely.
+ */
+class ArchiveWriter
+{
+public:
+    ArchiveWriter();
+    ~ArchiveWriter();
+
+    bool open(const std::string& path);
+    uint32_t device(const std::string& deviceId);
+    bool append(uint32_t device, const FixSample& sample);
+    bool sync();
+    bool close();
+    uint64_t size() const;
+
+private:
+    bool seal(uint32_t device);
+
+    FILE* file;
+    uint64_t fileSize;
+    std::unordered_map<std::string, uint32_t> deviceIndex;
+    std::vector<std::string> deviceNames;
+    std::vector<std::vector<FixSample>> openChunks;     /* Per device, not yet sealed */
+    std::vector<ArchiveChunk> directory;
+    std::vector<uint8_t> packed;
+};
+
+/*
+ * Read-only view of an archive file, memory mapped. The directory is kept in memory, sorted by device and then by
+ * time, so the chunks of a device are a contiguous run; the chunks themselves are decompressed on demand and may be
+ * read from several threads at once.
+ */
+class ArchiveReader
+{
+public:
+    ArchiveReader();
+    ~ArchiveReader();
+
+    bool open(const std::string& path);
+    const std::vector<std::string>& devices() const;
+    const std::vector<ArchiveChunk>& chunks() const;
+    size_t firstChunk(uint32_t device) const;
+    bool read(const ArchiveChunk& chunk, std::vector<FixSample>& out) const;
+
+private:
+    int fd;
+    const uint8_t* mapped;
+    size_t mappedSize;
+    std::vector<std::string> deviceNames;
+    std::vector<ArchiveChunk> directory;
+    std::vector<size_t> deviceChunks;   /* Index of the first chunk of each device, plus one past the last chunk */
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_ARCHIVE_H__
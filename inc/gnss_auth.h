@@ -0,0 +1,173 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_AUTH_H__
+#define __GNSS_AUTH_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <openssl/evp.h>
+#include "gnss_payload.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define AUTH_MIN_KEY_BYTES      (16U)             /* Shortest HMAC key accepted */
+#define AUTH_CACHE_SIZE         (8192U)           /* Verified payloads remembered to skip the HMAC of replays */
+#define AUTH_CHUNK              (16U)             /* Payloads a worker takes from the batch at a time */
+#define AUTH_PARALLEL_MIN       (64U)             /* Smaller batches are verified on the calling thread */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Outcome of the authentication of one payload */
+enum AuthResult
+{
+    AUTH_UNSIGNED,              /* No tag and no key for the device: accepted as before */
+    AUTH_VERIFIED,              /* Tag checked against the device key */
+    AUTH_CACHED,                /* Identical to a payload verified recently */
+    AUTH_MISSING,               /* The device has a key but the payload carries no tag */
+    AUTH_UNKNOWN_KEY,           /* Tagged by a device without a key */
+    AUTH_BAD_TAG                /* Tag does not match: spoofed or corrupted */
+};
+
+/* One payload to authenticate; data must stay valid until PayloadVerifier::verify() returns */
+struct AuthCheck
+{
+    const char* data;
+    size_t size;
+    std::string topicDevice;    /* Device named by the topic, used when the payload carries none */
+    AuthResult result;
+};
+
+struct AuthStats
+{
+    uint64_t verified;          /* Tags computed and matched */
+    uint64_t cached;            /* Tags skipped thanks to the verified cache */
+    uint64_t rejected;          /* Payloads failing authentication */
+    uint64_t bytes;             /* Bytes of the payloads whose tag was computed */
+    double seconds;             /* Time spent computing tags */
+};
+
+/* SHA-256 states after the inner and outer key pads of HMAC, so a tag costs two state copies, not a key schedule */
+struct PreparedKey
+{
+    EVP_MD_CTX* inner;
+    EVP_MD_CTX* outer;
+};
+
+/* HMAC-SHA256 keys of the registered devices, each prepared once, and the keyed devices each gateway may forward */
+class DeviceKeys
+{
+public:
+    DeviceKeys();
+    ~DeviceKeys();
+
+    bool load(const std::string& text, std::string& error);
+    bool loadFile(const std::string& path, std::string& error);
+    bool add(const std::string& deviceId, const std::string& key);
+    const PreparedKey* find(const std::string& deviceId) const;
+    bool mayForward(const std::string& gateway, const std::string& deviceId) const;
+    size_t size() const;
+    static bool tag(const PreparedKey& key, const char* data, size_t size, unsigned char* out);
+
+private:
+    DeviceKeys(const DeviceKeys&) = delete;
+    DeviceKeys& operator=(const DeviceKeys&) = delete;
+
+    EVP_MD* sha256;
+    std::unordered_map<std::string, PreparedKey> keys;
+    std::unordered_map<std::string, std::unordered_set<std::string>> forwards;     /* By gateway */
+};
+
+/*
+ * Checks the tags of a batch of payloads on a pool of worker threads.
+ *
+ * The calling thread works through the batch with the workers, each taking AUTH_CHUNK payloads at a time, so a batch
+ * costs one wake-up of the pool. SHA-256 runs through OpenSSL, which uses the SHA extensions of the CPU when present.
+ * Payloads identical to one verified recently, e.g. QoS 1 redeliveries, retransmitted batches or copies from another
+ * broker, are accepted from a cache after a byte comparison instead of a new HMAC.
+ */
+class PayloadVerifier
+{
+public:
+    PayloadVerifier();
+    ~PayloadVerifier();
+
+    bool start(size_t workers);
+    void stop();
+    bool loadKeys(const std::string& path, std::string& error);
+    bool enabled() const;
+    size_t keyCount() const;
+    bool hasKey(const std::string& deviceId) const;
+    bool mayForward(const std::string& gateway, const std::string& deviceId) const;
+    void verify(std::vector<AuthCheck>& checks);
+    size_t workers() const;
+    AuthStats stats() const;
+
+private:
+    struct Job
+    {
+        AuthCheck* item;
+        const PreparedKey* key;
+        std::string deviceId;
+        uint64_t tagId;         /* First bytes of the tag, indexing the verified cache */
+    };
+
+    /* A verified payload; slots are reused in turn so the cache allocates nothing once warm */
+    struct CacheSlot
+    {
+        uint64_t tagId;
+        std::string deviceId;
+        std::string payload;
+    };
+
+    void workerLoop();
+    void runChunks();
+    static void check(Job& job);
+    bool cached(const Job& job) const;
+    void remember(const Job& job);
+
+    std::unique_ptr<DeviceKeys> keys;
+    std::vector<CacheSlot> cacheSlots;                      /* AUTH_CACHE_SIZE slots, overwritten oldest first */
+    std::unordered_map<uint64_t, size_t> cacheIndex;        /* Tag ID to its slot */
+    size_t cacheNext;                                       /* Slot the next verified payload goes to */
+
+    // Tags to compute for the current batch, shared with the workers
+    std::vector<Job> jobs;
+    std::atomic<size_t> nextJob;
+
+    std::mutex mutex;
+    std::condition_variable startCond;
+    std::condition_variable doneCond;
+    uint64_t generation;
+    size_t busy;
+    bool stopping;
+    std::vector<std::thread> pool;
+    AuthStats totals;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool parseHexKey(const std::string& hex, std::string& key);
+bool signPayload(std::string& payload, const std::string& key);
+bool authAccepted(AuthResult result);
+const char* authResultName(AuthResult result);
+bool shaExtensions();
+
+#endif // __GNSS_AUTH_H__
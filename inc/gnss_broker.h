@@ -0,0 +1,140 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_BROKER_H__
+#define __GNSS_BROKER_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define BROKER_BIND_ADDRESS     "127.0.0.1"       /* Default listen address, loopback only */
+#define BROKER_MAX_PACKET       (4U * 1024U * 1024U)  /* Largest accepted MQTT packet */
+#define BROKER_MAX_BACKLOG      (16U * 1024U * 1024U) /* Queued output per client before QoS 0 messages are dropped */
+#define BROKER_MAX_EVENTS       (256)             /* Events handled per epoll wait */
+#define BROKER_TICK_MS          (1000)            /* Longest epoll wait, bounds keep-alive checks */
+#define BROKER_CONNECT_TIMEOUT_MS (10000)         /* Time a new connection has to send CONNECT */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+struct BrokerStats
+{
+    uint64_t clients;           /* Connected clients */
+    uint64_t messagesIn;        /* PUBLISH packets received */
+    uint64_t messagesOut;       /* PUBLISH packets queued to subscribers */
+    uint64_t messagesDropped;   /* QoS 0 deliveries dropped because a subscriber fell too far behind */
+    uint64_t bytesOut;
+};
+
+/*
+ * A minimal MQTT 3.1.1 broker running on its own epoll thread, for benchmarks, CI hosts without mosquitto, and edge
+ * gateways aggregating vehicles.
+ *
+ * Supported: CONNECT, SUBSCRIBE/UNSUBSCRIBE with "+" and "#" wildcards, PUBLISH at QoS 0 and 1, PINGREQ, DISCONNECT,
+ * keep-alive. Each message is copied once from the publisher's packet into a shared buffer that all subscribers'
+ * output queues reference, and queues are written with scatter/gather I/O, so fan-out does not copy the payload again.
+ *
+ * Not supported: QoS 2 (the client is disconnected), retained messages, wills, authentication and persistent
+ * sessions. QoS 1 messages are acknowledged to publishers and delivered to subscribers once over the live
+ * connection, without redelivery after a reconnect.
+ */
+class MqttBroker
+{
+public:
+    MqttBroker();
+    ~MqttBroker();
+
+    bool start(uint16_t port, const std::string& bindAddress = BROKER_BIND_ADDRESS);
+    void stop();
+    uint16_t port() const;
+    BrokerStats stats() const;
+
+private:
+    struct OutChunk
+    {
+        std::shared_ptr<const std::string> data;
+        size_t offset;
+    };
+
+    struct Client
+    {
+        int fd;
+        bool connected;         /* CONNECT received */
+        bool closing;           /* Closed at the end of the current event batch */
+        bool wantWrite;         /* Registered for EPOLLOUT because the socket buffer was full */
+        std::string clientId;
+        std::string in;
+        std::deque<OutChunk> out;
+        size_t outBytes;
+        uint16_t nextPacketId;
+        int64_t keepAliveMs;
+        int64_t lastActivityMs;
+        std::vector<std::string> filters;
+    };
+
+    /* One level of the subscription tree; "+" and "#" are stored as ordinary children */
+    struct TopicNode
+    {
+        std::map<std::string, std::unique_ptr<TopicNode>> children;
+        std::map<Client*, uint8_t> subscribers;
+    };
+
+    void run();
+    void acceptClients();
+    void readClient(Client& client);
+    bool handlePacket(Client& client, uint8_t header, const uint8_t* body, size_t size);
+    bool handleConnect(Client& client, const uint8_t* body, size_t size);
+    bool handleSubscribe(Client& client, const uint8_t* body, size_t size);
+    bool handleUnsubscribe(Client& client, const uint8_t* body, size_t size);
+    bool handlePublish(Client& client, uint8_t header, const uint8_t* body, size_t size);
+    void route(const std::string& topic, const std::shared_ptr<const std::string>& payload, uint8_t qos);
+    void collect(const TopicNode& node, const std::vector<std::string>& levels, size_t level,
+                 std::vector<std::pair<Client*, uint8_t>>& matches) const;
+    void subscribe(Client& client, const std::string& filter, uint8_t qos);
+    void unsubscribe(Client& client, const std::string& filter);
+    void queue(Client& client, const std::shared_ptr<const std::string>& data);
+    void flush(Client& client);
+    void drop(Client& client);
+    void reap();
+
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    uint16_t boundPort;
+    std::thread thread;
+    std::atomic<bool> running;
+    TopicNode root;
+    std::unordered_map<int, std::unique_ptr<Client>> clients;
+    std::unordered_map<std::string, Client*> clientIds;
+    std::vector<Client*> dirty;         /* Clients with output queued during the current event batch */
+
+    std::atomic<uint64_t> clientCount;
+    std::atomic<uint64_t> messagesIn;
+    std::atomic<uint64_t> messagesOut;
+    std::atomic<uint64_t> messagesDropped;
+    std::atomic<uint64_t> bytesOut;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool isValidTopicFilter(const std::string& filter);
+std::vector<std::string> splitTopic(const std::string& topic);
+
+#endif // __GNSS_BROKER_H__
@@ -0,0 +1,218 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_BROKER_POOL_H__
+#define __GNSS_BROKER_POOL_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <poll.h>
+#include <mosquitto.h>
+#include "gnss_tls.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define POOL_VIRTUAL_NODES      (64U)             /* Points per broker on the hash ring, evens out the spread */
+#define POOL_RECONNECT_MS       (1000)            /* Pause between connection attempts to a broker that is down */
+#define POOL_MAX_UNACKED        (2000U)           /* Unacknowledged messages that mark a broker as saturated */
+#define POOL_STALL_MS           (3000)            /* A broker holding messages without acknowledging any is stalled */
+#ifndef POOL_MAX_BACKLOG
+#define POOL_MAX_BACKLOG        (100000U)         /* Messages buffered while no broker is connected */
+#endif
+#define POOL_KEEPALIVE_S        (10)              /* MQTT keep-alive, bounds the detection of a silent broker */
+#define POOL_MISC_MS            (2500)            /* Longest pause between keep-alive checks, a quarter of the above */
+#define POOL_MAX_EVENTS         (64)              /* Readiness events taken per epoll_wait call */
+#define DEDUP_WINDOW            (65536U)          /* Recent messages remembered to drop copies from other brokers */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A broker of the pool */
+struct BrokerEndpoint
+{
+    std::string host;
+    int port;
+};
+
+/* Counters of one broker, see BrokerPool::stats() */
+struct BrokerLinkStats
+{
+    std::string name;           /* "host:port" */
+    bool connected;
+    bool healthy;
+    uint64_t published;         /* Messages handed to the broker */
+    uint64_t bytes;             /* Payload bytes handed to the broker */
+    uint64_t acknowledged;      /* Messages the broker confirmed (QoS 1/2) or that were written (QoS 0) */
+    uint64_t failedOver;        /* Unacknowledged messages moved to another broker when this one was lost */
+    uint64_t disconnects;
+    uint64_t received;          /* Messages received on the pool subscriptions */
+    uint64_t receivedBytes;
+    uint64_t duplicates;        /* Received messages the caller reported as already seen, see countDuplicate() */
+    uint64_t tlsHandshakes;     /* Completed TLS handshakes, full and resumed */
+    uint64_t tlsResumed;        /* TLS handshakes that resumed the previous session */
+};
+
+/*
+ * Queue of at most N elements in one allocation made up front, for builds that must not allocate while running. Has
+ * the members of std::deque the broker pool uses; push_back() on a full ring is a caller error.
+ */
+template<typename T, size_t N>
+class FixedRing
+{
+public:
+    FixedRing() : slots(N), head(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    T& front() { return slots[head]; }
+    void push_back(T&& value) { slots[(head + count++) % N] = std::move(value); }
+    void pop_front() { slots[head] = T(); head = (head + 1) % N; --count; }
+    void clear() { while (count > 0) { pop_front(); } }
+
+private:
+    std::vector<T> slots;
+    size_t head;
+    size_t count;
+};
+
+/* Called with the index of a broker whose connection was established */
+typedef std::function<void(size_t)> BrokerConnectHandler;
+
+/* Called with the index of a broker and a message received from one of the pool subscriptions */
+typedef std::function<void(size_t, const struct mosquitto_message*)> BrokerMessageHandler;
+
+/*
+ * A set of MQTT brokers used as one.
+ *
+ * Each message has a routing key (the vehicle) that is placed on a consistent-hash ring, so the vehicles spread evenly
+ * over the brokers and adding or losing a broker only moves the vehicles of that broker. A message goes to the first
+ * healthy broker clockwise from its key: connected, not saturated with unacknowledged messages and not stalled.
+ *
+ * The pool keeps every QoS 1/2 message until its broker acknowledges it. When a connection is lost, those messages are
+ * republished at once on the next healthy broker, and messages published while no broker is connected are buffered
+ * until one is. Brokers that are down are retried in the background with non-blocking connects.
+ *
+ * run() waits on all connections, and on any descriptor added with watch(), with a single epoll set, so one thread
+ * serves every broker and a broker that is lost or slow never holds up the others. A caller with its own event loop
+ * waits on fd() instead, after prepareWait(), and then calls run(0).
+ */
+class BrokerPool
+{
+public:
+    BrokerPool();
+    ~BrokerPool();
+
+    bool start(const std::vector<BrokerEndpoint>& brokers, const std::string& clientId, bool cleanSession,
+               const TlsConfig& tls, const BrokerConnectHandler& onConnect, const BrokerMessageHandler& onMessage);
+    void stop();
+    bool publish(const std::string& key, const std::string& topic, const std::string& payload, int qos);
+    bool publishTo(size_t broker, const std::string& topic, const std::string& payload, int qos);
+    void subscribe(const std::string& topic, int qos);
+    size_t route(const std::string& key) const;
+    void addPollFds(std::vector<struct pollfd>& fds) const;
+    bool watch(int fd);
+    void service();
+    void run(int timeoutMs);
+    int64_t nextDueMs() const;
+    int fd() const;
+    void prepareWait();
+    void countDuplicate(size_t broker);
+    bool connected() const;
+    size_t pending() const;
+    size_t size() const;
+    uint64_t dropped() const;
+    std::vector<BrokerLinkStats> stats() const;
+
+    static const size_t none = (size_t)-1;
+
+private:
+    struct Message
+    {
+        std::string key;
+        std::string topic;
+        std::string payload;
+        int qos;
+    };
+
+    struct Link
+    {
+        BrokerPool* pool;
+        size_t index;
+        BrokerEndpoint endpoint;
+        struct mosquitto* mosq;
+        bool connected;
+        bool connecting;                /* A connection attempt is in progress */
+        int64_t lastAttemptMs;
+        int64_t lastAckMs;              /* Last acknowledgement, or when the oldest unacknowledged message was sent */
+        int64_t lastMiscMs;             /* Last keep-alive check, see mosquitto_loop_misc() */
+        std::map<int, Message> unacked; /* QoS 1/2 messages by message ID */
+        int watchedFd;                  /* Socket registered in the epoll set, -1 when none */
+        uint32_t watchedEvents;
+        uint32_t readyEvents;           /* Events reported for the socket by the last epoll_wait */
+        TlsSession tls;
+        BrokerLinkStats stats;
+    };
+
+    static void onConnect(struct mosquitto* mosq, void* obj, int rc);
+    static void onDisconnect(struct mosquitto* mosq, void* obj, int rc);
+    static void onPublish(struct mosquitto* mosq, void* obj, int mid);
+    static void onMessage(struct mosquitto* mosq, void* obj, const struct mosquitto_message* message);
+
+    bool healthy(const Link& link, int64_t now) const;
+    bool send(Link& link, Message& message);
+    void serviceLink(Link& link, bool readable, bool writable);
+    void updateWatch(Link& link);
+    void linkLost(Link& link);
+    void drainBacklog();
+
+    std::vector<std::unique_ptr<Link>> links;
+    std::vector<std::pair<uint64_t, size_t>> ring;  /* Hash ring, sorted by point */
+#ifdef GNSS_LEAN
+    FixedRing<Message, POOL_MAX_BACKLOG> backlog;   /* Messages waiting for a connected broker */
+#else
+    std::deque<Message> backlog;                    /* Messages waiting for a connected broker */
+#endif
+    std::vector<std::pair<std::string, int>> subscriptions;
+    BrokerConnectHandler connectHandler;
+    BrokerMessageHandler messageHandler;
+    uint64_t backlogDropped;
+    int epollFd;
+};
+
+/*
+ * Drops copies of a message that arrive over several brokers, e.g. from a sender that failed over or from bridged
+ * brokers. Remembers a 64-bit hash of the topic and payload of the last DEDUP_WINDOW messages, so it is only used for
+ * unsequenced data: a collision would drop a message, whereas sequenced batches are stored once by their numbers.
+ */
+class DuplicateFilter
+{
+public:
+    DuplicateFilter();
+
+    bool seen(const std::string& topic, const std::string& payload) const;
+    void remember(const std::string& topic, const std::string& payload);
+
+private:
+    std::vector<uint64_t> recent;           /* Ring of the remembered hashes, oldest at next */
+    std::unordered_set<uint64_t> index;
+    size_t next;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_BROKER_POOL_H__
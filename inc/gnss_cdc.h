@@ -0,0 +1,97 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_CDC_H__
+#define __GNSS_CDC_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <sqlite3.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define CDC_SOCKET_PATH         "gnss_cdc.sock"   /* Unix socket the change stream is served on */
+#define CDC_RING_RECORDS        (65536U)          /* Committed rows kept in memory for subscribers to catch up */
+#define CDC_CLIENT_BUFFER       (256U * 1024U)    /* Pending output per subscriber before it is refilled */
+#define CDC_CATCHUP_ROWS        (1024U)           /* Rows read from the database per catch-up query */
+#define CDC_MAX_CLIENTS         (64U)             /* Simultaneous subscribers */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A committed row of GNSS_DATA. The row ID is the stream position. */
+struct CdcRecord
+{
+    int64_t     id;
+    std::string data;
+};
+
+/*
+ * Change-data-capture of committed GNSS_DATA inserts.
+ *
+ * SQLite hooks collect the rows of the running transaction and set them aside when it starts to commit; committed()
+ * publishes them once the COMMIT has returned, so subscribers never see rolled back rows, nor those of a commit that
+ * failed after its hook. Subscribers connect to a Unix socket, send "FROM <id>\n" (or "FROM now\n") and then receive
+ * one "<id> <data>\n" line per committed row with a larger ID. Rows still in the in-memory ring are served from
+ * memory; older positions are replayed from the database first, so a subscriber can resume from the last ID it
+ * processed.
+ */
+class ChangeCapture
+{
+public:
+    ChangeCapture();
+    ~ChangeCapture();
+
+    bool start(sqlite3* db, const std::string& socketPath = CDC_SOCKET_PATH);
+    void stop();
+    void stage(const std::string& data);
+    void committed();
+    void service();
+    int64_t lastCommittedId() const;
+
+private:
+    struct Subscriber
+    {
+        int fd;
+        bool started;           /* The FROM request has been received */
+        int64_t position;       /* Last row ID queued for the subscriber */
+        std::string in;
+        std::string out;
+    };
+
+    static void onUpdate(void* self, int op, const char* dbName, const char* table, sqlite3_int64 rowid);
+    static int onCommit(void* self);
+    static void onRollback(void* self);
+
+    void acceptSubscribers();
+    bool readRequest(Subscriber& sub);
+    void fill(Subscriber& sub);
+    bool flush(Subscriber& sub);
+
+    sqlite3* db;
+    sqlite3_stmt* catchUp;
+    int listenFd;
+    std::string socketPath;
+    std::string staged;                 /* Payload of the insert about to be executed */
+    std::vector<CdcRecord> pending;     /* Rows of the open transaction */
+    std::vector<CdcRecord> committing;  /* Rows of the transaction whose COMMIT is running */
+    std::deque<CdcRecord> ring;         /* Recently committed rows, ordered by ID */
+    int64_t committedId;
+    int64_t ringFloor;                  /* Every committed row with a larger ID is in the ring */
+    std::vector<Subscriber> subscribers;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_CDC_H__
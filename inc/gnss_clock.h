@@ -0,0 +1,56 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_CLOCK_H__
+#define __GNSS_CLOCK_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define CLOCK_MAX_SPEED         (1000000.0)       /* Fastest paced simulation, "max" is not paced at all */
+#define CLOCK_AS_FAST_AS_POSSIBLE (0.0)           /* Speed of a clock advanced only by the simulated waits */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/*
+ * Clock of the simulated fixes, in Unix milliseconds.
+ *
+ * At speed 1 it follows the wall clock. At speed N it runs N times faster than the wall clock from its start time,
+ * and the waits of the simulation are divided by N. As fast as possible, it only moves by the waits of the simulation,
+ * which take no time at all, so the fix times are exactly one interval apart however fast they are sent.
+ */
+class VirtualClock
+{
+public:
+    VirtualClock();
+
+    void start(double speed, int64_t startMs);
+    int64_t nowMs() const;
+    int64_t wait(int64_t virtualMs);
+    int64_t elapsedMs() const;
+
+private:
+    double rate;
+    int64_t originMs;                                   /* Simulated time at start() */
+    std::chrono::steady_clock::time_point realOrigin;   /* Wall clock at start() */
+    int64_t scheduledMs;                                /* Simulated time at the end of the waits taken */
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool parseClockSpeed(const std::string& text, double& speed);
+bool parseClockStart(const std::string& text, int64_t& startMs);
+
+#endif // __GNSS_CLOCK_H__
@@ -0,0 +1,116 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_DEVICES_H__
+#define __GNSS_DEVICES_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "gnss_nmea.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define DEVICE_FILTER_WINDOW_MS (60000)           /* Window of the min-filter, the offset follows a change within two */
+#define DEVICE_MAX_REORDER_MS   (2000)            /* Longest a fix is held back for the ones overtaken by it */
+#define DEVICE_MAX_HELD         (1024U)           /* Fixes held per device before the oldest is released regardless */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/*
+ * What the receiver knows about the clock and the link of one device, from receive time minus fix time per fix.
+ *
+ * The fastest fix shows the offset of the device clock plus the smallest transport delay; one-way, the two cannot be
+ * told apart. A GNSS fix time is true UTC, so for real receivers the offset is that delay (plus any error of the
+ * receiver's own clock, the same for every device); a device with a free-running clock adds its skew.
+ */
+struct DeviceClock
+{
+    int64_t offsetMs;           /* Smallest receive time minus fix time within the last one or two filter windows */
+    double delayMs;             /* Smoothed transport delay above the fastest fix, i.e. queueing on the way */
+    double jitterMs;            /* Smoothed mean deviation of that delay */
+    double driftPpm;            /* Change of the offset between filter windows, the skew of the device clock rate */
+    int64_t reorderMs;          /* Current reorder window: delay plus four times the jitter, or the recent peak */
+    uint64_t fixes;
+    uint64_t late;              /* Fixes behind the watermark, after a later fix of the device was released */
+};
+
+struct DeviceRegistryStats
+{
+    size_t devices;
+    size_t held;                /* Fixes waiting in the reorder buffers */
+    uint64_t fixes;
+    uint64_t late;
+    uint64_t forced;            /* Fixes released early because DEVICE_MAX_HELD were waiting */
+    int64_t offsetP50Ms;        /* Over the devices */
+    double delayP50Ms;
+    double delayP99Ms;
+    int64_t reorderP50Ms;
+    int64_t reorderP99Ms;
+};
+
+/*
+ * Registry of the devices heard from, with an online estimate of their clock offset and transport delay, and the
+ * reorder buffer that hands their fixes on in time order.
+ *
+ * hold() takes each decoded fix with its receive time on the wall clock. The offset is a min-filter over receive time
+ * minus fix time, kept as the minimum of the current and the previous DEVICE_FILTER_WINDOW_MS of receive time, so it
+ * follows a clock that is stepped or drifts; the delay above it and its jitter are smoothed like a TCP round-trip time.
+ * The reorder window covers that delay plus four jitters, and at least the largest delay of the last few tens of
+ * seconds, decaying, so that rare stragglers of a busy device are not forgotten after a few fixes.
+ * A fix is released once the watermark of its device, now minus the offset minus the reorder window, has passed its
+ * fix time, so a fix delayed less than the window on the way is still released before the later ones. A fix arriving
+ * behind the last one released is late: it is counted and not handed on.
+ */
+class DeviceRegistry
+{
+public:
+    DeviceRegistry();
+
+    bool hold(const GNSSFix& fix, int64_t receivedMs);
+    int64_t release(int64_t nowMs, std::vector<GNSSFix>& out);
+    const DeviceClock* find(const std::string& deviceId) const;
+    size_t size() const;
+    size_t held() const;
+    DeviceRegistryStats stats() const;
+    std::vector<std::pair<std::string, DeviceClock>> slowest(size_t count) const;
+
+private:
+    struct Device
+    {
+        DeviceClock clock;
+        int64_t windowMin;      /* Smallest receive time minus fix time of the current filter window */
+        int64_t previousMin;    /* Of the previous window, INT64_MAX when there is none */
+        int64_t windowStartMs;  /* Receive time at which the current window began */
+        double peakMs;          /* Largest delay above the offset, halved every PEAK_HALF_LIFE_MS */
+        int64_t peakAtMs;       /* Receive time peakMs was last brought up to date */
+        std::vector<GNSSFix> pending;   /* Held fixes, a heap with the oldest on top */
+        int64_t releasedMs;     /* Fix time of the last fix released, INT64_MIN before the first */
+        bool waiting;           /* Listed in waitingDevices */
+    };
+
+    void estimate(Device& device, int64_t sampleMs, int64_t receivedMs);
+
+    std::unordered_map<std::string, Device> devices;
+    std::vector<Device*> waitingDevices;        /* Devices with held fixes, in the order they began waiting */
+    size_t heldFixes;
+    uint64_t lateFixes;
+    uint64_t forcedFixes;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_DEVICES_H__
@@ -0,0 +1,129 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_GATEWAY_H__
+#define __GNSS_GATEWAY_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <poll.h>
+#include "gnss_payload.h"
+#include "gnss_udp.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define GATEWAY_MAX_INPUTS      PAYLOAD_MAX_SOURCES   /* Local inputs, each is one source of the merged batches */
+#define GATEWAY_MAX_LINE        (512U)            /* Longer lines are discarded, NMEA allows 82 characters */
+#define GATEWAY_REOPEN_MS       (1000)            /* Pause before reopening a serial input that was closed */
+#define GATEWAY_SPOOL_MAX_BYTES (64U * 1024U * 1024U) /* Unconfirmed batches kept on disk, the oldest are dropped */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A local input given as "<device>=pty:<path>", "<device>=udp:<addr>:<port>" or "<device>=unix:<path>" */
+struct GatewayInputSpec
+{
+    std::string deviceId;       /* Device the sentences of the input are stored under */
+    std::string kind;           /* "pty", "udp" or "unix" */
+    std::string address;
+};
+
+/* A sentence read from a local input, timestamped for merging */
+struct GatewaySentence
+{
+    int64_t timestampMs;        /* Fix time when the sentence carries one, arrival time otherwise */
+    uint8_t source;             /* Index of the input */
+    std::string sentence;
+};
+
+/*
+ * The local inputs of a gateway: serial ports or PTYs, UDP ports and Unix datagram sockets, each carrying NMEA lines
+ * of one device. Inputs are non-blocking and waited on with poll() together with the uplink socket.
+ */
+class GatewayInputs
+{
+public:
+    GatewayInputs();
+    ~GatewayInputs();
+
+    bool open(const std::vector<GatewayInputSpec>& specs);
+    void close();
+    void addPollFds(std::vector<struct pollfd>& fds) const;
+    size_t read(std::vector<GatewaySentence>& sentences);
+    const std::vector<std::string>& deviceIds() const;
+    uint64_t linesDiscarded() const;
+
+private:
+    struct Input
+    {
+        GatewayInputSpec spec;
+        int fd;                 /* Serial and Unix inputs, -1 while closed */
+        UdpReceiver udp;
+        std::string partial;    /* Unterminated line of a serial input */
+        int64_t closedAtMs;
+    };
+
+    bool openInput(Input& input);
+    void readStream(Input& input, uint8_t source, std::vector<GatewaySentence>& sentences);
+    void addLines(const char* data, size_t size, std::string& partial, uint8_t source,
+                  std::vector<GatewaySentence>& sentences);
+
+    std::vector<std::unique_ptr<Input>> inputs;
+    std::vector<std::string> devices;
+    std::vector<std::string> datagrams;
+    uint64_t discarded;
+};
+
+/*
+ * Store-and-forward spool of the batches a gateway has not seen confirmed yet.
+ *
+ * Batches are appended to a log file and synced before they are published, and confirmations are appended as they
+ * arrive, so a restarted gateway resends exactly the unconfirmed batches. The log is truncated whenever every batch
+ * is confirmed and rewritten when confirmed records dominate it.
+ */
+class GatewaySpool
+{
+public:
+    GatewaySpool();
+    ~GatewaySpool();
+
+    bool open(const std::string& path, std::map<uint64_t, std::string>& unconfirmed);
+    void close();
+    bool append(uint64_t lastSequence, const std::string& payload);
+    void confirm(uint64_t lastSequence);
+    uint64_t size() const;
+
+private:
+    struct Record
+    {
+        uint64_t offset;        /* Payload position in the log */
+        uint32_t size;
+    };
+
+    bool writeRecord(char type, uint64_t lastSequence, const std::string& payload, bool sync);
+    bool rewrite();
+
+    std::string path;
+    int fd;
+    std::map<uint64_t, Record> live;        /* Unconfirmed batches by last sequence number */
+    uint64_t liveBytes;
+    uint64_t fileBytes;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool parseGatewayInput(const std::string& text, GatewayInputSpec& spec);
+int64_t sentenceTimeMs(const std::string& sentence, int64_t arrivalMs);
+
+#endif // __GNSS_GATEWAY_H__
@@ -0,0 +1,119 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_HOT_STORE_H__
+#define __GNSS_HOT_STORE_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "gnss_nmea.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define HOT_STORE_CHUNK_FIXES   (128U)                      /* Fixes per chunk before it is sealed and compressed */
+#define HOT_STORE_RETENTION_MS  (24LL * 60 * 60 * 1000)     /* Keep the last 24 hours of fixes in memory */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Fixed-point form of a fix as kept in the open chunk. */
+struct FixSample
+{
+    int64_t  timestampMs;
+    int32_t  latE7;             /* Latitude in 1e-7 degrees */
+    int32_t  lonE7;             /* Longitude in 1e-7 degrees */
+    uint16_t speedCentiKnots;
+    uint16_t courseCentiDeg;
+};
+
+/* A run of consecutive fixes of one device. Sealed chunks hold only the compressed bytes. */
+struct FixChunk
+{
+    int64_t                 firstMs;
+    int64_t                 lastMs;
+    uint32_t                count;
+    int32_t                 minLatE7, minLonE7, maxLatE7, maxLonE7;
+    std::vector<FixSample>  raw;        /* Populated until the sealer has compressed the chunk */
+    std::vector<uint8_t>    packed;     /* Delta-of-delta time, delta coordinates, zigzag varints */
+};
+
+struct HotStoreStats
+{
+    size_t devices;
+    size_t fixes;
+    size_t sealedChunks;
+    size_t pendingChunks;
+    size_t memoryBytes;         /* Approximate bytes held by samples and compressed chunks */
+    size_t structBytes;         /* Bytes the same fixes would take as GNSSFix structs */
+};
+
+typedef std::function<void(const GNSSFix&)> FixVisitor;
+
+/* Per-device append-only store of recent fixes, compressed in fixed-size chunks by a background thread. */
+class HotStore
+{
+public:
+    explicit HotStore(int64_t retentionMs = HOT_STORE_RETENTION_MS);
+    ~HotStore();
+
+    void append(const GNSSFix& fix);
+    size_t scan(const std::string& deviceId, int64_t fromMs, int64_t toMs, const FixVisitor& visitor) const;
+    size_t scanAll(int64_t fromMs, int64_t toMs, const FixVisitor& visitor) const;
+    size_t evictExpired(int64_t nowMs);
+    void drain();
+    HotStoreStats stats() const;
+
+private:
+    struct Series
+    {
+        std::vector<std::shared_ptr<const FixChunk>> chunks;
+        std::vector<FixSample> open;
+    };
+
+    struct SealJob
+    {
+        std::string deviceId;
+        std::shared_ptr<const FixChunk> chunk;
+    };
+
+    void sealerLoop();
+    static size_t scanSeries(const std::string& deviceId, const std::vector<std::shared_ptr<const FixChunk>>& chunks,
+                             const std::vector<FixSample>& open, int64_t fromMs, int64_t toMs,
+                             const FixVisitor& visitor);
+
+    int64_t retentionMs;
+    mutable std::mutex mutex;
+    std::condition_variable sealCond;
+    std::condition_variable drainCond;
+    std::unordered_map<std::string, Series> series;
+    std::deque<SealJob> sealQueue;
+    bool sealing;
+    bool stopping;
+    std::thread sealer;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+FixSample toFixSample(const GNSSFix& fix);
+void fromFixSample(const FixSample& sample, const std::string& deviceId, GNSSFix& fix);
+std::shared_ptr<FixChunk> makeFixChunk(const std::vector<FixSample>& samples);
+void compressFixChunk(const std::vector<FixSample>& samples, std::vector<uint8_t>& out);
+bool decompressFixChunk(const uint8_t* data, size_t size, std::vector<FixSample>& out);
+
+#endif // __GNSS_HOT_STORE_H__
@@ -0,0 +1,153 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_IMPAIR_H__
+#define __GNSS_IMPAIR_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "gnss_random.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define IMPAIR_DEFAULT_SEED     (1U)              /* Seed when the specification names none */
+#define IMPAIR_MAX_QUEUED       (4000000U)        /* Delayed messages held at most, further ones are lost */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A distribution of delays in milliseconds; negative samples are clamped to 0 */
+struct DelayDistribution
+{
+    enum Kind
+    {
+        NONE,
+        FIXED,                  /* a */
+        UNIFORM,                /* a to b */
+        NORMAL,                 /* Mean a, standard deviation b */
+        EXPONENTIAL,            /* Mean a */
+        PARETO                  /* Minimum a, shape b: heavy tail */
+    };
+
+    Kind kind;
+    double a;
+    double b;
+
+    double sample(FastRandom& random) const;
+};
+
+/* A message leaving the impairment layer */
+struct ImpairedMessage
+{
+    std::string topic;
+    std::string payload;
+};
+
+struct ImpairStats
+{
+    uint64_t submitted;         /* Messages handed to the layer */
+    uint64_t delivered;         /* Messages released, duplicates included */
+    uint64_t lost;              /* Dropped by the loss model or a full queue */
+    uint64_t duplicated;        /* Extra copies created */
+    uint64_t reordered;         /* Messages held back so later ones overtake them */
+    uint64_t outages;           /* Outages that held or dropped a message */
+    uint64_t outageHeld;        /* Messages submitted during an outage and held until its end */
+    uint64_t outageDropped;     /* Messages submitted during a dropping outage */
+    double delayMsTotal;        /* Sum of the delays applied, for the mean */
+    size_t maxQueued;           /* Most messages delayed at once */
+};
+
+/*
+ * Emulates an impaired network between the fix generator and the transport, as netem does for a link.
+ *
+ * Configured by a comma-separated specification, all probabilities in percent:
+ *   loss=P                      independent loss
+ *   loss=burst:P:R              Gilbert model: the link turns bad with P% per message, recovers with R%, loses all
+ *                               messages while bad
+ *   delay=MS | uniform:MIN:MAX | normal:MEAN:SD | exp:MEAN | pareto:MIN:SHAPE
+ *                               delay of each message, messages overtake each other as the delays vary
+ *   dup=P                       extra copy, with its own delay
+ *   reorder=P:GAP               the message is held back GAP ms more, so the following ones overtake it
+ *   outage=PERIOD:LENGTH[:drop] the link is down for LENGTH s every PERIOD s
+ *   outage=exp:UP:DOWN[:drop]   up and down times drawn with means UP s and DOWN s
+ *                               messages submitted while down are sent when the link is back, or lost with :drop
+ *   seed=N                      deterministic seed, the outages use a stream of their own
+ *
+ * Messages are held in a binary heap keyed by release time and FIFO order; a message that is neither delayed nor
+ * overtaken passes straight through, so the layer costs little more than its random draws.
+ */
+class ImpairmentLayer
+{
+public:
+    ImpairmentLayer();
+
+    bool configure(const std::string& spec, std::string& error);
+    bool enabled() const;
+    bool submit(std::string& topic, std::string& payload, int64_t nowUs);
+    void release(int64_t nowUs, std::vector<ImpairedMessage>& out);
+    int64_t nextReleaseUs() const;
+    size_t queued() const;
+    ImpairStats stats() const;
+
+private:
+    struct Held
+    {
+        int64_t releaseUs;
+        uint64_t order;         /* Submission order, keeps equal release times FIFO */
+        size_t slot;
+    };
+
+    static bool laterRelease(const Held& a, const Held& b);
+
+    void enqueue(std::string& topic, std::string& payload, int64_t releaseUs, int64_t nowUs, bool copy);
+    bool lose();
+    int64_t outageEnd(int64_t nowUs);
+
+    bool active;
+    FastRandom random;
+    FastRandom outageRandom;
+
+    // Loss model
+    double lossPercent;
+    bool burstLoss;
+    double badPercent;          /* Good to bad transition of the Gilbert model */
+    double recoverPercent;      /* Bad to good transition */
+    bool bad;
+
+    DelayDistribution delay;
+    double dupPercent;
+    double reorderPercent;
+    double reorderGapMs;
+
+    // Outages, from the first submission on
+    bool outagePeriodic;
+    bool outageExponential;
+    bool outageDrop;
+    double outageUp;            /* Period, or mean up time, in seconds */
+    double outageDown;          /* Length, or mean down time, in seconds */
+    int64_t originUs;
+    int64_t downStartUs;        /* Start of the current or next outage */
+    int64_t downEndUs;
+    bool outageCounted;         /* The current outage has met a message */
+
+    std::vector<Held> heap;
+    std::vector<ImpairedMessage> slots;
+    std::vector<size_t> freeSlots;
+    uint64_t nextOrder;
+    ImpairStats totals;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_IMPAIR_H__
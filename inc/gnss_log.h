@@ -0,0 +1,302 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_LOG_H__
+#define __GNSS_LOG_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <atomic>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define LOG_BUFFER_SIZE         (1U << 20)        /* Bytes of the staging buffer of each logging thread */
+#define LOG_MAX_STRING          (4096U)           /* Longer string arguments are truncated */
+#define LOG_FLUSH_INTERVAL_MS   (1)               /* Default pause of the writer thread when every buffer is empty */
+#define LOG_MAGIC               "GNSSLOG1"        /* First bytes of a binary log file */
+#define LOG_TEXT                "-"               /* Log path rendering text on stdout instead of a binary file */
+
+/* Chunks of a binary log file, each starting with its type byte */
+#define LOG_CHUNK_SITES         ('D')             /* Site count, then level, line, file, format, types */
+#define LOG_CHUNK_SYNC          ('S')             /* Tick counter, Unix time in ns and ticks per second */
+#define LOG_CHUNK_RECORDS       ('R')             /* Thread number, byte count, then records of that thread */
+
+/*
+ * Logs a message with its arguments in binary form; the text is only rendered by gnss_logdecode, or by the writer
+ * thread when logging to LOG_TEXT. Each "{}" in the format is replaced by the next argument, "{.N}" prints a floating
+ * point argument with N decimals. Integers, enums, floating point numbers, chars and strings are supported.
+ *
+ * The format, its call site and the argument types are placed in the gnss_log_sites section at compile time, so the
+ * call itself only copies the arguments into the staging buffer of the thread.
+ */
+#define LOG_INFO(format, ...)   GNSS_LOG(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG_ALERT(format, ...)  GNSS_LOG(LOG_LEVEL_ALERT, format, ##__VA_ARGS__)
+#define LOG_TRACE(format, ...)  GNSS_LOG(LOG_LEVEL_TRACE, format, ##__VA_ARGS__)
+
+#define GNSS_LOG(level, format, ...)                                                                                  \
+    do                                                                                                                \
+    {                                                                                                                 \
+        typedef decltype(logSignature(__VA_ARGS__)) LogTypes;                                                         \
+        static_assert(logPlaceholders(format) == LogTypes::count, "Arguments do not match the {} of the format");    \
+        __attribute__((section("gnss_log_sites"), used, aligned(8))) static LogSite logSite =                        \
+            { level, __LINE__, __FILE__, format, LogTypes::codes };                                                   \
+        logWrite(logSite, ##__VA_ARGS__);                                                                             \
+    } while (0)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+enum LogLevel
+{
+    LOG_LEVEL_TRACE,            /* Per-message audit trail, printed without a prefix */
+    LOG_LEVEL_INFO,             /* "[INFO] " */
+    LOG_LEVEL_ALERT             /* "[ALERT] " */
+};
+
+/* A log statement, one per call site; the sites of a binary are numbered by their place in gnss_log_sites */
+struct LogSite
+{
+    int level;
+    int line;
+    const char* file;
+    const char* format;
+    const char* types;          /* One code per argument: i, u, d, c or s */
+};
+
+static_assert(sizeof(LogSite) % 8 == 0, "Call sites must follow each other in gnss_log_sites without padding");
+
+/* Staging buffer of one thread, written by that thread and emptied by the writer thread */
+struct LogBuffer
+{
+    char* data;
+    size_t capacity;
+    size_t reserved;                        /* Producer only: position of the record being written */
+    size_t cachedConsumer;                  /* Producer only: last consumer position seen */
+    std::atomic<size_t> producer;           /* End of the committed records */
+    std::atomic<size_t> consumer;           /* Start of the records not yet written out */
+    std::atomic<size_t> wrapEnd;            /* End of the committed records when the producer wrapped around */
+    std::atomic<bool> retired;              /* The thread has exited, the buffer is freed once empty */
+    uint32_t thread;
+};
+
+/* Code and encoding of each argument type; integers and enums are widened to 64 bits */
+template<typename T, typename Enable = void>
+struct LogArg;
+
+template<typename T>
+struct LogScalarArg
+{
+    static size_t size(T) { return sizeof(T); }
+    static char* put(char* out, T value)
+    {
+        std::memcpy(out, &value, sizeof(value));
+        return out + sizeof(value);
+    }
+};
+
+template<typename T>
+struct LogArg<T, typename std::enable_if<std::is_enum<T>::value ||
+                                         (std::is_integral<T>::value && std::is_signed<T>::value)>::type>
+{
+    static constexpr char code = 'i';
+    static size_t size(T) { return sizeof(int64_t); }
+    static char* put(char* out, T value) { return LogScalarArg<int64_t>::put(out, (int64_t)value); }
+};
+
+template<typename T>
+struct LogArg<T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type>
+{
+    static constexpr char code = 'u';
+    static size_t size(T) { return sizeof(uint64_t); }
+    static char* put(char* out, T value) { return LogScalarArg<uint64_t>::put(out, (uint64_t)value); }
+};
+
+template<typename T>
+struct LogArg<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static constexpr char code = 'd';
+    static size_t size(T) { return sizeof(double); }
+    static char* put(char* out, T value) { return LogScalarArg<double>::put(out, (double)value); }
+};
+
+template<>
+struct LogArg<char> : LogScalarArg<char>
+{
+    static constexpr char code = 'c';
+};
+
+/* Strings are written as a 32-bit length and their bytes */
+struct LogStringArg
+{
+    static constexpr char code = 's';
+    static size_t clamp(size_t length) { return (length < LOG_MAX_STRING) ? length : LOG_MAX_STRING; }
+    static char* put(char* out, const char* text, size_t length)
+    {
+        uint32_t n = (uint32_t)length;
+        std::memcpy(out, &n, sizeof(n));
+        std::memcpy(out + sizeof(n), text, length);
+        return out + sizeof(n) + length;
+    }
+};
+
+template<>
+struct LogArg<std::string> : LogStringArg
+{
+    static size_t size(const std::string& s) { return sizeof(uint32_t) + clamp(s.size()); }
+    static char* put(char* out, const std::string& s) { return LogStringArg::put(out, s.data(), clamp(s.size())); }
+};
+
+template<>
+struct LogArg<const char*> : LogStringArg
+{
+    static size_t size(const char* s) { return sizeof(uint32_t) + clamp(std::strlen(s)); }
+    static char* put(char* out, const char* s) { return LogStringArg::put(out, s, clamp(std::strlen(s))); }
+};
+
+template<>
+struct LogArg<char*> : LogArg<const char*>
+{
+};
+
+/* Argument type codes of a call site, derived from the argument types without evaluating the arguments */
+template<typename... Args>
+struct LogSignature
+{
+    static constexpr size_t count = sizeof...(Args);
+    static constexpr char codes[sizeof...(Args) + 1] = { LogArg<Args>::code..., '\0' };
+};
+
+template<typename... Args>
+constexpr char LogSignature<Args...>::codes[];
+
+/***********************************************************************************************************************
+ * Exported global variables
+ **********************************************************************************************************************/
+extern thread_local LogBuffer* logThreadBuffer;
+extern std::atomic<bool> logActive;
+extern LogSite __start_gnss_log_sites[] __attribute__((weak));
+extern LogSite __stop_gnss_log_sites[] __attribute__((weak));
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool logOpen(const std::string& path);
+void logClose();
+void logSetIdlePause(int ms);
+uint64_t logDropped();
+LogBuffer* logAttach();
+char* logReserveSlow(LogBuffer* buffer, size_t size);
+void logDrop();
+size_t logSiteCount();
+const LogSite* logSiteAt(size_t index);
+bool logRender(const char* format, const char* types, const char*& data, const char* end, std::string& text);
+void logFormatLine(int level, int64_t unixNs, const std::string& message, std::string& line);
+
+template<typename... Args>
+LogSignature<typename std::decay<Args>::type...> logSignature(const Args&...);
+
+/*******************************************************************************************************************//**
+ * @brief Number of "{" in a format, each standing for one argument.
+ **********************************************************************************************************************/
+constexpr size_t logPlaceholders (const char* format)
+{
+    return (*format == '\0') ? 0 : ((*format == '{') ? 1 : 0) + logPlaceholders(format + 1);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Cycle counter of the CPU, converted to time by the sync chunks of the log.
+ **********************************************************************************************************************/
+inline uint64_t logTicks ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline size_t logArgsSize ()
+{
+    return 0;
+}
+
+template<typename T, typename... Rest>
+inline size_t logArgsSize (const T& first, const Rest&... rest)
+{
+    return LogArg<typename std::decay<T>::type>::size(first) + logArgsSize(rest...);
+}
+
+inline char* logPut (char* out)
+{
+    return out;
+}
+
+template<typename T, typename... Rest>
+inline char* logPut (char* out, const T& first, const Rest&... rest)
+{
+    return logPut(LogArg<typename std::decay<T>::type>::put(out, first), rest...);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Copies a record into the staging buffer of the calling thread: site number, ticks and the arguments.
+ *
+ * Waits for the writer thread when the buffer is full, so no record is lost while the log is open; records are
+ * dropped and counted when it is not.
+ **********************************************************************************************************************/
+template<typename... Args>
+inline void logWrite (const LogSite& site, const Args&... args)
+{
+    if (!logActive.load(std::memory_order_relaxed))
+    {
+        logDrop();
+        return;
+    }
+
+    size_t size = sizeof(uint32_t) + sizeof(uint64_t) + logArgsSize(args...);
+    LogBuffer* buffer = logThreadBuffer;
+    if (buffer == nullptr)
+    {
+        buffer = logAttach();
+    }
+
+    // Fast path: the record fits before the end of the buffer and behind the consumer
+    char* out;
+    size_t position = buffer->reserved;
+    if ((position >= buffer->cachedConsumer) ? (buffer->capacity - position > size)
+                                             : (buffer->cachedConsumer - position > size))
+    {
+        out = buffer->data + position;
+    }
+    else
+    {
+        out = logReserveSlow(buffer, size);
+        position = buffer->reserved;
+    }
+
+    uint32_t index = (uint32_t)(&site - __start_gnss_log_sites);
+    uint64_t ticks = logTicks();
+    std::memcpy(out, &index, sizeof(index));
+    std::memcpy(out + sizeof(index), &ticks, sizeof(ticks));
+    logPut(out + sizeof(index) + sizeof(ticks), args...);
+
+    buffer->reserved = position + size;
+    buffer->producer.store(position + size, std::memory_order_release);
+}
+
+#endif // __GNSS_LOG_H__
@@ -0,0 +1,44 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_NMEA_H__
+#define __GNSS_NMEA_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define GNSS_DEFAULT_DEVICE_ID  "default"         /* Device ID used when the topic carries no device level */
+#define GPRMC_MAX_LENGTH        (96U)             /* Longest sentence written by formatGPRMC(), without terminator */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A decoded position fix. Coordinates are signed decimal degrees (south and west are negative). */
+struct GNSSFix
+{
+    std::string deviceId;
+    int64_t     timestampMs;    /* UTC fix time in milliseconds since the epoch */
+    double      latitude;
+    double      longitude;
+    double      speedKnots;
+    double      course;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool parseGPRMC(const std::string& sentence, GNSSFix& fix);
+size_t formatGPRMC(const GNSSFix& fix, char* out);
+std::string deviceIdFromTopic(const std::string& topic);
+
+#endif // __GNSS_NMEA_H__
@@ -0,0 +1,67 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_PAYLOAD_H__
+#define __GNSS_PAYLOAD_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define PAYLOAD_MAGIC           "GNB1"            /* First bytes of a batch payload */
+#define PAYLOAD_MAGIC_SIZE      (4U)
+#define PAYLOAD_MAX_SENTENCES   (65535U)          /* Sentences per batch, bounded by the 16-bit count */
+#define PAYLOAD_MAX_DEVICE_ID   (255U)            /* Device ID length, bounded by the 8-bit length */
+#define PAYLOAD_MAX_SOURCES     (255U)            /* Devices merged into one batch, bounded by the 8-bit index */
+#define PAYLOAD_MAX_INFLATED    (16U * 1024U * 1024U) /* Largest decompressed body accepted */
+#define PAYLOAD_FLAG_DEFLATE    (0x01U)           /* Everything after the device ID is zlib-compressed */
+#define PAYLOAD_FLAG_SOURCES    (0x02U)           /* Each sentence names its device in a source table */
+#define PAYLOAD_FLAG_HMAC       (0x04U)           /* The payload ends with an HMAC-SHA256 tag, see gnss_auth.h */
+#define PAYLOAD_TAG_SIZE        (32U)             /* Size of the HMAC-SHA256 tag */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/*
+ * A sequenced batch of NMEA sentences from one device. Sentence i carries sequence number firstSequence + i, so the
+ * receiver can store every sentence exactly once however often the batch is delivered.
+ *
+ * A gateway merges the sentences of several local devices into one batch under its own device ID and sequence
+ * numbers; sources then holds the device IDs and sourceOf the index of each sentence's device.
+ *
+ * Wire layout, integers little endian:
+ *   "GNB1" | flags u8 | device length u8 | device | body
+ *   body: first sequence u64 | [sources u8 | sources x (length u8 | device)] | count u16 |
+ *         count x ([source u8] | length u16 | sentence)
+ * With PAYLOAD_FLAG_DEFLATE the body is replaced by its length u32 and its zlib stream. With PAYLOAD_FLAG_HMAC the
+ * payload ends with a tag of PAYLOAD_TAG_SIZE bytes over everything before it, keyed with the key of the device.
+ */
+struct PayloadBatch
+{
+    std::string deviceId;
+    uint64_t firstSequence;
+    std::vector<std::string> sentences;
+    std::vector<std::string> sources;       /* Devices of a merged batch, empty otherwise */
+    std::vector<uint8_t> sourceOf;          /* Index into sources of each sentence of a merged batch */
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool isBatchPayload(const char* data, size_t size);
+bool encodeBatch(const PayloadBatch& batch, std::string& out, bool compress = false);
+bool decodeBatch(const char* data, size_t size, PayloadBatch& batch);
+bool peekBatchHeader(const char* data, size_t size, uint8_t& flags, std::string& deviceId);
+const std::string& sentenceDevice(const PayloadBatch& batch, size_t index);
+
+#endif // __GNSS_PAYLOAD_H__
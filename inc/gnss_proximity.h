@@ -0,0 +1,148 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_PROXIMITY_H__
+#define __GNSS_PROXIMITY_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "gnss_nmea.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define PROXIMITY_MIN_M         (10.0)            /* Smallest clear distance, the grid cell being as wide */
+#define PROXIMITY_MAX_M         (100000.0)        /* Largest clear distance */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+enum ProximityEventType
+{
+    PROXIMITY_NEAR,             /* Two vehicles came within the near distance */
+    PROXIMITY_CLEAR,            /* They moved beyond the clear distance, or one of them fell silent */
+    PROXIMITY_CONVOY,           /* They have stayed near each other for the convoy time */
+    PROXIMITY_CONVOY_END        /* A convoy pair cleared; follows its PROXIMITY_CLEAR */
+};
+
+struct ProximityConfig
+{
+    double nearM;               /* A pair becomes near within this distance, */
+    double clearM;              /* and clears beyond this one, at least nearM */
+    int64_t convoyMs;           /* Time a pair stays near before it is reported as a convoy */
+    int64_t staleMs;            /* A vehicle without a fix for this long leaves the grid */
+};
+
+struct ProximityEvent
+{
+    ProximityEventType type;
+    uint32_t a;                 /* Vehicles of the pair, see ProximityEngine::device() */
+    uint32_t b;
+    int64_t timeMs;             /* Time of the step that found the change */
+    int64_t sinceMs;            /* Time of the step at which the pair became near */
+    double distanceM;           /* Distance at the last step the pair was within the clear distance */
+};
+
+struct ProximityStats
+{
+    size_t vehicles;            /* Heard from */
+    size_t active;              /* On the grid at the last step */
+    size_t cells;               /* Occupied cells at the last step */
+    size_t pairs;               /* Near pairs */
+    size_t convoys;             /* Of those, convoys */
+    uint64_t steps;
+    uint64_t tested;            /* Distances computed, over all steps */
+};
+
+/*
+ * Proximity and convoy detection over the latest position of every vehicle.
+ *
+ * update() records the latest fix of a vehicle as a point on the sphere, in metres. step() puts the vehicles heard
+ * from within the stale time on a grid of cubes as wide as the clear distance and radix sorts them by cell key, the
+ * cell coordinates packed with z lowest, so the cells of one (x, y) column are consecutive. Each cell is tested
+ * against itself and the 13 of its 26 neighbours that come after it, the next cell of its column and three cells of
+ * four neighbouring columns; as the key of a neighbour rises with the key of the cell, a cursor per column walks the
+ * sorted cells once, and every pair within the clear distance is found once without a lookup. The pairs found are
+ * sorted too and merged with the pair states of the previous step, which gives the hysteresis: a pair becomes near
+ * within nearM and stays near until it is found beyond clearM, or one of the vehicles leaves the grid. A pair near for
+ * convoyMs becomes a convoy.
+ */
+class ProximityEngine
+{
+public:
+    ProximityEngine();
+
+    void configure(const ProximityConfig& config);
+    void update(const GNSSFix& fix);
+    size_t step(int64_t nowMs, std::vector<ProximityEvent>& events);
+    const std::string& device(uint32_t vehicle) const;
+    ProximityStats stats() const;
+
+private:
+    struct Position
+    {
+        double x, y, z;
+    };
+
+    struct Entry
+    {
+        uint64_t key;           /* Cell of the vehicle */
+        uint32_t vehicle;
+    };
+
+    /* A pair within the clear distance at this step; the lower vehicle is in the high half of the key */
+    struct Found
+    {
+        uint64_t key;
+        double distanceM;
+    };
+
+    /* A near pair */
+    struct Pair
+    {
+        uint64_t key;
+        double distanceM;       /* At the last step the pair was within the clear distance */
+        int64_t sinceMs;
+        bool convoy;
+    };
+
+    void buildGrid(int64_t nowMs);
+    void joinGrid();
+    void mergePairs(int64_t nowMs, std::vector<ProximityEvent>& events);
+
+    ProximityConfig config;
+    double cellM;
+    std::unordered_map<std::string, uint32_t> vehicles;
+    std::vector<std::string> names;
+    std::vector<Position> positions;            /* Latest position per vehicle, on the sphere */
+    std::vector<int64_t> times;                 /* Time of the latest fix per vehicle */
+    std::vector<Entry> entries;                 /* Vehicles on the grid, sorted by cell */
+    std::vector<Entry> spareEntries;            /* The other buffer of their radix sort */
+    unsigned yShift;                            /* Cell keys of the last step: z below yShift, y below xShift, x */
+    unsigned xShift;
+    std::vector<uint64_t> cellKeys;             /* Key per occupied cell, ascending */
+    std::vector<uint32_t> cellStart;            /* First member per cell, and one past the last member */
+    std::vector<uint32_t> members;              /* Vehicles by cell */
+    std::vector<Position> memberPositions;      /* Their positions */
+    std::vector<Found> found;                   /* Pairs within the clear distance at this step */
+    std::vector<Found> spareFound;              /* The other buffer of their radix sort */
+    std::vector<Pair> pairs;                    /* Near pairs, sorted by key */
+    std::vector<Pair> nextPairs;                /* Those of this step while merging */
+    size_t convoys;
+    uint64_t steps;
+    uint64_t tested;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_PROXIMITY_H__
@@ -0,0 +1,102 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_RANDOM_H__
+#define __GNSS_RANDOM_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <cstdint>
+#include <cmath>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/*
+ * xoshiro256** generator, seeded with splitmix64, so a seed gives the same stream on every platform and nearby seeds
+ * give unrelated streams. Small enough to keep one per simulated vehicle or per thread.
+ */
+class FastRandom
+{
+public:
+    explicit FastRandom(uint64_t seed = 1);
+
+    uint64_t next();
+    double uniform();           /* In [0, 1) with 53 bits */
+    double normal();            /* Mean 0, standard deviation 1 */
+    bool chance(double percent);
+
+private:
+    uint64_t s[4];
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Seeds the generator, expanding the seed with splitmix64.
+ **********************************************************************************************************************/
+inline FastRandom::FastRandom (uint64_t seed)
+{
+    for (uint64_t& word : s)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        word = z ^ (z >> 31);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Next 64 random bits.
+ **********************************************************************************************************************/
+inline uint64_t FastRandom::next ()
+{
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Uniform number in [0, 1).
+ **********************************************************************************************************************/
+inline double FastRandom::uniform ()
+{
+    return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Standard normal number, with Box-Muller; one of the pair is enough.
+ **********************************************************************************************************************/
+inline double FastRandom::normal ()
+{
+    double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    return radius * std::cos(2.0 * M_PI * uniform());
+}
+
+/*******************************************************************************************************************//**
+ * @brief True with the given probability in percent; draws nothing for 0, so unused choices keep the stream.
+ **********************************************************************************************************************/
+inline bool FastRandom::chance (double percent)
+{
+    return (percent > 0.0) && (uniform() * 100.0 < percent);
+}
+
+#endif // __GNSS_RANDOM_H__
@@ -14,9 +14,34 @@
 #include <mosquitto.h>
 #include <sqlite3.h>
 #include <csignal>
+#include <cstdlib>
 #include <atomic>
 #include <iomanip>      // for std::put_time
 #include <chrono>       // for system clock
+#include <ctime>
+#include <vector>
+#include <sstream>
+#include <poll.h>
+#include <map>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <deque>
+#include "gnss_nmea.h"
+#include "gnss_hot_store.h"
+#include "gnss_subscriptions.h"
+#include "gnss_rules.h"
+#include "gnss_cdc.h"
+#include "gnss_payload.h"
+#include "gnss_broker.h"
+#include "gnss_udp.h"
+#include "gnss_broker_pool.h"
+#include "gnss_auth.h"
+#include "gnss_tenants.h"
+#include "gnss_log.h"
+#include "gnss_runtime.h"
+#include "gnss_devices.h"
+#include "gnss_proximity.h"
 
 /***********************************************************************************************************************
  * Macro definitions
@@ -25,6 +50,89 @@
 /***********************************************************************************************************************
  * Typedef definitions
  **********************************************************************************************************************/
+struct ReceivedMessage
+{
+    std::string topic;
+    std::string payload;
+    bool datagram;              /* Received on the UDP input rather than over MQTT */
+    size_t broker;              /* Index of the broker it came from, BrokerPool::none for datagrams */
+    AuthResult auth;            /* Outcome of the tag check, AUTH_UNSIGNED when no device has a key */
+};
+
+/* An accepted batch waiting in the queue of its tenant */
+struct QueuedBatch
+{
+    PayloadBatch batch;
+    size_t broker;              /* Index of the broker it came from, BrokerPool::none for datagrams */
+    bool datagram;
+    int64_t receivedMs;         /* Wall clock time of arrival in milliseconds since the epoch */
+};
+
+/* Outcome of storing one sentence */
+enum StoreResult
+{
+    STORE_INSERTED,             /* A new row */
+    STORE_DUPLICATE,            /* The sequence number of the device is already stored */
+    STORE_ERROR                 /* The insert failed; the transaction must not be committed */
+};
+
+/* Commit confirmations to publish, one line per batch, by the broker the batches came from and their device */
+typedef std::map<std::pair<size_t, std::string>, std::string> CommitAcks;
+
+/* Command line options of the receiver */
+struct ReceiverConfig
+{
+    std::string host;
+    int port;
+    std::vector<BrokerEndpoint> brokers;    /* --broker list, --host and --port when none is given */
+    int qos;                    /* QoS of the data subscription */
+    std::string clientId;       /* Set for a persistent session: the broker queues data while the receiver is down */
+    int embeddedBrokerPort;     /* Runs the embedded broker on this port when non-zero */
+    std::string udpListen;      /* "address:port" of the UDP input, disabled when empty */
+    TlsConfig tls;              /* TLS towards the brokers, off unless --tls-ca or --tls-psk is given */
+    int authWorkers;            /* Threads helping with the HMAC checks, besides the loop thread */
+    std::string logPath;        /* Binary log file, or LOG_TEXT to render the log on stdout */
+    bool fixClock;              /* --clock fix: retention follows the latest fix time instead of the wall clock */
+    ProximityConfig proximity;  /* Proximity and convoy detection, off while nearM is 0 */
+};
+
+/* State shared by the tasks of the receiver, all run by one event loop */
+struct ReceiverState
+{
+    ReceiverConfig config;
+    EventLoop loop;
+    AsyncEvent storeWork;                   /* Set when batches were queued for the storage task */
+    AsyncEvent reorderWork;                 /* Set when the storage task left fixes in the reorder buffers */
+    sqlite3* db;
+    ChangeCapture changeCapture;            /* Streams committed rows to downstream consumers */
+    SubscriptionEngine subscriptions;       /* Continuous queries registered by dashboards */
+    BrokerPool brokers;
+    DuplicateFilter duplicates;             /* Drops copies of a message arriving over several brokers */
+    bool federated;                         /* More than one broker, so copies can arrive */
+    PayloadVerifier verifier;
+    std::vector<AuthCheck> authChecks;
+    RuleEngine rules;
+    DeviceRegistry devices;                 /* Clock and delay estimates and reorder buffers of the devices */
+    std::vector<GNSSFix> fixes;             /* Fixes released in time order, checked against the rules */
+    std::vector<std::pair<GNSSFix, int64_t>> uncommitted;  /* Fixes of the open transaction and their arrival */
+    ProximityEngine proximity;              /* Latest positions and near pairs of the vehicles */
+    CommitAcks acks;
+    HotStore hotStore;
+    int64_t latestFixMs;
+    int64_t lastEvictionMs;
+    UdpReceiver udp;
+    SequenceTracker udpSequences;
+    TenantScheduler tenants;
+    std::vector<std::deque<QueuedBatch>> tenantQueues;
+    std::vector<size_t> picks;
+    std::vector<size_t> picked;             /* Batches of each tenant in the open transaction, popped once committed */
+    QueuedBatch queued;                     /* Reused for every received message */
+
+    ReceiverState()
+        : storeWork(loop), reorderWork(loop), db(nullptr), federated(false), latestFixMs(0), lastEvictionMs(0)
+    {
+    }
+};
 
 /**********************************************************************************************************************
  * Exported global variables
@@ -33,10 +141,34 @@
 /***********************************************************************************************************************
  * Function declarations
  **********************************************************************************************************************/
+bool parseReceiverArgs(int argc, char* argv[], ReceiverConfig& config);
 sqlite3* initDatabase();
-void on_message(struct mosquitto* mosq, void* userdata, const struct mosquitto_message* message);
+void on_message(size_t broker, const struct mosquitto_message* message, SubscriptionEngine& engine);
+bool unpackMessage(const ReceivedMessage& received, PayloadBatch& batch);
 void logGNSSData(const std::string& gnssData);
 bool validateNMEAFormat(const std::string& gnssData);
-void storeValidData(sqlite3* db, const std::string& gnssData);
+StoreResult storeValidData(sqlite3* db, const std::string& gnssData, const std::string& deviceId, int64_t sequence);
+bool decodeGNSSData(const std::string& deviceId, const std::string& gnssData, GNSSFix& fix);
+void publishCommitAcks(BrokerPool& brokers, int qos, const CommitAcks& acks);
+void handleSubscriptionRequest(SubscriptionEngine& engine, const std::string& topic, const std::string& spec);
+void pushSubscriptionUpdates(BrokerPool& brokers, SubscriptionEngine& engine);
+void loadRuleFile(RuleEngine& engine, const std::string& path);
+bool loadKeyFile(PayloadVerifier& verifier, const std::string& path);
+void authenticateMessages(PayloadVerifier& verifier, std::vector<AuthCheck>& checks);
+bool sourcesAuthorized(const PayloadVerifier& verifier, const ReceivedMessage& received, const PayloadBatch& batch);
+void logAuthStats(const PayloadVerifier& verifier);
+bool loadTenantFile(TenantScheduler& scheduler, const std::string& path);
+bool queueBatch(TenantScheduler& scheduler, std::vector<std::deque<QueuedBatch>>& queues, QueuedBatch& queued,
+                int64_t nowUs);
+void logTenantStats(TenantScheduler& scheduler);
+void evaluateRules(BrokerPool& brokers, RuleEngine& engine, const std::vector<GNSSFix>& fixes);
+void logHotStoreStats(const HotStore& store);
+void logBrokerStats(const BrokerPool& brokers, bool tls);
+void receiveDatagrams(UdpReceiver& udp);
+void logSequenceStats(const SequenceTracker& tracker, const UdpReceiver& udp);
+void logDeviceStats(const DeviceRegistry& registry);
+void publishProximityEvents(BrokerPool& brokers, const ProximityEngine& engine,
+                            const std::vector<ProximityEvent>& events);
+void logProximityStats(const ProximityEngine& engine);
 
 #endif // __GNSS_RECEIVER_H__
@@ -0,0 +1,149 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_RULES_H__
+#define __GNSS_RULES_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "gnss_nmea.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define RULES_MAX_NODES         (65536U)          /* Maximum program size of a rule set */
+#define RULE_NODE_IMM           (0xFFFFFFFFU)     /* Operand b of a binary node is the immediate value */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Per-fix inputs a rule can read. Derived fields compare the fix with the previous fix of the same device. */
+enum RuleField
+{
+    RULE_FIELD_SPEED = 0,       /* Speed in km/h */
+    RULE_FIELD_KNOTS,           /* Speed in knots as reported */
+    RULE_FIELD_COURSE,          /* Course over ground in degrees */
+    RULE_FIELD_LAT,
+    RULE_FIELD_LON,
+    RULE_FIELD_HOUR,            /* Hour of day of the fix in the configured time zone */
+    RULE_FIELD_WEEKDAY,         /* 0 = Sunday */
+    RULE_FIELD_DT,              /* Seconds since the previous fix, 0 for the first fix */
+    RULE_FIELD_PREV_SPEED,      /* Speed of the previous fix in km/h */
+    RULE_FIELD_ACCEL,           /* Speed change in km/h per second */
+    RULE_FIELD_DISTANCE,        /* Metres travelled since the previous fix */
+    RULE_FIELD_COUNT
+};
+
+/*
+ * Operations of the flat program. Numeric nodes produce a column of doubles, predicate nodes a bit mask with one bit
+ * per fix, so and/or/not combine 64 fixes per instruction. Binary operations read nodes a and b, or node a and imm
+ * when b is RULE_NODE_IMM; unary operations read node a.
+ */
+enum RuleOp
+{
+    RULE_OP_FIELD = 0,          /* Numeric: field column a */
+    RULE_OP_CONST,              /* Numeric: constant imm */
+    RULE_OP_ADD, RULE_OP_SUB, RULE_OP_MUL, RULE_OP_DIV,
+    RULE_OP_NEG,
+    RULE_OP_TO_NUM,             /* Numeric: 1 or 0 from predicate a */
+    RULE_OP_IN_ZONE,            /* Predicate: the fix lies in zones[a] */
+    RULE_OP_LT, RULE_OP_LE, RULE_OP_GT, RULE_OP_GE, RULE_OP_EQ, RULE_OP_NE,
+    RULE_OP_AND, RULE_OP_OR, RULE_OP_NOT,
+    RULE_OP_TO_MASK             /* Predicate: numeric a is non-zero */
+};
+
+/*
+ * One instruction of the flat program. Nodes only refer to earlier nodes, so the program runs front to back, and
+ * identical subexpressions of different rules share a single node.
+ */
+struct RuleNode
+{
+    uint8_t  op;
+    uint32_t a;
+    uint32_t b;
+    double   imm;
+    uint32_t slot;              /* Scratch column holding the result, reused once the node is no longer read */
+};
+
+struct RuleZone
+{
+    std::string name;
+    double minLat, minLon, maxLat, maxLon;
+};
+
+struct CompiledRule
+{
+    std::string name;
+    uint32_t root;              /* Node holding the result of the rule */
+};
+
+/* An immutable set of rules. The engine swaps whole sets, so evaluations never see a half-loaded file. */
+struct RuleSet
+{
+    std::vector<RuleNode> nodes;
+    std::vector<CompiledRule> rules;
+    std::vector<RuleZone> zones;
+    std::vector<std::pair<uint32_t, uint32_t>> roots;   /* (node, rule) pairs sorted by node */
+    uint32_t numberSlots;
+    uint32_t maskSlots;
+    int utcOffsetHours;
+};
+
+struct RuleMatch
+{
+    uint32_t rule;              /* Index into RuleSet::rules */
+    uint32_t fix;               /* Index into the evaluated batch */
+};
+
+/*
+ * Evaluates rule sets against batches of fixes. Instead of running every rule per fix, each node of the program is
+ * applied to the whole batch column by column, so the dispatch cost is paid once per batch, shared subexpressions are
+ * computed once, and the scratch columns stay in cache.
+ */
+class RuleEngine
+{
+public:
+    RuleEngine();
+
+    bool load(const std::string& text, std::string& error);
+    bool loadFile(const std::string& path, std::string& error);
+    std::shared_ptr<const RuleSet> current() const;
+    size_t evaluate(const std::vector<GNSSFix>& fixes, std::vector<RuleMatch>& matches,
+                    std::shared_ptr<const RuleSet>& rules);
+
+private:
+    struct DeviceState
+    {
+        int64_t timestampMs;
+        double latitude;
+        double longitude;
+        double speedKmh;
+    };
+
+    void extractFields(const std::vector<GNSSFix>& fixes, int utcOffsetHours);
+
+    std::shared_ptr<const RuleSet> ruleSet;
+    std::unordered_map<std::string, DeviceState> devices;
+    std::vector<double> columns[RULE_FIELD_COUNT];
+    std::vector<double> values;                 /* One batch-sized column per numeric scratch slot */
+    std::vector<uint64_t> masks;                /* One batch-sized bit mask per predicate scratch slot */
+    std::vector<const double*> numbers;         /* Column of each numeric node, either a field or values */
+    std::vector<const uint64_t*> bits;          /* Mask of each predicate node */
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+std::shared_ptr<RuleSet> compileRules(const std::string& text, std::string& error);
+bool isPredicateOp(uint8_t op);
+
+#endif // __GNSS_RULES_H__
@@ -0,0 +1,264 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_RUNTIME_H__
+#define __GNSS_RUNTIME_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <coroutine>
+#include <deque>
+#include <list>
+#include <map>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <exception>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define RUNTIME_MAX_EVENTS      (64)              /* Readiness events taken per epoll_wait call */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+class EventLoop;
+
+/*
+ * A coroutine run by an EventLoop, e.g. "Task receive(State& state) { for (;;) { co_await ...; } }".
+ *
+ * It does not start until it is handed to EventLoop::spawn(), which owns it from then on. Its frame is freed when it
+ * returns, or when the loop is destroyed while it is suspended. Nothing awaits a task; tasks talk through the state
+ * they share, an AsyncEvent or an AsyncQueue.
+ */
+class Task
+{
+public:
+    struct promise_type
+    {
+        EventLoop* loop = nullptr;
+        std::list<std::coroutine_handle<>>::iterator self;      /* Entry in the task list of the loop */
+
+        ~promise_type();
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { if (handle) { handle.destroy(); } }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+
+    friend class EventLoop;
+};
+
+/*
+ * Single-threaded executor of coroutine tasks, over one epoll set and one timer list.
+ *
+ * Tasks suspend on a timer, on a descriptor becoming readable or on an AsyncEvent or AsyncQueue, and cost their frame
+ * and nothing else while they wait, so thousands of them need no thread each. Each turn of run() polls the descriptors,
+ * without waiting when a task is ready, moves the expired timers to the ready list and then resumes the tasks that were
+ * ready at that point, in order; a task resumed later in the same turn, e.g. by a queue, waits for the next turn.
+ *
+ * Only the thread running the loop may spawn tasks or touch the events and queues its tasks wait on.
+ */
+class EventLoop
+{
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        int fd;                 /* Descriptor waited for, -1 for a timer alone */
+        bool ready;             /* The descriptor became readable, rather than the timer ran out */
+        bool timed;             /* The wait has a deadline, its entry in the timer list is timer */
+        std::multimap<int64_t, Waiter*>::iterator timer;
+    };
+
+public:
+    /* Awaitable of sleepUntil() and readable() */
+    class WaitAwaiter
+    {
+    public:
+        WaitAwaiter(EventLoop& loop, int fd, int64_t dueUs)
+            : loop(loop), dueUs(dueUs), waiter{ nullptr, fd, false, false, {} }
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { loop.suspend(waiter, handle, dueUs); }
+        bool await_resume() const noexcept { return waiter.ready; }
+
+    private:
+        EventLoop& loop;
+        int64_t dueUs;
+        Waiter waiter;
+    };
+
+    /* Awaitable of yield() */
+    class YieldAwaiter
+    {
+    public:
+        explicit YieldAwaiter(EventLoop& loop) : loop(loop) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { loop.schedule(handle); }
+        void await_resume() const noexcept {}
+
+    private:
+        EventLoop& loop;
+    };
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void spawn(Task task);
+    void run(const std::atomic<bool>& running);
+    void schedule(std::coroutine_handle<> handle);
+    size_t tasks() const;
+    uint64_t turns() const;
+
+    WaitAwaiter sleepUntil(int64_t dueUs) { return WaitAwaiter(*this, -1, dueUs); }
+    WaitAwaiter sleep(int64_t ms) { return WaitAwaiter(*this, -1, nowUs() + ms * 1000); }
+    WaitAwaiter readable(int fd, int64_t timeoutMs)
+    {
+        return WaitAwaiter(*this, fd, (timeoutMs < 0) ? -1 : nowUs() + timeoutMs * 1000);
+    }
+    YieldAwaiter yield() { return YieldAwaiter(*this); }
+
+    static int64_t nowUs();
+
+private:
+    void suspend(Waiter& waiter, std::coroutine_handle<> handle, int64_t dueUs);
+    void finished(std::list<std::coroutine_handle<>>::iterator task);
+
+    int epollFd;
+    std::list<std::coroutine_handle<>> taskList;    /* Every spawned task that has not returned */
+    std::deque<std::coroutine_handle<>> ready;      /* Tasks to resume, in order */
+    std::multimap<int64_t, Waiter*> timers;         /* Waits with a deadline, by deadline on the steady clock */
+    uint64_t turnCount;
+
+    friend struct Task::promise_type;
+};
+
+/*
+ * Wakes one task waiting for something to do, e.g. for work another task has queued. A set() without a waiter is
+ * remembered, so the next wait returns at once, and several set() calls before the wait count as one.
+ */
+class AsyncEvent
+{
+public:
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(AsyncEvent& event) : event(event) {}
+
+        bool await_ready() const noexcept { return event.signalled; }
+        void await_suspend(std::coroutine_handle<> handle) { event.waiter = handle; }
+        void await_resume() const noexcept { event.signalled = false; }
+
+    private:
+        AsyncEvent& event;
+    };
+
+    explicit AsyncEvent(EventLoop& loop) : loop(loop), signalled(false) {}
+
+    void set()
+    {
+        signalled = true;
+        if (waiter)
+        {
+            loop.schedule(std::exchange(waiter, nullptr));
+        }
+    }
+
+    Awaiter wait() { return Awaiter(*this); }
+
+private:
+    EventLoop& loop;
+    bool signalled;
+    std::coroutine_handle<> waiter;
+};
+
+/*
+ * Unbounded queue between tasks with one consumer, e.g. the fixes of one device for the task that tracks it.
+ * "co_await queue.pop(value)" takes the oldest element, waiting for one if the queue is empty, and returns false once
+ * the queue is closed and drained.
+ */
+template<typename T>
+class AsyncQueue
+{
+public:
+    class Awaiter
+    {
+    public:
+        Awaiter(AsyncQueue& queue, T& value) : queue(queue), value(value) {}
+
+        bool await_ready() const noexcept { return !queue.items.empty() || queue.closed; }
+        void await_suspend(std::coroutine_handle<> handle) { queue.waiter = handle; }
+        bool await_resume()
+        {
+            if (queue.items.empty())
+            {
+                return false;
+            }
+            value = std::move(queue.items.front());
+            queue.items.pop_front();
+            return true;
+        }
+
+    private:
+        AsyncQueue& queue;
+        T& value;
+    };
+
+    explicit AsyncQueue(EventLoop& loop) : loop(loop), closed(false) {}
+
+    void push(T value)
+    {
+        items.push_back(std::move(value));
+        wake();
+    }
+
+    void close()
+    {
+        closed = true;
+        wake();
+    }
+
+    Awaiter pop(T& value) { return Awaiter(*this, value); }
+    size_t size() const { return items.size(); }
+
+private:
+    void wake()
+    {
+        if (waiter)
+        {
+            loop.schedule(std::exchange(waiter, nullptr));
+        }
+    }
+
+    EventLoop& loop;
+    std::deque<T> items;
+    bool closed;
+    std::coroutine_handle<> waiter;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_RUNTIME_H__
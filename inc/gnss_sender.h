@@ -9,25 +9,110 @@
 /***********************************************************************************************************************
  * Includes
  **********************************************************************************************************************/
-#include <iostream>
 #include <string>
 #include <mosquitto.h>
 #include <ctime>        // For std::time and std::gmtime
 #include <cstring>
+#include <cstdio>       // For std::snprintf
 #include <cstdlib>      // For std::rand
 #include <chrono>
 #include <thread>
-#include <iomanip>      // For std::setw and std::setfill
-#include <sstream>      // For std::stringstream
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>     // For fsync
+#include <sys/resource.h>   // For getrusage
+#include "gnss_payload.h"
+#include "gnss_udp.h"
+#include "gnss_gateway.h"
+#include "gnss_broker_pool.h"
+#include "gnss_auth.h"
+#include "gnss_log.h"
+#include "gnss_impair.h"
+#include "gnss_clock.h"
 
 /***********************************************************************************************************************
  * Macro definitions
  **********************************************************************************************************************/
+#define SENDER_DEFAULT_COUNT        (5)               /* Messages published when --count is not given */
+#define SENDER_DEFAULT_INTERVAL_MS  (2000)            /* Pause between messages when --interval-ms is not given */
+#define SENDER_DEFAULT_DEVICE       "default"         /* Device of exactly-once mode when --device is not given */
+#define SENDER_LOG_FILE             "gnss_sender"     /* Default binary log, followed by the device and ".binlog" */
+#define GATEWAY_DEFAULT_BATCH       (512)             /* Sentences per uplink batch in gateway mode without --batch */
+#define SENDER_MAX_BACKLOG          (1000U)           /* Unacknowledged messages at which --speed max waits */
+#define SENDER_MAX_SENTENCE         (96U)             /* Buffer of one generated sentence, with its terminator */
+#define SENDER_MAX_SLACK_MS         (POOL_MISC_MS)    /* Largest --slack, keeps the keep-alive checks in time */
 
 /***********************************************************************************************************************
  * Typedef definitions
  **********************************************************************************************************************/
 
+/* Command line options of the sender */
+struct SenderConfig
+{
+    std::string host;
+    int port;
+    std::vector<BrokerEndpoint> brokers;            /* --broker list, --host and --port when none is given */
+    int qos;
+    std::string deviceId;       /* Publishes on "gnss/data/<device>" when set, on "gnss/data" otherwise */
+    std::string clientId;
+    int count;                  /* Number of fixes to send */
+    int intervalMs;             /* Pause between fixes */
+    int batchSize;              /* Fixes per message, more than one sends sequenced batches */
+    int vehicles;               /* Simulated vehicles, each fix goes to the next one */
+    bool exactlyOnce;           /* Sequenced batches retained until the receiver confirms their commit */
+    std::string udpTarget;      /* "host:port" to send sequenced datagrams to instead of MQTT */
+    std::vector<GatewayInputSpec> gatewayInputs;    /* Local inputs forwarded in gateway mode */
+    TlsConfig tls;              /* TLS towards the brokers, off unless --tls-ca or --tls-psk is given */
+    std::string hmacKey;        /* --hmac-key: raw key signing every batch, unsigned plain fixes when empty */
+    std::string logPath;        /* Binary log file, or LOG_TEXT to render the log on stdout */
+    std::string impairSpec;     /* --impair: emulated loss, delay and outages before the transport, none when empty */
+    double speed;               /* --speed: simulated time per wall clock time, CLOCK_AS_FAST_AS_POSSIBLE for "max" */
+    int64_t startMs;            /* --start: simulated time of the first fix, negative for the current time */
+    int slackMs;                /* --slack: timed work is aligned to wakeup slots this far apart, 0 to poll instead */
+};
+
+/* A batch published in exactly-once mode and not yet confirmed by the receiver */
+struct OutboxEntry
+{
+    std::string payload;
+    int64_t sentAtMs;
+};
+
+/* State shared by the main loop and the broker pool handlers */
+struct SenderState
+{
+    SenderConfig config;
+    std::string topic;
+    bool sequenced;                         /* Batches are numbered: exactly-once, UDP or HMAC mode */
+    std::string sequenceFile;
+    uint64_t nextSequence;
+    uint64_t reservedSequence;              /* Sequences below this value are recorded as used */
+    std::string fix;                        /* Sentence of the latest fix, its buffer reused for every fix */
+    std::string vehicleTopic;               /* Topic of the latest simulated vehicle, reused likewise */
+    std::vector<std::string> sentences;     /* Fixes of the batch being assembled */
+    std::map<uint64_t, OutboxEntry> outbox; /* Keyed by the last sequence number of the batch */
+    uint64_t fixesSent;
+    uint64_t messagesQueued;
+    BrokerPool pool;                        /* Connections to the MQTT brokers */
+    UdpSender udp;                          /* Output of UDP mode */
+    GatewayInputs inputs;                   /* Local devices of gateway mode */
+    GatewaySpool spool;                     /* Unconfirmed batches of exactly-once mode, on disk */
+    std::vector<GatewaySentence> pending;   /* Sentences of gateway mode waiting for the next batch */
+    int64_t batchStartMs;                   /* Arrival of the oldest pending sentence */
+    uint64_t rawBytes;                      /* Bytes of the sentences sent in gateway mode */
+    uint64_t uplinkBytes;                   /* Bytes of the batches carrying them */
+    uint64_t batchesDropped;                /* Unconfirmed batches dropped to bound the spool */
+    ImpairmentLayer impair;                 /* Emulated network between the fixes and the transport */
+    std::vector<ImpairedMessage> released;  /* Messages the impairment layer has let through, reused */
+    VirtualClock clock;                     /* Time of the simulated fixes and their schedule */
+    uint64_t wakeups;                       /* Returns from the waits of the main loop */
+};
+
 /**********************************************************************************************************************
  * Exported global variables
  **********************************************************************************************************************/
@@ -35,8 +120,13 @@
 /***********************************************************************************************************************
  * Function declarations
  **********************************************************************************************************************/
-std::string generateGNSSData();
-void on_publish(struct mosquitto *mosq, void *obj, int mid);
-void gnssDataHandler(struct mosquitto *mosq);
+void generateGNSSData(int64_t timeMs, std::string& out);
+bool parseSenderArgs(int argc, char* argv[], SenderConfig& config);
+bool loadSequence(SenderState& state);
+void on_connect(SenderState& state, size_t broker);
+void on_message(SenderState& state, const struct mosquitto_message *message);
+void gnssDataHandler(SenderState& state);
+void flushBatch(SenderState& state);
+void retransmitOutbox(SenderState& state, bool all);
 
 #endif // __GNSS_SENDER_H__
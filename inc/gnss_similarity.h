@@ -0,0 +1,64 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_SIMILARITY_H__
+#define __GNSS_SIMILARITY_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "gnss_hot_store.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define SIMILARITY_MAX_BAND     (31U)             /* Widest alignment band, in grid steps either way */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+enum SimilarityMetric
+{
+    SIMILARITY_DTW,             /* Root mean square distance along the best warping path */
+    SIMILARITY_FRECHET          /* Largest distance along the best coupling, the discrete Frechet distance */
+};
+
+/*
+ * A track resampled on a regular time grid, in metres east and north of a local origin. Grid points outside the span
+ * of the fixes are NaN; points inside are interpolated between the fixes around them and counted as covered when
+ * those are at most the gap apart.
+ */
+struct SimilarityTrack
+{
+    int64_t startMs;
+    int64_t stepMs;
+    std::vector<double> x;
+    std::vector<double> y;
+    size_t first;               /* First and one past the last grid point within the span, first == last if none */
+    size_t last;
+    size_t covered;
+};
+
+/* Equirectangular projection around an origin, accurate to a fraction of a percent over a few hundred kilometres */
+struct SimilarityOrigin
+{
+    double lat;
+    double lon;
+    double metresPerDegLon;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+SimilarityOrigin makeSimilarityOrigin(double lat, double lon);
+void resampleTrack(const std::vector<FixSample>& samples, const SimilarityOrigin& origin, int64_t startMs,
+                   int64_t stepMs, size_t count, int64_t maxGapMs, SimilarityTrack& out);
+double trackDistance(SimilarityMetric metric, const double* ax, const double* ay, const double* bx, const double* by,
+                     size_t count, unsigned band, double limitM);
+
+#endif // __GNSS_SIMILARITY_H__
@@ -0,0 +1,85 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_SUBSCRIPTIONS_H__
+#define __GNSS_SUBSCRIPTIONS_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <cstdint>
+#include "gnss_nmea.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define SUBSCRIPTION_CELL_DEG       (1.0)         /* Grid cell size of the subscription index in degrees */
+#define SUBSCRIPTION_MAX_CELLS      (4096U)       /* Rectangles covering more cells are kept in a scan-always list */
+#define SUBSCRIPTION_FLUSH_MS       (250)         /* Coalescing window of pushed updates */
+#define SUBSCRIPTION_MAX_BATCH      (512U)        /* Pending updates that force an early flush of a client */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Called with the client ID and the payload of one coalesced batch. */
+typedef std::function<void(const std::string&, const std::string&)> PushPublisher;
+
+/*
+ * Continuous queries registered by clients. A client holds any number of bounding-box and device-set filters; every
+ * incoming fix is matched against the candidate filters of its grid cell and of its device only, and the latest fix
+ * per device is pushed to each interested client once per coalescing window.
+ */
+class SubscriptionEngine
+{
+public:
+    SubscriptionEngine();
+
+    bool registerClient(const std::string& clientId, const std::string& spec, std::string& error);
+    void removeClient(const std::string& clientId);
+    size_t match(const GNSSFix& fix);
+    size_t flush(int64_t nowMs, const PushPublisher& publish);
+    size_t clientCount() const;
+
+private:
+    struct Rect
+    {
+        double minLat, minLon, maxLat, maxLon;
+    };
+
+    struct Client
+    {
+        std::vector<Rect> rects;
+        std::vector<std::string> devices;
+        std::map<std::string, GNSSFix> pending;   /* Latest unsent fix per device, ordered for stable output */
+        int64_t lastFlushMs;
+    };
+
+    void indexClient(uint32_t slot, const Client& client);
+    void unindexClient(uint32_t slot, const Client& client);
+    static int64_t cellKey(int latCell, int lonCell);
+    static int cellOf(double degrees);
+
+    std::unordered_map<std::string, uint32_t> slots;
+    std::vector<std::string> slotClients;                             /* Client ID per slot, empty when free */
+    std::vector<Client> clients;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<int64_t, std::vector<uint32_t>> cells;         /* Grid cell to client slots */
+    std::vector<uint32_t> wideClients;                                /* Slots with rectangles too large to index */
+    std::unordered_map<std::string, std::vector<uint32_t>> deviceIndex;
+    std::unordered_set<uint32_t> dirty;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_SUBSCRIPTIONS_H__
@@ -0,0 +1,131 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_TENANTS_H__
+#define __GNSS_TENANTS_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define TENANT_DEFAULT          "default"         /* Tenant of the devices no prefix matches */
+#define TENANT_QUANTUM_FIXES    (256U)            /* Fixes a tenant of weight 1 may store per round */
+#define TENANT_MAX_QUEUED       (1000000U)        /* Fixes queued per tenant before new batches are dropped */
+#define LATENCY_BUCKETS         (128U)            /* Four buckets per power of two, from 1 us to about 70 minutes */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Log-scale histogram of latencies in microseconds, accurate to about 19% */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(int64_t us);
+    int64_t percentile(double fraction) const;
+    int64_t max() const;
+    uint64_t count() const;
+    void reset();
+
+private:
+    static size_t bucketOf(int64_t us);
+    static int64_t bucketLimit(size_t bucket);
+
+    uint64_t buckets[LATENCY_BUCKETS];
+    uint64_t samples;
+    int64_t largest;
+};
+
+struct TenantStats
+{
+    std::string name;
+    unsigned weight;
+    double quota;               /* Stored fixes per second, 0 for no limit */
+    uint64_t stored;            /* Fixes of the items reported stored */
+    uint64_t dropped;           /* Fixes of batches refused on a full queue */
+    uint64_t throttled;         /* Rounds in which the quota held the tenant back */
+    size_t queued;              /* Fixes waiting */
+    int64_t p50Us;              /* Queueing and commit latency since the last reset */
+    int64_t p99Us;
+    int64_t maxUs;
+};
+
+/*
+ * Weighted deficit round robin over per-tenant queues, with a storage quota per tenant.
+ *
+ * Tenants are configured with "tenant <name> <weight> <quota fixes/s> [device prefix]..." lines; a device belongs to
+ * the tenant of its longest matching prefix, or to TENANT_DEFAULT. The scheduler only accounts for the queues: the
+ * caller keeps the items in one FIFO per tenant, reports each arrival with admit() and, once completed() reports them
+ * stored, pops one item of the tenant for every index schedule() returned; items not stored are queued again. Each
+ * round a backlogged tenant may store TENANT_QUANTUM_FIXES times its weight, so a burst of one fleet is spread over the
+ * rounds while the other fleets keep their share; a quota additionally caps the fixes per second of a tenant, even
+ * when the others are idle.
+ */
+class TenantScheduler
+{
+public:
+    TenantScheduler();
+
+    bool load(const std::string& text, std::string& error);
+    bool loadFile(const std::string& path, std::string& error);
+    size_t size() const;
+    size_t tenantOf(const std::string& deviceId) const;
+    bool admit(size_t tenant, size_t cost, int64_t nowUs);
+    size_t schedule(size_t budget, int64_t nowUs, std::vector<size_t>& picks);
+    void completed(int64_t nowUs, bool stored);
+    size_t backlog() const;
+    std::vector<TenantStats> stats() const;
+    void resetLatency();
+
+private:
+    struct Entry
+    {
+        size_t cost;            /* Fixes of the queued batch */
+        int64_t arrivalUs;
+    };
+
+    struct Tenant
+    {
+        std::string name;
+        unsigned weight;
+        double quota;
+        double tokens;          /* Fixes the quota still allows, refilled continuously up to one second's worth */
+        int64_t refilledUs;
+        size_t deficit;
+        size_t queued;
+        std::deque<Entry> queue;
+        uint64_t stored;
+        uint64_t dropped;
+        uint64_t throttled;
+        LatencyHistogram latency;
+    };
+
+    void addTenant(const std::string& name, unsigned weight, double quota);
+    bool quotaAllows(Tenant& tenant, size_t cost, int64_t nowUs);
+
+    std::vector<Tenant> tenants;
+    std::vector<std::pair<std::string, size_t>> prefixes;   /* Device prefix and tenant, longest prefix first */
+    std::deque<size_t> active;                              /* Backlogged tenants in round-robin order */
+    bool visiting;                                          /* The front tenant already got its quantum this round */
+    std::vector<std::pair<size_t, Entry>> inFlight;         /* Tenant and entry of the items handed out */
+    size_t backlogged;                                      /* Fixes queued over all tenants */
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_TENANTS_H__
@@ -0,0 +1,80 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_TLS_H__
+#define __GNSS_TLS_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <cstdint>
+#include <mosquitto.h>
+#include <openssl/ssl.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define TLS_DEFAULT_VERSION     "tlsv1.2"         /* Lowest protocol version accepted from the broker */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* TLS options shared by the sender and the receiver, see setTlsOption() */
+struct TlsConfig
+{
+    std::string caFile;         /* --tls-ca: CA certificates verifying the broker, enables certificate TLS */
+    std::string certFile;       /* --tls-cert: client certificate, optional */
+    std::string keyFile;        /* --tls-key: key of the client certificate */
+    std::string psk;            /* --tls-psk: pre-shared key in hex, enables PSK TLS instead of certificates */
+    std::string pskIdentity;    /* --tls-psk-identity */
+    std::string version;        /* --tls-version: "tlsv1.2" or "tlsv1.3" */
+    std::string ciphers;        /* --tls-ciphers: OpenSSL cipher list for TLS 1.2 */
+    std::string ciphersuites;   /* --tls-ciphersuites: OpenSSL ciphersuites for TLS 1.3 */
+    bool resume;                /* --tls-resume 0|1: reuse session tickets across reconnects, on by default */
+};
+
+/*
+ * TLS client context of one broker connection, reusing the TLS session of the previous connection.
+ *
+ * A full handshake costs the broker a private key operation; a resumed one only a symmetric ticket decryption, so a
+ * fleet reconnecting after a broker restart or a network outage does not saturate the broker CPU. libmosquitto creates
+ * and connects its SSL objects internally, so the context hands it an SSL_CTX of its own: new session tickets are kept
+ * from the new-session callback, and the last one is attached to each new connection when its handshake starts.
+ */
+class TlsSession
+{
+public:
+    TlsSession();
+    ~TlsSession();
+
+    bool init(const TlsConfig& config);
+    bool apply(struct mosquitto* mosq) const;
+    SSL_CTX* context() const;
+    uint64_t handshakes() const;
+    uint64_t resumed() const;
+
+private:
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+    static void onInfo(const SSL* ssl, int where, int ret);
+
+    TlsConfig config;
+    SSL_CTX* ctx;
+    SSL_SESSION* session;       /* Last session ticket received, NULL before the first handshake */
+    uint64_t handshakeCount;
+    uint64_t resumedCount;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool tlsEnabled(const TlsConfig& config);
+void initTlsConfig(TlsConfig& config);
+bool isTlsOption(const std::string& option);
+bool setTlsOption(const std::string& option, const std::string& value, TlsConfig& config);
+bool checkTlsConfig(const TlsConfig& config);
+
+#endif // __GNSS_TLS_H__
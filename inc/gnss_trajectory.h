@@ -0,0 +1,63 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_TRAJECTORY_H__
+#define __GNSS_TRAJECTORY_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <cstdint>
+#include "gnss_nmea.h"
+#include "gnss_random.h"
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define TRAJECTORY_CITY_RADIUS_M    (20000.0)         /* Vehicles start within this distance of their city centre */
+#define TRAJECTORY_MIN_CRUISE_MS    (5.0)             /* Slowest cruising speed in m/s */
+#define TRAJECTORY_MAX_CRUISE_MS    (30.0)            /* Fastest cruising speed in m/s */
+#define TRAJECTORY_ACCEL_MS2        (2.0)             /* Largest change of speed in m/s per second */
+#define TRAJECTORY_MEAN_CRUISE_S    (60.0)            /* Mean time between changes of the cruising speed */
+#define TRAJECTORY_MEAN_DRIVE_S     (300.0)           /* Mean driving time between stops */
+#define TRAJECTORY_MAX_STOP_S       (120.0)           /* Longest stop, e.g. a traffic light or a delivery */
+#define TRAJECTORY_MEAN_TURN_S      (90.0)            /* Mean time between turns at a junction */
+#define TRAJECTORY_HEADING_NOISE    (3.0)             /* Drift of the course in degrees per square root second */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/*
+ * Movement of one simulated vehicle around one of a few cities: it cruises at a speed that changes now and then,
+ * accelerates and brakes smoothly, drifts and turns at junctions, and stops for a while every few minutes.
+ *
+ * Each vehicle has its own random stream derived from the seed and its number, so a vehicle moves the same way
+ * whichever thread simulates it and whatever the other vehicles do.
+ */
+class TrajectoryModel
+{
+public:
+    TrajectoryModel(uint64_t seed, uint64_t vehicle, int64_t startMs);
+
+    void step(int64_t dtMs, GNSSFix& fix);
+
+private:
+    FastRandom random;
+    int64_t timeMs;
+    double latitude;
+    double longitude;
+    double speedMs;
+    double cruiseMs;            /* Speed the vehicle is accelerating or braking towards */
+    double course;              /* Degrees clockwise from north */
+    double stopS;               /* Time left standing once the vehicle has braked to a stop */
+    bool stopping;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_TRAJECTORY_H__
@@ -0,0 +1,105 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_UDP_H__
+#define __GNSS_UDP_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <sys/socket.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define UDP_BIND_ADDRESS        "127.0.0.1"       /* Default listen address; the UDP input is for trusted senders */
+#define UDP_BATCH               (64U)             /* Datagrams per recvmmsg/sendmmsg call */
+#define UDP_MAX_DATAGRAM        (65507U)          /* Largest IPv4 UDP payload */
+#define UDP_MAX_PER_RECEIVE     (4096U)           /* Datagrams drained per receive() call, bounds one batch */
+#define UDP_SOCKET_BUFFER       (4 * 1024 * 1024) /* Kernel receive buffer, absorbs bursts between loops */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Non-blocking UDP input draining datagrams with recvmmsg */
+class UdpReceiver
+{
+public:
+    UdpReceiver();
+    ~UdpReceiver();
+
+    bool open(uint16_t port, const std::string& bindAddress = UDP_BIND_ADDRESS);
+    void close();
+    int fd() const;
+    uint16_t port() const;
+    size_t receive(std::vector<std::string>& datagrams);
+    uint64_t truncated() const;
+
+private:
+    int sock;
+    uint16_t boundPort;
+    uint64_t truncatedCount;
+    std::vector<char> buffers;
+    std::vector<struct mmsghdr> headers;
+    std::vector<struct iovec> iovecs;
+};
+
+/* UDP output queuing datagrams and sending them with sendmmsg */
+class UdpSender
+{
+public:
+    UdpSender();
+    ~UdpSender();
+
+    bool open(const std::string& host, uint16_t port);
+    void close();
+    void queue(const std::string& datagram);
+    bool flush();
+    uint64_t datagramsSent() const;
+    uint64_t sendCalls() const;
+
+private:
+    int sock;
+    std::vector<std::string> queued;
+    uint64_t sent;
+    uint64_t calls;
+};
+
+struct SequenceStats
+{
+    uint64_t received;          /* Sequence numbers received */
+    uint64_t lost;              /* Sequence numbers skipped when a later one arrived */
+    uint64_t late;              /* Sequence numbers arriving after a later one, reordered or duplicated */
+};
+
+/*
+ * Detects loss on sequenced streams. Each device is expected to continue where its previous batch ended; a gap is
+ * counted as lost. Numbers arriving behind the expected one are counted as late, so lost - late estimates the
+ * actual loss when the network reorders.
+ */
+class SequenceTracker
+{
+public:
+    SequenceTracker();
+
+    void observe(const std::string& deviceId, uint64_t firstSequence, uint64_t count);
+    SequenceStats stats() const;
+
+private:
+    std::unordered_map<std::string, uint64_t> expected;
+    SequenceStats totals;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+bool parseHostPort(const std::string& text, std::string& host, uint16_t& port);
+
+#endif // __GNSS_UDP_H__
@@ -0,0 +1,94 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+#ifndef __GNSS_ZONES_H__
+#define __GNSS_ZONES_H__
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define ZONE_BATCH_POINTS       (128U)            /* Points per containment test, one archive chunk */
+#define ZONE_NODE_ENTRIES       (16U)             /* Children per node of the R-tree */
+#define ZONE_MAX_VERTICES       (100000U)         /* Vertices of one polygon at most */
+#define ZONE_UNUSED_LAT         (1000.0)          /* Latitude of the unused points of a batch, north of every zone */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Bounding box in degrees. Longitudes are not wrapped: a polygon must not cross the antimeridian. */
+struct ZoneBox
+{
+    double minLat, minLon, maxLat, maxLon;
+};
+
+/* Polygon edge prepared for the crossing test: the longitude of the edge at latitude y is lon0 + (y - lat0) * slope */
+struct ZoneEdge
+{
+    double lat0, lat1;
+    double lon0;
+    double slope;               /* Zero for an edge along a parallel, which no ray crosses */
+};
+
+struct Zone
+{
+    std::string name;
+    ZoneBox box;
+    uint32_t firstEdge;
+    uint32_t edgeCount;
+};
+
+/*
+ * An immutable set of polygons with a packed R-tree over their bounding boxes.
+ *
+ * The file has one "zone <name> <lat> <lon> <lat> <lon> ..." line per polygon, at least three vertices in either
+ * winding, the last joined back to the first; blank lines and lines starting with '#' are ignored. The R-tree is bulk
+ * loaded once by sort-tile-recursive packing, ZONE_NODE_ENTRIES children per node, so every node but the last of each
+ * level is full and a query visits few nodes. contains() tests a batch of points against one polygon by the
+ * crossing number, the edge in the outer loop and the points in a branch-free inner loop the compiler vectorizes.
+ */
+class ZoneSet
+{
+public:
+    ZoneSet();
+
+    bool load(const std::string& path, std::string& error);
+    size_t size() const;
+    const Zone& zone(uint32_t index) const;
+    void query(const ZoneBox& box, std::vector<uint32_t>& out) const;
+    void contains(uint32_t index, const double* lat, const double* lon, uint8_t* inside) const;
+    size_t depth() const;
+
+private:
+    struct Node
+    {
+        ZoneBox box;
+        uint32_t first;         /* First child: a node of the level below, or an entry of order at the leaves */
+        uint32_t count;
+    };
+
+    void build();
+
+    std::vector<Zone> zones;
+    std::vector<ZoneEdge> edges;
+    std::vector<uint32_t> order;        /* Zone indexes in leaf order */
+    std::vector<Node> nodes;            /* Level by level from the leaves; the root is last */
+    size_t leafNodes;
+    size_t levels;
+};
+
+/***********************************************************************************************************************
+ * Function declarations
+ **********************************************************************************************************************/
+
+#endif // __GNSS_ZONES_H__
@@ -0,0 +1,340 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_archive.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Last bytes of an archive file, locating the device names and the directory */
+struct ArchiveTrailer
+{
+    uint64_t namesOffset;       /* Names as a u32 length followed by the bytes, in device order */
+    uint64_t deviceCount;
+    uint64_t directoryOffset;   /* ArchiveChunk entries sorted by device and first fix time */
+    uint64_t chunkCount;
+    char magic[ARCHIVE_MAGIC_SIZE];
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an unopened writer.
+ **********************************************************************************************************************/
+ArchiveWriter::ArchiveWriter ()
+    : file(nullptr), fileSize(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the file if close() was not called; the archive is then incomplete.
+ **********************************************************************************************************************/
+ArchiveWriter::~ArchiveWriter ()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the archive file, replacing any file of that name.
+ **********************************************************************************************************************/
+bool ArchiveWriter::open (const std::string& path)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if ((file == nullptr) || (std::fwrite(ARCHIVE_MAGIC, 1, ARCHIVE_MAGIC_SIZE, file) != ARCHIVE_MAGIC_SIZE))
+    {
+        std::cerr << "Unable to create " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    fileSize = ARCHIVE_MAGIC_SIZE;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The index of a device in the archive, added on first use.
+ **********************************************************************************************************************/
+uint32_t ArchiveWriter::device (const std::string& deviceId)
+{
+    auto inserted = deviceIndex.emplace(deviceId, (uint32_t)deviceNames.size());
+    if (inserted.second)
+    {
+        deviceNames.push_back(deviceId);
+        openChunks.emplace_back();
+        openChunks.back().reserve(HOT_STORE_CHUNK_FIXES);
+    }
+    return inserted.first->second;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds a fix to the open chunk of its device and writes the chunk once it is full.
+ *
+ * @param device Index returned by device().
+ * @param sample The fix, not older than the previous fix of the device.
+ *
+ * @return False if the chunk could not be written.
+ **********************************************************************************************************************/
+bool ArchiveWriter::append (uint32_t device, const FixSample& sample)
+{
+    std::vector<FixSample>& chunk = openChunks[device];
+    chunk.push_back(sample);
+    return (chunk.size() < HOT_STORE_CHUNK_FIXES) || seal(device);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Makes the chunks written so far durable; the fixes of the open chunks are still only in memory.
+ *
+ * @return False if the file could not be flushed or synced.
+ **********************************************************************************************************************/
+bool ArchiveWriter::sync ()
+{
+    return (file != nullptr) && (std::fflush(file) == 0) && (fdatasync(fileno(file)) == 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes the partial chunks, the device names, the directory and the trailer, and closes the file durably.
+ **********************************************************************************************************************/
+bool ArchiveWriter::close ()
+{
+    bool ok = (file != nullptr);
+    for (uint32_t device = 0; ok && (device < openChunks.size()); ++device)
+    {
+        ok = openChunks[device].empty() || seal(device);
+    }
+
+    // Chunks were sealed in time order per device, so a stable sort keeps them in time order within each device
+    std::stable_sort(directory.begin(), directory.end(),
+                     [](const ArchiveChunk& a, const ArchiveChunk& b) { return a.device < b.device; });
+
+    ArchiveTrailer trailer;
+    trailer.namesOffset = fileSize;
+    trailer.deviceCount = deviceNames.size();
+    for (size_t i = 0; ok && (i < deviceNames.size()); ++i)
+    {
+        uint32_t length = (uint32_t)deviceNames[i].size();
+        ok = (std::fwrite(&length, sizeof(length), 1, file) == 1) &&
+             (std::fwrite(deviceNames[i].data(), 1, length, file) == length);
+        fileSize += sizeof(length) + length;
+    }
+    trailer.directoryOffset = fileSize;
+    trailer.chunkCount = directory.size();
+    fileSize += directory.size() * sizeof(ArchiveChunk) + sizeof(trailer);
+    std::memcpy(trailer.magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE);
+    ok = ok && (std::fwrite(directory.data(), sizeof(ArchiveChunk), directory.size(), file) == directory.size()) &&
+         (std::fwrite(&trailer, sizeof(trailer), 1, file) == 1) && sync();
+
+    if ((file != nullptr) && (std::fclose(file) != 0))
+    {
+        ok = false;
+    }
+    file = nullptr;
+    if (!ok)
+    {
+        std::cerr << "Unable to write the archive: " << std::strerror(errno) << std::endl;
+    }
+    return ok;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bytes written so far, the size of the file once it is closed.
+ **********************************************************************************************************************/
+uint64_t ArchiveWriter::size () const
+{
+    return fileSize;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates an unopened reader.
+ **********************************************************************************************************************/
+ArchiveReader::ArchiveReader ()
+    : fd(-1), mapped(nullptr), mappedSize(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Unmaps and closes the file.
+ **********************************************************************************************************************/
+ArchiveReader::~ArchiveReader ()
+{
+    if (mapped != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(mapped), mappedSize);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Maps an archive file and loads its device names and directory.
+ *
+ * @return False if the file cannot be read or is not a complete archive.
+ **********************************************************************************************************************/
+bool ArchiveReader::open (const std::string& path)
+{
+    struct stat st;
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        std::cerr << "Unable to open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mappedSize = (size_t)st.st_size;
+    if (mappedSize < ARCHIVE_MAGIC_SIZE + sizeof(ArchiveTrailer))
+    {
+        std::cerr << path << " is not an archive" << std::endl;
+        return false;
+    }
+    void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        std::cerr << "Unable to map " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mapped = static_cast<const uint8_t*>(address);
+
+    // The chunks of a device are spread over the file among those of the others, so read-ahead would mostly bring in
+    // chunks of other devices, pruned or evicted again before they are used
+    madvise(address, mappedSize, MADV_RANDOM);
+
+    ArchiveTrailer trailer;
+    size_t trailerOffset = mappedSize - sizeof(trailer);
+    std::memcpy(&trailer, mapped + trailerOffset, sizeof(trailer));
+    if ((std::memcmp(mapped, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) != 0) ||
+        (std::memcmp(trailer.magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) != 0) ||
+        (trailer.namesOffset > trailer.directoryOffset) || (trailer.directoryOffset > trailerOffset) ||
+        (trailer.chunkCount != (trailerOffset - trailer.directoryOffset) / sizeof(ArchiveChunk)))
+    {
+        std::cerr << path << " is not a complete archive" << std::endl;
+        return false;
+    }
+
+    const uint8_t* pos = mapped + trailer.namesOffset;
+    const uint8_t* end = mapped + trailer.directoryOffset;
+    deviceNames.resize(trailer.deviceCount);
+    for (std::string& name : deviceNames)
+    {
+        uint32_t length = UINT32_MAX;
+        if ((size_t)(end - pos) >= sizeof(length))
+        {
+            std::memcpy(&length, pos, sizeof(length));
+            pos += sizeof(length);
+        }
+        if ((size_t)(end - pos) < length)
+        {
+            std::cerr << path << " has a corrupt device table" << std::endl;
+            return false;
+        }
+        name.assign(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+    }
+
+    directory.resize(trailer.chunkCount);
+    std::memcpy(directory.data(), mapped + trailer.directoryOffset, directory.size() * sizeof(ArchiveChunk));
+    deviceChunks.assign(deviceNames.size() + 1, 0);
+    for (const ArchiveChunk& chunk : directory)
+    {
+        if ((chunk.device >= deviceNames.size()) || (chunk.offset > trailer.namesOffset) ||
+            (chunk.size > trailer.namesOffset - chunk.offset))
+        {
+            std::cerr << path << " has a corrupt directory" << std::endl;
+            return false;
+        }
+        ++deviceChunks[chunk.device + 1];
+    }
+    for (size_t i = 1; i < deviceChunks.size(); ++i)
+    {
+        deviceChunks[i] += deviceChunks[i - 1];
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Names of the devices, indexed by ArchiveChunk::device.
+ **********************************************************************************************************************/
+const std::vector<std::string>& ArchiveReader::devices () const
+{
+    return deviceNames;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The directory, sorted by device and then by time.
+ **********************************************************************************************************************/
+const std::vector<ArchiveChunk>& ArchiveReader::chunks () const
+{
+    return directory;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Index of the first chunk of a device in the directory; device + 1 gives one past its last chunk.
+ *
+ * @param device Index of the device, up to and including the number of devices.
+ **********************************************************************************************************************/
+size_t ArchiveReader::firstChunk (uint32_t device) const
+{
+    return deviceChunks[device];
+}
+
+/*******************************************************************************************************************//**
+ * @brief Decompresses one chunk from the mapped file.
+ *
+ * @return False if the chunk is corrupt.
+ **********************************************************************************************************************/
+bool ArchiveReader::read (const ArchiveChunk& chunk, std::vector<FixSample>& out) const
+{
+    return decompressFixChunk(mapped + chunk.offset, (size_t)chunk.size, out) && (out.size() == chunk.count);
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Compresses the open chunk of a device, writes it and adds it to the directory.
+ **********************************************************************************************************************/
+bool ArchiveWriter::seal (uint32_t device)
+{
+    std::vector<FixSample>& samples = openChunks[device];
+    ArchiveChunk chunk = { device, (uint32_t)samples.size(), samples.front().timestampMs, samples.back().timestampMs,
+                           INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN, fileSize, 0 };
+    for (const FixSample& s : samples)
+    {
+        chunk.minLatE7 = std::min(chunk.minLatE7, s.latE7);
+        chunk.minLonE7 = std::min(chunk.minLonE7, s.lonE7);
+        chunk.maxLatE7 = std::max(chunk.maxLatE7, s.latE7);
+        chunk.maxLonE7 = std::max(chunk.maxLonE7, s.lonE7);
+    }
+    compressFixChunk(samples, packed);
+    samples.clear();
+
+    chunk.size = packed.size();
+    directory.push_back(chunk);
+    fileSize += packed.size();
+    return std::fwrite(packed.data(), 1, packed.size(), file) == packed.size();
+}
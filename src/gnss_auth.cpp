@@ -0,0 +1,704 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_auth.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define PAYLOAD_FLAGS_OFFSET    (PAYLOAD_MAGIC_SIZE)    /* Position of the flags byte in a batch */
+#define SHA256_BLOCK_BYTES      (64U)             /* HMAC pads the key to one block of the hash */
+#define HMAC_INNER_PAD          (0x36)
+#define HMAC_OUTER_PAD          (0x5C)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Digest context of the calling thread, reused for every tag it computes */
+struct ScratchDigest
+{
+    EVP_MD_CTX* ctx;
+
+    ScratchDigest() : ctx(EVP_MD_CTX_new()) {}
+    ~ScratchDigest() { EVP_MD_CTX_free(ctx); }
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static int hexValue(char c);
+
+static thread_local ScratchDigest scratch;
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty key table.
+ **********************************************************************************************************************/
+DeviceKeys::DeviceKeys ()
+    : sha256(EVP_MD_fetch(NULL, "SHA256", NULL))
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Releases the prepared keys.
+ **********************************************************************************************************************/
+DeviceKeys::~DeviceKeys ()
+{
+    for (auto& key : keys)
+    {
+        EVP_MD_CTX_free(key.second.inner);
+        EVP_MD_CTX_free(key.second.outer);
+    }
+    EVP_MD_free(sha256);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a key table, one "<device> <hex key>" line per device; '#' starts a comment.
+ *
+ * A "gateway <gateway> <device>..." line lets a gateway forward the sentences of keyed devices other than itself in
+ * the batches it signs. Having three fields at least, it cannot be taken for the key of a device named "gateway".
+ *
+ * @param text The key table.
+ * @param error Set to the reason when the table is rejected.
+ *
+ * @return False if a line is malformed or a key shorter than AUTH_MIN_KEY_BYTES.
+ **********************************************************************************************************************/
+bool DeviceKeys::load (const std::string& text, std::string& error)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string deviceId, field, key;
+        std::vector<std::string> rest;
+        if (!(fields >> deviceId))
+        {
+            continue;
+        }
+        while (fields >> field)
+        {
+            rest.push_back(field);
+        }
+        if ((deviceId == "gateway") && (rest.size() >= 2))
+        {
+            forwards[rest[0]].insert(rest.begin() + 1, rest.end());
+            continue;
+        }
+        if ((rest.size() != 1) || !parseHexKey(rest[0], key))
+        {
+            error = "line " + std::to_string(number) + ": expected \"<device> <hex key>\" with a key of at least " +
+                    std::to_string(AUTH_MIN_KEY_BYTES) + " bytes";
+            return false;
+        }
+        if (!add(deviceId, key))
+        {
+            error = "line " + std::to_string(number) + ": cannot prepare the key of " + deviceId;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a key table from a file, see load().
+ **********************************************************************************************************************/
+bool DeviceKeys::loadFile (const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    if (!load(contents.str(), error))
+    {
+        error = path + ", " + error;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sets the key of a device, replacing any previous one.
+ *
+ * The key is padded to a block and the inner and outer pads are hashed once here (RFC 2104); keys longer than a block
+ * are hashed first.
+ *
+ * @param deviceId The device.
+ * @param key The raw key bytes.
+ *
+ * @return False if OpenSSL cannot set up SHA-256.
+ **********************************************************************************************************************/
+bool DeviceKeys::add (const std::string& deviceId, const std::string& key)
+{
+    unsigned char block[SHA256_BLOCK_BYTES] = { 0 };
+    unsigned int size = 0;
+    if (key.size() > SHA256_BLOCK_BYTES)
+    {
+        if ((sha256 == NULL) || (EVP_Digest(key.data(), key.size(), block, &size, sha256, NULL) != 1))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        std::memcpy(block, key.data(), key.size());
+    }
+
+    unsigned char innerPad[SHA256_BLOCK_BYTES];
+    unsigned char outerPad[SHA256_BLOCK_BYTES];
+    for (size_t i = 0; i < SHA256_BLOCK_BYTES; ++i)
+    {
+        innerPad[i] = block[i] ^ HMAC_INNER_PAD;
+        outerPad[i] = block[i] ^ HMAC_OUTER_PAD;
+    }
+
+    PreparedKey prepared = { EVP_MD_CTX_new(), EVP_MD_CTX_new() };
+    bool ok = (sha256 != NULL) && (prepared.inner != NULL) && (prepared.outer != NULL) &&
+              (EVP_DigestInit_ex(prepared.inner, sha256, NULL) == 1) &&
+              (EVP_DigestUpdate(prepared.inner, innerPad, sizeof(innerPad)) == 1) &&
+              (EVP_DigestInit_ex(prepared.outer, sha256, NULL) == 1) &&
+              (EVP_DigestUpdate(prepared.outer, outerPad, sizeof(outerPad)) == 1);
+    OPENSSL_cleanse(block, sizeof(block));
+    OPENSSL_cleanse(innerPad, sizeof(innerPad));
+    OPENSSL_cleanse(outerPad, sizeof(outerPad));
+    if (!ok)
+    {
+        EVP_MD_CTX_free(prepared.inner);
+        EVP_MD_CTX_free(prepared.outer);
+        return false;
+    }
+
+    auto slot = keys.find(deviceId);
+    if (slot != keys.end())
+    {
+        EVP_MD_CTX_free(slot->second.inner);
+        EVP_MD_CTX_free(slot->second.outer);
+        slot->second = prepared;
+    }
+    else
+    {
+        keys[deviceId] = prepared;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The prepared key of a device, NULL if it has none. It is only read, so threads can share it.
+ **********************************************************************************************************************/
+const PreparedKey* DeviceKeys::find (const std::string& deviceId) const
+{
+    auto key = keys.find(deviceId);
+    return (key != keys.end()) ? &key->second : NULL;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a "gateway" line lets the gateway forward the sentences of the device.
+ **********************************************************************************************************************/
+bool DeviceKeys::mayForward (const std::string& gateway, const std::string& deviceId) const
+{
+    auto devices = forwards.find(gateway);
+    return (devices != forwards.end()) && (devices->second.count(deviceId) != 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of devices with a key.
+ **********************************************************************************************************************/
+size_t DeviceKeys::size () const
+{
+    return keys.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Computes the HMAC-SHA256 of data by resuming the prepared states in the digest context of the thread.
+ *
+ * @param key The prepared key.
+ * @param data The data.
+ * @param size Size of the data in bytes.
+ * @param out Output tag of PAYLOAD_TAG_SIZE bytes.
+ *
+ * @return False if OpenSSL fails.
+ **********************************************************************************************************************/
+bool DeviceKeys::tag (const PreparedKey& key, const char* data, size_t size, unsigned char* out)
+{
+    unsigned char inner[EVP_MAX_MD_SIZE];
+    unsigned int innerSize = 0, outerSize = 0;
+    EVP_MD_CTX* ctx = scratch.ctx;
+
+    return (ctx != NULL) && (EVP_MD_CTX_copy_ex(ctx, key.inner) == 1) && (EVP_DigestUpdate(ctx, data, size) == 1) &&
+           (EVP_DigestFinal_ex(ctx, inner, &innerSize) == 1) && (EVP_MD_CTX_copy_ex(ctx, key.outer) == 1) &&
+           (EVP_DigestUpdate(ctx, inner, innerSize) == 1) && (EVP_DigestFinal_ex(ctx, out, &outerSize) == 1) &&
+           (outerSize == PAYLOAD_TAG_SIZE);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a verifier without keys, which accepts everything, and without workers.
+ **********************************************************************************************************************/
+PayloadVerifier::PayloadVerifier ()
+    : keys(new DeviceKeys()), cacheSlots(AUTH_CACHE_SIZE), cacheNext(0), nextJob(0), generation(0), busy(0),
+      stopping(false)
+{
+    totals = AuthStats();
+    cacheIndex.reserve(AUTH_CACHE_SIZE);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stops the workers.
+ **********************************************************************************************************************/
+PayloadVerifier::~PayloadVerifier ()
+{
+    stop();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Starts the worker threads that share the HMAC computations with the caller of verify().
+ *
+ * @param workers Number of worker threads; 0 verifies every batch on the calling thread.
+ *
+ * @return False if a thread cannot be started.
+ **********************************************************************************************************************/
+bool PayloadVerifier::start (size_t workers)
+{
+#if defined(__cpp_exceptions)
+    try
+    {
+        for (size_t i = 0; i < workers; ++i)
+        {
+            pool.emplace_back(&PayloadVerifier::workerLoop, this);
+        }
+    }
+    catch (const std::system_error& e)
+    {
+        std::cerr << "Unable to start the verification workers: " << e.what() << std::endl;
+        stop();
+        return false;
+    }
+#else
+    // Built without exceptions (PROFILE=lean), a thread that cannot be started aborts the process
+    for (size_t i = 0; i < workers; ++i)
+    {
+        pool.emplace_back(&PayloadVerifier::workerLoop, this);
+    }
+#endif
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stops and joins the worker threads.
+ **********************************************************************************************************************/
+void PayloadVerifier::stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCond.notify_all();
+    for (std::thread& worker : pool)
+    {
+        worker.join();
+    }
+    pool.clear();
+    stopping = false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Replaces the device keys with those of a key file, see DeviceKeys::load().
+ *
+ * The verified cache is cleared, so a revoked key stops being accepted at once. A file that cannot be loaded leaves
+ * the active keys untouched.
+ *
+ * @param path Path of the key file.
+ * @param error Set to the reason when the file is rejected.
+ *
+ * @return False if the file cannot be read or is malformed.
+ **********************************************************************************************************************/
+bool PayloadVerifier::loadKeys (const std::string& path, std::string& error)
+{
+    std::unique_ptr<DeviceKeys> loaded(new DeviceKeys());
+    if (!loaded->loadFile(path, error))
+    {
+        return false;
+    }
+
+    keys.swap(loaded);
+    cacheIndex.clear();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether any device has a key; without keys every payload is accepted unchecked.
+ **********************************************************************************************************************/
+bool PayloadVerifier::enabled () const
+{
+    return keys->size() > 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of devices with a key.
+ **********************************************************************************************************************/
+size_t PayloadVerifier::keyCount () const
+{
+    return keys->size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a device has a key, so its data is accepted only when authenticated.
+ **********************************************************************************************************************/
+bool PayloadVerifier::hasKey (const std::string& deviceId) const
+{
+    return keys->find(deviceId) != NULL;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether the key file lets a gateway sign for a keyed device behind it, see DeviceKeys::load().
+ **********************************************************************************************************************/
+bool PayloadVerifier::mayForward (const std::string& gateway, const std::string& deviceId) const
+{
+    return keys->mayForward(gateway, deviceId);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Authenticates a batch of payloads, setting the result of each.
+ *
+ * A payload belongs to the device in its batch header, or to the device of its topic. Payloads of devices with a key
+ * must carry a valid tag; payloads of other devices must not carry one. The tags left to compute after the cache
+ * lookup are shared between the calling thread and the workers when there are at least AUTH_PARALLEL_MIN of them.
+ *
+ * @param checks The payloads, see AuthCheck.
+ **********************************************************************************************************************/
+void PayloadVerifier::verify (std::vector<AuthCheck>& checks)
+{
+    jobs.clear();
+    std::string deviceId;
+    uint8_t flags = 0;
+
+    for (AuthCheck& item : checks)
+    {
+        bool batch = peekBatchHeader(item.data, item.size, flags, deviceId);
+        if (!batch || deviceId.empty())
+        {
+            deviceId = item.topicDevice;
+        }
+        const PreparedKey* key = keys->find(deviceId);
+        bool tagged = batch && (flags & PAYLOAD_FLAG_HMAC) && (item.size >= PAYLOAD_TAG_SIZE);
+
+        if (!tagged)
+        {
+            item.result = (key != NULL) ? AUTH_MISSING : AUTH_UNSIGNED;
+            continue;
+        }
+        if (key == NULL)
+        {
+            item.result = AUTH_UNKNOWN_KEY;
+            continue;
+        }
+
+        Job job;
+        job.item = &item;
+        job.key = key;
+        job.deviceId = deviceId;
+        std::memcpy(&job.tagId, item.data + item.size - PAYLOAD_TAG_SIZE, sizeof(job.tagId));
+        if (cached(job))
+        {
+            item.result = AUTH_CACHED;
+            continue;
+        }
+        jobs.push_back(job);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    nextJob = 0;
+    if ((jobs.size() < AUTH_PARALLEL_MIN) || pool.empty())
+    {
+        runChunks();
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = pool.size();
+            ++generation;
+        }
+        startCond.notify_all();
+        runChunks();
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCond.wait(lock, [this]() { return busy == 0; });
+    }
+    totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const Job& job : jobs)
+    {
+        totals.bytes += job.item->size;
+        if (job.item->result == AUTH_VERIFIED)
+        {
+            remember(job);
+        }
+    }
+    for (const AuthCheck& item : checks)
+    {
+        totals.verified += (item.result == AUTH_VERIFIED);
+        totals.cached += (item.result == AUTH_CACHED);
+        totals.rejected += !authAccepted(item.result);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of worker threads.
+ **********************************************************************************************************************/
+size_t PayloadVerifier::workers () const
+{
+    return pool.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counters since the start, for throughput reporting.
+ **********************************************************************************************************************/
+AuthStats PayloadVerifier::stats () const
+{
+    return totals;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Body of a worker thread: helps with each batch verify() announces.
+ **********************************************************************************************************************/
+void PayloadVerifier::workerLoop ()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        startCond.wait(lock, [this, seen]() { return stopping || (generation != seen); });
+        if (stopping)
+        {
+            return;
+        }
+        seen = generation;
+
+        lock.unlock();
+        runChunks();
+        lock.lock();
+
+        if (--busy == 0)
+        {
+            doneCond.notify_one();
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Computes the tags of the current batch, AUTH_CHUNK jobs at a time, until none is left.
+ **********************************************************************************************************************/
+void PayloadVerifier::runChunks ()
+{
+    size_t first;
+    while ((first = nextJob.fetch_add(AUTH_CHUNK)) < jobs.size())
+    {
+        size_t last = std::min<size_t>(first + AUTH_CHUNK, jobs.size());
+        for (size_t i = first; i < last; ++i)
+        {
+            check(jobs[i]);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Computes the HMAC of one payload and compares it with its tag in constant time.
+ **********************************************************************************************************************/
+void PayloadVerifier::check (Job& job)
+{
+    const char* data = job.item->data;
+    size_t signedSize = job.item->size - PAYLOAD_TAG_SIZE;
+    unsigned char tag[EVP_MAX_MD_SIZE];
+
+    bool valid = DeviceKeys::tag(*job.key, data, signedSize, tag) &&
+                 (CRYPTO_memcmp(tag, data + signedSize, PAYLOAD_TAG_SIZE) == 0);
+    job.item->result = valid ? AUTH_VERIFIED : AUTH_BAD_TAG;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether the same device sent the same bytes recently and they were verified then.
+ **********************************************************************************************************************/
+bool PayloadVerifier::cached (const Job& job) const
+{
+    auto entry = cacheIndex.find(job.tagId);
+    if (entry == cacheIndex.end())
+    {
+        return false;
+    }
+    const CacheSlot& slot = cacheSlots[entry->second];
+    return (slot.deviceId == job.deviceId) && (slot.payload.size() == job.item->size) &&
+           (std::memcmp(slot.payload.data(), job.item->data, job.item->size) == 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds a verified payload to the cache in place of the oldest one.
+ **********************************************************************************************************************/
+void PayloadVerifier::remember (const Job& job)
+{
+    CacheSlot& slot = cacheSlots[cacheNext];
+    auto previous = cacheIndex.find(slot.tagId);
+    if ((previous != cacheIndex.end()) && (previous->second == cacheNext))
+    {
+        cacheIndex.erase(previous);
+    }
+
+    slot.tagId = job.tagId;
+    slot.deviceId = job.deviceId;
+    slot.payload.assign(job.item->data, job.item->size);
+    cacheIndex[job.tagId] = cacheNext;
+    cacheNext = (cacheNext + 1) % AUTH_CACHE_SIZE;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Decodes a key given in hex.
+ *
+ * @param hex The key, two hex digits per byte.
+ * @param key Output raw key.
+ *
+ * @return False if the text is not hex or the key is shorter than AUTH_MIN_KEY_BYTES.
+ **********************************************************************************************************************/
+bool parseHexKey (const std::string& hex, std::string& key)
+{
+    if ((hex.size() % 2 != 0) || (hex.size() / 2 < AUTH_MIN_KEY_BYTES))
+    {
+        return false;
+    }
+
+    key.clear();
+    for (size_t i = 0; i < hex.size(); i += 2)
+    {
+        int high = hexValue(hex[i]);
+        int low = hexValue(hex[i + 1]);
+        if ((high < 0) || (low < 0))
+        {
+            return false;
+        }
+        key += (char)((high << 4) | low);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sets PAYLOAD_FLAG_HMAC on an encoded batch and appends its tag.
+ *
+ * @param payload The batch, see encodeBatch().
+ * @param key The raw key of the device.
+ *
+ * @return False if the payload is not a batch or is already signed.
+ **********************************************************************************************************************/
+bool signPayload (std::string& payload, const std::string& key)
+{
+    if (!isBatchPayload(payload.data(), payload.size()) || (payload[PAYLOAD_FLAGS_OFFSET] & PAYLOAD_FLAG_HMAC))
+    {
+        return false;
+    }
+
+    payload[PAYLOAD_FLAGS_OFFSET] = (char)(payload[PAYLOAD_FLAGS_OFFSET] | PAYLOAD_FLAG_HMAC);
+    unsigned char tag[EVP_MAX_MD_SIZE];
+    unsigned int tagSize = 0;
+    if (HMAC(EVP_sha256(), key.data(), (int)key.size(), reinterpret_cast<const unsigned char*>(payload.data()),
+             payload.size(), tag, &tagSize) == NULL)
+    {
+        return false;
+    }
+    payload.append(reinterpret_cast<const char*>(tag), tagSize);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a payload with this result may be stored.
+ **********************************************************************************************************************/
+bool authAccepted (AuthResult result)
+{
+    return (result == AUTH_UNSIGNED) || (result == AUTH_VERIFIED) || (result == AUTH_CACHED);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Short description of a result, for logging rejections.
+ **********************************************************************************************************************/
+const char* authResultName (AuthResult result)
+{
+    switch (result)
+    {
+        case AUTH_UNSIGNED:     return "unsigned";
+        case AUTH_VERIFIED:     return "verified";
+        case AUTH_CACHED:       return "verified earlier";
+        case AUTH_MISSING:      return "missing tag";
+        case AUTH_UNKNOWN_KEY:  return "no key for the device";
+        case AUTH_BAD_TAG:      return "invalid tag";
+    }
+    return "unknown";
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether the CPU has SHA-256 instructions, which OpenSSL then uses for the HMAC computations.
+ **********************************************************************************************************************/
+bool shaExtensions ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1U << 29));
+#elif defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#else
+    return false;
+#endif
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Value of a hex digit, -1 if the character is not one.
+ **********************************************************************************************************************/
+static int hexValue (char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
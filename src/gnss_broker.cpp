@@ -0,0 +1,993 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_broker.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define MQTT_CONNECT            (1U)
+#define MQTT_PUBLISH            (3U)
+#define MQTT_PUBACK             (4U)
+#define MQTT_SUBSCRIBE          (8U)
+#define MQTT_UNSUBSCRIBE        (10U)
+#define MQTT_PINGREQ            (12U)
+#define MQTT_DISCONNECT         (14U)
+
+#define CONNACK_REFUSED_PROTOCOL (1U)             /* Unacceptable protocol version */
+#define SUBACK_FAILURE          (0x80U)
+#define READ_CHUNK              (65536U)          /* Bytes read per recv call */
+#define WRITE_IOVECS            (64)              /* Queued chunks written per writev call */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool readUint16(const uint8_t*& p, const uint8_t* end, uint16_t& value);
+static bool readString(const uint8_t*& p, const uint8_t* end, std::string& value);
+static void putLength(std::string& out, size_t length);
+static std::shared_ptr<const std::string> makePacket(uint8_t header, const std::string& body);
+static int64_t nowMs();
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates a stopped broker.
+ **********************************************************************************************************************/
+MqttBroker::MqttBroker ()
+    : listenFd(-1), epollFd(-1), wakeFd(-1), boundPort(0), running(false),
+      clientCount(0), messagesIn(0), messagesOut(0), messagesDropped(0), bytesOut(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stops the broker and disconnects all clients.
+ **********************************************************************************************************************/
+MqttBroker::~MqttBroker ()
+{
+    stop();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Starts listening and runs the broker on its own thread.
+ *
+ * @param port TCP port to listen on, 0 for an ephemeral port (see port()).
+ * @param bindAddress IPv4 address to listen on, "0.0.0.0" for all interfaces.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool MqttBroker::start (uint16_t port, const std::string& bindAddress)
+{
+    if (running)
+    {
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress.c_str(), &addr.sin_addr) != 1)
+    {
+        std::cerr << "Broker: invalid bind address " << bindAddress << std::endl;
+        return false;
+    }
+
+    int one = 1;
+    socklen_t addrLength = sizeof(addr);
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((listenFd < 0) || (setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0) ||
+        (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(listenFd, SOMAXCONN) != 0) ||
+        (getsockname(listenFd, (struct sockaddr*)&addr, &addrLength) != 0))
+    {
+        std::cerr << "Broker: cannot listen on " << bindAddress << ":" << port << ": " << std::strerror(errno)
+                  << std::endl;
+        stop();
+        return false;
+    }
+    boundPort = ntohs(addr.sin_port);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    bool ok = (epollFd >= 0) && (wakeFd >= 0) && (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) == 0);
+    ev.data.fd = wakeFd;
+    if (!ok || (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) != 0))
+    {
+        std::cerr << "Broker: cannot set up epoll: " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    running = true;
+    thread = std::thread(&MqttBroker::run, this);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stops the broker thread and closes all connections.
+ **********************************************************************************************************************/
+void MqttBroker::stop ()
+{
+    if (running.exchange(false))
+    {
+        uint64_t one = 1;
+        ssize_t n = write(wakeFd, &one, sizeof(one));
+        (void)n;
+        thread.join();
+    }
+
+    for (auto& entry : clients)
+    {
+        ::close(entry.first);
+    }
+    clients.clear();
+    clientIds.clear();
+    dirty.clear();
+    root.children.clear();
+    root.subscribers.clear();
+    clientCount = 0;
+
+    for (int* fd : { &listenFd, &epollFd, &wakeFd })
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief The port the broker listens on.
+ **********************************************************************************************************************/
+uint16_t MqttBroker::port () const
+{
+    return boundPort;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Snapshot of the broker counters. Safe to call from any thread.
+ **********************************************************************************************************************/
+BrokerStats MqttBroker::stats () const
+{
+    BrokerStats st;
+    st.clients = clientCount;
+    st.messagesIn = messagesIn;
+    st.messagesOut = messagesOut;
+    st.messagesDropped = messagesDropped;
+    st.bytesOut = bytesOut;
+    return st;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Checks an MQTT topic filter: "+" and "#" must fill a whole level, and "#" must be the last level.
+ *
+ * @param filter The topic filter.
+ *
+ * @return True if the filter is valid.
+ **********************************************************************************************************************/
+bool isValidTopicFilter (const std::string& filter)
+{
+    if (filter.empty())
+    {
+        return false;
+    }
+
+    std::vector<std::string> levels = splitTopic(filter);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const std::string& level = levels[i];
+        if ((level.find('#') != std::string::npos) && ((level != "#") || (i + 1 != levels.size())))
+        {
+            return false;
+        }
+        if ((level.find('+') != std::string::npos) && (level != "+"))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Splits a topic or filter into its levels. Empty levels are kept, as MQTT requires.
+ *
+ * @param topic The topic.
+ *
+ * @return The levels of the topic.
+ **********************************************************************************************************************/
+std::vector<std::string> splitTopic (const std::string& topic)
+{
+    std::vector<std::string> levels;
+    size_t start = 0;
+
+    while (true)
+    {
+        size_t slash = topic.find('/', start);
+        levels.push_back(topic.substr(start, slash - start));
+        if (slash == std::string::npos)
+        {
+            return levels;
+        }
+        start = slash + 1;
+    }
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Event loop of the broker thread.
+ **********************************************************************************************************************/
+void MqttBroker::run ()
+{
+    struct epoll_event events[BROKER_MAX_EVENTS];
+    int64_t lastCheckMs = nowMs();
+
+    while (running)
+    {
+        int n = epoll_wait(epollFd, events, BROKER_MAX_EVENTS, BROKER_TICK_MS);
+
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listenFd)
+            {
+                acceptClients();
+                continue;
+            }
+            if (fd == wakeFd)
+            {
+                continue;
+            }
+
+            auto it = clients.find(fd);
+            if ((it == clients.end()) || it->second->closing)
+            {
+                continue;
+            }
+
+            Client& client = *it->second;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                readClient(client);
+            }
+            if ((events[i].events & EPOLLOUT) && !client.closing)
+            {
+                flush(client);
+            }
+        }
+
+        // Write everything queued by this batch of events with as few system calls as possible
+        for (Client* client : dirty)
+        {
+            flush(*client);
+        }
+        dirty.clear();
+
+        int64_t now = nowMs();
+        if (now - lastCheckMs >= BROKER_TICK_MS)
+        {
+            for (auto& entry : clients)
+            {
+                Client& client = *entry.second;
+                if ((client.keepAliveMs > 0) && (now - client.lastActivityMs > client.keepAliveMs * 3 / 2))
+                {
+                    client.closing = true;
+                }
+            }
+            lastCheckMs = now;
+        }
+
+        reap();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Accepts all waiting connections.
+ **********************************************************************************************************************/
+void MqttBroker::acceptClients ()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            ::close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Client> client(new Client());
+        client->fd = fd;
+        client->connected = false;
+        client->closing = false;
+        client->wantWrite = false;
+        client->outBytes = 0;
+        client->nextPacketId = 1;
+        client->keepAliveMs = BROKER_CONNECT_TIMEOUT_MS;
+        client->lastActivityMs = nowMs();
+        clients[fd] = std::move(client);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads what the socket holds and handles every complete packet.
+ **********************************************************************************************************************/
+void MqttBroker::readClient (Client& client)
+{
+    char buffer[READ_CHUNK];
+    bool closed = false;
+    while (true)
+    {
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            client.in.append(buffer, n);
+            continue;
+        }
+        // Packets that arrived before the end of the stream are still handled, a client may publish and close at once
+        closed = (n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK));
+        break;
+    }
+    client.lastActivityMs = nowMs();
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(client.in.data());
+    size_t size = client.in.size();
+    size_t pos = 0;
+
+    while (!client.closing && (size - pos >= 2))
+    {
+        // Remaining length: 1 to 4 bytes, 7 bits each
+        size_t length = 0;
+        size_t lengthBytes = 0;
+        bool complete = false;
+        while ((lengthBytes < 4) && (pos + 1 + lengthBytes < size))
+        {
+            uint8_t b = data[pos + 1 + lengthBytes];
+            length |= (size_t)(b & 0x7FU) << (7 * lengthBytes);
+            ++lengthBytes;
+            if ((b & 0x80U) == 0)
+            {
+                complete = true;
+                break;
+            }
+        }
+
+        if (!complete)
+        {
+            client.closing = (lengthBytes == 4);
+            break;
+        }
+        if (length > BROKER_MAX_PACKET)
+        {
+            client.closing = true;
+            break;
+        }
+
+        size_t headerSize = 1 + lengthBytes;
+        if (size - pos < headerSize + length)
+        {
+            break;
+        }
+
+        if (!handlePacket(client, data[pos], data + pos + headerSize, length))
+        {
+            client.closing = true;
+        }
+        pos += headerSize + length;
+    }
+
+    client.in.erase(0, pos);
+    client.closing = client.closing || closed;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Dispatches one packet.
+ *
+ * @return False if the client must be disconnected.
+ **********************************************************************************************************************/
+bool MqttBroker::handlePacket (Client& client, uint8_t header, const uint8_t* body, size_t size)
+{
+    uint8_t type = header >> 4;
+
+    if (type == MQTT_CONNECT)
+    {
+        return !client.connected && handleConnect(client, body, size);
+    }
+    if (!client.connected)
+    {
+        return false;
+    }
+
+    switch (type)
+    {
+        case MQTT_PUBLISH:
+            return handlePublish(client, header, body, size);
+
+        case MQTT_PUBACK:
+            return true;    // Deliveries are not tracked for redelivery
+
+        case MQTT_SUBSCRIBE:
+            return (header == 0x82U) && handleSubscribe(client, body, size);
+
+        case MQTT_UNSUBSCRIBE:
+            return (header == 0xA2U) && handleUnsubscribe(client, body, size);
+
+        case MQTT_PINGREQ:
+        {
+            static const std::shared_ptr<const std::string> pingResp = makePacket(0xD0U, std::string());
+            queue(client, pingResp);
+            return true;
+        }
+
+        case MQTT_DISCONNECT:
+        default:
+            return false;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handles CONNECT. A client connecting with the ID of a connected client takes its place.
+ **********************************************************************************************************************/
+bool MqttBroker::handleConnect (Client& client, const uint8_t* body, size_t size)
+{
+    const uint8_t* p = body;
+    const uint8_t* end = body + size;
+    std::string protocol, clientId, ignored;
+    uint16_t keepAlive;
+
+    if (!readString(p, end, protocol) || (end - p < 2))
+    {
+        return false;
+    }
+    uint8_t level = *p++;
+    uint8_t flags = *p++;
+
+    if (!(((protocol == "MQTT") && (level == 4)) || ((protocol == "MQIsdp") && (level == 3))))
+    {
+        std::string refused;
+        refused += (char)0;
+        refused += (char)CONNACK_REFUSED_PROTOCOL;
+        queue(client, makePacket(0x20U, refused));
+        return false;
+    }
+
+    if (!readUint16(p, end, keepAlive) || !readString(p, end, clientId))
+    {
+        return false;
+    }
+    if (((flags & 0x04U) && (!readString(p, end, ignored) || !readString(p, end, ignored))) ||   // Will
+        ((flags & 0x80U) && !readString(p, end, ignored)) ||                                     // User name
+        ((flags & 0x40U) && !readString(p, end, ignored)))                                       // Password
+    {
+        return false;
+    }
+
+    if (clientId.empty())
+    {
+        clientId = "gnss-broker-" + std::to_string(client.fd) + "-" + std::to_string(nowMs());
+    }
+
+    auto previous = clientIds.find(clientId);
+    if (previous != clientIds.end())
+    {
+        previous->second->closing = true;
+    }
+    clientIds[clientId] = &client;
+
+    client.clientId = clientId;
+    client.connected = true;
+    client.keepAliveMs = (int64_t)keepAlive * 1000;
+    ++clientCount;
+
+    static const std::shared_ptr<const std::string> connAck = makePacket(0x20U, std::string(2, '\0'));
+    queue(client, connAck);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handles SUBSCRIBE. QoS 2 requests are granted QoS 1.
+ **********************************************************************************************************************/
+bool MqttBroker::handleSubscribe (Client& client, const uint8_t* body, size_t size)
+{
+    const uint8_t* p = body;
+    const uint8_t* end = body + size;
+    uint16_t packetId;
+
+    if (!readUint16(p, end, packetId) || (p == end))
+    {
+        return false;
+    }
+
+    std::string ack;
+    ack += (char)(packetId >> 8);
+    ack += (char)(packetId & 0xFFU);
+
+    while (p < end)
+    {
+        std::string filter;
+        if (!readString(p, end, filter) || (p == end))
+        {
+            return false;
+        }
+        uint8_t qos = *p++;
+
+        if (!isValidTopicFilter(filter) || (qos > 2))
+        {
+            ack += (char)SUBACK_FAILURE;
+            continue;
+        }
+
+        qos = std::min<uint8_t>(qos, 1);
+        subscribe(client, filter, qos);
+        ack += (char)qos;
+    }
+
+    queue(client, makePacket(0x90U, ack));
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handles UNSUBSCRIBE.
+ **********************************************************************************************************************/
+bool MqttBroker::handleUnsubscribe (Client& client, const uint8_t* body, size_t size)
+{
+    const uint8_t* p = body;
+    const uint8_t* end = body + size;
+    uint16_t packetId;
+
+    if (!readUint16(p, end, packetId))
+    {
+        return false;
+    }
+
+    while (p < end)
+    {
+        std::string filter;
+        if (!readString(p, end, filter))
+        {
+            return false;
+        }
+        unsubscribe(client, filter);
+    }
+
+    std::string ack;
+    ack += (char)(packetId >> 8);
+    ack += (char)(packetId & 0xFFU);
+    queue(client, makePacket(0xB0U, ack));
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handles PUBLISH: acknowledges QoS 1 and routes the message to the matching subscriptions.
+ **********************************************************************************************************************/
+bool MqttBroker::handlePublish (Client& client, uint8_t header, const uint8_t* body, size_t size)
+{
+    const uint8_t* p = body;
+    const uint8_t* end = body + size;
+    uint8_t qos = (header >> 1) & 0x03U;
+    std::string topic;
+    uint16_t packetId = 0;
+
+    if ((qos > 1) || !readString(p, end, topic) || topic.empty() ||
+        (topic.find_first_of("+#") != std::string::npos) || ((qos > 0) && !readUint16(p, end, packetId)))
+    {
+        return false;
+    }
+
+    ++messagesIn;
+    if (qos > 0)
+    {
+        std::string ack;
+        ack += (char)(packetId >> 8);
+        ack += (char)(packetId & 0xFFU);
+        queue(client, makePacket(0x40U, ack));
+    }
+
+    // The only copy of the payload; every subscriber's queue shares it
+    std::shared_ptr<const std::string> payload = std::make_shared<const std::string>(
+        reinterpret_cast<const char*>(p), end - p);
+    route(topic, payload, qos);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Queues a message to every matching subscriber, once per subscriber at the highest matching QoS.
+ *
+ * QoS 0 subscribers share one packet header as well as the payload; QoS 1 subscribers get their own header carrying
+ * their packet ID.
+ **********************************************************************************************************************/
+void MqttBroker::route (const std::string& topic, const std::shared_ptr<const std::string>& payload, uint8_t qos)
+{
+    std::vector<std::pair<Client*, uint8_t>> matches;
+    collect(root, splitTopic(topic), 0, matches);
+    if (matches.empty())
+    {
+        return;
+    }
+
+    // Overlapping subscriptions of one client deliver once, at the highest QoS
+    std::sort(matches.begin(), matches.end());
+    std::shared_ptr<const std::string> sharedHeader;
+    std::string topicField;
+    topicField += (char)(topic.size() >> 8);
+    topicField += (char)(topic.size() & 0xFFU);
+    topicField += topic;
+
+    for (size_t i = 0; i < matches.size(); ++i)
+    {
+        Client& client = *matches[i].first;
+        if ((i + 1 < matches.size()) && (matches[i + 1].first == &client))
+        {
+            continue;
+        }
+        if (client.closing)
+        {
+            continue;
+        }
+
+        uint8_t deliveryQos = std::min(qos, matches[i].second);
+        if (deliveryQos == 0)
+        {
+            if (client.outBytes > BROKER_MAX_BACKLOG)
+            {
+                ++messagesDropped;
+                continue;
+            }
+            if (!sharedHeader)
+            {
+                std::string header;
+                header += (char)0x30;
+                putLength(header, topicField.size() + payload->size());
+                sharedHeader = std::make_shared<const std::string>(header + topicField);
+            }
+            queue(client, sharedHeader);
+        }
+        else
+        {
+            if (client.nextPacketId == 0)
+            {
+                client.nextPacketId = 1;
+            }
+            uint16_t packetId = client.nextPacketId++;
+            std::string header;
+            header += (char)0x32;
+            putLength(header, topicField.size() + 2 + payload->size());
+            header += topicField;
+            header += (char)(packetId >> 8);
+            header += (char)(packetId & 0xFFU);
+            queue(client, std::make_shared<const std::string>(header));
+        }
+
+        queue(client, payload);
+        ++messagesOut;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Collects the subscribers of the filters matching the topic levels from a node on.
+ *
+ * Wildcards at the first level do not match topics starting with "$", as MQTT requires.
+ **********************************************************************************************************************/
+void MqttBroker::collect (const TopicNode& node, const std::vector<std::string>& levels, size_t level,
+                          std::vector<std::pair<Client*, uint8_t>>& matches) const
+{
+    auto hash = node.children.find("#");
+    bool wildcards = !((level == 0) && !levels[0].empty() && (levels[0][0] == '$'));
+
+    if (level == levels.size())
+    {
+        matches.insert(matches.end(), node.subscribers.begin(), node.subscribers.end());
+        if (hash != node.children.end())
+        {
+            // "a/#" also matches "a"
+            matches.insert(matches.end(), hash->second->subscribers.begin(), hash->second->subscribers.end());
+        }
+        return;
+    }
+
+    auto exact = node.children.find(levels[level]);
+    if (exact != node.children.end())
+    {
+        collect(*exact->second, levels, level + 1, matches);
+    }
+
+    if (wildcards)
+    {
+        auto plus = node.children.find("+");
+        if (plus != node.children.end())
+        {
+            collect(*plus->second, levels, level + 1, matches);
+        }
+        if (hash != node.children.end())
+        {
+            matches.insert(matches.end(), hash->second->subscribers.begin(), hash->second->subscribers.end());
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds or updates a subscription of a client.
+ **********************************************************************************************************************/
+void MqttBroker::subscribe (Client& client, const std::string& filter, uint8_t qos)
+{
+    TopicNode* node = &root;
+    for (const std::string& level : splitTopic(filter))
+    {
+        std::unique_ptr<TopicNode>& child = node->children[level];
+        if (!child)
+        {
+            child.reset(new TopicNode());
+        }
+        node = child.get();
+    }
+
+    node->subscribers[&client] = qos;
+    if (std::find(client.filters.begin(), client.filters.end(), filter) == client.filters.end())
+    {
+        client.filters.push_back(filter);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes a subscription of a client and prunes the nodes left empty.
+ **********************************************************************************************************************/
+void MqttBroker::unsubscribe (Client& client, const std::string& filter)
+{
+    std::vector<std::string> levels = splitTopic(filter);
+    std::vector<TopicNode*> path(1, &root);
+
+    for (const std::string& level : levels)
+    {
+        auto it = path.back()->children.find(level);
+        if (it == path.back()->children.end())
+        {
+            return;
+        }
+        path.push_back(it->second.get());
+    }
+
+    path.back()->subscribers.erase(&client);
+    for (size_t i = levels.size(); i > 0; --i)
+    {
+        TopicNode* node = path[i];
+        if (!node->subscribers.empty() || !node->children.empty())
+        {
+            break;
+        }
+        path[i - 1]->children.erase(levels[i - 1]);
+    }
+
+    client.filters.erase(std::remove(client.filters.begin(), client.filters.end(), filter), client.filters.end());
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends a shared buffer to the output queue of a client.
+ **********************************************************************************************************************/
+void MqttBroker::queue (Client& client, const std::shared_ptr<const std::string>& data)
+{
+    if (client.out.empty() && !client.wantWrite)
+    {
+        dirty.push_back(&client);
+    }
+
+    OutChunk chunk;
+    chunk.data = data;
+    chunk.offset = 0;
+    client.out.push_back(chunk);
+    client.outBytes += data->size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes the output queue of a client, many chunks per call, until it is empty or the socket is full.
+ *
+ * Waits for EPOLLOUT only while output is pending.
+ **********************************************************************************************************************/
+void MqttBroker::flush (Client& client)
+{
+    struct iovec iov[WRITE_IOVECS];
+
+    while (!client.out.empty())
+    {
+        int count = 0;
+        for (auto it = client.out.begin(); (it != client.out.end()) && (count < WRITE_IOVECS); ++it, ++count)
+        {
+            iov[count].iov_base = const_cast<char*>(it->data->data() + it->offset);
+            iov[count].iov_len = it->data->size() - it->offset;
+        }
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                client.closing = true;
+                return;
+            }
+            break;
+        }
+
+        bytesOut += n;
+        client.outBytes -= n;
+        size_t written = n;
+        while (written > 0)
+        {
+            OutChunk& chunk = client.out.front();
+            size_t left = chunk.data->size() - chunk.offset;
+            if (written < left)
+            {
+                chunk.offset += written;
+                break;
+            }
+            written -= left;
+            client.out.pop_front();
+        }
+    }
+
+    bool wantWrite = !client.out.empty();
+    if (wantWrite != client.wantWrite)
+    {
+        struct epoll_event ev;
+        ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = client.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &ev);
+        client.wantWrite = wantWrite;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes the subscriptions of a client and closes its connection.
+ **********************************************************************************************************************/
+void MqttBroker::drop (Client& client)
+{
+    std::vector<std::string> filters = client.filters;
+    for (const std::string& filter : filters)
+    {
+        unsubscribe(client, filter);
+    }
+
+    auto id = clientIds.find(client.clientId);
+    if ((id != clientIds.end()) && (id->second == &client))
+    {
+        clientIds.erase(id);
+    }
+    if (client.connected)
+    {
+        --clientCount;
+    }
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+    ::close(client.fd);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Drops the clients marked for closing during the last event batch.
+ **********************************************************************************************************************/
+void MqttBroker::reap ()
+{
+    for (auto it = clients.begin(); it != clients.end(); )
+    {
+        if (it->second->closing)
+        {
+            drop(*it->second);
+            it = clients.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a big-endian 16-bit integer.
+ **********************************************************************************************************************/
+static bool readUint16 (const uint8_t*& p, const uint8_t* end, uint16_t& value)
+{
+    if (end - p < 2)
+    {
+        return false;
+    }
+
+    value = (uint16_t)((p[0] << 8) | p[1]);
+    p += 2;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a length-prefixed MQTT string.
+ **********************************************************************************************************************/
+static bool readString (const uint8_t*& p, const uint8_t* end, std::string& value)
+{
+    uint16_t length;
+    if (!readUint16(p, end, length) || (end - p < length))
+    {
+        return false;
+    }
+
+    value.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends an MQTT remaining length.
+ **********************************************************************************************************************/
+static void putLength (std::string& out, size_t length)
+{
+    do
+    {
+        uint8_t b = length & 0x7FU;
+        length >>= 7;
+        out += (char)(length > 0 ? (b | 0x80U) : b);
+    } while (length > 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Builds a complete packet from its first header byte and body.
+ **********************************************************************************************************************/
+static std::shared_ptr<const std::string> makePacket (uint8_t header, const std::string& body)
+{
+    std::string packet;
+    packet += (char)header;
+    putLength(packet, body.size());
+    packet += body;
+    return std::make_shared<const std::string>(packet);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in milliseconds.
+ **********************************************************************************************************************/
+static int64_t nowMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,115 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_broker.h"
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <atomic>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define STATS_INTERVAL_S        (10)              /* Period of the statistics line */
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void handle_signal(int signal);
+
+/***********************************************************************************************************************
+ * Global Variables
+ **********************************************************************************************************************/
+std::atomic<bool> running(true);                // Atomic flag for running the loop
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Signal handler for graceful shutdown.
+ *
+ * @param signal The signal received (e.g., SIGINT, SIGTERM).
+ **********************************************************************************************************************/
+static void handle_signal (int signal)
+{
+    running = false;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Entry point of the standalone GNSS broker.
+ *
+ * Runs the embedded MQTT broker for hosts without mosquitto: "gnss_broker [--port P] [--bind ADDR]". The default is
+ * port 1883 on the loopback interface.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    int port = 1883;
+    std::string bindAddress = BROKER_BIND_ADDRESS;
+    bool ok = (argc % 2 == 1);
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--port")
+        {
+            port = std::atoi(argv[i + 1]);
+        }
+        else if (option == "--bind")
+        {
+            bindAddress = argv[i + 1];
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    if (!ok || (port <= 0) || (port > 65535))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--port P] [--bind ADDR]" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    MqttBroker broker;
+    if (!broker.start((uint16_t)port, bindAddress))
+    {
+        return 1;
+    }
+    std::cout << "[INFO] Broker listening on " << bindAddress << ":" << broker.port() << std::endl;
+
+    auto lastStats = std::chrono::steady_clock::now();
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (std::chrono::steady_clock::now() - lastStats >= std::chrono::seconds(STATS_INTERVAL_S))
+        {
+            BrokerStats st = broker.stats();
+            std::cout << "[INFO] Broker: " << st.clients << " clients, " << st.messagesIn << " in, "
+                      << st.messagesOut << " out, " << st.messagesDropped << " dropped" << std::endl;
+            lastStats = std::chrono::steady_clock::now();
+        }
+    }
+
+    broker.stop();
+    return 0;
+}
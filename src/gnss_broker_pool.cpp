@@ -0,0 +1,823 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_broker_pool.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static uint64_t hashBytes(uint64_t hash, const char* data, size_t size);
+static uint64_t finishHash(uint64_t hash);
+static int64_t nowMs();
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty pool.
+ **********************************************************************************************************************/
+BrokerPool::BrokerPool ()
+    : backlogDropped(0), epollFd(-1)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Disconnects from all brokers.
+ **********************************************************************************************************************/
+BrokerPool::~BrokerPool ()
+{
+    stop();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates one client per broker and starts connecting them.
+ *
+ * The connections complete in service(); messages published before are buffered.
+ *
+ * @param brokers The brokers, at least one.
+ * @param clientId Client ID used on every broker, empty for a generated one.
+ * @param cleanSession False to let the brokers keep the session across reconnects.
+ * @param tls TLS options of every connection, TLS is off unless they enable it.
+ * @param onConnect Called whenever a broker connection is established.
+ * @param onMessage Called for every message received on the pool subscriptions.
+ *
+ * @return False if a client cannot be created or TLS cannot be set up.
+ **********************************************************************************************************************/
+bool BrokerPool::start (const std::vector<BrokerEndpoint>& brokers, const std::string& clientId, bool cleanSession,
+                        const TlsConfig& tls, const BrokerConnectHandler& onConnect,
+                        const BrokerMessageHandler& onMessage)
+{
+    connectHandler = onConnect;
+    messageHandler = onMessage;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        std::cerr << "Broker pool: cannot create epoll set: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    for (const BrokerEndpoint& endpoint : brokers)
+    {
+        std::unique_ptr<Link> link(new Link());
+        link->pool = this;
+        link->index = links.size();
+        link->endpoint = endpoint;
+        link->connected = false;
+        link->connecting = false;
+        link->lastAttemptMs = nowMs();
+        link->lastAckMs = 0;
+        link->lastMiscMs = 0;
+        link->watchedFd = -1;
+        link->watchedEvents = 0;
+        link->readyEvents = 0;
+        link->stats = BrokerLinkStats();
+        link->stats.name = endpoint.host + ":" + std::to_string(endpoint.port);
+        link->mosq = mosquitto_new(clientId.empty() ? NULL : clientId.c_str(), cleanSession, link.get());
+        if (link->mosq == NULL)
+        {
+            std::cerr << "Failed to create Mosquitto instance!" << std::endl;
+            stop();
+            return false;
+        }
+        // Each connection resumes its own TLS session, the broker behind it issued the ticket
+        if (!link->tls.init(tls) || !link->tls.apply(link->mosq))
+        {
+            mosquitto_destroy(link->mosq);
+            stop();
+            return false;
+        }
+
+        mosquitto_connect_callback_set(link->mosq, BrokerPool::onConnect);
+        mosquitto_disconnect_callback_set(link->mosq, onDisconnect);
+        mosquitto_publish_callback_set(link->mosq, onPublish);
+        mosquitto_message_callback_set(link->mosq, BrokerPool::onMessage);
+
+        link->connecting = (mosquitto_connect_async(link->mosq, endpoint.host.c_str(), endpoint.port,
+                                                    POOL_KEEPALIVE_S) == MOSQ_ERR_SUCCESS);
+        if (!link->connecting)
+        {
+            std::cerr << "Unable to connect to the MQTT broker " << link->stats.name << ", retrying" << std::endl;
+        }
+
+        for (unsigned v = 0; v < POOL_VIRTUAL_NODES; ++v)
+        {
+            std::string point = link->stats.name + "#" + std::to_string(v);
+            ring.push_back(std::make_pair(finishHash(hashBytes(0, point.data(), point.size())), link->index));
+        }
+        links.push_back(std::move(link));
+    }
+    std::sort(ring.begin(), ring.end());
+
+    return !links.empty();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Disconnects from all brokers. Unacknowledged and buffered messages are discarded.
+ **********************************************************************************************************************/
+void BrokerPool::stop ()
+{
+    for (std::unique_ptr<Link>& link : links)
+    {
+        link->unacked.clear();
+        if (link->connected)
+        {
+            link->connected = false;
+            mosquitto_disconnect(link->mosq);
+        }
+        mosquitto_destroy(link->mosq);
+    }
+    links.clear();
+    ring.clear();
+    backlog.clear();
+    subscriptions.clear();
+
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes a message on the broker of its key.
+ *
+ * @param key Routing key, the vehicle the message belongs to.
+ * @param topic The topic.
+ * @param payload The payload.
+ * @param qos The QoS level.
+ *
+ * @return False if the message was dropped because the backlog is full.
+ **********************************************************************************************************************/
+bool BrokerPool::publish (const std::string& key, const std::string& topic, const std::string& payload, int qos)
+{
+    Message message;
+    message.key = key;
+    message.topic = topic;
+    message.payload = payload;
+    message.qos = qos;
+
+    if (backlog.empty())
+    {
+        size_t broker;
+        while ((broker = route(key)) != none)
+        {
+            if (send(*links[broker], message))
+            {
+                return true;
+            }
+            linkLost(*links[broker]);
+        }
+    }
+
+    // Keep the order of a vehicle's messages: nothing overtakes the backlog
+    bool ok = true;
+    if (backlog.size() >= POOL_MAX_BACKLOG)
+    {
+        backlog.pop_front();
+        ++backlogDropped;
+        ok = false;
+    }
+    backlog.push_back(std::move(message));
+    return ok;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes a message on a given broker, e.g. a reply to a message received from it.
+ *
+ * @param broker Index of the broker, none to route by topic.
+ * @param topic The topic.
+ * @param payload The payload.
+ * @param qos The QoS level.
+ *
+ * @return False if the message was dropped because the backlog is full.
+ **********************************************************************************************************************/
+bool BrokerPool::publishTo (size_t broker, const std::string& topic, const std::string& payload, int qos)
+{
+    if ((broker < links.size()) && links[broker]->connected)
+    {
+        Message message;
+        message.key = topic;
+        message.topic = topic;
+        message.payload = payload;
+        message.qos = qos;
+        if (send(*links[broker], message))
+        {
+            return true;
+        }
+        linkLost(*links[broker]);
+    }
+
+    // The broker is gone, any other one is better than dropping the message
+    return publish(topic, topic, payload, qos);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Subscribes on every broker, now and after every reconnect.
+ *
+ * @param topic The topic filter.
+ * @param qos The QoS level.
+ **********************************************************************************************************************/
+void BrokerPool::subscribe (const std::string& topic, int qos)
+{
+    subscriptions.push_back(std::make_pair(topic, qos));
+    for (std::unique_ptr<Link>& link : links)
+    {
+        if (link->connected)
+        {
+            mosquitto_subscribe(link->mosq, NULL, topic.c_str(), qos);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief The broker a key is currently routed to.
+ *
+ * @param key The routing key.
+ *
+ * @return The first healthy broker clockwise from the key, else the first connected one, else none.
+ **********************************************************************************************************************/
+size_t BrokerPool::route (const std::string& key) const
+{
+    if (ring.empty())
+    {
+        return none;
+    }
+
+    int64_t now = nowMs();
+    uint64_t point = finishHash(hashBytes(0, key.data(), key.size()));
+    size_t start = std::lower_bound(ring.begin(), ring.end(), std::make_pair(point, (size_t)0)) - ring.begin();
+    size_t fallback = none;
+
+    for (size_t i = 0; i < ring.size(); ++i)
+    {
+        const Link& link = *links[ring[(start + i) % ring.size()].second];
+        if (healthy(link, now))
+        {
+            return link.index;
+        }
+        if (link.connected && (fallback == none))
+        {
+            fallback = link.index;
+        }
+    }
+
+    return fallback;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends the sockets of the broker connections for poll().
+ *
+ * @param fds Output descriptor list.
+ **********************************************************************************************************************/
+void BrokerPool::addPollFds (std::vector<struct pollfd>& fds) const
+{
+    for (const std::unique_ptr<Link>& link : links)
+    {
+        int sock = mosquitto_socket(link->mosq);
+        if (sock >= 0)
+        {
+            struct pollfd pfd = { sock, (short)(POLLIN | (mosquitto_want_write(link->mosq) ? POLLOUT : 0)), 0 };
+            fds.push_back(pfd);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Services every connection once without blocking.
+ *
+ * Lost and stalled connections fail their unacknowledged messages over, brokers that are down are retried every
+ * POOL_RECONNECT_MS, and buffered messages are published once a broker is available.
+ **********************************************************************************************************************/
+void BrokerPool::service ()
+{
+    for (std::unique_ptr<Link>& link : links)
+    {
+        serviceLink(*link, true, true);
+    }
+
+    drainBacklog();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds a descriptor to the epoll set of run(), e.g. another input served by the same thread.
+ *
+ * Must be called after start(). The caller handles the descriptor itself once run() returns.
+ *
+ * @param fd The descriptor, watched for input.
+ *
+ * @return False if it cannot be added.
+ **********************************************************************************************************************/
+bool BrokerPool::watch (int fd)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = none;
+    if ((epollFd < 0) || (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0))
+    {
+        std::cerr << "Broker pool: cannot watch descriptor " << fd << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Waits on all connections and watched descriptors with one epoll_wait, then services every connection.
+ *
+ * Only the connections that are ready are read or written; the others just run their keep-alive and reconnects.
+ *
+ * @param timeoutMs Longest wait.
+ **********************************************************************************************************************/
+void BrokerPool::run (int timeoutMs)
+{
+    struct epoll_event events[POOL_MAX_EVENTS];
+
+    for (std::unique_ptr<Link>& link : links)
+    {
+        updateWatch(*link);
+        link->readyEvents = 0;
+    }
+
+    int count = epoll_wait(epollFd, events, POOL_MAX_EVENTS, timeoutMs);
+    for (int i = 0; i < count; ++i)
+    {
+        if (events[i].data.u64 < links.size())
+        {
+            links[events[i].data.u64]->readyEvents = events[i].events;
+        }
+    }
+
+    for (std::unique_ptr<Link>& link : links)
+    {
+        serviceLink(*link, (link->readyEvents & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+                    (link->readyEvents & EPOLLOUT) != 0);
+    }
+
+    drainBacklog();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in milliseconds at which the pool next has timed work to do in run() or service().
+ *
+ * That is the next keep-alive check of a connection, the end of a connection attempt or of the wait for an
+ * acknowledgement that marks a broker as stalled, or the next reconnect. Sockets that become ready end a run() early on
+ * their own, so a caller may wait until then instead of calling run() with a short timeout.
+ *
+ * @return The time on the steady clock, INT64_MAX without brokers.
+ **********************************************************************************************************************/
+int64_t BrokerPool::nextDueMs () const
+{
+    int64_t due = INT64_MAX;
+    for (const std::unique_ptr<Link>& link : links)
+    {
+        if (link->connecting)
+        {
+            due = std::min(due, std::min(link->lastMiscMs + POOL_MISC_MS, link->lastAttemptMs + POOL_STALL_MS));
+        }
+        else if (link->connected)
+        {
+            due = std::min(due, link->lastMiscMs + POOL_MISC_MS);
+            if (!link->unacked.empty())
+            {
+                due = std::min(due, link->lastAckMs + POOL_STALL_MS);
+            }
+        }
+        else
+        {
+            due = std::min(due, link->lastAttemptMs + POOL_RECONNECT_MS);
+        }
+    }
+    return due;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The epoll set of run(), readable while a connection or a watched descriptor is ready.
+ **********************************************************************************************************************/
+int BrokerPool::fd () const
+{
+    return epollFd;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Brings the epoll set in line with the connections before a caller waits on fd() itself, so that it also wakes
+ *        up when queued output can be written.
+ **********************************************************************************************************************/
+void BrokerPool::prepareWait ()
+{
+    for (std::unique_ptr<Link>& link : links)
+    {
+        updateWatch(*link);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts a message received from a broker that was a copy of one already received.
+ *
+ * @param broker Index of the broker.
+ **********************************************************************************************************************/
+void BrokerPool::countDuplicate (size_t broker)
+{
+    if (broker < links.size())
+    {
+        ++links[broker]->stats.duplicates;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether at least one broker is connected.
+ **********************************************************************************************************************/
+bool BrokerPool::connected () const
+{
+    for (const std::unique_ptr<Link>& link : links)
+    {
+        if (link->connected)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Messages not yet acknowledged by a broker, including the buffered ones.
+ **********************************************************************************************************************/
+size_t BrokerPool::pending () const
+{
+    size_t count = backlog.size();
+    for (const std::unique_ptr<Link>& link : links)
+    {
+        count += link->unacked.size();
+    }
+    return count;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of brokers.
+ **********************************************************************************************************************/
+size_t BrokerPool::size () const
+{
+    return links.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Messages dropped from a full backlog.
+ **********************************************************************************************************************/
+uint64_t BrokerPool::dropped () const
+{
+    return backlogDropped;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counters of every broker, in the order the brokers were given.
+ **********************************************************************************************************************/
+std::vector<BrokerLinkStats> BrokerPool::stats () const
+{
+    std::vector<BrokerLinkStats> result;
+    int64_t now = nowMs();
+    for (const std::unique_ptr<Link>& link : links)
+    {
+        result.push_back(link->stats);
+        result.back().connected = link->connected;
+        result.back().healthy = healthy(*link, now);
+        result.back().tlsHandshakes = link->tls.handshakes();
+        result.back().tlsResumed = link->tls.resumed();
+    }
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Connection callback of every client, subscribes the pool topics.
+ **********************************************************************************************************************/
+void BrokerPool::onConnect (struct mosquitto* mosq, void* obj, int rc)
+{
+    Link& link = *static_cast<Link*>(obj);
+    link.connecting = false;
+    if (rc != 0)
+    {
+        std::cerr << "Connection refused by the MQTT broker " << link.stats.name << ", code: " << rc << std::endl;
+        return;
+    }
+
+    link.connected = true;
+    link.lastAckMs = nowMs();
+    for (const std::pair<std::string, int>& subscription : link.pool->subscriptions)
+    {
+        mosquitto_subscribe(mosq, NULL, subscription.first.c_str(), subscription.second);
+    }
+    if (link.pool->connectHandler)
+    {
+        link.pool->connectHandler(link.index);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Disconnection callback of every client.
+ **********************************************************************************************************************/
+void BrokerPool::onDisconnect (struct mosquitto* mosq, void* obj, int rc)
+{
+    Link& link = *static_cast<Link*>(obj);
+    if (link.connected)
+    {
+        link.pool->linkLost(link);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publish callback of every client: the broker acknowledged a QoS 1/2 message or a QoS 0 one was written.
+ **********************************************************************************************************************/
+void BrokerPool::onPublish (struct mosquitto* mosq, void* obj, int mid)
+{
+    Link& link = *static_cast<Link*>(obj);
+    ++link.stats.acknowledged;
+    link.unacked.erase(mid);
+    link.lastAckMs = nowMs();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Message callback of every client.
+ **********************************************************************************************************************/
+void BrokerPool::onMessage (struct mosquitto* mosq, void* obj, const struct mosquitto_message* message)
+{
+    Link& link = *static_cast<Link*>(obj);
+    ++link.stats.received;
+    link.stats.receivedBytes += message->payloadlen;
+    if (link.pool->messageHandler)
+    {
+        link.pool->messageHandler(link.index, message);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Health check of a broker: connected, not saturated and acknowledging within half the stall limit.
+ **********************************************************************************************************************/
+bool BrokerPool::healthy (const Link& link, int64_t now) const
+{
+    return link.connected && (link.unacked.size() < POOL_MAX_UNACKED) &&
+           (link.unacked.empty() || (now - link.lastAckMs < POOL_STALL_MS / 2));
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands a message to a broker, keeping QoS 1/2 messages until they are acknowledged.
+ *
+ * @return False if the client refused the message, i.e. the connection is gone.
+ **********************************************************************************************************************/
+bool BrokerPool::send (Link& link, Message& message)
+{
+    int mid = 0;
+    if (mosquitto_publish(link.mosq, &mid, message.topic.c_str(), message.payload.size(), message.payload.data(),
+                          message.qos, false) != MOSQ_ERR_SUCCESS)
+    {
+        return false;
+    }
+
+    ++link.stats.published;
+    link.stats.bytes += message.payload.size();
+    if (message.qos > 0)
+    {
+        if (link.unacked.empty())
+        {
+            link.lastAckMs = nowMs();
+        }
+        link.unacked[mid] = std::move(message);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads, writes and keeps alive one connection, and handles its loss, stall and reconnection.
+ *
+ * @param link The connection.
+ * @param readable Whether to read from the socket.
+ * @param writable Whether to write to the socket even if nothing is known to be queued.
+ **********************************************************************************************************************/
+void BrokerPool::serviceLink (Link& link, bool readable, bool writable)
+{
+    int64_t now = nowMs();
+    if (link.connected || link.connecting)
+    {
+        int rc = readable ? mosquitto_loop_read(link.mosq, 1) : MOSQ_ERR_SUCCESS;
+        if ((rc == MOSQ_ERR_SUCCESS) && (writable || mosquitto_want_write(link.mosq)))
+        {
+            rc = mosquitto_loop_write(link.mosq, 1);
+        }
+        if (rc == MOSQ_ERR_SUCCESS)
+        {
+            rc = mosquitto_loop_misc(link.mosq);
+            link.lastMiscMs = now;
+        }
+
+        if ((rc != MOSQ_ERR_SUCCESS) || (link.connecting && (now - link.lastAttemptMs >= POOL_STALL_MS)))
+        {
+            linkLost(link);
+        }
+        else if (link.connected && !link.unacked.empty() && (now - link.lastAckMs >= POOL_STALL_MS))
+        {
+            // A broker that holds messages without acknowledging any is treated as lost, well before the keep-alive
+            // would notice it
+            std::cerr << "The MQTT broker " << link.stats.name << " stalled" << std::endl;
+            linkLost(link);
+            mosquitto_disconnect(link.mosq);
+        }
+    }
+    else if (now - link.lastAttemptMs >= POOL_RECONNECT_MS)
+    {
+        link.lastAttemptMs = now;
+        link.connecting = (mosquitto_reconnect_async(link.mosq) == MOSQ_ERR_SUCCESS);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Keeps the registration of a connection in the epoll set in line with its current socket and queued output.
+ **********************************************************************************************************************/
+void BrokerPool::updateWatch (Link& link)
+{
+    int sock = mosquitto_socket(link.mosq);
+    uint32_t events = EPOLLIN | (mosquitto_want_write(link.mosq) ? EPOLLOUT : 0);
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.u64 = link.index;
+
+    if (sock != link.watchedFd)
+    {
+        // A closed socket has already left the set, the call only matters if it is still open
+        if (link.watchedFd >= 0)
+        {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, link.watchedFd, nullptr);
+        }
+        link.watchedFd = ((sock >= 0) && (epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &ev) == 0)) ? sock : -1;
+        link.watchedEvents = events;
+    }
+    else if ((sock >= 0) && (events != link.watchedEvents))
+    {
+        // A reconnect can reuse the number of the closed socket, which is then no longer in the set
+        if ((epoll_ctl(epollFd, EPOLL_CTL_MOD, sock, &ev) != 0) && (errno == ENOENT))
+        {
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &ev);
+        }
+        link.watchedEvents = events;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Marks a broker as down and republishes its unacknowledged messages on the others.
+ *
+ * A broker that comes back with a persistent session may deliver some of them a second time; sequenced payloads make
+ * such duplicates harmless at the receiver.
+ **********************************************************************************************************************/
+void BrokerPool::linkLost (Link& link)
+{
+    if (link.connected)
+    {
+        ++link.stats.disconnects;
+        std::cerr << "Lost the MQTT broker " << link.stats.name << ", failing over " << link.unacked.size()
+                  << " messages" << std::endl;
+    }
+    link.connected = false;
+    link.connecting = false;
+    link.lastAttemptMs = nowMs();
+
+    std::map<int, Message> moved;
+    moved.swap(link.unacked);
+    link.stats.failedOver += moved.size();
+    for (auto& entry : moved)
+    {
+        publish(entry.second.key, entry.second.topic, entry.second.payload, entry.second.qos);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes buffered messages while a broker is available.
+ **********************************************************************************************************************/
+void BrokerPool::drainBacklog ()
+{
+    while (!backlog.empty())
+    {
+        size_t broker = route(backlog.front().key);
+        if (broker == none)
+        {
+            return;
+        }
+        if (send(*links[broker], backlog.front()))
+        {
+            backlog.pop_front();
+        }
+        else
+        {
+            linkLost(*links[broker]);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty filter.
+ **********************************************************************************************************************/
+DuplicateFilter::DuplicateFilter ()
+    : next(0)
+{
+    recent.reserve(DEDUP_WINDOW);
+    index.reserve(DEDUP_WINDOW);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a message is among the last DEDUP_WINDOW ones remembered.
+ *
+ * @param topic The topic of the message.
+ * @param payload The payload of the message.
+ *
+ * @return True for a copy of a remembered message.
+ **********************************************************************************************************************/
+bool DuplicateFilter::seen (const std::string& topic, const std::string& payload) const
+{
+    uint64_t hash = hashBytes(0, topic.data(), topic.size() + 1);
+    return index.count(finishHash(hashBytes(hash, payload.data(), payload.size()))) != 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Remembers a message, forgetting the oldest one once DEDUP_WINDOW are remembered.
+ *
+ * Call it only once the message is queued for storage, so the copy of a message that was dropped is still stored.
+ *
+ * @param topic The topic of the message.
+ * @param payload The payload of the message.
+ **********************************************************************************************************************/
+void DuplicateFilter::remember (const std::string& topic, const std::string& payload)
+{
+    uint64_t hash = hashBytes(0, topic.data(), topic.size() + 1);
+    hash = finishHash(hashBytes(hash, payload.data(), payload.size()));
+    if (!index.insert(hash).second)
+    {
+        return;
+    }
+
+    if (recent.size() < DEDUP_WINDOW)
+    {
+        recent.push_back(hash);
+    }
+    else
+    {
+        index.erase(recent[next]);
+        recent[next] = hash;
+        next = (next + 1) % DEDUP_WINDOW;
+    }
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Continues a 64-bit FNV-1a hash over some bytes; 0 starts a new hash.
+ **********************************************************************************************************************/
+static uint64_t hashBytes (uint64_t hash, const char* data, size_t size)
+{
+    if (hash == 0)
+    {
+        hash = 14695981039346656037ULL;
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Final mix of a hash, spreads similar keys over the whole ring.
+ **********************************************************************************************************************/
+static uint64_t finishHash (uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in milliseconds.
+ **********************************************************************************************************************/
+static int64_t nowMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,441 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_cdc.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define CDC_TABLE               "GNSS_DATA"       /* Table whose inserts are captured */
+#define CDC_REQUEST_MAX         (64U)             /* Longest accepted FROM request */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool setNonBlocking(int fd);
+static void appendRecord(std::string& out, int64_t id, const char* data, size_t size);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an inactive change capture.
+ **********************************************************************************************************************/
+ChangeCapture::ChangeCapture ()
+    : db(nullptr), catchUp(nullptr), listenFd(-1), committedId(0), ringFloor(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Detaches from the database and closes all subscribers.
+ **********************************************************************************************************************/
+ChangeCapture::~ChangeCapture ()
+{
+    stop();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Installs the SQLite hooks and starts listening for subscribers.
+ *
+ * @param db The database the receiver writes to.
+ * @param socketPath Path of the Unix socket to serve the stream on.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool ChangeCapture::start (sqlite3* db, const std::string& socketPath)
+{
+    const char* sql = "SELECT ID, NMEA_DATA FROM " CDC_TABLE " WHERE ID > ?1 AND ID <= ?2 ORDER BY ID LIMIT ?3;";
+    if (sqlite3_prepare_v2(db, sql, -1, &catchUp, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "CDC: cannot prepare catch-up query: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    // Rows committed before start-up are only reachable through the database
+    sqlite3_stmt* maxId = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT IFNULL(MAX(ID), 0) FROM " CDC_TABLE ";", -1, &maxId, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(maxId) == SQLITE_ROW)
+        {
+            committedId = sqlite3_column_int64(maxId, 0);
+        }
+        sqlite3_finalize(maxId);
+    }
+    ringFloor = committedId;
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "CDC: socket path too long" << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if ((listenFd < 0) || !setNonBlocking(listenFd) ||
+        (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(listenFd, 16) != 0))
+    {
+        std::cerr << "CDC: cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    this->db = db;
+    this->socketPath = socketPath;
+    sqlite3_update_hook(db, &ChangeCapture::onUpdate, this);
+    sqlite3_commit_hook(db, &ChangeCapture::onCommit, this);
+    sqlite3_rollback_hook(db, &ChangeCapture::onRollback, this);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes the hooks, closes the socket and disconnects all subscribers.
+ **********************************************************************************************************************/
+void ChangeCapture::stop ()
+{
+    if (db != nullptr)
+    {
+        sqlite3_update_hook(db, nullptr, nullptr);
+        sqlite3_commit_hook(db, nullptr, nullptr);
+        sqlite3_rollback_hook(db, nullptr, nullptr);
+        db = nullptr;
+    }
+    if (catchUp != nullptr)
+    {
+        sqlite3_finalize(catchUp);
+        catchUp = nullptr;
+    }
+    for (Subscriber& sub : subscribers)
+    {
+        close(sub.fd);
+    }
+    subscribers.clear();
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+        unlink(socketPath.c_str());
+        listenFd = -1;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands over the payload of the next insert, so the stream carries it without reading the row back.
+ *
+ * Must be called right before the corresponding INSERT is executed. A payload whose insert fails is replaced by the
+ * next one.
+ *
+ * @param data The payload being inserted.
+ **********************************************************************************************************************/
+void ChangeCapture::stage (const std::string& data)
+{
+    if (db != nullptr)
+    {
+        staged = data;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes the rows of the last transaction to the ring.
+ *
+ * Must be called once its COMMIT has returned SQLITE_OK: the commit hook runs before the commit is durable, and a
+ * commit that fails after it is rolled back, which discards the rows instead.
+ **********************************************************************************************************************/
+void ChangeCapture::committed ()
+{
+    for (CdcRecord& record : committing)
+    {
+        committedId = std::max(committedId, record.id);
+        ring.push_back(CdcRecord());
+        ring.back().id = record.id;
+        ring.back().data.swap(record.data);
+    }
+    committing.clear();
+
+    while (ring.size() > CDC_RING_RECORDS)
+    {
+        ringFloor = ring.front().id;
+        ring.pop_front();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Accepts subscribers, reads their requests and sends them the rows they have not seen yet.
+ *
+ * Never blocks. Call it after each batch of inserts and periodically from the main loop.
+ **********************************************************************************************************************/
+void ChangeCapture::service ()
+{
+    if (listenFd < 0)
+    {
+        return;
+    }
+
+    acceptSubscribers();
+
+    for (auto it = subscribers.begin(); it != subscribers.end(); )
+    {
+        bool alive = it->started || readRequest(*it);
+        if (alive && it->started)
+        {
+            fill(*it);
+            alive = flush(*it);
+        }
+
+        if (alive)
+        {
+            ++it;
+        }
+        else
+        {
+            close(it->fd);
+            it = subscribers.erase(it);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief ID of the newest committed row, the position a subscriber starting with "FROM now" resumes from.
+ **********************************************************************************************************************/
+int64_t ChangeCapture::lastCommittedId () const
+{
+    return committedId;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief SQLite update hook collecting the inserted rows of the open transaction.
+ **********************************************************************************************************************/
+void ChangeCapture::onUpdate (void* self, int op, const char* dbName, const char* table, sqlite3_int64 rowid)
+{
+    ChangeCapture* cdc = static_cast<ChangeCapture*>(self);
+    if ((op != SQLITE_INSERT) || (std::strcmp(table, CDC_TABLE) != 0))
+    {
+        return;
+    }
+
+    CdcRecord record;
+    record.id = rowid;
+    record.data.swap(cdc->staged);
+    cdc->staged.clear();
+    cdc->pending.push_back(record);
+}
+
+/*******************************************************************************************************************//**
+ * @brief SQLite commit hook setting the rows of the committing transaction aside until committed() is called.
+ *
+ * @return Always 0 so the commit proceeds.
+ **********************************************************************************************************************/
+int ChangeCapture::onCommit (void* self)
+{
+    ChangeCapture* cdc = static_cast<ChangeCapture*>(self);
+    for (CdcRecord& record : cdc->pending)
+    {
+        cdc->committing.push_back(CdcRecord());
+        cdc->committing.back().id = record.id;
+        cdc->committing.back().data.swap(record.data);
+    }
+    cdc->pending.clear();
+    return 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief SQLite rollback hook discarding the rows of the aborted transaction, also after a failed COMMIT.
+ **********************************************************************************************************************/
+void ChangeCapture::onRollback (void* self)
+{
+    ChangeCapture* cdc = static_cast<ChangeCapture*>(self);
+    cdc->pending.clear();
+    cdc->committing.clear();
+    cdc->staged.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Accepts all waiting connections.
+ **********************************************************************************************************************/
+void ChangeCapture::acceptSubscribers ()
+{
+    while (true)
+    {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        if ((subscribers.size() >= CDC_MAX_CLIENTS) || !setNonBlocking(fd))
+        {
+            close(fd);
+            continue;
+        }
+
+        Subscriber sub;
+        sub.fd = fd;
+        sub.started = false;
+        sub.position = 0;
+        subscribers.push_back(sub);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads the "FROM <id>" request of a subscriber.
+ *
+ * @return False if the subscriber disconnected or sent an invalid request.
+ **********************************************************************************************************************/
+bool ChangeCapture::readRequest (Subscriber& sub)
+{
+    char buffer[CDC_REQUEST_MAX];
+    ssize_t n = recv(sub.fd, buffer, sizeof(buffer), 0);
+    if (n == 0)
+    {
+        return false;
+    }
+    if (n < 0)
+    {
+        return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+    }
+
+    sub.in.append(buffer, n);
+    size_t eol = sub.in.find('\n');
+    if (eol == std::string::npos)
+    {
+        return sub.in.size() < CDC_REQUEST_MAX;
+    }
+
+    std::string request = sub.in.substr(0, eol);
+    if (request.compare(0, 5, "FROM ") != 0)
+    {
+        return false;
+    }
+
+    std::string from = request.substr(5);
+    if (from == "now")
+    {
+        sub.position = committedId;
+    }
+    else
+    {
+        char* end = nullptr;
+        sub.position = std::strtoll(from.c_str(), &end, 10);
+        if ((end == from.c_str()) || (sub.position < 0))
+        {
+            return false;
+        }
+    }
+
+    sub.started = true;
+    sub.in.clear();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Queues the rows after the subscriber's position, from the ring or, for old positions, from the database.
+ **********************************************************************************************************************/
+void ChangeCapture::fill (Subscriber& sub)
+{
+    while ((sub.out.size() < CDC_CLIENT_BUFFER) && (sub.position < committedId))
+    {
+        if (sub.position >= ringFloor)
+        {
+            // Every committed row after ringFloor is in the ring
+            auto it = std::upper_bound(ring.begin(), ring.end(), sub.position,
+                                       [](int64_t id, const CdcRecord& r) { return id < r.id; });
+            for (; (it != ring.end()) && (sub.out.size() < CDC_CLIENT_BUFFER); ++it)
+            {
+                appendRecord(sub.out, it->id, it->data.data(), it->data.size());
+                sub.position = it->id;
+            }
+            return;
+        }
+
+        // Catch up from the database up to the oldest row of the ring
+        sqlite3_reset(catchUp);
+        sqlite3_bind_int64(catchUp, 1, sub.position);
+        sqlite3_bind_int64(catchUp, 2, ringFloor);
+        sqlite3_bind_int(catchUp, 3, CDC_CATCHUP_ROWS);
+
+        bool any = false;
+        while (sqlite3_step(catchUp) == SQLITE_ROW)
+        {
+            int64_t id = sqlite3_column_int64(catchUp, 0);
+            const char* data = reinterpret_cast<const char*>(sqlite3_column_text(catchUp, 1));
+            appendRecord(sub.out, id, (data != nullptr) ? data : "", sqlite3_column_bytes(catchUp, 1));
+            sub.position = id;
+            any = true;
+        }
+        if (!any)
+        {
+            sub.position = ringFloor;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes as much queued output as the socket accepts.
+ *
+ * @return False if the subscriber disconnected.
+ **********************************************************************************************************************/
+bool ChangeCapture::flush (Subscriber& sub)
+{
+    size_t sent = 0;
+    while (sent < sub.out.size())
+    {
+        ssize_t n = send(sub.fd, sub.out.data() + sent, sub.out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                break;
+            }
+            return false;
+        }
+        sent += n;
+    }
+
+    sub.out.erase(0, sent);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Switches a descriptor to non-blocking mode.
+ **********************************************************************************************************************/
+static bool setNonBlocking (int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends one "<id> <data>\n" line to a subscriber buffer.
+ **********************************************************************************************************************/
+static void appendRecord (std::string& out, int64_t id, const char* data, size_t size)
+{
+    out += std::to_string(id);
+    out += ' ';
+    out.append(data, size);
+    out += '\n';
+}
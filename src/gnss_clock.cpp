@@ -0,0 +1,146 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_clock.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates a clock following the wall clock.
+ **********************************************************************************************************************/
+VirtualClock::VirtualClock ()
+{
+    start(1.0, -1);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Starts the clock.
+ *
+ * @param speed Simulated time per wall clock time, CLOCK_AS_FAST_AS_POSSIBLE to move only by the waits.
+ * @param startMs Simulated time to start from in Unix milliseconds, negative for the current time.
+ **********************************************************************************************************************/
+void VirtualClock::start (double speed, int64_t startMs)
+{
+    rate = speed;
+    realOrigin = std::chrono::steady_clock::now();
+    originMs = (startMs >= 0) ? startMs : std::chrono::duration_cast<std::chrono::milliseconds>(
+                                              std::chrono::system_clock::now().time_since_epoch()).count();
+    scheduledMs = 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Current simulated time in Unix milliseconds.
+ **********************************************************************************************************************/
+int64_t VirtualClock::nowMs () const
+{
+    return originMs + elapsedMs();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Takes a wait of the simulation.
+ *
+ * Waits are scheduled from the start of the clock, so the time spent between them does not add up over a run.
+ *
+ * @param virtualMs Simulated time to wait.
+ *
+ * @return The wall clock time to wait for it in milliseconds; 0 as fast as possible, where the clock moves at once.
+ **********************************************************************************************************************/
+int64_t VirtualClock::wait (int64_t virtualMs)
+{
+    scheduledMs += virtualMs;
+    if (rate == CLOCK_AS_FAST_AS_POSSIBLE)
+    {
+        return 0;
+    }
+    return std::max<int64_t>(std::llround((double)(scheduledMs - elapsedMs()) / rate), 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Simulated time since start() in milliseconds.
+ **********************************************************************************************************************/
+int64_t VirtualClock::elapsedMs () const
+{
+    if (rate == CLOCK_AS_FAST_AS_POSSIBLE)
+    {
+        return scheduledMs;
+    }
+    double realMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - realOrigin).count();
+    return (int64_t)(realMs * rate);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a clock speed: a factor such as "1", "60" or "0.5", or "max" for as fast as possible.
+ **********************************************************************************************************************/
+bool parseClockSpeed (const std::string& text, double& speed)
+{
+    if (text == "max")
+    {
+        speed = CLOCK_AS_FAST_AS_POSSIBLE;
+        return true;
+    }
+
+    char* end = nullptr;
+    speed = std::strtod(text.c_str(), &end);
+    return !text.empty() && (*end == '\0') && (speed > 0.0) && (speed <= CLOCK_MAX_SPEED);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a start time in UTC: "YYYY-MM-DDTHH:MM:SS", "YYYY-MM-DD" or Unix seconds.
+ **********************************************************************************************************************/
+bool parseClockStart (const std::string& text, int64_t& startMs)
+{
+    std::tm tm = {};
+    int dateLength = 0;
+    int timeLength = 0;
+    bool date = (std::sscanf(text.c_str(), "%4d-%2d-%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &dateLength) == 3);
+    if (date && (text.size() > (size_t)dateLength))
+    {
+        std::sscanf(text.c_str() + dateLength, "T%2d:%2d:%2d%n", &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &timeLength);
+    }
+
+    if (date && (text.size() == (size_t)(dateLength + timeLength)))
+    {
+        if ((tm.tm_year < 1970) || (tm.tm_mon < 1) || (tm.tm_mon > 12) || (tm.tm_mday < 1) || (tm.tm_mday > 31) ||
+            (tm.tm_hour > 23) || (tm.tm_min > 59) || (tm.tm_sec > 59))
+        {
+            return false;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        startMs = (int64_t)timegm(&tm) * 1000;
+        return true;
+    }
+
+    char* end = nullptr;
+    long long seconds = std::strtoll(text.c_str(), &end, 10);
+    if (text.empty() || (*end != '\0') || (seconds < 0))
+    {
+        return false;
+    }
+    startMs = (int64_t)seconds * 1000;
+    return true;
+}
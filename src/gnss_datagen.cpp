@@ -0,0 +1,590 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_trajectory.h"
+#include "../inc/gnss_payload.h"
+#include "../inc/gnss_clock.h"
+#include "../inc/gnss_archive.h"
+#include <sqlite3.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define DATAGEN_GROUP_VEHICLES  (64U)             /* Vehicles per block, fixed whatever the number of threads */
+#define DATAGEN_WINDOW_FIXES    (256U)            /* Fixes per vehicle and block, rounded up to whole batches */
+#define DATAGEN_BLOCKS_PER_THREAD (4U)            /* Blocks a thread generates ahead of the writer */
+#define DATAGEN_DEFAULT_START   "2026-01-01"      /* Time of the first fix when --start is not given */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+enum DatagenFormat
+{
+    DATAGEN_NMEA,               /* "<device> <sentence>" lines */
+    DATAGEN_BATCHES,            /* Sequenced batch payloads, each preceded by its length as u32 */
+    DATAGEN_SQLITE,             /* GNSS_DATA table of gnss_receiver */
+    DATAGEN_ARCHIVE             /* Compressed per-device chunks with a directory, see gnss_archive.h */
+};
+
+/* Command line options of the generator */
+struct DatagenConfig
+{
+    DatagenFormat format;
+    std::string outPath;
+    uint64_t vehicles;
+    uint64_t fixes;             /* Fixes per vehicle */
+    int intervalMs;             /* Time between two fixes of a vehicle */
+    int64_t startMs;
+    uint64_t seed;
+    unsigned threads;
+    int batchSize;              /* Sentences per batch of the batches format */
+    bool deflate;               /* Compress the batches */
+};
+
+/* A stored row of the SQLite format, pointing into the data of its block */
+struct DatagenRow
+{
+    uint32_t vehicle;
+    uint32_t offset;
+    uint32_t length;
+    uint64_t sequence;
+};
+
+/* The output of one window of one group of vehicles */
+struct DatagenBlock
+{
+    std::string data;
+    std::vector<DatagenRow> rows;
+    std::vector<FixSample> samples;         /* Archive format: the fixes, vehicle-major */
+    uint64_t firstVehicle;
+    uint64_t steps;                         /* Fixes per vehicle */
+    uint64_t fixes;
+    bool ready;
+};
+
+/* Work shared by the generator threads and the writer */
+struct DatagenJob
+{
+    DatagenConfig config;
+    std::vector<TrajectoryModel> vehicles;  /* Carried from one window to the next */
+    uint64_t groups;
+    uint64_t windowFixes;
+    uint64_t windows;
+    uint64_t blocks;                        /* Window-major: block b is window b / groups of group b % groups */
+    uint64_t nextBlock;
+    uint64_t written;
+    std::vector<uint64_t> windowsDone;      /* Per group */
+    std::vector<DatagenBlock> slots;        /* Ring of the blocks between generation and writing */
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::atomic<bool> failed;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool parseDatagenArgs(int argc, char* argv[], DatagenConfig& config);
+static bool parseCount(const std::string& text, uint64_t minValue, uint64_t maxValue, uint64_t& value);
+static std::string deviceName(uint64_t vehicle);
+static void generateBlock(DatagenJob& job, uint64_t block, DatagenBlock& out);
+static void generateLoop(DatagenJob& job);
+static sqlite3* openDatabase(const std::string& path, sqlite3_stmt*& insert);
+static bool storeBlock(sqlite3* db, sqlite3_stmt* insert, const DatagenBlock& block);
+static bool archiveBlock(ArchiveWriter& archive, const DatagenBlock& block);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parses the command line options of the generator.
+ *
+ * @return False if an option is unknown or invalid.
+ **********************************************************************************************************************/
+static bool parseDatagenArgs (int argc, char* argv[], DatagenConfig& config)
+{
+    config.format = DATAGEN_NMEA;
+    config.vehicles = 1000;
+    config.fixes = 1000;
+    config.intervalMs = 1000;
+    parseClockStart(DATAGEN_DEFAULT_START, config.startMs);
+    config.seed = 1;
+    config.threads = std::max(1U, std::thread::hardware_concurrency());
+    config.batchSize = 64;
+    config.deflate = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--deflate")
+        {
+            config.deflate = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        uint64_t number = 0;
+        bool ok = true;
+
+        if (option == "--format")
+        {
+            ok = (value == "nmea") || (value == "batches") || (value == "sqlite") || (value == "archive");
+            config.format = (value == "archive") ? DATAGEN_ARCHIVE
+                          : (value == "sqlite")  ? DATAGEN_SQLITE
+                          : (value == "batches") ? DATAGEN_BATCHES : DATAGEN_NMEA;
+        }
+        else if (option == "--out")
+        {
+            config.outPath = value;
+            ok = !value.empty();
+        }
+        else if (option == "--vehicles")
+        {
+            ok = parseCount(value, 1, 100000000, config.vehicles);
+        }
+        else if (option == "--fixes")
+        {
+            ok = parseCount(value, 1, UINT32_MAX, config.fixes);
+        }
+        else if (option == "--interval-ms")
+        {
+            ok = parseCount(value, 1, 86400000, number);
+            config.intervalMs = (int)number;
+        }
+        else if (option == "--start")
+        {
+            ok = parseClockStart(value, config.startMs);
+        }
+        else if (option == "--seed")
+        {
+            ok = parseCount(value, 0, UINT64_MAX, config.seed);
+        }
+        else if (option == "--threads")
+        {
+            ok = parseCount(value, 1, 256, number);
+            config.threads = (unsigned)number;
+        }
+        else if (option == "--batch")
+        {
+            ok = parseCount(value, 1, PAYLOAD_MAX_SENTENCES, number);
+            config.batchSize = (int)number;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (config.outPath.empty())
+    {
+        std::cerr << "--out is required" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a decimal count within the given bounds.
+ **********************************************************************************************************************/
+static bool parseCount (const std::string& text, uint64_t minValue, uint64_t maxValue, uint64_t& value)
+{
+    char* end = nullptr;
+    value = std::strtoull(text.c_str(), &end, 10);
+    return !text.empty() && (text[0] != '-') && (*end == '\0') && (value >= minValue) && (value <= maxValue);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Device ID of a simulated vehicle.
+ **********************************************************************************************************************/
+static std::string deviceName (uint64_t vehicle)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "veh%06llu", (unsigned long long)vehicle);
+    return name;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Simulates one window of one group of vehicles and renders it in the output format.
+ *
+ * NMEA lines and rows are in time order across the vehicles of the group; batches and archive samples hold
+ * consecutive fixes of one vehicle.
+ **********************************************************************************************************************/
+static void generateBlock (DatagenJob& job, uint64_t block, DatagenBlock& out)
+{
+    const DatagenConfig& config = job.config;
+    uint64_t window = block / job.groups;
+    uint64_t first = (block % job.groups) * DATAGEN_GROUP_VEHICLES;
+    uint64_t count = std::min<uint64_t>(DATAGEN_GROUP_VEHICLES, config.vehicles - first);
+    uint64_t firstFix = window * job.windowFixes;
+    uint64_t steps = std::min<uint64_t>(job.windowFixes, config.fixes - firstFix);
+
+    // Fixes of the window, vehicle-major
+    std::vector<GNSSFix> fixes(count * steps);
+    for (uint64_t v = 0; v < count; ++v)
+    {
+        TrajectoryModel& model = job.vehicles[first + v];
+        for (uint64_t s = 0; s < steps; ++s)
+        {
+            model.step((firstFix + s == 0) ? 0 : config.intervalMs, fixes[v * steps + s]);
+        }
+    }
+
+    std::vector<std::string> devices(count);
+    for (uint64_t v = 0; v < count; ++v)
+    {
+        devices[v] = deviceName(first + v);
+    }
+
+    out.data.clear();
+    out.rows.clear();
+    out.samples.clear();
+    out.firstVehicle = first;
+    out.steps = steps;
+    out.fixes = count * steps;
+    char sentence[GPRMC_MAX_LENGTH];
+
+    if (config.format == DATAGEN_ARCHIVE)
+    {
+        out.samples.reserve(fixes.size());
+        for (const GNSSFix& fix : fixes)
+        {
+            out.samples.push_back(toFixSample(fix));
+        }
+        return;
+    }
+
+    if (config.format == DATAGEN_BATCHES)
+    {
+        PayloadBatch batch;
+        std::string payload;
+        for (uint64_t v = 0; v < count; ++v)
+        {
+            batch.deviceId = devices[v];
+            for (uint64_t s = 0; s < steps; s += config.batchSize)
+            {
+                uint64_t size = std::min<uint64_t>(config.batchSize, steps - s);
+                batch.firstSequence = firstFix + s + 1;
+                batch.sentences.resize(size);
+                for (uint64_t i = 0; i < size; ++i)
+                {
+                    batch.sentences[i].assign(sentence, formatGPRMC(fixes[v * steps + s + i], sentence));
+                }
+                encodeBatch(batch, payload, config.deflate);
+                uint32_t length = (uint32_t)payload.size();
+                out.data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                out.data.append(payload);
+            }
+        }
+        return;
+    }
+
+    out.data.reserve(count * steps * (GPRMC_MAX_LENGTH / 2 + 12));
+    for (uint64_t s = 0; s < steps; ++s)
+    {
+        for (uint64_t v = 0; v < count; ++v)
+        {
+            size_t length = formatGPRMC(fixes[v * steps + s], sentence);
+            if (config.format == DATAGEN_SQLITE)
+            {
+                out.rows.push_back(DatagenRow{(uint32_t)(first + v), (uint32_t)out.data.size(), (uint32_t)length,
+                                              firstFix + s + 1});
+                out.data.append(sentence, length);
+            }
+            else
+            {
+                out.data.append(devices[v]);
+                out.data.push_back(' ');
+                out.data.append(sentence, length);
+                out.data.push_back('\n');
+            }
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Generator thread: takes the blocks in order, each once the previous window of its group is done and the
+ *        writer has room for it.
+ **********************************************************************************************************************/
+static void generateLoop (DatagenJob& job)
+{
+    std::unique_lock<std::mutex> lock(job.mutex);
+    while (!job.failed)
+    {
+        job.changed.wait(lock, [&job]() {
+            return job.failed || (job.nextBlock >= job.blocks) || (job.nextBlock < job.written + job.slots.size());
+        });
+        if (job.failed || (job.nextBlock >= job.blocks))
+        {
+            return;
+        }
+
+        uint64_t block = job.nextBlock++;
+        uint64_t group = block % job.groups;
+        uint64_t window = block / job.groups;
+        job.changed.wait(lock, [&job, group, window]() { return job.failed || (job.windowsDone[group] == window); });
+        DatagenBlock& slot = job.slots[block % job.slots.size()];
+
+        lock.unlock();
+        generateBlock(job, block, slot);
+        lock.lock();
+
+        slot.ready = true;
+        ++job.windowsDone[group];
+        job.changed.notify_all();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the database with the schema of gnss_receiver, tuned for a bulk load.
+ **********************************************************************************************************************/
+static sqlite3* openDatabase (const std::string& path, sqlite3_stmt*& insert)
+{
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK)
+    {
+        std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // Same table and unique index as initDatabase() of the receiver, so the database can be served as it is
+    const char* sql = "PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF;"
+                      "CREATE TABLE IF NOT EXISTS GNSS_DATA("
+                      "ID INTEGER PRIMARY KEY AUTOINCREMENT,"
+                      "NMEA_DATA TEXT NOT NULL,"
+                      "DEVICE TEXT,"
+                      "SEQ INTEGER);"
+                      "CREATE UNIQUE INDEX IF NOT EXISTS GNSS_DATA_DEVICE_SEQ ON GNSS_DATA(DEVICE, SEQ);";
+    if ((sqlite3_exec(db, sql, nullptr, nullptr, nullptr) != SQLITE_OK) ||
+        (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO GNSS_DATA (NMEA_DATA, DEVICE, SEQ) VALUES (?1, ?2, ?3);", -1,
+                            &insert, nullptr) != SQLITE_OK))
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return db;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Inserts the rows of a block in one transaction.
+ **********************************************************************************************************************/
+static bool storeBlock (sqlite3* db, sqlite3_stmt* insert, const DatagenBlock& block)
+{
+    std::string device;
+    uint32_t deviceOf = UINT32_MAX;
+    bool ok = (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+    for (size_t i = 0; ok && (i < block.rows.size()); ++i)
+    {
+        const DatagenRow& row = block.rows[i];
+        if (row.vehicle != deviceOf)
+        {
+            device = deviceName(row.vehicle);
+            deviceOf = row.vehicle;
+        }
+        sqlite3_bind_text(insert, 1, block.data.data() + row.offset, (int)row.length, SQLITE_STATIC);
+        sqlite3_bind_text(insert, 2, device.data(), (int)device.size(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(insert, 3, (sqlite3_int64)row.sequence);
+        ok = (sqlite3_step(insert) == SQLITE_DONE);
+        sqlite3_reset(insert);
+    }
+
+    ok = (sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr) == SQLITE_OK) && ok;
+    if (!ok)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+    }
+    return ok;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends the fixes of a block to the archive, one vehicle after the other.
+ **********************************************************************************************************************/
+static bool archiveBlock (ArchiveWriter& archive, const DatagenBlock& block)
+{
+    bool ok = true;
+    for (size_t i = 0; ok && (i < block.samples.size()); ++i)
+    {
+        ok = archive.append((uint32_t)(block.firstVehicle + i / block.steps), block.samples[i]);
+    }
+    return ok;
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Writes a synthetic fleet for storage and query benchmarks, without going through a broker.
+ *
+ * "gnss_datagen --out PATH [--format nmea|batches|sqlite|archive] [--vehicles N] [--fixes N] [--interval-ms MS]
+ * [--start TIME] [--seed N] [--threads N] [--batch N] [--deflate]" simulates the vehicles with the trajectory model
+ * on several threads and writes:
+ *   nmea     one "<device> <GPRMC sentence>" line per fix
+ *   batches  the sequenced batch payloads a sender would publish, each preceded by its length as a little endian u32
+ *   sqlite   a database with the GNSS_DATA table of gnss_receiver, with device and sequence number
+ *   archive  per-device chunks in the compressed format of the hot store with a directory, the input of gnss_zonejoin
+ * The vehicles are simulated in blocks of 64 vehicles and 256 fixes, each vehicle with its own random stream, and the
+ * blocks are written in a fixed order, so the output is the same for a seed whatever the number of threads.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    DatagenJob job;
+    if (!parseDatagenArgs(argc, argv, job.config))
+    {
+        std::cerr << "Usage: " << argv[0] << " --out PATH [--format nmea|batches|sqlite|archive] [--vehicles N]"
+                  << " [--fixes N] [--interval-ms MS] [--start YYYY-MM-DD[THH:MM:SS]] [--seed N] [--threads N]"
+                  << " [--batch N] [--deflate]" << std::endl;
+        return 1;
+    }
+    const DatagenConfig& config = job.config;
+
+    FILE* file = nullptr;
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    ArchiveWriter archive;
+    bool archiving = false;
+    if (config.format == DATAGEN_SQLITE)
+    {
+        db = openDatabase(config.outPath, insert);
+    }
+    else if (config.format == DATAGEN_ARCHIVE)
+    {
+        archiving = archive.open(config.outPath);
+        for (uint64_t v = 0; archiving && (v < config.vehicles); ++v)
+        {
+            archive.device(deviceName(v));
+        }
+    }
+    else
+    {
+        file = (config.outPath == "-") ? stdout : std::fopen(config.outPath.c_str(), "wb");
+        if (file == nullptr)
+        {
+            std::cerr << "Unable to open " << config.outPath << std::endl;
+        }
+    }
+    if ((file == nullptr) && (db == nullptr) && !archiving)
+    {
+        return 1;
+    }
+
+    job.vehicles.reserve(config.vehicles);
+    for (uint64_t v = 0; v < config.vehicles; ++v)
+    {
+        job.vehicles.emplace_back(config.seed, v, config.startMs);
+    }
+    job.groups = (config.vehicles + DATAGEN_GROUP_VEHICLES - 1) / DATAGEN_GROUP_VEHICLES;
+    job.windowFixes = (config.format == DATAGEN_BATCHES)
+                          ? (DATAGEN_WINDOW_FIXES + config.batchSize - 1) / config.batchSize * config.batchSize
+                          : DATAGEN_WINDOW_FIXES;
+    job.windows = (config.fixes + job.windowFixes - 1) / job.windowFixes;
+    job.blocks = job.groups * job.windows;
+    job.nextBlock = 0;
+    job.written = 0;
+    job.windowsDone.assign(job.groups, 0);
+    job.slots.resize(config.threads * DATAGEN_BLOCKS_PER_THREAD);
+    job.failed = false;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < config.threads; ++t)
+    {
+        threads.emplace_back(generateLoop, std::ref(job));
+    }
+
+    // Write the blocks in order as they are ready
+    uint64_t bytes = 0;
+    uint64_t fixes = 0;
+    std::unique_lock<std::mutex> lock(job.mutex);
+    while ((job.written < job.blocks) && !job.failed)
+    {
+        DatagenBlock& slot = job.slots[job.written % job.slots.size()];
+        job.changed.wait(lock, [&slot]() { return slot.ready; });
+        lock.unlock();
+
+        bool ok = (db != nullptr) ? storeBlock(db, insert, slot)
+                : archiving       ? archiveBlock(archive, slot)
+                                  : (std::fwrite(slot.data.data(), 1, slot.data.size(), file) == slot.data.size());
+        bytes += slot.data.size();
+        fixes += slot.fixes;
+
+        lock.lock();
+        if (!ok)
+        {
+            std::cerr << "Unable to write " << config.outPath << std::endl;
+            job.failed = true;
+        }
+        slot.ready = false;
+        ++job.written;
+        job.changed.notify_all();
+    }
+    lock.unlock();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    bool ok = !job.failed;
+    if (db != nullptr)
+    {
+        sqlite3_finalize(insert);
+        sqlite3_close(db);
+    }
+    else if (archiving)
+    {
+        ok = archive.close() && ok;
+        bytes = archive.size();
+    }
+    else if (file != stdout)
+    {
+        ok = (std::fclose(file) == 0) && ok;
+    }
+    else
+    {
+        ok = (std::fflush(file) == 0) && ok;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Generated " << fixes << " fixes of " << config.vehicles << " vehicles, " << bytes << " bytes in "
+              << std::fixed << std::setprecision(2) << seconds << " s (" << std::setprecision(0)
+              << fixes / seconds << " fixes/s, " << std::setprecision(1) << bytes / seconds / 1e6 << " MB/s) on "
+              << config.threads << " threads" << std::endl;
+
+    return ok ? 0 : 1;
+}
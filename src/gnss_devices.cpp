@@ -0,0 +1,279 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_devices.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define DELAY_GAIN              (0.125)           /* Weight of a new sample in the smoothed delay, as for TCP's SRTT */
+#define JITTER_GAIN             (0.25)            /* Weight of a new deviation in the jitter, as for TCP's RTTVAR */
+#define DRIFT_GAIN              (0.25)            /* Weight of a new window in the drift */
+#define REORDER_JITTERS         (4.0)             /* Jitters added to the delay for the reorder window */
+#define PEAK_HALF_LIFE_MS       (15000.0)         /* Half-life of the largest recent delay, which the window covers */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool laterFix(const GNSSFix& a, const GNSSFix& b);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty registry.
+ **********************************************************************************************************************/
+DeviceRegistry::DeviceRegistry ()
+    : heldFixes(0), lateFixes(0), forcedFixes(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Updates the estimates of the device of a fix and holds the fix for release in time order.
+ *
+ * @param fix The decoded fix.
+ * @param receivedMs Wall clock time at which it was received, in milliseconds since the epoch.
+ *
+ * @return False if the fix is late and was not held.
+ **********************************************************************************************************************/
+bool DeviceRegistry::hold (const GNSSFix& fix, int64_t receivedMs)
+{
+    auto inserted = devices.try_emplace(fix.deviceId);
+    Device& device = inserted.first->second;
+    if (inserted.second)
+    {
+        device.clock = DeviceClock{ 0, 0.0, 0.0, 0.0, 0, 0, 0 };
+        device.releasedMs = INT64_MIN;
+        device.waiting = false;
+    }
+
+    estimate(device, receivedMs - fix.timestampMs, receivedMs);
+    ++device.clock.fixes;
+    if (fix.timestampMs < device.releasedMs)
+    {
+        ++device.clock.late;
+        ++lateFixes;
+        return false;
+    }
+
+    device.pending.push_back(fix);
+    std::push_heap(device.pending.begin(), device.pending.end(), laterFix);
+    ++heldFixes;
+    if (!device.waiting)
+    {
+        device.waiting = true;
+        waitingDevices.push_back(&device);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands on the held fixes the watermarks of their devices have passed, in time order per device.
+ *
+ * @param nowMs The wall clock in milliseconds since the epoch.
+ * @param out Output list the released fixes are appended to.
+ *
+ * @return Wall clock time at which the next held fix is due, INT64_MAX when none is held.
+ **********************************************************************************************************************/
+int64_t DeviceRegistry::release (int64_t nowMs, std::vector<GNSSFix>& out)
+{
+    int64_t next = INT64_MAX;
+    size_t kept = 0;
+    for (Device* device : waitingDevices)
+    {
+        std::vector<GNSSFix>& pending = device->pending;
+        int64_t watermarkMs = nowMs - device->clock.offsetMs - device->clock.reorderMs;
+        while (!pending.empty() && ((pending.front().timestampMs <= watermarkMs) || (pending.size() > DEVICE_MAX_HELD)))
+        {
+            if (pending.front().timestampMs > watermarkMs)
+            {
+                ++forcedFixes;
+            }
+            std::pop_heap(pending.begin(), pending.end(), laterFix);
+            device->releasedMs = std::max(device->releasedMs, pending.back().timestampMs);
+            out.push_back(std::move(pending.back()));
+            pending.pop_back();
+            --heldFixes;
+        }
+
+        if (pending.empty())
+        {
+            device->waiting = false;
+        }
+        else
+        {
+            next = std::min(next, pending.front().timestampMs + device->clock.offsetMs + device->clock.reorderMs);
+            waitingDevices[kept++] = device;
+        }
+    }
+    waitingDevices.resize(kept);
+    return next;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The estimates of one device, nullptr if it has not been heard from.
+ **********************************************************************************************************************/
+const DeviceClock* DeviceRegistry::find (const std::string& deviceId) const
+{
+    auto it = devices.find(deviceId);
+    return (it != devices.end()) ? &it->second.clock : nullptr;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Devices heard from.
+ **********************************************************************************************************************/
+size_t DeviceRegistry::size () const
+{
+    return devices.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Fixes waiting in the reorder buffers.
+ **********************************************************************************************************************/
+size_t DeviceRegistry::held () const
+{
+    return heldFixes;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Totals and the median and 99th percentile of the estimates over the devices.
+ **********************************************************************************************************************/
+DeviceRegistryStats DeviceRegistry::stats () const
+{
+    DeviceRegistryStats st = { devices.size(), heldFixes, 0, lateFixes, forcedFixes, 0, 0.0, 0.0, 0, 0 };
+    if (devices.empty())
+    {
+        return st;
+    }
+
+    std::vector<int64_t> offsets;
+    std::vector<double> delays;
+    std::vector<int64_t> windows;
+    offsets.reserve(devices.size());
+    delays.reserve(devices.size());
+    windows.reserve(devices.size());
+    for (const auto& entry : devices)
+    {
+        st.fixes += entry.second.clock.fixes;
+        offsets.push_back(entry.second.clock.offsetMs);
+        delays.push_back(entry.second.clock.delayMs);
+        windows.push_back(entry.second.clock.reorderMs);
+    }
+
+    size_t median = devices.size() / 2;
+    size_t p99 = std::min(devices.size() - 1, devices.size() * 99 / 100);
+    std::nth_element(offsets.begin(), offsets.begin() + median, offsets.end());
+    st.offsetP50Ms = offsets[median];
+    std::nth_element(delays.begin(), delays.begin() + median, delays.end());
+    st.delayP50Ms = delays[median];
+    std::nth_element(delays.begin(), delays.begin() + p99, delays.end());
+    st.delayP99Ms = delays[p99];
+    std::nth_element(windows.begin(), windows.begin() + median, windows.end());
+    st.reorderP50Ms = windows[median];
+    std::nth_element(windows.begin(), windows.begin() + p99, windows.end());
+    st.reorderP99Ms = windows[p99];
+    return st;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The devices with the largest transport delay, largest first.
+ *
+ * @param count Devices to return at most.
+ **********************************************************************************************************************/
+std::vector<std::pair<std::string, DeviceClock>> DeviceRegistry::slowest (size_t count) const
+{
+    std::vector<std::pair<std::string, DeviceClock>> result;
+    result.reserve(devices.size());
+    for (const auto& entry : devices)
+    {
+        result.emplace_back(entry.first, entry.second.clock);
+    }
+
+    count = std::min(count, result.size());
+    std::partial_sort(result.begin(), result.begin() + count, result.end(),
+                      [](const std::pair<std::string, DeviceClock>& a, const std::pair<std::string, DeviceClock>& b)
+                      { return a.second.delayMs > b.second.delayMs; });
+    result.resize(count);
+    return result;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Orders the reorder buffer of a device as a heap with the oldest fix on top.
+ **********************************************************************************************************************/
+static bool laterFix (const GNSSFix& a, const GNSSFix& b)
+{
+    return a.timestampMs > b.timestampMs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds one sample of receive time minus fix time to the estimates of a device.
+ *
+ * @param device The device.
+ * @param sampleMs Receive time minus fix time.
+ * @param receivedMs Receive time, which advances the filter windows.
+ **********************************************************************************************************************/
+void DeviceRegistry::estimate (Device& device, int64_t sampleMs, int64_t receivedMs)
+{
+    DeviceClock& clock = device.clock;
+    if ((clock.fixes == 0) || (receivedMs - device.windowStartMs >= 2 * DEVICE_FILTER_WINDOW_MS))
+    {
+        // First fix, or silent for longer than both windows: nothing of the earlier minima is current
+        device.windowMin = sampleMs;
+        device.previousMin = INT64_MAX;
+        device.windowStartMs = receivedMs;
+        device.peakMs = 0.0;
+        device.peakAtMs = receivedMs;
+    }
+    else if (receivedMs - device.windowStartMs >= DEVICE_FILTER_WINDOW_MS)
+    {
+        if (device.previousMin != INT64_MAX)
+        {
+            double ppm = (double)(device.windowMin - device.previousMin) * 1e6 / DEVICE_FILTER_WINDOW_MS;
+            clock.driftPpm += DRIFT_GAIN * (ppm - clock.driftPpm);
+        }
+        device.previousMin = device.windowMin;
+        device.windowMin = sampleMs;
+        device.windowStartMs += DEVICE_FILTER_WINDOW_MS;
+    }
+    else
+    {
+        device.windowMin = std::min(device.windowMin, sampleMs);
+    }
+
+    clock.offsetMs = std::min(device.windowMin, device.previousMin);
+    double excess = (double)(sampleMs - clock.offsetMs);
+    if (clock.fixes == 0)
+    {
+        clock.delayMs = excess;
+        clock.jitterMs = 0.0;
+    }
+    else
+    {
+        clock.jitterMs += JITTER_GAIN * (std::fabs(excess - clock.delayMs) - clock.jitterMs);
+        clock.delayMs += DELAY_GAIN * (excess - clock.delayMs);
+    }
+
+    // The smoothed figures forget a rare late fix within a few fixes of a busy device, the decaying peak does not
+    device.peakMs *= std::exp2(-(double)(receivedMs - device.peakAtMs) / PEAK_HALF_LIFE_MS);
+    device.peakMs = std::max(device.peakMs, excess);
+    device.peakAtMs = receivedMs;
+    double windowMs = std::max(clock.delayMs + REORDER_JITTERS * clock.jitterMs, device.peakMs);
+    clock.reorderMs = std::min((int64_t)std::ceil(windowMs), (int64_t)DEVICE_MAX_REORDER_MS);
+}
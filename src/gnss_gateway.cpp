@@ -0,0 +1,752 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_gateway.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define SPOOL_RECORD_HEADER     (13U)             /* Type u8, last sequence u64, payload size u32 */
+#define SPOOL_COMPACT_SLACK     (1024U * 1024U)   /* Confirmed bytes tolerated in the log before it is rewritten */
+#define STREAM_READ_SIZE        (4096U)           /* Bytes read per call, also the largest Unix datagram */
+#define DAY_MS                  (86400000LL)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static int64_t wallClockMs();
+static void putUint(std::string& out, uint64_t value, size_t bytes);
+static uint64_t getUint(const char* p, size_t bytes);
+static bool writeAll(int fd, const std::string& data);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parses a "<device>=<kind>:<address>" input option.
+ *
+ * @param text The option value.
+ * @param spec Output input specification.
+ *
+ * @return False if the device ID, the kind or the address is invalid.
+ **********************************************************************************************************************/
+bool parseGatewayInput (const std::string& text, GatewayInputSpec& spec)
+{
+    size_t equals = text.find('=');
+    size_t colon = (equals == std::string::npos) ? std::string::npos : text.find(':', equals + 1);
+    if ((equals == 0) || (colon == std::string::npos) || (colon + 1 == text.size()))
+    {
+        return false;
+    }
+
+    spec.deviceId = text.substr(0, equals);
+    spec.kind = text.substr(equals + 1, colon - equals - 1);
+    spec.address = text.substr(colon + 1);
+    if ((spec.deviceId.size() > PAYLOAD_MAX_DEVICE_ID) ||
+        (spec.deviceId.find_first_of("/+#") != std::string::npos))
+    {
+        return false;
+    }
+
+    std::string host;
+    uint16_t port;
+    return (spec.kind == "pty") || (spec.kind == "unix") ||
+           ((spec.kind == "udp") && parseHostPort(spec.address, host, port));
+}
+
+/*******************************************************************************************************************//**
+ * @brief Timestamp used to order a sentence among those of other devices.
+ *
+ * RMC, GGA, GNS and ZDA sentences start with the UTC time of day of the fix. It is placed on the day that brings it
+ * closest to the arrival time, which handles midnight and a gateway clock that is somewhat off. Other sentences are
+ * ordered by their arrival.
+ *
+ * @param sentence The NMEA sentence.
+ * @param arrivalMs Arrival time in milliseconds since the epoch.
+ *
+ * @return Milliseconds since the epoch.
+ **********************************************************************************************************************/
+int64_t sentenceTimeMs (const std::string& sentence, int64_t arrivalMs)
+{
+    if ((sentence.size() < 14) || (sentence[0] != '$') || (sentence[6] != ','))
+    {
+        return arrivalMs;
+    }
+
+    std::string type = sentence.substr(3, 3);
+    if ((type != "RMC") && (type != "GGA") && (type != "GNS") && (type != "ZDA"))
+    {
+        return arrivalMs;
+    }
+
+    const char* p = sentence.c_str() + 7;
+    for (int i = 0; i < 6; ++i)
+    {
+        if ((p[i] < '0') || (p[i] > '9'))
+        {
+            return arrivalMs;
+        }
+    }
+
+    int hours = (p[0] - '0') * 10 + (p[1] - '0');
+    int minutes = (p[2] - '0') * 10 + (p[3] - '0');
+    double seconds = std::strtod(p + 4, nullptr);
+    if ((hours > 23) || (minutes > 59) || (seconds >= 61.0))
+    {
+        return arrivalMs;
+    }
+
+    int64_t timeOfDay = ((int64_t)hours * 3600 + minutes * 60) * 1000 + (int64_t)(seconds * 1000.0 + 0.5);
+    int64_t timestamp = arrivalMs - arrivalMs % DAY_MS + timeOfDay;
+    if (timestamp - arrivalMs > DAY_MS / 2)
+    {
+        timestamp -= DAY_MS;
+    }
+    else if (arrivalMs - timestamp > DAY_MS / 2)
+    {
+        timestamp += DAY_MS;
+    }
+
+    return timestamp;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a gateway without inputs.
+ **********************************************************************************************************************/
+GatewayInputs::GatewayInputs ()
+    : discarded(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes all inputs.
+ **********************************************************************************************************************/
+GatewayInputs::~GatewayInputs ()
+{
+    close();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Opens the local inputs.
+ *
+ * UDP and Unix inputs must bind; a serial input that cannot be opened yet is retried, as its device may appear later.
+ *
+ * @param specs The inputs, at most GATEWAY_MAX_INPUTS with distinct device IDs.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool GatewayInputs::open (const std::vector<GatewayInputSpec>& specs)
+{
+    if (specs.size() > GATEWAY_MAX_INPUTS)
+    {
+        std::cerr << "Gateway: at most " << GATEWAY_MAX_INPUTS << " inputs are supported" << std::endl;
+        return false;
+    }
+
+    for (const GatewayInputSpec& spec : specs)
+    {
+        for (const std::string& device : devices)
+        {
+            if (device == spec.deviceId)
+            {
+                std::cerr << "Gateway: device " << device << " is given twice" << std::endl;
+                close();
+                return false;
+            }
+        }
+
+        std::unique_ptr<Input> input(new Input());
+        input->spec = spec;
+        input->fd = -1;
+        input->closedAtMs = 0;
+        if (!openInput(*input) && (spec.kind != "pty"))
+        {
+            close();
+            return false;
+        }
+
+        devices.push_back(spec.deviceId);
+        inputs.push_back(std::move(input));
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes all inputs, removing the Unix sockets.
+ **********************************************************************************************************************/
+void GatewayInputs::close ()
+{
+    for (std::unique_ptr<Input>& input : inputs)
+    {
+        if (input->fd >= 0)
+        {
+            ::close(input->fd);
+            if (input->spec.kind == "unix")
+            {
+                unlink(input->spec.address.c_str());
+            }
+        }
+        input->udp.close();
+    }
+    inputs.clear();
+    devices.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends the descriptors of the open inputs for poll().
+ *
+ * @param fds Output descriptor list.
+ **********************************************************************************************************************/
+void GatewayInputs::addPollFds (std::vector<struct pollfd>& fds) const
+{
+    for (const std::unique_ptr<Input>& input : inputs)
+    {
+        int fd = (input->spec.kind == "udp") ? input->udp.fd() : input->fd;
+        if (fd >= 0)
+        {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            fds.push_back(pfd);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads the lines waiting on all inputs. Never blocks.
+ *
+ * Serial inputs that were closed are reopened once GATEWAY_REOPEN_MS has passed.
+ *
+ * @param sentences Output, the lines read are appended with their timestamp and source.
+ *
+ * @return Number of lines appended.
+ **********************************************************************************************************************/
+size_t GatewayInputs::read (std::vector<GatewaySentence>& sentences)
+{
+    size_t before = sentences.size();
+
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        Input& input = *inputs[i];
+        if (input.spec.kind == "udp")
+        {
+            datagrams.clear();
+            input.udp.receive(datagrams);
+            for (const std::string& datagram : datagrams)
+            {
+                std::string partial;
+                addLines(datagram.data(), datagram.size(), partial, (uint8_t)i, sentences);
+                addLines("\n", 1, partial, (uint8_t)i, sentences);     // A datagram ends its last line
+            }
+        }
+        else if (input.fd >= 0)
+        {
+            readStream(input, (uint8_t)i, sentences);
+        }
+        else if (wallClockMs() - input.closedAtMs >= GATEWAY_REOPEN_MS)
+        {
+            openInput(input);
+        }
+    }
+
+    return sentences.size() - before;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Device IDs of the inputs, indexed like GatewaySentence::source.
+ **********************************************************************************************************************/
+const std::vector<std::string>& GatewayInputs::deviceIds () const
+{
+    return devices;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of lines discarded for exceeding GATEWAY_MAX_LINE.
+ **********************************************************************************************************************/
+uint64_t GatewayInputs::linesDiscarded () const
+{
+    return discarded;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Opens one input.
+ *
+ * @param input The input.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool GatewayInputs::openInput (Input& input)
+{
+    const GatewayInputSpec& spec = input.spec;
+    bool firstAttempt = (input.closedAtMs == 0);
+    input.closedAtMs = wallClockMs();
+    input.partial.clear();
+
+    if (spec.kind == "udp")
+    {
+        std::string host;
+        uint16_t port = 0;
+        parseHostPort(spec.address, host, port);
+        return input.udp.open(port, host);
+    }
+
+    if (spec.kind == "pty")
+    {
+        input.fd = ::open(spec.address.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (input.fd < 0)
+        {
+            if (firstAttempt)
+            {
+                std::cerr << "Gateway: cannot open " << spec.address << " yet: " << std::strerror(errno) << std::endl;
+            }
+            return false;
+        }
+
+        // Serial devices deliver bytes as they arrive, the lines are split here
+        struct termios tty;
+        if (isatty(input.fd) && (tcgetattr(input.fd, &tty) == 0))
+        {
+            cfmakeraw(&tty);
+            tcsetattr(input.fd, TCSANOW, &tty);
+        }
+        return true;
+    }
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (spec.address.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Gateway: socket path too long: " << spec.address << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, spec.address.c_str(), sizeof(addr.sun_path) - 1);
+
+    input.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(spec.address.c_str());
+    if ((input.fd < 0) || (bind(input.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0))
+    {
+        std::cerr << "Gateway: cannot bind " << spec.address << ": " << std::strerror(errno) << std::endl;
+        if (input.fd >= 0)
+        {
+            ::close(input.fd);
+            input.fd = -1;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Drains a serial or Unix input, closing a serial input whose writer went away.
+ **********************************************************************************************************************/
+void GatewayInputs::readStream (Input& input, uint8_t source, std::vector<GatewaySentence>& sentences)
+{
+    char buffer[STREAM_READ_SIZE];
+    bool datagram = (input.spec.kind == "unix");
+
+    while (true)
+    {
+        ssize_t n = ::read(input.fd, buffer, sizeof(buffer));
+        if ((n > 0) || (datagram && (n == 0)))
+        {
+            addLines(buffer, n, input.partial, source, sentences);
+            if (datagram)
+            {
+                addLines("\n", 1, input.partial, source, sentences);
+            }
+            continue;
+        }
+        if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR) || datagram))
+        {
+            return;
+        }
+
+        // End of file, or EIO once the other side of a PTY is closed
+        std::cerr << "Gateway: input " << input.spec.deviceId << " closed, reopening" << std::endl;
+        ::close(input.fd);
+        input.fd = -1;
+        input.closedAtMs = wallClockMs();
+        return;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Splits received bytes into lines, carrying an unterminated line over to the next call.
+ **********************************************************************************************************************/
+void GatewayInputs::addLines (const char* data, size_t size, std::string& partial, uint8_t source,
+                              std::vector<GatewaySentence>& sentences)
+{
+    int64_t arrivalMs = wallClockMs();
+    const char* end = data + size;
+
+    while (data < end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        const char* stop = (newline != nullptr) ? newline : end;
+
+        // Keep at most one character beyond the limit, enough to recognize an oversized line
+        size_t room = GATEWAY_MAX_LINE + 1 - std::min<size_t>(partial.size(), GATEWAY_MAX_LINE + 1);
+        partial.append(data, std::min<size_t>(stop - data, room));
+        data = stop;
+        if (newline == nullptr)
+        {
+            break;
+        }
+        ++data;
+
+        if (!partial.empty() && (partial.back() == '\r'))
+        {
+            partial.pop_back();
+        }
+        if (partial.size() > GATEWAY_MAX_LINE)
+        {
+            ++discarded;
+        }
+        else if (!partial.empty())
+        {
+            GatewaySentence sentence;
+            sentence.timestampMs = sentenceTimeMs(partial, arrivalMs);
+            sentence.source = source;
+            sentence.sentence.swap(partial);
+            sentences.push_back(std::move(sentence));
+        }
+        partial.clear();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a closed spool.
+ **********************************************************************************************************************/
+GatewaySpool::GatewaySpool ()
+    : fd(-1), liveBytes(0), fileBytes(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the spool file.
+ **********************************************************************************************************************/
+GatewaySpool::~GatewaySpool ()
+{
+    close();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Opens the spool file and recovers the batches left unconfirmed by the previous run.
+ *
+ * A record cut short by a crash is discarded.
+ *
+ * @param spoolPath The spool file, created if missing.
+ * @param unconfirmed Output, the unconfirmed batches by last sequence number.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool GatewaySpool::open (const std::string& spoolPath, std::map<uint64_t, std::string>& unconfirmed)
+{
+    path = spoolPath;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Gateway: cannot open spool " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::string log;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), log.size())) > 0)
+    {
+        log.append(buffer, n);
+    }
+
+    size_t offset = 0;
+    while (log.size() - offset >= SPOOL_RECORD_HEADER)
+    {
+        char type = log[offset];
+        uint64_t lastSequence = getUint(&log[offset + 1], 8);
+        uint32_t size = (uint32_t)getUint(&log[offset + 9], 4);
+        if (((type != 'B') && (type != 'A')) || (log.size() - offset - SPOOL_RECORD_HEADER < size))
+        {
+            break;
+        }
+
+        offset += SPOOL_RECORD_HEADER;
+        if (type == 'B')
+        {
+            Record record = { offset, size };
+            live[lastSequence] = record;
+            liveBytes += size;
+            unconfirmed[lastSequence].assign(&log[offset], size);
+        }
+        else if (live.count(lastSequence) != 0)
+        {
+            liveBytes -= live[lastSequence].size;
+            live.erase(lastSequence);
+            unconfirmed.erase(lastSequence);
+        }
+        offset += size;
+    }
+
+    fileBytes = offset;
+    if ((offset != log.size()) && (ftruncate(fd, offset) != 0))
+    {
+        return false;
+    }
+    if (live.empty() && (fileBytes > 0) && (ftruncate(fd, 0) == 0))
+    {
+        fileBytes = 0;
+    }
+    else if (fileBytes > 2 * liveBytes + SPOOL_COMPACT_SLACK)
+    {
+        rewrite();
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the spool file.
+ **********************************************************************************************************************/
+void GatewaySpool::close ()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    live.clear();
+    liveBytes = 0;
+    fileBytes = 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Records a batch before it is published. The record is synced to disk.
+ *
+ * @param lastSequence Last sequence number of the batch, the key of its confirmation.
+ * @param payload The encoded batch.
+ *
+ * @return False if the record could not be written.
+ **********************************************************************************************************************/
+bool GatewaySpool::append (uint64_t lastSequence, const std::string& payload)
+{
+    uint64_t offset = fileBytes + SPOOL_RECORD_HEADER;
+    if (!writeRecord('B', lastSequence, payload, true))
+    {
+        return false;
+    }
+
+    Record record = { offset, (uint32_t)payload.size() };
+    live[lastSequence] = record;
+    liveBytes += payload.size();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Records the confirmation of a batch.
+ *
+ * Confirmations are not synced; one lost in a crash only causes the batch to be resent, which the receiver ignores.
+ *
+ * @param lastSequence Last sequence number of the confirmed batch.
+ **********************************************************************************************************************/
+void GatewaySpool::confirm (uint64_t lastSequence)
+{
+    auto it = live.find(lastSequence);
+    if (it == live.end())
+    {
+        return;
+    }
+    liveBytes -= it->second.size;
+    live.erase(it);
+
+    if (live.empty())
+    {
+        if (ftruncate(fd, 0) == 0)
+        {
+            fileBytes = 0;
+        }
+        return;
+    }
+
+    writeRecord('A', lastSequence, std::string(), false);
+    if (fileBytes > 2 * liveBytes + SPOOL_COMPACT_SLACK)
+    {
+        rewrite();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bytes of unconfirmed batches in the spool.
+ **********************************************************************************************************************/
+uint64_t GatewaySpool::size () const
+{
+    return liveBytes;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends one record to the log.
+ *
+ * A record that fails is cut off again, so the records after it stay at the offsets kept in live and a restart does
+ * not stop reading at it; when even that fails, the file size is taken as it is.
+ **********************************************************************************************************************/
+bool GatewaySpool::writeRecord (char type, uint64_t lastSequence, const std::string& payload, bool sync)
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    std::string record;
+    record.reserve(SPOOL_RECORD_HEADER + payload.size());
+    record += type;
+    putUint(record, lastSequence, 8);
+    putUint(record, payload.size(), 4);
+    record += payload;
+
+    if (!writeAll(fd, record) || (sync && (fdatasync(fd) != 0)))
+    {
+        std::cerr << "Gateway: cannot write spool " << path << ": " << std::strerror(errno) << std::endl;
+        struct stat st;
+        if ((ftruncate(fd, (off_t)fileBytes) != 0) && (fstat(fd, &st) == 0))
+        {
+            fileBytes = (uint64_t)st.st_size;
+        }
+        return false;
+    }
+
+    fileBytes += record.size();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Replaces the log with one holding only the unconfirmed batches.
+ *
+ * The new log is synced and renamed over the old one, so a crash leaves one of the two complete.
+ **********************************************************************************************************************/
+bool GatewaySpool::rewrite ()
+{
+    std::string temp = path + ".tmp";
+    int out = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0)
+    {
+        return false;
+    }
+
+    std::map<uint64_t, Record> moved;
+    uint64_t written = 0;
+    bool ok = true;
+    for (auto it = live.begin(); ok && (it != live.end()); ++it)
+    {
+        std::string payload(it->second.size, '\0');
+        ok = (pread(fd, &payload[0], payload.size(), it->second.offset) == (ssize_t)payload.size());
+
+        std::string record;
+        record += 'B';
+        putUint(record, it->first, 8);
+        putUint(record, payload.size(), 4);
+        record += payload;
+        ok = ok && writeAll(out, record);
+
+        Record position = { written + SPOOL_RECORD_HEADER, it->second.size };
+        moved[it->first] = position;
+        written += record.size();
+    }
+    ok = ok && (fdatasync(out) == 0);
+    ok = (::close(out) == 0) && ok;
+
+    int reopened = ok ? ::open(temp.c_str(), O_RDWR | O_APPEND | O_CLOEXEC) : -1;
+    if ((reopened < 0) || (std::rename(temp.c_str(), path.c_str()) != 0))
+    {
+        if (reopened >= 0)
+        {
+            ::close(reopened);
+        }
+        unlink(temp.c_str());
+        return false;
+    }
+
+    ::close(fd);
+    fd = reopened;
+    live.swap(moved);
+    fileBytes = written;
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Wall-clock time in milliseconds since the epoch, the reference of the NMEA fix times.
+ **********************************************************************************************************************/
+static int64_t wallClockMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends the low bytes of an integer in little-endian order.
+ **********************************************************************************************************************/
+static void putUint (std::string& out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a little-endian integer.
+ **********************************************************************************************************************/
+static uint64_t getUint (const char* p, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        value |= (uint64_t)(uint8_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a whole buffer to a descriptor.
+ **********************************************************************************************************************/
+static bool writeAll (int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
@@ -0,0 +1,573 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_hot_store.h"
+#include <cmath>
+#include <algorithm>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define COORDINATE_SCALE        (1e7)             /* Degrees to 1e-7 degree fixed point */
+#define CENTI_SCALE             (100.0)           /* Knots and degrees to hundredths */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void putVarint(std::vector<uint8_t>& out, uint64_t value);
+static void putSigned(std::vector<uint8_t>& out, int64_t value);
+static bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value);
+static bool getSigned(const uint8_t*& pos, const uint8_t* end, int64_t& value);
+static size_t chunkBytes(const FixChunk& chunk);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates the hot store and starts its background sealer thread.
+ *
+ * @param retentionMs How long fixes are kept, measured against the time passed to evictExpired().
+ **********************************************************************************************************************/
+HotStore::HotStore (int64_t retentionMs)
+    : retentionMs(retentionMs), sealing(false), stopping(false)
+{
+    sealer = std::thread(&HotStore::sealerLoop, this);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stops the sealer thread. Chunks still waiting in the queue are dropped together with the store.
+ **********************************************************************************************************************/
+HotStore::~HotStore ()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    sealCond.notify_all();
+    sealer.join();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends a fix to the open chunk of its device.
+ *
+ * When the open chunk reaches HOT_STORE_CHUNK_FIXES it is handed to the sealer thread, which replaces it with its
+ * compressed form. Until then scans keep reading the uncompressed samples.
+ *
+ * @param fix The fix to store.
+ **********************************************************************************************************************/
+void HotStore::append (const GNSSFix& fix)
+{
+    FixSample sample = toFixSample(fix);
+    bool queued = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Series& s = series[fix.deviceId];
+        if (s.open.capacity() < HOT_STORE_CHUNK_FIXES)
+        {
+            s.open.reserve(HOT_STORE_CHUNK_FIXES);
+        }
+        s.open.push_back(sample);
+
+        if (s.open.size() >= HOT_STORE_CHUNK_FIXES)
+        {
+            std::shared_ptr<const FixChunk> chunk = makeFixChunk(s.open);
+            s.chunks.push_back(chunk);
+            s.open.clear();
+
+            SealJob job;
+            job.deviceId = fix.deviceId;
+            job.chunk = chunk;
+            sealQueue.push_back(job);
+            queued = true;
+        }
+    }
+
+    if (queued)
+    {
+        sealCond.notify_one();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Visits the fixes of one device within a time range, decoding sealed chunks on the fly.
+ *
+ * @param deviceId The device to scan.
+ * @param fromMs Inclusive start of the range.
+ * @param toMs Inclusive end of the range.
+ * @param visitor Called for every matching fix in time order.
+ *
+ * @return Number of fixes visited.
+ **********************************************************************************************************************/
+size_t HotStore::scan (const std::string& deviceId, int64_t fromMs, int64_t toMs, const FixVisitor& visitor) const
+{
+    std::vector<std::shared_ptr<const FixChunk>> chunks;
+    std::vector<FixSample> open;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = series.find(deviceId);
+        if (it == series.end())
+        {
+            return 0;
+        }
+        chunks = it->second.chunks;
+        open = it->second.open;
+    }
+
+    return scanSeries(deviceId, chunks, open, fromMs, toMs, visitor);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Visits the fixes of all devices within a time range.
+ *
+ * @param fromMs Inclusive start of the range.
+ * @param toMs Inclusive end of the range.
+ * @param visitor Called for every matching fix, grouped by device.
+ *
+ * @return Number of fixes visited.
+ **********************************************************************************************************************/
+size_t HotStore::scanAll (int64_t fromMs, int64_t toMs, const FixVisitor& visitor) const
+{
+    std::vector<std::string> devices;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        devices.reserve(series.size());
+        for (const auto& entry : series)
+        {
+            devices.push_back(entry.first);
+        }
+    }
+
+    size_t visited = 0;
+    for (const std::string& deviceId : devices)
+    {
+        visited += scan(deviceId, fromMs, toMs, visitor);
+    }
+
+    return visited;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Drops chunks whose newest fix is older than the retention window.
+ *
+ * @param nowMs Current time in milliseconds since the epoch.
+ *
+ * @return Number of chunks dropped.
+ **********************************************************************************************************************/
+size_t HotStore::evictExpired (int64_t nowMs)
+{
+    int64_t cutoff = nowMs - retentionMs;
+    size_t dropped = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = series.begin(); it != series.end(); )
+    {
+        std::vector<std::shared_ptr<const FixChunk>>& chunks = it->second.chunks;
+        size_t expired = 0;
+        while ((expired < chunks.size()) && (chunks[expired]->lastMs < cutoff))
+        {
+            ++expired;
+        }
+        chunks.erase(chunks.begin(), chunks.begin() + expired);
+        dropped += expired;
+
+        std::vector<FixSample>& open = it->second.open;
+        if (chunks.empty() && (open.empty() || (open.back().timestampMs < cutoff)))
+        {
+            it = series.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return dropped;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Blocks until every full chunk handed to the sealer has been compressed.
+ **********************************************************************************************************************/
+void HotStore::drain ()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    drainCond.wait(lock, [this] { return sealQueue.empty() && !sealing; });
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reports the size of the store.
+ *
+ * @return Snapshot of the store statistics.
+ **********************************************************************************************************************/
+HotStoreStats HotStore::stats () const
+{
+    HotStoreStats st = {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    st.devices = series.size();
+    st.pendingChunks = sealQueue.size() + (sealing ? 1 : 0);
+    for (const auto& entry : series)
+    {
+        const Series& s = entry.second;
+        st.memoryBytes += sizeof(Series) + entry.first.capacity() + s.open.capacity() * sizeof(FixSample);
+        st.fixes += s.open.size();
+        for (const auto& chunk : s.chunks)
+        {
+            st.fixes += chunk->count;
+            st.memoryBytes += chunkBytes(*chunk);
+            if (chunk->raw.empty())
+            {
+                ++st.sealedChunks;
+            }
+        }
+    }
+    st.structBytes = st.fixes * sizeof(GNSSFix);
+
+    return st;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Converts a fix to its fixed-point form.
+ *
+ * @param fix The fix to convert.
+ *
+ * @return The fixed-point sample.
+ **********************************************************************************************************************/
+FixSample toFixSample (const GNSSFix& fix)
+{
+    FixSample sample;
+    sample.timestampMs = fix.timestampMs;
+    sample.latE7 = (int32_t)std::lround(fix.latitude * COORDINATE_SCALE);
+    sample.lonE7 = (int32_t)std::lround(fix.longitude * COORDINATE_SCALE);
+    sample.speedCentiKnots = (uint16_t)std::min(65535L, std::max(0L, std::lround(fix.speedKnots * CENTI_SCALE)));
+    sample.courseCentiDeg = (uint16_t)std::min(65535L, std::max(0L, std::lround(fix.course * CENTI_SCALE)));
+    return sample;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Converts a fixed-point sample back to a fix.
+ *
+ * @param sample The sample to convert.
+ * @param deviceId Device the sample belongs to.
+ * @param fix Output fix.
+ **********************************************************************************************************************/
+void fromFixSample (const FixSample& sample, const std::string& deviceId, GNSSFix& fix)
+{
+    fix.deviceId = deviceId;
+    fix.timestampMs = sample.timestampMs;
+    fix.latitude = sample.latE7 / COORDINATE_SCALE;
+    fix.longitude = sample.lonE7 / COORDINATE_SCALE;
+    fix.speedKnots = sample.speedCentiKnots / CENTI_SCALE;
+    fix.course = sample.courseCentiDeg / CENTI_SCALE;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Builds an unsealed chunk holding a copy of the samples and their time range and bounding box.
+ *
+ * @param samples The samples of the chunk, in time order. Must not be empty.
+ *
+ * @return The new chunk.
+ **********************************************************************************************************************/
+std::shared_ptr<FixChunk> makeFixChunk (const std::vector<FixSample>& samples)
+{
+    std::shared_ptr<FixChunk> chunk = std::make_shared<FixChunk>();
+    chunk->raw = samples;
+    chunk->count = (uint32_t)samples.size();
+    chunk->firstMs = samples.front().timestampMs;
+    chunk->lastMs = samples.back().timestampMs;
+    chunk->minLatE7 = chunk->maxLatE7 = samples.front().latE7;
+    chunk->minLonE7 = chunk->maxLonE7 = samples.front().lonE7;
+
+    for (const FixSample& s : samples)
+    {
+        chunk->minLatE7 = std::min(chunk->minLatE7, s.latE7);
+        chunk->maxLatE7 = std::max(chunk->maxLatE7, s.latE7);
+        chunk->minLonE7 = std::min(chunk->minLonE7, s.lonE7);
+        chunk->maxLonE7 = std::max(chunk->maxLonE7, s.lonE7);
+    }
+
+    return chunk;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Compresses a run of samples.
+ *
+ * Timestamps are stored as delta-of-delta, coordinates, speed and course as deltas to the previous sample. Every value
+ * is zigzag encoded into a varint, so a vehicle reporting at a steady rate costs about 6-10 bytes per fix.
+ *
+ * @param samples The samples to compress, in time order.
+ * @param out Output buffer, replaced with the compressed bytes.
+ **********************************************************************************************************************/
+void compressFixChunk (const std::vector<FixSample>& samples, std::vector<uint8_t>& out)
+{
+    out.clear();
+    out.reserve(samples.size() * 8 + 16);
+    putVarint(out, samples.size());
+
+    FixSample prev = {};
+    int64_t prevDelta = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const FixSample& s = samples[i];
+        if (i == 0)
+        {
+            putSigned(out, s.timestampMs);
+        }
+        else
+        {
+            int64_t delta = s.timestampMs - prev.timestampMs;
+            putSigned(out, delta - prevDelta);
+            prevDelta = delta;
+        }
+
+        putSigned(out, (int64_t)s.latE7 - prev.latE7);
+        putSigned(out, (int64_t)s.lonE7 - prev.lonE7);
+        putSigned(out, (int64_t)s.speedCentiKnots - prev.speedCentiKnots);
+        putSigned(out, (int64_t)s.courseCentiDeg - prev.courseCentiDeg);
+        prev = s;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Decompresses a run of samples produced by compressFixChunk().
+ *
+ * @param data The compressed bytes.
+ * @param size Number of compressed bytes.
+ * @param out Output samples, replaced with the decoded run.
+ *
+ * @return True on success, false if the data is truncated or corrupt.
+ **********************************************************************************************************************/
+bool decompressFixChunk (const uint8_t* data, size_t size, std::vector<FixSample>& out)
+{
+    const uint8_t* pos = data;
+    const uint8_t* end = data + size;
+    uint64_t count = 0;
+
+    out.clear();
+    if (!getVarint(pos, end, count) || (count > size))
+    {
+        return false;
+    }
+    out.reserve(count);
+
+    FixSample prev = {};
+    int64_t prevDelta = 0;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        int64_t t, lat, lon, speed, course;
+        if (!getSigned(pos, end, t) || !getSigned(pos, end, lat) || !getSigned(pos, end, lon) ||
+            !getSigned(pos, end, speed) || !getSigned(pos, end, course))
+        {
+            return false;
+        }
+
+        FixSample s;
+        if (i == 0)
+        {
+            s.timestampMs = t;
+        }
+        else
+        {
+            prevDelta += t;
+            s.timestampMs = prev.timestampMs + prevDelta;
+        }
+        s.latE7 = (int32_t)(prev.latE7 + lat);
+        s.lonE7 = (int32_t)(prev.lonE7 + lon);
+        s.speedCentiKnots = (uint16_t)(prev.speedCentiKnots + speed);
+        s.courseCentiDeg = (uint16_t)(prev.courseCentiDeg + course);
+        out.push_back(s);
+        prev = s;
+    }
+
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Background thread compressing full chunks.
+ *
+ * The compressed chunk replaces the raw one in its series. If the chunk was evicted in the meantime the result is
+ * discarded.
+ **********************************************************************************************************************/
+void HotStore::sealerLoop ()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        sealCond.wait(lock, [this] { return stopping || !sealQueue.empty(); });
+        if (stopping)
+        {
+            break;
+        }
+
+        SealJob job = sealQueue.front();
+        sealQueue.pop_front();
+        sealing = true;
+        lock.unlock();
+
+        // Raw chunks are immutable once queued, so compression runs without the lock
+        std::shared_ptr<FixChunk> sealed = std::make_shared<FixChunk>();
+        sealed->firstMs = job.chunk->firstMs;
+        sealed->lastMs = job.chunk->lastMs;
+        sealed->count = job.chunk->count;
+        sealed->minLatE7 = job.chunk->minLatE7;
+        sealed->minLonE7 = job.chunk->minLonE7;
+        sealed->maxLatE7 = job.chunk->maxLatE7;
+        sealed->maxLonE7 = job.chunk->maxLonE7;
+        compressFixChunk(job.chunk->raw, sealed->packed);
+        sealed->packed.shrink_to_fit();
+
+        lock.lock();
+        auto it = series.find(job.deviceId);
+        if (it != series.end())
+        {
+            std::vector<std::shared_ptr<const FixChunk>>& chunks = it->second.chunks;
+            for (auto c = chunks.rbegin(); c != chunks.rend(); ++c)
+            {
+                if (*c == job.chunk)
+                {
+                    *c = sealed;
+                    break;
+                }
+            }
+        }
+        sealing = false;
+        if (sealQueue.empty())
+        {
+            drainCond.notify_all();
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Visits the fixes of a snapshot of one series, skipping chunks outside the time range.
+ *
+ * @return Number of fixes visited.
+ **********************************************************************************************************************/
+size_t HotStore::scanSeries (const std::string& deviceId, const std::vector<std::shared_ptr<const FixChunk>>& chunks,
+                             const std::vector<FixSample>& open, int64_t fromMs, int64_t toMs,
+                             const FixVisitor& visitor)
+{
+    size_t visited = 0;
+    std::vector<FixSample> decoded;
+    GNSSFix fix;
+
+    for (const auto& chunk : chunks)
+    {
+        if ((chunk->lastMs < fromMs) || (chunk->firstMs > toMs))
+        {
+            continue;
+        }
+
+        const std::vector<FixSample>* samples = &chunk->raw;
+        if (chunk->raw.empty())
+        {
+            if (!decompressFixChunk(chunk->packed.data(), chunk->packed.size(), decoded))
+            {
+                continue;
+            }
+            samples = &decoded;
+        }
+
+        for (const FixSample& s : *samples)
+        {
+            if ((s.timestampMs >= fromMs) && (s.timestampMs <= toMs))
+            {
+                fromFixSample(s, deviceId, fix);
+                visitor(fix);
+                ++visited;
+            }
+        }
+    }
+
+    for (const FixSample& s : open)
+    {
+        if ((s.timestampMs >= fromMs) && (s.timestampMs <= toMs))
+        {
+            fromFixSample(s, deviceId, fix);
+            visitor(fix);
+            ++visited;
+        }
+    }
+
+    return visited;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends an unsigned LEB128 varint.
+ **********************************************************************************************************************/
+static void putVarint (std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends a zigzag encoded signed varint.
+ **********************************************************************************************************************/
+static void putSigned (std::vector<uint8_t>& out, int64_t value)
+{
+    putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads an unsigned LEB128 varint.
+ *
+ * @return False if the input ends before the varint does.
+ **********************************************************************************************************************/
+static bool getVarint (const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; (pos < end) && (shift < 64); shift += 7)
+    {
+        uint8_t byte = *pos++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a zigzag encoded signed varint.
+ *
+ * @return False if the input ends before the varint does.
+ **********************************************************************************************************************/
+static bool getSigned (const uint8_t*& pos, const uint8_t* end, int64_t& value)
+{
+    uint64_t raw = 0;
+    if (!getVarint(pos, end, raw))
+    {
+        return false;
+    }
+    value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Approximate heap footprint of a chunk.
+ **********************************************************************************************************************/
+static size_t chunkBytes (const FixChunk& chunk)
+{
+    return sizeof(FixChunk) + chunk.raw.capacity() * sizeof(FixSample) + chunk.packed.capacity();
+}
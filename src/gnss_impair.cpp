@@ -0,0 +1,456 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_impair.h"
+#include <algorithm>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define IMPAIR_OUTAGE_STREAM    (0x6F7574616765ULL) /* Added to the seed for the random stream of the outages */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool parseNumbers(const std::string& text, std::vector<double>& numbers);
+static bool parsePercent(const std::string& text, double& percent);
+static bool parseDelay(const std::string& text, DelayDistribution& delay);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Draws a delay in milliseconds.
+ **********************************************************************************************************************/
+double DelayDistribution::sample (FastRandom& random) const
+{
+    double value = 0.0;
+    switch (kind)
+    {
+        case FIXED:
+            value = a;
+            break;
+        case UNIFORM:
+            value = a + (b - a) * random.uniform();
+            break;
+        case NORMAL:
+            value = a + b * random.normal();
+            break;
+        case EXPONENTIAL:
+            value = -a * std::log(1.0 - random.uniform());
+            break;
+        case PARETO:
+            value = a / std::pow(1.0 - random.uniform(), 1.0 / b);
+            break;
+        default:
+            break;
+    }
+    return (value > 0.0) ? value : 0.0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a layer passing every message through untouched.
+ **********************************************************************************************************************/
+ImpairmentLayer::ImpairmentLayer ()
+    : active(false), lossPercent(0.0), burstLoss(false), badPercent(0.0), recoverPercent(0.0), bad(false),
+      delay{DelayDistribution::NONE, 0.0, 0.0}, dupPercent(0.0), reorderPercent(0.0), reorderGapMs(0.0),
+      outagePeriodic(false), outageExponential(false), outageDrop(false), outageUp(0.0), outageDown(0.0),
+      originUs(-1), downStartUs(0), downEndUs(0), outageCounted(false), nextOrder(0), totals()
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses an impairment specification such as "loss=1,delay=normal:50:10,dup=0.5,seed=7".
+ *
+ * @param spec The comma-separated impairments, see the class description.
+ * @param error Set to the offending impairment on failure.
+ *
+ * @return True if the whole specification is valid.
+ **********************************************************************************************************************/
+bool ImpairmentLayer::configure (const std::string& spec, std::string& error)
+{
+    std::istringstream items(spec);
+    std::string item;
+    uint64_t seed = IMPAIR_DEFAULT_SEED;
+
+    while (std::getline(items, item, ','))
+    {
+        size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = (equals == std::string::npos) ? "" : item.substr(equals + 1);
+        std::vector<double> numbers;
+        bool ok = true;
+
+        if (equals == std::string::npos)
+        {
+            ok = false;
+        }
+        else if (key == "loss")
+        {
+            burstLoss = (value.compare(0, 6, "burst:") == 0);
+            if (burstLoss)
+            {
+                ok = parseNumbers(value.substr(6), numbers) && (numbers.size() == 2) && (numbers[0] <= 100.0) &&
+                     (numbers[1] > 0.0) && (numbers[1] <= 100.0);
+                badPercent = ok ? numbers[0] : 0.0;
+                recoverPercent = ok ? numbers[1] : 0.0;
+            }
+            else
+            {
+                ok = parsePercent(value, lossPercent);
+            }
+        }
+        else if (key == "delay")
+        {
+            ok = parseDelay(value, delay);
+        }
+        else if (key == "dup")
+        {
+            ok = parsePercent(value, dupPercent);
+        }
+        else if (key == "reorder")
+        {
+            size_t colon = value.find(':');
+            ok = (colon != std::string::npos) && parsePercent(value.substr(0, colon), reorderPercent) &&
+                 parseNumbers(value.substr(colon + 1), numbers) && (numbers.size() == 1) && (numbers[0] > 0.0);
+            reorderGapMs = ok ? numbers[0] : 0.0;
+        }
+        else if (key == "outage")
+        {
+            outageExponential = (value.compare(0, 4, "exp:") == 0);
+            outageDrop = (value.size() >= 5) && (value.compare(value.size() - 5, 5, ":drop") == 0);
+            std::string times = value.substr(outageExponential ? 4 : 0,
+                                             value.size() - (outageExponential ? 4 : 0) - (outageDrop ? 5 : 0));
+            ok = parseNumbers(times, numbers) && (numbers.size() == 2) && (numbers[0] > 0.0) && (numbers[1] > 0.0) &&
+                 (outageExponential || (numbers[1] < numbers[0]));
+            outagePeriodic = ok && !outageExponential;
+            outageExponential = ok && outageExponential;
+            outageUp = ok ? numbers[0] : 0.0;
+            outageDown = ok ? numbers[1] : 0.0;
+        }
+        else if (key == "seed")
+        {
+            char* end = nullptr;
+            seed = std::strtoull(value.c_str(), &end, 10);
+            ok = !value.empty() && (*end == '\0');
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            error = item;
+            return false;
+        }
+    }
+
+    random = FastRandom(seed);
+    outageRandom = FastRandom(seed + IMPAIR_OUTAGE_STREAM);
+    active = (lossPercent > 0.0) || (badPercent > 0.0) || (delay.kind != DelayDistribution::NONE) ||
+             (dupPercent > 0.0) || (reorderPercent > 0.0) || outagePeriodic || outageExponential;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief True if the specification impairs anything, otherwise messages are best sent without the layer.
+ **********************************************************************************************************************/
+bool ImpairmentLayer::enabled () const
+{
+    return active;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands a message to the impaired network.
+ *
+ * @param topic Topic of the message; left unchanged when the message passes straight through, otherwise taken.
+ * @param payload Payload of the message, as the topic.
+ * @param nowUs Current time in microseconds, on any monotonic clock used for every call.
+ *
+ * @return True if the message is to be sent now, ahead of anything still held; false if it was lost or is held
+ *         until release() returns it.
+ **********************************************************************************************************************/
+bool ImpairmentLayer::submit (std::string& topic, std::string& payload, int64_t nowUs)
+{
+    ++totals.submitted;
+    if (originUs < 0)
+    {
+        originUs = nowUs;
+        downEndUs = nowUs;
+    }
+
+    int64_t startUs = nowUs;
+    if (outagePeriodic || outageExponential)
+    {
+        int64_t endUs = outageEnd(nowUs);
+        if (endUs > nowUs)
+        {
+            if (outageDrop)
+            {
+                ++totals.outageDropped;
+                return false;
+            }
+            ++totals.outageHeld;
+            startUs = endUs;
+        }
+    }
+
+    if (lose())
+    {
+        ++totals.lost;
+        return false;
+    }
+
+    if (random.chance(dupPercent))
+    {
+        ++totals.duplicated;
+        enqueue(topic, payload, startUs + (int64_t)(delay.sample(random) * 1000.0), nowUs, true);
+    }
+
+    double delayMs = delay.sample(random);
+    if (random.chance(reorderPercent))
+    {
+        ++totals.reordered;
+        delayMs += reorderGapMs;
+    }
+
+    int64_t releaseUs = startUs + (int64_t)(delayMs * 1000.0);
+    if ((releaseUs <= nowUs) && (heap.empty() || (heap.front().releaseUs > nowUs)))
+    {
+        ++totals.delivered;
+        return true;
+    }
+    enqueue(topic, payload, releaseUs, nowUs, false);
+    return false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Appends the held messages due by now to out, in release order.
+ **********************************************************************************************************************/
+void ImpairmentLayer::release (int64_t nowUs, std::vector<ImpairedMessage>& out)
+{
+    while (!heap.empty() && (heap.front().releaseUs <= nowUs))
+    {
+        size_t slot = heap.front().slot;
+        out.emplace_back();
+        out.back().topic.swap(slots[slot].topic);
+        out.back().payload.swap(slots[slot].payload);
+        freeSlots.push_back(slot);
+        std::pop_heap(heap.begin(), heap.end(), laterRelease);
+        heap.pop_back();
+        ++totals.delivered;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Time at which the next held message is due, -1 if none is held.
+ **********************************************************************************************************************/
+int64_t ImpairmentLayer::nextReleaseUs () const
+{
+    return heap.empty() ? -1 : heap.front().releaseUs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of messages held.
+ **********************************************************************************************************************/
+size_t ImpairmentLayer::queued () const
+{
+    return heap.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counters since the layer was configured.
+ **********************************************************************************************************************/
+ImpairStats ImpairmentLayer::stats () const
+{
+    return totals;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Holds a message until the given time; the message is lost if the queue is full.
+ *
+ * @param copy Copy the topic and payload instead of taking them, for a duplicate.
+ **********************************************************************************************************************/
+void ImpairmentLayer::enqueue (std::string& topic, std::string& payload, int64_t releaseUs, int64_t nowUs, bool copy)
+{
+    if (heap.size() >= IMPAIR_MAX_QUEUED)
+    {
+        ++totals.lost;
+        return;
+    }
+
+    size_t slot;
+    if (freeSlots.empty())
+    {
+        slot = slots.size();
+        slots.emplace_back();
+    }
+    else
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    if (copy)
+    {
+        slots[slot].topic = topic;
+        slots[slot].payload = payload;
+    }
+    else
+    {
+        slots[slot].topic.swap(topic);
+        slots[slot].payload.swap(payload);
+    }
+
+    heap.push_back(Held{releaseUs, nextOrder++, slot});
+    std::push_heap(heap.begin(), heap.end(), laterRelease);
+    totals.delayMsTotal += (double)(releaseUs - nowUs) / 1000.0;
+    totals.maxQueued = std::max(totals.maxQueued, heap.size());
+}
+
+/*******************************************************************************************************************//**
+ * @brief Draws whether the next message is lost, moving the Gilbert model between its good and bad state.
+ **********************************************************************************************************************/
+bool ImpairmentLayer::lose ()
+{
+    if (!burstLoss)
+    {
+        return random.chance(lossPercent);
+    }
+
+    bad = bad ? !random.chance(recoverPercent) : random.chance(badPercent);
+    return bad;
+}
+
+/*******************************************************************************************************************//**
+ * @brief End of the outage under way at the given time, or the time itself when the link is up.
+ *
+ * The link is up for PERIOD - LENGTH seconds, then down for LENGTH seconds, from the first message on; with
+ * exponential outages both times are drawn from the outage stream, so the messages do not shift the outages.
+ **********************************************************************************************************************/
+int64_t ImpairmentLayer::outageEnd (int64_t nowUs)
+{
+    while (nowUs >= downEndUs)
+    {
+        double upS = outagePeriodic ? outageUp - outageDown : -outageUp * std::log(1.0 - outageRandom.uniform());
+        double downS = outagePeriodic ? outageDown : -outageDown * std::log(1.0 - outageRandom.uniform());
+        downStartUs = downEndUs + (int64_t)(upS * 1e6);
+        downEndUs = downStartUs + std::max<int64_t>((int64_t)(downS * 1e6), 1);
+        outageCounted = false;
+    }
+
+    if (nowUs < downStartUs)
+    {
+        return nowUs;
+    }
+    if (!outageCounted)
+    {
+        ++totals.outages;
+        outageCounted = true;
+    }
+    return downEndUs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Heap order: the earliest release on top, then the earliest submission.
+ **********************************************************************************************************************/
+bool ImpairmentLayer::laterRelease (const ImpairmentLayer::Held& a, const ImpairmentLayer::Held& b)
+{
+    return (a.releaseUs != b.releaseUs) ? (a.releaseUs > b.releaseUs) : (a.order > b.order);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses colon-separated non-negative numbers.
+ **********************************************************************************************************************/
+static bool parseNumbers (const std::string& text, std::vector<double>& numbers)
+{
+    std::istringstream fields(text);
+    std::string field;
+    numbers.clear();
+    while (std::getline(fields, field, ':'))
+    {
+        char* end = nullptr;
+        double number = std::strtod(field.c_str(), &end);
+        if (field.empty() || (*end != '\0') || !(number >= 0.0) || std::isinf(number))
+        {
+            return false;
+        }
+        numbers.push_back(number);
+    }
+    return !numbers.empty() && (text.back() != ':');
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a probability in percent.
+ **********************************************************************************************************************/
+static bool parsePercent (const std::string& text, double& percent)
+{
+    std::vector<double> numbers;
+    if (!parseNumbers(text, numbers) || (numbers.size() != 1) || (numbers[0] > 100.0))
+    {
+        return false;
+    }
+    percent = numbers[0];
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a delay: "MS", "uniform:MIN:MAX", "normal:MEAN:SD", "exp:MEAN" or "pareto:MIN:SHAPE".
+ **********************************************************************************************************************/
+static bool parseDelay (const std::string& text, DelayDistribution& delay)
+{
+    static const struct
+    {
+        const char* name;
+        DelayDistribution::Kind kind;
+        size_t parameters;
+    } kinds[] = {
+        { "uniform:", DelayDistribution::UNIFORM, 2 },
+        { "normal:", DelayDistribution::NORMAL, 2 },
+        { "exp:", DelayDistribution::EXPONENTIAL, 1 },
+        { "pareto:", DelayDistribution::PARETO, 2 },
+    };
+
+    std::vector<double> numbers;
+    for (const auto& kind : kinds)
+    {
+        size_t length = std::strlen(kind.name);
+        if (text.compare(0, length, kind.name) == 0)
+        {
+            if (!parseNumbers(text.substr(length), numbers) || (numbers.size() != kind.parameters) ||
+                ((kind.kind == DelayDistribution::UNIFORM) && (numbers[1] < numbers[0])) ||
+                ((kind.kind == DelayDistribution::PARETO) && ((numbers[0] <= 0.0) || (numbers[1] <= 0.0))))
+            {
+                return false;
+            }
+            delay = DelayDistribution{kind.kind, numbers[0], (numbers.size() > 1) ? numbers[1] : 0.0};
+            return true;
+        }
+    }
+
+    if (!parseNumbers(text, numbers) || (numbers.size() != 1))
+    {
+        return false;
+    }
+    delay = DelayDistribution{DelayDistribution::FIXED, numbers[0], 0.0};
+    return true;
+}
@@ -0,0 +1,604 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_log.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define LOG_CALIBRATION_MS      (10)              /* First measurement of the tick rate when the log is opened */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Marks the buffer of a thread as retired when the thread exits */
+struct LogRetirer
+{
+    LogBuffer* buffer;
+
+    ~LogRetirer()
+    {
+        if (buffer != nullptr)
+        {
+            buffer->retired.store(true, std::memory_order_release);
+            logThreadBuffer = nullptr;
+        }
+    }
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static std::mutex logMutex;                         // Guards logBuffers and logNextThread
+static std::vector<LogBuffer*> logBuffers;          // Staging buffers of all threads that have logged
+static uint32_t logNextThread = 0;
+static std::thread logWriter;
+static std::atomic<bool> logStopping(false);
+static std::mutex logWakeMutex;                     // Guards the wait of the writer thread for logWake
+static std::condition_variable logWake;             // Ends the idle pause of the writer thread early
+static std::atomic<int> logIdlePauseMs(LOG_FLUSH_INTERVAL_MS);
+static std::atomic<uint64_t> logDroppedRecords(0);
+static FILE* logFile = nullptr;                     // Binary log, nullptr when rendering text to stdout
+static thread_local LogRetirer logRetirer = { nullptr };
+
+// Conversion of ticks to time, measured since the log was opened
+static uint64_t logOriginTicks;
+static int64_t logOriginNs;
+
+static int64_t unixNanoseconds();
+static double ticksPerSecond(uint64_t ticks, int64_t unixNs);
+static bool writeDictionary();
+static bool writeSync(uint64_t ticks, int64_t unixNs, double rate);
+static size_t drainBuffer(LogBuffer& buffer, uint64_t syncTicks, int64_t syncNs, double rate);
+static void renderRecords(const char* data, size_t size, uint64_t syncTicks, int64_t syncNs, double rate);
+static void writerLoop();
+
+/***********************************************************************************************************************
+ * Global Variables
+ **********************************************************************************************************************/
+thread_local LogBuffer* logThreadBuffer = nullptr;  // Staging buffer of the calling thread, created on first use
+std::atomic<bool> logActive(false);                 // Records are accepted while the writer thread runs
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Starts the writer thread of the log.
+ *
+ * A binary log is appended to, each run starting with the dictionary of the call sites so gnss_logdecode can render it
+ * without the binary. Rendering text on stdout instead costs the writer thread the formatting, but not the callers.
+ *
+ * @param path Binary log file, or LOG_TEXT for text on stdout.
+ *
+ * @return False if the file cannot be opened.
+ **********************************************************************************************************************/
+bool logOpen (const std::string& path)
+{
+    if (path != LOG_TEXT)
+    {
+        logFile = std::fopen(path.c_str(), "ab");
+        if (logFile == nullptr)
+        {
+            std::cerr << "Unable to open log file " << path << std::endl;
+            return false;
+        }
+    }
+
+    // A first estimate of the tick rate, refined by the writer thread as time goes on
+    logOriginTicks = logTicks();
+    logOriginNs = unixNanoseconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOG_CALIBRATION_MS));
+
+    if ((logFile != nullptr) && !writeDictionary())
+    {
+        std::cerr << "Unable to write log file " << path << std::endl;
+        std::fclose(logFile);
+        logFile = nullptr;
+        return false;
+    }
+
+    // Every way out of the program writes out the pending records
+    static bool registered = false;
+    if (!registered)
+    {
+        std::atexit(logClose);
+        registered = true;
+    }
+
+    logStopping = false;
+    logActive = true;
+    logWriter = std::thread(writerLoop);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes out the pending records and stops the writer thread.
+ **********************************************************************************************************************/
+void logClose ()
+{
+    if (!logWriter.joinable())
+    {
+        return;
+    }
+
+    logActive = false;
+    logStopping = true;
+    {
+        std::lock_guard<std::mutex> lock(logWakeMutex);
+    }
+    logWake.notify_one();
+    logWriter.join();
+    if (logFile != nullptr)
+    {
+        std::fclose(logFile);
+        logFile = nullptr;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sets how long the writer thread sleeps when it finds every buffer empty.
+ *
+ * The default of LOG_FLUSH_INTERVAL_MS gets records to the file almost at once, at the cost of a wakeup per
+ * millisecond. A process that would rather sleep may lengthen it: its records then reach the file up to that much
+ * later. Closing the log and a thread waiting for room in its buffer still wake the writer at once.
+ *
+ * @param ms Pause in milliseconds, at least LOG_FLUSH_INTERVAL_MS.
+ **********************************************************************************************************************/
+void logSetIdlePause (int ms)
+{
+    logIdlePauseMs = std::max(ms, LOG_FLUSH_INTERVAL_MS);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of records dropped because the log was not open.
+ **********************************************************************************************************************/
+uint64_t logDropped ()
+{
+    return logDroppedRecords.load();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counts a record logged while the log is not open.
+ **********************************************************************************************************************/
+void logDrop ()
+{
+    logDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the staging buffer of the calling thread on its first record.
+ **********************************************************************************************************************/
+LogBuffer* logAttach ()
+{
+    LogBuffer* buffer = new LogBuffer();
+    buffer->capacity = LOG_BUFFER_SIZE;
+    buffer->data = new char[buffer->capacity];
+    buffer->reserved = 0;
+    buffer->cachedConsumer = 0;
+    buffer->producer = 0;
+    buffer->consumer = 0;
+    buffer->wrapEnd = 0;
+    buffer->retired = false;
+
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        buffer->thread = logNextThread++;
+        logBuffers.push_back(buffer);
+    }
+
+    logThreadBuffer = buffer;
+    logRetirer.buffer = buffer;
+    return buffer;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Finds room for a record that does not fit in the space known to be free, wrapping around or waiting for the
+ *        writer thread.
+ *
+ * @param buffer Staging buffer of the calling thread.
+ * @param size Bytes of the record.
+ *
+ * @return Where to write the record; buffer->reserved is set to its position.
+ **********************************************************************************************************************/
+char* logReserveSlow (LogBuffer* buffer, size_t size)
+{
+    for (;;)
+    {
+        size_t position = buffer->reserved;
+        buffer->cachedConsumer = buffer->consumer.load(std::memory_order_acquire);
+        if (position >= buffer->cachedConsumer)
+        {
+            if (buffer->capacity - position > size)
+            {
+                return buffer->data + position;
+            }
+
+            // Wrap around, but never onto the consumer: equal positions mean an empty buffer
+            if (buffer->cachedConsumer > size)
+            {
+                buffer->wrapEnd.store(position, std::memory_order_relaxed);
+                buffer->producer.store(0, std::memory_order_release);
+                buffer->reserved = 0;
+                return buffer->data;
+            }
+        }
+        else if (buffer->cachedConsumer - position > size)
+        {
+            return buffer->data + position;
+        }
+
+        logWake.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of call sites of the binary.
+ **********************************************************************************************************************/
+size_t logSiteCount ()
+{
+    return (__start_gnss_log_sites != nullptr) ? (size_t)(__stop_gnss_log_sites - __start_gnss_log_sites) : 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief A call site of the binary by its number.
+ **********************************************************************************************************************/
+const LogSite* logSiteAt (size_t index)
+{
+    return &__start_gnss_log_sites[index];
+}
+
+/*******************************************************************************************************************//**
+ * @brief Renders the arguments of a record into its format.
+ *
+ * @param format Format of the call site.
+ * @param types Argument type codes of the call site.
+ * @param data Arguments of the record, advanced past them.
+ * @param end End of the available bytes.
+ * @param text Output message.
+ *
+ * @return False if the record is truncated or the type codes are unknown.
+ **********************************************************************************************************************/
+bool logRender (const char* format, const char* types, const char*& data, const char* end, std::string& text)
+{
+    std::ostringstream out;
+    const char* type = types;
+
+    for (const char* f = format; *f != '\0'; ++f)
+    {
+        if (*f != '{')
+        {
+            out << *f;
+            continue;
+        }
+
+        // "{}" or "{.N}"
+        int precision = -1;
+        const char* close = std::strchr(f, '}');
+        if (close == nullptr)
+        {
+            return false;
+        }
+        if (f[1] == '.')
+        {
+            precision = std::atoi(f + 2);
+        }
+        f = close;
+
+        switch (*type++)
+        {
+            case 'i':
+            case 'u':
+            case 'd':
+            {
+                if (end - data < 8)
+                {
+                    return false;
+                }
+                int64_t i;
+                uint64_t u;
+                double d;
+                if (type[-1] == 'i')
+                {
+                    std::memcpy(&i, data, sizeof(i));
+                    out << i;
+                }
+                else if (type[-1] == 'u')
+                {
+                    std::memcpy(&u, data, sizeof(u));
+                    out << u;
+                }
+                else
+                {
+                    std::memcpy(&d, data, sizeof(d));
+                    if (precision >= 0)
+                    {
+                        out << std::fixed << std::setprecision(precision) << d << std::defaultfloat;
+                    }
+                    else
+                    {
+                        out << std::setprecision(6) << d;
+                    }
+                }
+                data += 8;
+                break;
+            }
+            case 'c':
+            {
+                if (end - data < 1)
+                {
+                    return false;
+                }
+                out << *data++;
+                break;
+            }
+            case 's':
+            {
+                uint32_t length;
+                if (end - data < (ptrdiff_t)sizeof(length))
+                {
+                    return false;
+                }
+                std::memcpy(&length, data, sizeof(length));
+                data += sizeof(length);
+                if ((size_t)(end - data) < length)
+                {
+                    return false;
+                }
+                out.write(data, length);
+                data += length;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    text = out.str();
+    return *type == '\0';
+}
+
+/*******************************************************************************************************************//**
+ * @brief Formats a log line: local time with microseconds, the level prefix and the message.
+ **********************************************************************************************************************/
+void logFormatLine (int level, int64_t unixNs, const std::string& message, std::string& line)
+{
+    std::time_t seconds = (std::time_t)(unixNs / 1000000000);
+    std::tm local;
+    localtime_r(&seconds, &local);
+
+    char stamp[64];
+    size_t length = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(stamp + length, sizeof(stamp) - length, ".%06d ", (int)((unixNs % 1000000000) / 1000));
+
+    line = stamp;
+    if (level == LOG_LEVEL_INFO)
+    {
+        line += "[INFO] ";
+    }
+    else if (level == LOG_LEVEL_ALERT)
+    {
+        line += "[ALERT] ";
+    }
+    line += message;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Current Unix time in nanoseconds.
+ **********************************************************************************************************************/
+static int64_t unixNanoseconds ()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tick rate measured from the opening of the log.
+ **********************************************************************************************************************/
+static double ticksPerSecond (uint64_t ticks, int64_t unixNs)
+{
+    return (unixNs > logOriginNs) ? (double)(ticks - logOriginTicks) * 1e9 / (double)(unixNs - logOriginNs) : 1e9;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes the magic and the dictionary of the call sites.
+ **********************************************************************************************************************/
+static bool writeDictionary ()
+{
+    std::string chunk = LOG_MAGIC;
+    uint32_t count = (uint32_t)logSiteCount();
+    chunk += LOG_CHUNK_SITES;
+    chunk.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const LogSite* site = logSiteAt(i);
+        int32_t fields[2] = { site->level, site->line };
+        chunk.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+        for (const char* text : { site->file, site->format, site->types })
+        {
+            uint32_t length = (uint32_t)std::strlen(text);
+            chunk.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            chunk.append(text, length);
+        }
+    }
+    return std::fwrite(chunk.data(), 1, chunk.size(), logFile) == chunk.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a sync chunk, relating the ticks of the following records to the time.
+ **********************************************************************************************************************/
+static bool writeSync (uint64_t ticks, int64_t unixNs, double rate)
+{
+    char chunk[1 + sizeof(ticks) + sizeof(unixNs) + sizeof(rate)];
+    chunk[0] = LOG_CHUNK_SYNC;
+    std::memcpy(chunk + 1, &ticks, sizeof(ticks));
+    std::memcpy(chunk + 1 + sizeof(ticks), &unixNs, sizeof(unixNs));
+    std::memcpy(chunk + 1 + sizeof(ticks) + sizeof(unixNs), &rate, sizeof(rate));
+    return std::fwrite(chunk, 1, sizeof(chunk), logFile) == sizeof(chunk);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes out the committed records of a staging buffer.
+ *
+ * @return Bytes written out.
+ **********************************************************************************************************************/
+static size_t drainBuffer (LogBuffer& buffer, uint64_t syncTicks, int64_t syncNs, double rate)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        size_t consumer = buffer.consumer.load(std::memory_order_relaxed);
+        size_t producer = buffer.producer.load(std::memory_order_acquire);
+        size_t end = producer;
+        if (producer < consumer)
+        {
+            // The producer wrapped around: finish the records up to its wrap point first
+            end = buffer.wrapEnd.load(std::memory_order_relaxed);
+            if (consumer == end)
+            {
+                buffer.consumer.store(0, std::memory_order_release);
+                continue;
+            }
+        }
+        if (end == consumer)
+        {
+            return total;
+        }
+
+        size_t size = end - consumer;
+        if (logFile != nullptr)
+        {
+            char header[1 + 2 * sizeof(uint32_t)];
+            uint32_t thread = buffer.thread;
+            uint32_t bytes = (uint32_t)size;
+            header[0] = LOG_CHUNK_RECORDS;
+            std::memcpy(header + 1, &thread, sizeof(thread));
+            std::memcpy(header + 1 + sizeof(thread), &bytes, sizeof(bytes));
+            std::fwrite(header, 1, sizeof(header), logFile);
+            std::fwrite(buffer.data + consumer, 1, size, logFile);
+        }
+        else
+        {
+            renderRecords(buffer.data + consumer, size, syncTicks, syncNs, rate);
+        }
+        buffer.consumer.store(end, std::memory_order_release);
+        total += size;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints records on stdout, for a text log.
+ **********************************************************************************************************************/
+static void renderRecords (const char* data, size_t size, uint64_t syncTicks, int64_t syncNs, double rate)
+{
+    const char* end = data + size;
+    std::string message, line;
+    size_t sites = logSiteCount();
+
+    while (end - data >= (ptrdiff_t)(sizeof(uint32_t) + sizeof(uint64_t)))
+    {
+        uint32_t index;
+        uint64_t ticks;
+        std::memcpy(&index, data, sizeof(index));
+        std::memcpy(&ticks, data + sizeof(index), sizeof(ticks));
+        data += sizeof(index) + sizeof(ticks);
+        if (index >= sites)
+        {
+            return;
+        }
+
+        const LogSite* site = logSiteAt(index);
+        if (!logRender(site->format, site->types, data, end, message))
+        {
+            return;
+        }
+        int64_t unixNs = syncNs + (int64_t)(((double)(int64_t)(ticks - syncTicks)) * 1e9 / rate);
+        logFormatLine(site->level, unixNs, message, line);
+        std::cout << line << '\n';
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writer thread: empties the staging buffers into the log until the log is closed, then once more.
+ *
+ * Each pass that finds records first writes a sync chunk. Buffers of exited threads are freed once empty.
+ **********************************************************************************************************************/
+static void writerLoop ()
+{
+    std::vector<LogBuffer*> buffers;
+    bool stopping = false;
+
+    while (!stopping)
+    {
+        stopping = logStopping.load();
+        {
+            std::lock_guard<std::mutex> lock(logMutex);
+            buffers = logBuffers;
+        }
+
+        uint64_t ticks = logTicks();
+        int64_t unixNs = unixNanoseconds();
+        double rate = ticksPerSecond(ticks, unixNs);
+        bool synced = false;
+        size_t written = 0;
+        for (LogBuffer* buffer : buffers)
+        {
+            bool retired = buffer->retired.load(std::memory_order_acquire);
+            if (!synced && (logFile != nullptr) &&
+                (buffer->producer.load(std::memory_order_acquire) != buffer->consumer.load()))
+            {
+                writeSync(ticks, unixNs, rate);
+                synced = true;
+            }
+            written += drainBuffer(*buffer, ticks, unixNs, rate);
+
+            if (retired)
+            {
+                std::lock_guard<std::mutex> lock(logMutex);
+                logBuffers.erase(std::find(logBuffers.begin(), logBuffers.end(), buffer));
+                delete[] buffer->data;
+                delete buffer;
+            }
+        }
+
+        if (written > 0)
+        {
+            if (logFile != nullptr)
+            {
+                std::fflush(logFile);
+            }
+            else
+            {
+                std::cout.flush();
+            }
+        }
+        else if (!stopping)
+        {
+            std::unique_lock<std::mutex> lock(logWakeMutex);
+            logWake.wait_for(lock, std::chrono::milliseconds(logIdlePauseMs.load()),
+                             [] { return logStopping.load(); });
+        }
+    }
+}
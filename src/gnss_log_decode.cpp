@@ -0,0 +1,266 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_log.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define FOLLOW_POLL_MS          (200)             /* Pause at the end of a followed log before reading again */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* A call site as recorded in the dictionary of the log */
+struct DecodedSite
+{
+    int level;
+    std::string format;
+    std::string types;
+};
+
+/* A rendered record waiting to be printed in time order */
+struct DecodedLine
+{
+    int64_t unixNs;
+    std::string line;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool readExact(FILE* file, void* out, size_t size, bool follow);
+static bool readString(FILE* file, std::string& text, bool follow);
+static bool readDictionary(FILE* file, std::vector<DecodedSite>& sites, bool follow);
+static bool decodeRecords(const std::vector<char>& data, const std::vector<DecodedSite>& sites, uint64_t syncTicks,
+                          int64_t syncNs, double rate, std::vector<DecodedLine>& pending);
+static void printPending(std::vector<DecodedLine>& pending);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Reads the given number of bytes, waiting for the writer when following the log.
+ *
+ * @return False at the end of the file when not following.
+ **********************************************************************************************************************/
+static bool readExact (FILE* file, void* out, size_t size, bool follow)
+{
+    char* next = static_cast<char*>(out);
+    while (size > 0)
+    {
+        size_t got = std::fread(next, 1, size, file);
+        next += got;
+        size -= got;
+        if (size > 0)
+        {
+            if (!follow || std::ferror(file))
+            {
+                return false;
+            }
+            std::clearerr(file);
+            std::this_thread::sleep_for(std::chrono::milliseconds(FOLLOW_POLL_MS));
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a string written as a 32-bit length and its bytes.
+ **********************************************************************************************************************/
+static bool readString (FILE* file, std::string& text, bool follow)
+{
+    uint32_t length;
+    if (!readExact(file, &length, sizeof(length), follow) || (length > LOG_MAX_STRING * 16))
+    {
+        return false;
+    }
+    text.resize(length);
+    return (length == 0) || readExact(file, &text[0], length, follow);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads the dictionary of call sites following the magic of a run.
+ **********************************************************************************************************************/
+static bool readDictionary (FILE* file, std::vector<DecodedSite>& sites, bool follow)
+{
+    char type;
+    uint32_t count;
+    if (!readExact(file, &type, 1, follow) || (type != LOG_CHUNK_SITES) ||
+        !readExact(file, &count, sizeof(count), follow))
+    {
+        return false;
+    }
+
+    sites.assign(count, DecodedSite());
+    for (DecodedSite& site : sites)
+    {
+        int32_t fields[2];
+        std::string source;
+        if (!readExact(file, fields, sizeof(fields), follow) || !readString(file, source, follow) ||
+            !readString(file, site.format, follow) || !readString(file, site.types, follow))
+        {
+            return false;
+        }
+        site.level = fields[0];
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Renders the records of one chunk.
+ *
+ * @return False if a record names an unknown call site or is malformed.
+ **********************************************************************************************************************/
+static bool decodeRecords (const std::vector<char>& data, const std::vector<DecodedSite>& sites, uint64_t syncTicks,
+                           int64_t syncNs, double rate, std::vector<DecodedLine>& pending)
+{
+    const char* next = data.data();
+    const char* end = next + data.size();
+    std::string message;
+
+    while (next < end)
+    {
+        uint32_t index;
+        uint64_t ticks;
+        if (end - next < (ptrdiff_t)(sizeof(index) + sizeof(ticks)))
+        {
+            return false;
+        }
+        std::memcpy(&index, next, sizeof(index));
+        std::memcpy(&ticks, next + sizeof(index), sizeof(ticks));
+        next += sizeof(index) + sizeof(ticks);
+        if ((index >= sites.size()) ||
+            !logRender(sites[index].format.c_str(), sites[index].types.c_str(), next, end, message))
+        {
+            return false;
+        }
+
+        DecodedLine decoded;
+        decoded.unixNs = syncNs + (int64_t)((double)(int64_t)(ticks - syncTicks) * 1e9 / rate);
+        logFormatLine(sites[index].level, decoded.unixNs, message, decoded.line);
+        pending.push_back(decoded);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints the records of one pass of the writer, merged over the threads by time.
+ **********************************************************************************************************************/
+static void printPending (std::vector<DecodedLine>& pending)
+{
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const DecodedLine& a, const DecodedLine& b) { return a.unixNs < b.unixNs; });
+    for (const DecodedLine& decoded : pending)
+    {
+        std::cout << decoded.line << '\n';
+    }
+    std::cout.flush();
+    pending.clear();
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Renders a binary log of gnss_sender or gnss_receiver as text.
+ *
+ * "gnss_logdecode [--follow] FILE" prints every record with its local time. Records are in time order within each
+ * pass of the writer thread, and in order per thread throughout. With --follow it keeps waiting for new records, as
+ * "tail -f" does, printing each chunk as it arrives.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    bool follow = (argc == 3) && (std::string(argv[1]) == "--follow");
+    if ((argc != 2) && !follow)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--follow] FILE" << std::endl;
+        return 1;
+    }
+
+    const char* path = argv[argc - 1];
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        std::cerr << "Unable to open " << path << std::endl;
+        return 1;
+    }
+
+    std::vector<DecodedSite> sites;
+    std::vector<DecodedLine> pending;
+    std::vector<char> data;
+    uint64_t syncTicks = 0;
+    int64_t syncNs = 0;
+    double rate = 1e9;
+    bool ok = true;
+    char type;
+
+    // Each run appends its magic and dictionary, then sync and record chunks
+    while (ok && readExact(file, &type, 1, follow))
+    {
+        if (type == LOG_MAGIC[0])
+        {
+            char magic[sizeof(LOG_MAGIC) - 1];
+            magic[0] = type;
+            ok = readExact(file, magic + 1, sizeof(magic) - 1, follow) &&
+                 (std::string(magic, sizeof(magic)) == LOG_MAGIC) && readDictionary(file, sites, follow);
+            printPending(pending);
+        }
+        else if (type == LOG_CHUNK_SYNC)
+        {
+            printPending(pending);
+            ok = readExact(file, &syncTicks, sizeof(syncTicks), follow) &&
+                 readExact(file, &syncNs, sizeof(syncNs), follow) && readExact(file, &rate, sizeof(rate), follow) &&
+                 (rate > 0.0);
+        }
+        else if (type == LOG_CHUNK_RECORDS)
+        {
+            uint32_t header[2];
+            ok = readExact(file, header, sizeof(header), follow);
+            if (ok)
+            {
+                data.resize(header[1]);
+                ok = readExact(file, data.data(), data.size(), follow) &&
+                     decodeRecords(data, sites, syncTicks, syncNs, rate, pending);
+            }
+            if (follow)
+            {
+                printPending(pending);      // Do not hold back the records of the latest pass until the next one
+            }
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    printPending(pending);
+    long offset = std::ftell(file);
+    std::fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "Malformed log " << path << " at byte " << offset << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,334 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_nmea.h"
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <vector>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define GPRMC_FIELD_COUNT       (13U)             /* Fields in a GPRMC sentence including the talker/type field */
+#define GNSS_TOPIC_PREFIX       "gnss/data/"      /* Topic prefix followed by the device ID */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool verifyChecksum(const std::string& sentence, size_t& starPos);
+static bool parseCoordinate(const std::string& value, const std::string& hemisphere, int degreeDigits, double& out);
+static int parseTwoDigits(const std::string& value, size_t offset);
+static char* putDigits(char* out, uint64_t value, int width);
+static char* putTenths(char* out, double value);
+static char* putCoordinate(char* out, double value, int degreeDigits, char positive, char negative);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parses a GPRMC sentence into a position fix.
+ *
+ * The checksum is verified and only sentences with an active ('A') status are accepted. The device ID of the fix is
+ * left untouched so that the caller can fill it in from the transport.
+ *
+ * @param sentence The NMEA GPRMC sentence.
+ * @param fix Output fix, only valid when true is returned.
+ *
+ * @return True if the sentence was parsed successfully, false otherwise.
+ **********************************************************************************************************************/
+bool parseGPRMC (const std::string& sentence, GNSSFix& fix)
+{
+    size_t starPos = 0;
+    if ((sentence.rfind("$GPRMC,", 0) != 0) || !verifyChecksum(sentence, starPos))
+    {
+        return false;
+    }
+
+    // Split the body into comma separated fields
+    std::vector<std::string> fields;
+    size_t start = 1;
+    while (start <= starPos)
+    {
+        size_t comma = sentence.find(',', start);
+        if ((comma == std::string::npos) || (comma > starPos))
+        {
+            comma = starPos;
+        }
+        fields.push_back(sentence.substr(start, comma - start));
+        start = comma + 1;
+    }
+
+    if ((fields.size() < GPRMC_FIELD_COUNT - 1) || (fields[2] != "A"))
+    {
+        return false;
+    }
+
+    const std::string& utc = fields[1];
+    const std::string& date = fields[9];
+    if ((utc.size() < 6) || (date.size() != 6))
+    {
+        return false;
+    }
+
+    std::tm tm = {};
+    tm.tm_hour = parseTwoDigits(utc, 0);
+    tm.tm_min  = parseTwoDigits(utc, 2);
+    tm.tm_sec  = parseTwoDigits(utc, 4);
+    tm.tm_mday = parseTwoDigits(date, 0);
+    tm.tm_mon  = parseTwoDigits(date, 2) - 1;
+    tm.tm_year = parseTwoDigits(date, 4) + 100;    // NMEA carries a two digit year, assume 20YY
+    if ((tm.tm_hour < 0) || (tm.tm_min < 0) || (tm.tm_sec < 0) || (tm.tm_mday < 1) || (tm.tm_mon < 0))
+    {
+        return false;
+    }
+
+    int64_t millis = 0;
+    if ((utc.size() > 7) && (utc[6] == '.'))
+    {
+        millis = (int64_t)(std::atof(utc.c_str() + 6) * 1000.0 + 0.5);
+    }
+
+    if (!parseCoordinate(fields[3], fields[4], 2, fix.latitude) ||
+        !parseCoordinate(fields[5], fields[6], 3, fix.longitude))
+    {
+        return false;
+    }
+
+    fix.timestampMs = (int64_t)timegm(&tm) * 1000 + millis;
+    fix.speedKnots = std::atof(fields[7].c_str());
+    fix.course = std::atof(fields[8].c_str());
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a fix as an active GPRMC sentence, in the layout of the sender, without snprintf or a time zone lookup.
+ *
+ * Time carries hundredths of a second, coordinates six decimals of minutes, speed and course one decimal. The
+ * magnetic variation is 0.0.
+ *
+ * @param fix The fix; its device ID is not written.
+ * @param out Output of at least GPRMC_MAX_LENGTH bytes, not terminated.
+ *
+ * @return Length of the sentence.
+ **********************************************************************************************************************/
+size_t formatGPRMC (const GNSSFix& fix, char* out)
+{
+    // Civil date from days since the epoch, after H. Hinnant's days_from_civil inverse
+    int64_t days = fix.timestampMs / 86400000;
+    int64_t msOfDay = fix.timestampMs - days * 86400000;
+    int64_t z = days + 719468;
+    int64_t era = z / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    int64_t month = (mp < 10) ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + ((month <= 2) ? 1 : 0);
+
+    char* p = out;
+    std::memcpy(p, "$GPRMC,", 7);
+    p += 7;
+    p = putDigits(p, (uint64_t)(msOfDay / 3600000), 2);
+    p = putDigits(p, (uint64_t)(msOfDay / 60000 % 60), 2);
+    p = putDigits(p, (uint64_t)(msOfDay / 1000 % 60), 2);
+    *p++ = '.';
+    p = putDigits(p, (uint64_t)(msOfDay % 1000 / 10), 2);
+    std::memcpy(p, ",A,", 3);
+    p += 3;
+    p = putCoordinate(p, fix.latitude, 2, 'N', 'S');
+    *p++ = ',';
+    p = putCoordinate(p, fix.longitude, 3, 'E', 'W');
+    *p++ = ',';
+    p = putTenths(p, fix.speedKnots);
+    *p++ = ',';
+    p = putTenths(p, fix.course);
+    *p++ = ',';
+    p = putDigits(p, (uint64_t)day, 2);
+    p = putDigits(p, (uint64_t)month, 2);
+    p = putDigits(p, (uint64_t)(year % 100), 2);
+    std::memcpy(p, ",0.0,E,A", 8);
+    p += 8;
+
+    unsigned char checksum = 0;
+    for (const char* c = out + 1; c < p; ++c)
+    {
+        checksum ^= (unsigned char)*c;
+    }
+    static const char hex[] = "0123456789ABCDEF";
+    *p++ = '*';
+    *p++ = hex[checksum >> 4];
+    *p++ = hex[checksum & 0x0F];
+
+    return (size_t)(p - out);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Extracts the device ID from an MQTT topic.
+ *
+ * Senders publish on "gnss/data/<device>". Messages on the bare "gnss/data" topic are attributed to the default device.
+ *
+ * @param topic The topic the message was received on.
+ *
+ * @return The device ID.
+ **********************************************************************************************************************/
+std::string deviceIdFromTopic (const std::string& topic)
+{
+    const std::string prefix = GNSS_TOPIC_PREFIX;
+    if ((topic.size() > prefix.size()) && (topic.compare(0, prefix.size(), prefix) == 0))
+    {
+        return topic.substr(prefix.size());
+    }
+
+    return GNSS_DEFAULT_DEVICE_ID;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Verifies the XOR checksum of an NMEA sentence.
+ *
+ * @param sentence The NMEA sentence.
+ * @param starPos Output position of the '*' delimiter.
+ *
+ * @return True if the checksum is present and matches, false otherwise.
+ **********************************************************************************************************************/
+static bool verifyChecksum (const std::string& sentence, size_t& starPos)
+{
+    starPos = sentence.rfind('*');
+    if ((starPos == std::string::npos) || (starPos + 3 > sentence.size()))
+    {
+        return false;
+    }
+
+    unsigned char checksum = 0;
+    for (size_t i = 1; i < starPos; ++i)
+    {
+        checksum ^= sentence[i];
+    }
+
+    char* end = nullptr;
+    std::string hex = sentence.substr(starPos + 1, 2);
+    long expected = std::strtol(hex.c_str(), &end, 16);
+
+    return (*end == '\0') && (expected == checksum);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Converts an NMEA "(d)ddmm.mmmm" coordinate into signed decimal degrees.
+ *
+ * @param value The coordinate field.
+ * @param hemisphere The hemisphere field (N, S, E or W).
+ * @param degreeDigits Number of leading degree digits (2 for latitude, 3 for longitude).
+ * @param out Output coordinate in decimal degrees.
+ *
+ * @return True if the field is well formed, false otherwise.
+ **********************************************************************************************************************/
+static bool parseCoordinate (const std::string& value, const std::string& hemisphere, int degreeDigits, double& out)
+{
+    size_t dot = value.find('.');
+    if ((dot == std::string::npos) || (dot != (size_t)degreeDigits + 2) || (hemisphere.size() != 1))
+    {
+        return false;
+    }
+
+    double degrees = std::atof(value.substr(0, degreeDigits).c_str());
+    double minutes = std::atof(value.c_str() + degreeDigits);
+    if (minutes >= 60.0)
+    {
+        return false;
+    }
+
+    out = degrees + minutes / 60.0;
+    if ((hemisphere[0] == 'S') || (hemisphere[0] == 'W'))
+    {
+        out = -out;
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses two decimal digits at the given offset.
+ *
+ * @param value The string to read from.
+ * @param offset Offset of the first digit.
+ *
+ * @return The parsed value, or -1 if the characters are not digits.
+ **********************************************************************************************************************/
+static int parseTwoDigits (const std::string& value, size_t offset)
+{
+    if ((offset + 2 > value.size()) || (value[offset] < '0') || (value[offset] > '9') ||
+        (value[offset + 1] < '0') || (value[offset + 1] > '9'))
+    {
+        return -1;
+    }
+
+    return (value[offset] - '0') * 10 + (value[offset + 1] - '0');
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a number with leading zeros to the given width, or wider if it needs more digits.
+ **********************************************************************************************************************/
+static char* putDigits (char* out, uint64_t value, int width)
+{
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (; width > count; --width)
+    {
+        *out++ = '0';
+    }
+    while (count > 0)
+    {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a non-negative number with one decimal.
+ **********************************************************************************************************************/
+static char* putTenths (char* out, double value)
+{
+    uint64_t tenths = (value > 0.0) ? (uint64_t)(value * 10.0 + 0.5) : 0;
+    out = putDigits(out, tenths / 10, 1);
+    *out++ = '.';
+    *out++ = (char)('0' + tenths % 10);
+    return out;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Writes a coordinate as "(d)ddmm.mmmmmm,H" from signed decimal degrees.
+ **********************************************************************************************************************/
+static char* putCoordinate (char* out, double value, int degreeDigits, char positive, char negative)
+{
+    uint64_t microMinutes = (uint64_t)(std::fabs(value) * 60000000.0 + 0.5);
+    out = putDigits(out, microMinutes / 60000000, degreeDigits);
+    out = putDigits(out, microMinutes / 1000000 % 60, 2);
+    *out++ = '.';
+    out = putDigits(out, microMinutes % 1000000, 6);
+    *out++ = ',';
+    *out++ = (value < 0.0) ? negative : positive;
+    return out;
+}
@@ -0,0 +1,326 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_payload.h"
+#include <cstring>
+#include <zlib.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define PAYLOAD_HEADER_SIZE     (PAYLOAD_MAGIC_SIZE + 2U)   /* Magic, flags and device length */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void putUint(std::string& out, uint64_t value, size_t bytes);
+static bool getUint(const uint8_t*& p, const uint8_t* end, size_t bytes, uint64_t& value);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Checks whether a payload is a batch rather than a plain NMEA sentence.
+ *
+ * @param data The payload.
+ * @param size Size of the payload in bytes.
+ *
+ * @return True if the payload starts with the batch magic.
+ **********************************************************************************************************************/
+bool isBatchPayload (const char* data, size_t size)
+{
+    return (size >= PAYLOAD_HEADER_SIZE) && (std::memcmp(data, PAYLOAD_MAGIC, PAYLOAD_MAGIC_SIZE) == 0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Serializes a batch.
+ *
+ * @param batch The batch to serialize.
+ * @param out Output payload.
+ * @param compress Deflate the body, worthwhile for batches of more than a few sentences.
+ *
+ * @return False if the device ID, a sentence, the sources or the number of sentences exceed the format limits.
+ **********************************************************************************************************************/
+bool encodeBatch (const PayloadBatch& batch, std::string& out, bool compress)
+{
+    bool merged = !batch.sources.empty();
+    if ((batch.deviceId.size() > PAYLOAD_MAX_DEVICE_ID) || (batch.sentences.size() > PAYLOAD_MAX_SENTENCES) ||
+        (batch.sources.size() > PAYLOAD_MAX_SOURCES) || (merged && (batch.sourceOf.size() != batch.sentences.size())))
+    {
+        return false;
+    }
+
+    size_t size = 11;
+    for (const std::string& source : batch.sources)
+    {
+        if (source.size() > PAYLOAD_MAX_DEVICE_ID)
+        {
+            return false;
+        }
+        size += 1 + source.size();
+    }
+    for (size_t i = 0; i < batch.sentences.size(); ++i)
+    {
+        if ((batch.sentences[i].size() > 0xFFFFU) || (merged && (batch.sourceOf[i] >= batch.sources.size())))
+        {
+            return false;
+        }
+        size += 3 + batch.sentences[i].size();
+    }
+
+    std::string body;
+    body.reserve(size);
+    putUint(body, batch.firstSequence, 8);
+    if (merged)
+    {
+        putUint(body, batch.sources.size(), 1);
+        for (const std::string& source : batch.sources)
+        {
+            putUint(body, source.size(), 1);
+            body += source;
+        }
+    }
+    putUint(body, batch.sentences.size(), 2);
+    for (size_t i = 0; i < batch.sentences.size(); ++i)
+    {
+        if (merged)
+        {
+            putUint(body, batch.sourceOf[i], 1);
+        }
+        putUint(body, batch.sentences[i].size(), 2);
+        body += batch.sentences[i];
+    }
+
+    compress = compress && (body.size() <= PAYLOAD_MAX_INFLATED);
+    uint64_t flags = (compress ? PAYLOAD_FLAG_DEFLATE : 0) | (merged ? PAYLOAD_FLAG_SOURCES : 0);
+
+    out.clear();
+    out.append(PAYLOAD_MAGIC, PAYLOAD_MAGIC_SIZE);
+    putUint(out, flags, 1);
+    putUint(out, batch.deviceId.size(), 1);
+    out += batch.deviceId;
+
+    if (!compress)
+    {
+        out += body;
+        return true;
+    }
+
+    uLongf deflatedSize = compressBound(body.size());
+    size_t offset = out.size() + 4;
+    putUint(out, body.size(), 4);
+    out.resize(offset + deflatedSize);
+    if (compress2(reinterpret_cast<Bytef*>(&out[offset]), &deflatedSize, reinterpret_cast<const Bytef*>(body.data()),
+                  body.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        return false;
+    }
+    out.resize(offset + deflatedSize);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a batch.
+ *
+ * @param data The payload.
+ * @param size Size of the payload in bytes.
+ * @param batch Output batch.
+ *
+ * @return False if the payload is not a well-formed batch.
+ **********************************************************************************************************************/
+bool decodeBatch (const char* data, size_t size, PayloadBatch& batch)
+{
+    if (!isBatchPayload(data, size))
+    {
+        return false;
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data) + PAYLOAD_MAGIC_SIZE;
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(data) + size;
+    uint64_t flags, deviceLength, count;
+
+    uint64_t known = PAYLOAD_FLAG_DEFLATE | PAYLOAD_FLAG_SOURCES | PAYLOAD_FLAG_HMAC;
+    if (!getUint(p, end, 1, flags) || ((flags & ~known) != 0) || !getUint(p, end, 1, deviceLength))
+    {
+        return false;
+    }
+    if (flags & PAYLOAD_FLAG_HMAC)
+    {
+        // The tag is checked by the caller before decoding, see PayloadVerifier
+        if ((size_t)(end - p) < PAYLOAD_TAG_SIZE)
+        {
+            return false;
+        }
+        end -= PAYLOAD_TAG_SIZE;
+    }
+    if ((size_t)(end - p) < deviceLength)
+    {
+        return false;
+    }
+    batch.deviceId.assign(reinterpret_cast<const char*>(p), deviceLength);
+    p += deviceLength;
+
+    std::string inflated;
+    if (flags & PAYLOAD_FLAG_DEFLATE)
+    {
+        uint64_t inflatedSize;
+        if (!getUint(p, end, 4, inflatedSize) || (inflatedSize > PAYLOAD_MAX_INFLATED))
+        {
+            return false;
+        }
+        inflated.resize(inflatedSize);
+        uLongf actualSize = inflatedSize;
+        if ((uncompress(reinterpret_cast<Bytef*>(&inflated[0]), &actualSize, p, end - p) != Z_OK) ||
+            (actualSize != inflatedSize))
+        {
+            return false;
+        }
+        p = reinterpret_cast<const uint8_t*>(inflated.data());
+        end = p + inflated.size();
+    }
+
+    if (!getUint(p, end, 8, batch.firstSequence))
+    {
+        return false;
+    }
+
+    batch.sources.clear();
+    batch.sourceOf.clear();
+    if (flags & PAYLOAD_FLAG_SOURCES)
+    {
+        uint64_t sources;
+        if (!getUint(p, end, 1, sources) || (sources == 0))
+        {
+            return false;
+        }
+        batch.sources.resize(sources);
+        for (std::string& source : batch.sources)
+        {
+            uint64_t length;
+            if (!getUint(p, end, 1, length) || ((size_t)(end - p) < length))
+            {
+                return false;
+            }
+            source.assign(reinterpret_cast<const char*>(p), length);
+            p += length;
+        }
+    }
+
+    if (!getUint(p, end, 2, count))
+    {
+        return false;
+    }
+
+    batch.sentences.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t source, length;
+        if (!batch.sources.empty())
+        {
+            if (!getUint(p, end, 1, source) || (source >= batch.sources.size()))
+            {
+                return false;
+            }
+            batch.sourceOf.push_back((uint8_t)source);
+        }
+        if (!getUint(p, end, 2, length) || ((size_t)(end - p) < length))
+        {
+            return false;
+        }
+        batch.sentences[i].assign(reinterpret_cast<const char*>(p), length);
+        p += length;
+    }
+
+    return p == end;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads the flags and the device ID of a batch without decoding its body.
+ *
+ * @param data The payload.
+ * @param size Size of the payload in bytes.
+ * @param flags Output flags, PAYLOAD_FLAG_*.
+ * @param deviceId Output device ID, empty when the topic names the device.
+ *
+ * @return False if the payload is not a batch or its header is truncated.
+ **********************************************************************************************************************/
+bool peekBatchHeader (const char* data, size_t size, uint8_t& flags, std::string& deviceId)
+{
+    if (!isBatchPayload(data, size))
+    {
+        return false;
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data) + PAYLOAD_MAGIC_SIZE;
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(data) + size;
+    uint64_t value, deviceLength;
+    if (!getUint(p, end, 1, value) || !getUint(p, end, 1, deviceLength) || ((size_t)(end - p) < deviceLength))
+    {
+        return false;
+    }
+    flags = (uint8_t)value;
+    deviceId.assign(reinterpret_cast<const char*>(p), deviceLength);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The device a sentence of a batch belongs to.
+ *
+ * @param batch The batch.
+ * @param index Index of the sentence.
+ *
+ * @return The sentence's source for a merged batch, the batch device otherwise.
+ **********************************************************************************************************************/
+const std::string& sentenceDevice (const PayloadBatch& batch, size_t index)
+{
+    return batch.sources.empty() ? batch.deviceId : batch.sources[batch.sourceOf[index]];
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Appends the low bytes of an integer in little-endian order.
+ **********************************************************************************************************************/
+static void putUint (std::string& out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a little-endian integer and advances the cursor.
+ *
+ * @return False if the input ends early.
+ **********************************************************************************************************************/
+static bool getUint (const uint8_t*& p, const uint8_t* end, size_t bytes, uint64_t& value)
+{
+    if ((size_t)(end - p) < bytes)
+    {
+        return false;
+    }
+
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    p += bytes;
+
+    return true;
+}
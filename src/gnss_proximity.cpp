@@ -0,0 +1,360 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_proximity.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define EARTH_RADIUS_M          (6371008.8)       /* Mean radius; the chord and the arc differ by 1e-8 at 10 km */
+#define RADIX_BITS              (11U)             /* Key bits per pass of the radix sort */
+#define NEIGHBOUR_COLUMNS       (4U)              /* Neighbouring (x, y) columns after the column of a cell */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+template <typename Item>
+static void radixSort(std::vector<Item>& items, std::vector<Item>& spare);
+static unsigned bitWidth(uint64_t value);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an engine with a near distance of 50 m, a clear distance of 75 m, convoys after 5 minutes and
+ *        vehicles dropped after 30 s of silence.
+ **********************************************************************************************************************/
+ProximityEngine::ProximityEngine ()
+    : yShift(1), xShift(2), convoys(0), steps(0), tested(0)
+{
+    configure(ProximityConfig{ 50.0, 75.0, 300000, 30000 });
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sets the distances and times; the grid follows from the next step.
+ *
+ * @param config The distances are clamped to PROXIMITY_MIN_M and PROXIMITY_MAX_M, the clear distance to at least the
+ *               near distance.
+ **********************************************************************************************************************/
+void ProximityEngine::configure (const ProximityConfig& config)
+{
+    this->config = config;
+    this->config.nearM = std::clamp(config.nearM, 1.0, PROXIMITY_MAX_M);
+    this->config.clearM = std::clamp(config.clearM, std::max(this->config.nearM, PROXIMITY_MIN_M), PROXIMITY_MAX_M);
+    cellM = this->config.clearM;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Records a fix as the latest position of its vehicle, unless a later fix is already recorded.
+ *
+ * @param fix The fix.
+ **********************************************************************************************************************/
+void ProximityEngine::update (const GNSSFix& fix)
+{
+    auto inserted = vehicles.emplace(fix.deviceId, (uint32_t)names.size());
+    uint32_t vehicle = inserted.first->second;
+    if (inserted.second)
+    {
+        names.push_back(fix.deviceId);
+        positions.push_back(Position{ 0.0, 0.0, 0.0 });
+        times.push_back(INT64_MIN);
+    }
+    if (fix.timestampMs < times[vehicle])
+    {
+        return;
+    }
+
+    double lat = fix.latitude * M_PI / 180.0;
+    double lon = fix.longitude * M_PI / 180.0;
+    positions[vehicle] = Position{ EARTH_RADIUS_M * std::cos(lat) * std::cos(lon),
+                                   EARTH_RADIUS_M * std::cos(lat) * std::sin(lon), EARTH_RADIUS_M * std::sin(lat) };
+    times[vehicle] = fix.timestampMs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Runs one time step: finds the pairs within the clear distance and updates the pair states.
+ *
+ * @param nowMs Time of the step, on the clock of the fix times.
+ * @param events Receives the changes of the pair states, in the order of their vehicles.
+ *
+ * @return The number of near pairs.
+ **********************************************************************************************************************/
+size_t ProximityEngine::step (int64_t nowMs, std::vector<ProximityEvent>& events)
+{
+    ++steps;
+    buildGrid(nowMs);
+    joinGrid();
+    mergePairs(nowMs, events);
+    return pairs.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief The device ID of a vehicle of an event.
+ **********************************************************************************************************************/
+const std::string& ProximityEngine::device (uint32_t vehicle) const
+{
+    return names[vehicle];
+}
+
+/*******************************************************************************************************************//**
+ * @brief The vehicles, the grid of the last step and the pair states.
+ **********************************************************************************************************************/
+ProximityStats ProximityEngine::stats () const
+{
+    return ProximityStats{ names.size(), entries.size(), cellKeys.size(), pairs.size(), convoys, steps, tested };
+}
+
+/*******************************************************************************************************************//**
+ * @brief Puts the vehicles heard from within the stale time on the grid, sorted by cell, and lays the members of each
+ *        cell out next to each other with their positions.
+ **********************************************************************************************************************/
+void ProximityEngine::buildGrid (int64_t nowMs)
+{
+    const double perCell = 1.0 / cellM;
+    double low[3] = { INFINITY, INFINITY, INFINITY };
+    double high[3] = { -INFINITY, -INFINITY, -INFINITY };
+    entries.clear();
+    for (uint32_t vehicle = 0; vehicle < (uint32_t)names.size(); ++vehicle)
+    {
+        if (nowMs - times[vehicle] <= config.staleMs)
+        {
+            const Position& p = positions[vehicle];
+            low[0] = std::min(low[0], p.x);
+            low[1] = std::min(low[1], p.y);
+            low[2] = std::min(low[2], p.z);
+            high[0] = std::max(high[0], p.x);
+            high[1] = std::max(high[1], p.y);
+            high[2] = std::max(high[2], p.z);
+            entries.push_back(Entry{ 0, vehicle });
+        }
+    }
+
+    // Cell coordinates count from one below the lowest cell, so the neighbours of every cell fit their bits and the
+    // keys only have the bits the fleet spans: three radix passes for a city, at most 63 bits for the whole sphere
+    int64_t origin[3];
+    unsigned bits[3];
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        origin[axis] = entries.empty() ? 0 : (int64_t)std::floor(low[axis] * perCell) - 1;
+        int64_t span = entries.empty() ? 0 : (int64_t)std::floor(high[axis] * perCell) - origin[axis] + 1;
+        bits[axis] = bitWidth((uint64_t)span);
+    }
+    yShift = bits[2];
+    xShift = bits[2] + bits[1];
+    for (Entry& entry : entries)
+    {
+        const Position& p = positions[entry.vehicle];
+        entry.key = ((uint64_t)((int64_t)std::floor(p.x * perCell) - origin[0]) << xShift) |
+                    ((uint64_t)((int64_t)std::floor(p.y * perCell) - origin[1]) << yShift) |
+                    (uint64_t)((int64_t)std::floor(p.z * perCell) - origin[2]);
+    }
+    radixSort(entries, spareEntries);
+
+    cellKeys.clear();
+    cellStart.clear();
+    members.resize(entries.size());
+    memberPositions.resize(entries.size());
+    for (uint32_t k = 0; k < (uint32_t)entries.size(); ++k)
+    {
+        if (cellKeys.empty() || (cellKeys.back() != entries[k].key))
+        {
+            cellKeys.push_back(entries[k].key);
+            cellStart.push_back(k);
+        }
+        members[k] = entries[k].vehicle;
+        memberPositions[k] = positions[entries[k].vehicle];
+    }
+    cellStart.push_back((uint32_t)entries.size());
+}
+
+/*******************************************************************************************************************//**
+ * @brief Collects the pairs within the clear distance into found, each cell against itself and its later neighbours.
+ **********************************************************************************************************************/
+void ProximityEngine::joinGrid ()
+{
+    // Key offsets of the columns after the column of a cell, (x, y + 1), (x + 1, y - 1), (x + 1, y) and (x + 1, y + 1),
+    // each from z - 1 to z + 1
+    const uint64_t x = 1ULL << xShift;
+    const uint64_t y = 1ULL << yShift;
+    const uint64_t columns[NEIGHBOUR_COLUMNS][2] = {
+        { y - 1, y + 1 }, { x - y - 1, x - y + 1 }, { x - 1, x + 1 }, { x + y - 1, x + y + 1 },
+    };
+
+    const double clear2 = config.clearM * config.clearM;
+    const uint32_t cells = (uint32_t)cellKeys.size();
+    const Position* p = memberPositions.data();
+    uint32_t cursors[NEIGHBOUR_COLUMNS] = {};
+    uint64_t distances = 0;
+    found.clear();
+
+    // Tests the members of cell against those of other, or against its later members when other is cell
+    auto testCells = [&](uint32_t cell, uint32_t other) {
+        uint32_t end = cellStart[cell + 1];
+        uint32_t last = cellStart[other + 1];
+        for (uint32_t i = cellStart[cell]; i < end; ++i)
+        {
+            uint32_t j = (other == cell) ? i + 1 : cellStart[other];
+            distances += last - j;
+            for (; j < last; ++j)
+            {
+                double dx = p[i].x - p[j].x;
+                double dy = p[i].y - p[j].y;
+                double dz = p[i].z - p[j].z;
+                double d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 <= clear2)
+                {
+                    uint32_t a = std::min(members[i], members[j]);
+                    uint32_t b = std::max(members[i], members[j]);
+                    found.push_back(Found{ ((uint64_t)a << 32) | b, std::sqrt(d2) });
+                }
+            }
+        }
+    };
+
+    for (uint32_t cell = 0; cell < cells; ++cell)
+    {
+        uint64_t key = cellKeys[cell];
+        testCells(cell, cell);
+        if ((cell + 1 < cells) && (cellKeys[cell + 1] == key + 1))
+        {
+            testCells(cell, cell + 1);
+        }
+        for (size_t c = 0; c < NEIGHBOUR_COLUMNS; ++c)
+        {
+            uint64_t low = key + columns[c][0];
+            uint64_t high = key + columns[c][1];
+            uint32_t& cursor = cursors[c];
+            while ((cursor < cells) && (cellKeys[cursor] < low))
+            {
+                ++cursor;
+            }
+            for (uint32_t other = cursor; (other < cells) && (cellKeys[other] <= high); ++other)
+            {
+                testCells(cell, other);
+            }
+        }
+    }
+    tested += distances;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Merges the pairs found with the near pairs of the previous step, both sorted by key.
+ *
+ * A pair found and near stays near, and becomes a convoy after the convoy time; a pair found but not near becomes
+ * near within the near distance; a near pair not found clears.
+ **********************************************************************************************************************/
+void ProximityEngine::mergePairs (int64_t nowMs, std::vector<ProximityEvent>& events)
+{
+    radixSort(found, spareFound);
+    nextPairs.clear();
+
+    size_t n = 0;
+    for (size_t f = 0; (f < found.size()) || (n < pairs.size());)
+    {
+        uint64_t key = (f < found.size()) ? found[f].key : UINT64_MAX;
+        if ((n < pairs.size()) && (pairs[n].key < key))
+        {
+            const Pair& pair = pairs[n++];
+            ProximityEvent event = { PROXIMITY_CLEAR, (uint32_t)(pair.key >> 32), (uint32_t)pair.key, nowMs,
+                                     pair.sinceMs, pair.distanceM };
+            events.push_back(event);
+            if (pair.convoy)
+            {
+                event.type = PROXIMITY_CONVOY_END;
+                events.push_back(event);
+                --convoys;
+            }
+            continue;
+        }
+
+        Pair pair = { key, found[f++].distanceM, nowMs, false };
+        uint32_t a = (uint32_t)(key >> 32);
+        uint32_t b = (uint32_t)key;
+        if ((n < pairs.size()) && (pairs[n].key == key))
+        {
+            pair.sinceMs = pairs[n].sinceMs;
+            pair.convoy = pairs[n++].convoy;
+            if (!pair.convoy && (nowMs - pair.sinceMs >= config.convoyMs))
+            {
+                pair.convoy = true;
+                ++convoys;
+                events.push_back(ProximityEvent{ PROXIMITY_CONVOY, a, b, nowMs, pair.sinceMs, pair.distanceM });
+            }
+        }
+        else if (pair.distanceM <= config.nearM)
+        {
+            events.push_back(ProximityEvent{ PROXIMITY_NEAR, a, b, nowMs, nowMs, pair.distanceM });
+        }
+        else
+        {
+            continue;
+        }
+        nextPairs.push_back(pair);
+    }
+    pairs.swap(nextPairs);
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Sorts items by their 64-bit key, a least significant digit radix sort of RADIX_BITS per pass that skips the
+ *        digits all keys share.
+ **********************************************************************************************************************/
+template <typename Item>
+static void radixSort (std::vector<Item>& items, std::vector<Item>& spare)
+{
+    const uint64_t mask = (1U << RADIX_BITS) - 1;
+    spare.resize(items.size());
+    for (unsigned shift = 0; (shift < 64) && !items.empty(); shift += RADIX_BITS)
+    {
+        uint32_t counts[1U << RADIX_BITS] = {};
+        for (const Item& item : items)
+        {
+            ++counts[(item.key >> shift) & mask];
+        }
+        if (counts[(items[0].key >> shift) & mask] == items.size())
+        {
+            continue;
+        }
+        uint32_t sum = 0;
+        for (uint32_t& count : counts)
+        {
+            uint32_t start = sum;
+            sum += count;
+            count = start;
+        }
+        for (const Item& item : items)
+        {
+            spare[counts[(item.key >> shift) & mask]++] = item;
+        }
+        items.swap(spare);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bits needed to hold a value.
+ **********************************************************************************************************************/
+static unsigned bitWidth (uint64_t value)
+{
+    unsigned bits = 1;
+    while ((bits < 64) && ((value >> bits) != 0))
+    {
+        ++bits;
+    }
+    return bits;
+}
@@ -11,7 +11,27 @@
 /***********************************************************************************************************************
  * Macro definitions
  **********************************************************************************************************************/
-#define QOS_LEVEL               (0U)              /* QoS level 0 is applied in this project */
+#define QOS_LEVEL               (0U)              /* QoS of pushes and alerts, default QoS of the data subscription */
+#define EVICTION_INTERVAL_S     (60)              /* Period of hot store retention checks in seconds */
+#define STATS_INTERVAL_S        (60)              /* Period of the statistics in the log in seconds */
+#define LOOP_TIMEOUT_MS         (100)             /* Period of the service task, bounds the latency of pushes */
+#define SUBSCRIBE_TOPIC_PREFIX  "gnss/subscribe/"  /* Control topic of continuous queries, followed by the client ID */
+#define PUSH_TOPIC_PREFIX       "gnss/push/"       /* Topic of pushed updates, followed by the client ID */
+#define ALERT_TOPIC_PREFIX      "gnss/alerts/"     /* Topic of rule alerts, followed by the device ID */
+#define RULES_FILE              "gnss_rules.conf"  /* Rule file loaded at start-up and on SIGHUP */
+#define ACK_TOPIC_PREFIX        "gnss/ack/"        /* Commit confirmations of sequenced batches, then the device ID */
+#define CONNECT_TIMEOUT_MS      (5000)            /* Longest wait for a first broker connection at startup */
+#define KEYS_FILE               "gnss_keys.conf"   /* Device keys of authenticated payloads, reloaded on SIGHUP */
+#define AUTH_MAX_WORKERS        (7U)              /* Default verification threads, with the loop thread one per core */
+#define LOG_FILE                "gnss_receiver.binlog" /* Default binary log, rendered by gnss_logdecode */
+#define TENANTS_FILE            "gnss_tenants.conf" /* Tenants sharing the receiver, loaded at start-up */
+#define TENANT_LOOP_FIXES       (4096U)           /* Fixes stored per transaction at most */
+#define TENANT_IDLE_WAIT_MS     (10)              /* Storage pause while quotas or a failed commit hold it back */
+#define DEVICE_LOG_SLOWEST      (5U)              /* Devices with the largest delay listed with the statistics */
+#define PROXIMITY_TOPIC         "gnss/proximity"   /* Topic of proximity and convoy events */
+#define PROXIMITY_STEP_MS       (1000)            /* Period of the proximity step */
+#define PROXIMITY_STALE_MS      (30000)           /* Vehicles without a fix for this long leave the proximity grid */
+#define CONVOY_DEFAULT_S        (300)             /* Default time a pair stays near before it is a convoy */
 
 /***********************************************************************************************************************
  * Typedef definitions
@@ -21,21 +41,218 @@
  * Private global variables and functions
  **********************************************************************************************************************/
 static void handle_signal(int signal);
+static void handle_reload(int signal);
+static void queueReceived(ReceiverState& state);
+static size_t storeBatches(ReceiverState& state);
+static int64_t releaseFixes(ReceiverState& state);
+static int64_t wallClockMs();
+static void evictExpired(ReceiverState& state);
+static void logReceiverStats(ReceiverState& state);
+static Task receiveTask(ReceiverState& state);
+static Task storeTask(ReceiverState& state);
+static Task reorderTask(ReceiverState& state);
+static Task serviceTask(ReceiverState& state);
+static Task statsTask(ReceiverState& state);
+static Task proximityTask(ReceiverState& state);
 
 /***********************************************************************************************************************
  * Global Variables
  **********************************************************************************************************************/
-std::string receivedMessage = "";  // Global variable to store the received message
-std::atomic<bool> running(true);   // Atomic flag for running the loop
+std::vector<ReceivedMessage> receivedMessages;  // Messages received during the last wakeup of the receive task
+std::atomic<bool> running(true);                // Atomic flag for running the loop
+std::atomic<bool> reloadRules(false);           // Set by SIGHUP to reload the rule file
+sqlite3_stmt* insertStatement = nullptr;        // Prepared insert of storeValidData
+std::map<std::string, size_t> deviceBrokers;    // Broker each device was last heard on, its alerts are sent there
+std::map<std::string, size_t> clientBrokers;    // Broker each dashboard subscribed on, its pushes are sent there
 
 /***********************************************************************************************************************
  * Functions
  **********************************************************************************************************************/
 
+/*******************************************************************************************************************//**
+ * @brief Parses the command line options of the receiver.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param config Output configuration, filled with defaults for the options not given.
+ *
+ * @return False if an option is unknown or invalid.
+ **********************************************************************************************************************/
+bool parseReceiverArgs (int argc, char* argv[], ReceiverConfig& config)
+{
+    config.host = "localhost";
+    config.port = 1883;
+    config.qos = QOS_LEVEL;
+    config.embeddedBrokerPort = 0;
+    config.logPath = LOG_FILE;
+    config.fixClock = false;
+    config.proximity = ProximityConfig{ 0.0, 0.0, CONVOY_DEFAULT_S * 1000, PROXIMITY_STALE_MS };
+    initTlsConfig(config.tls);
+    unsigned int cores = std::thread::hardware_concurrency();
+    config.authWorkers = (cores > 1) ? (int)std::min(cores - 1, AUTH_MAX_WORKERS) : 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (option == "--host")
+        {
+            config.host = value;
+        }
+        else if (option == "--port")
+        {
+            config.port = std::atoi(value.c_str());
+            if ((config.port <= 0) || (config.port > 65535))
+            {
+                std::cerr << "Invalid port: " << value << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--broker")
+        {
+            BrokerEndpoint broker;
+            uint16_t port;
+            if (!parseHostPort(value, broker.host, port))
+            {
+                std::cerr << "Invalid broker address: " << value << std::endl;
+                return false;
+            }
+            broker.port = port;
+            config.brokers.push_back(broker);
+        }
+        else if (option == "--qos")
+        {
+            if ((value != "0") && (value != "1") && (value != "2"))
+            {
+                std::cerr << "Invalid QoS: " << value << std::endl;
+                return false;
+            }
+            config.qos = value[0] - '0';
+        }
+        else if (option == "--client-id")
+        {
+            config.clientId = value;
+        }
+        else if (option == "--udp")
+        {
+            std::string host;
+            uint16_t port;
+            config.udpListen = value;
+            if (!parseHostPort(value, host, port))
+            {
+                std::cerr << "Invalid UDP address: " << value << std::endl;
+                return false;
+            }
+        }
+        else if (isTlsOption(option))
+        {
+            if (!setTlsOption(option, value, config.tls))
+            {
+                std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--auth-workers")
+        {
+            config.authWorkers = std::atoi(value.c_str());
+            if (value.empty() || (value.find_first_not_of("0123456789") != std::string::npos) ||
+                (config.authWorkers > 256))
+            {
+                std::cerr << "Invalid number of workers: " << value << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--log")
+        {
+            config.logPath = value;
+        }
+        else if (option == "--clock")
+        {
+            if ((value != "wall") && (value != "fix"))
+            {
+                std::cerr << "Invalid clock: " << value << std::endl;
+                return false;
+            }
+            config.fixClock = (value == "fix");
+        }
+        else if ((option == "--proximity-m") || (option == "--proximity-clear-m"))
+        {
+            char* end = nullptr;
+            double metres = std::strtod(value.c_str(), &end);
+            if (value.empty() || (*end != '\0') || !(metres >= 1.0) || (metres > PROXIMITY_MAX_M))
+            {
+                std::cerr << "Invalid distance: " << value << std::endl;
+                return false;
+            }
+            ((option == "--proximity-m") ? config.proximity.nearM : config.proximity.clearM) = metres;
+        }
+        else if (option == "--convoy-s")
+        {
+            int seconds = std::atoi(value.c_str());
+            if (value.empty() || (value.find_first_not_of("0123456789") != std::string::npos) || (seconds <= 0) ||
+                (seconds > 86400))
+            {
+                std::cerr << "Invalid convoy time: " << value << std::endl;
+                return false;
+            }
+            config.proximity.convoyMs = (int64_t)seconds * 1000;
+        }
+        else if (option == "--embedded-broker")
+        {
+            config.embeddedBrokerPort = std::atoi(value.c_str());
+            if ((config.embeddedBrokerPort <= 0) || (config.embeddedBrokerPort > 65535))
+            {
+                std::cerr << "Invalid port: " << value << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+
+    // The clear distance defaults to half as far again as the near distance, and at least PROXIMITY_MIN_M
+    if ((config.proximity.nearM == 0.0) && (config.proximity.clearM != 0.0))
+    {
+        std::cerr << "--proximity-clear-m needs --proximity-m" << std::endl;
+        return false;
+    }
+    if ((config.proximity.nearM != 0.0) && (config.proximity.clearM == 0.0))
+    {
+        config.proximity.clearM = std::clamp(1.5 * config.proximity.nearM, PROXIMITY_MIN_M, PROXIMITY_MAX_M);
+    }
+    if ((config.proximity.nearM != 0.0) &&
+        ((config.proximity.clearM < config.proximity.nearM) || (config.proximity.clearM < PROXIMITY_MIN_M)))
+    {
+        std::cerr << "The clear distance must be at least the near distance and " << PROXIMITY_MIN_M << " m"
+                  << std::endl;
+        return false;
+    }
+
+    if ((config.embeddedBrokerPort != 0) && tlsEnabled(config.tls))
+    {
+        std::cerr << "The embedded broker does not support TLS, it cannot be combined with --tls-ca or --tls-psk"
+                  << std::endl;
+        return false;
+    }
+
+    return checkTlsConfig(config.tls);
+}
+
 /*******************************************************************************************************************//**
  * @brief Initializes the SQLite database.
  * 
- * This function opens an SQLite database and creates a table for GNSS data if it doesn't already exist.
+ * This function opens an SQLite database and creates a table for GNSS data if it doesn't already exist. Sequenced
+ * data is stored with its device and sequence number, which are unique together, so redelivered batches are stored
+ * only once.
  * 
  * @return Pointer to the SQLite database object, or nullptr if an error occurs.
  **********************************************************************************************************************/
@@ -52,13 +269,15 @@ sqlite3* initDatabase ()
     }
     else
     {
-        std::cout << "Opened database successfully." << std::endl;
+        LOG_TRACE("Opened database successfully.");
     }
 
     // Create a table for GNSS data if it doesn't already exist
     const char* sql = "CREATE TABLE IF NOT EXISTS GNSS_DATA("
                       "ID INTEGER PRIMARY KEY AUTOINCREMENT,"
-                      "NMEA_DATA TEXT NOT NULL);";
+                      "NMEA_DATA TEXT NOT NULL,"
+                      "DEVICE TEXT,"
+                      "SEQ INTEGER);";
 
     rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
 
@@ -69,48 +288,115 @@ sqlite3* initDatabase ()
     }
     else
     {
-        std::cout << "Table created successfully." << std::endl;
+        LOG_TRACE("Table created successfully.");
+    }
+
+    // Databases created by earlier versions lack the sequence columns; the statements fail harmlessly otherwise
+    sqlite3_exec(db, "ALTER TABLE GNSS_DATA ADD COLUMN DEVICE TEXT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "ALTER TABLE GNSS_DATA ADD COLUMN SEQ INTEGER;", nullptr, nullptr, nullptr);
+
+    // Unsequenced rows have a NULL sequence and never collide
+    sql = "CREATE UNIQUE INDEX IF NOT EXISTS GNSS_DATA_DEVICE_SEQ ON GNSS_DATA(DEVICE, SEQ);";
+    rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
+    if (rc == SQLITE_OK)
+    {
+        sql = "INSERT OR IGNORE INTO GNSS_DATA (NMEA_DATA, DEVICE, SEQ) VALUES (?1, ?2, ?3);";
+        rc = sqlite3_prepare_v2(db, sql, -1, &insertStatement, nullptr);
+    }
+    else
+    {
+        sqlite3_free(errMsg);
+    }
+
+    if (rc != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
     }
 
     return db;
 }
 
 /*******************************************************************************************************************//**
- * @brief Callback function to handle incoming MQTT messages.
+ * @brief Handles incoming MQTT messages of any broker.
  * 
- * This function is called whenever a message is received from the MQTT broker. It stores the message in the global
- * variable `receivedMessage`.
+ * This function is called whenever a message is received from one of the MQTT brokers. Subscription requests are
+ * applied to the subscription engine right away, and their pushes go back to the same broker; GNSS data is queued
+ * with its topic and broker in the global `receivedMessages`, so all messages of one network loop are processed as a
+ * batch.
  * 
- * @param mosq Pointer to the Mosquitto instance.
- * @param userdata Pointer to user data (not used in this case).
+ * @param broker Index of the broker the message came from.
  * @param message Pointer to the message received from the MQTT broker.
+ * @param engine The subscription engine of the receiver.
+ **********************************************************************************************************************/
+void on_message (size_t broker, const struct mosquitto_message* message, SubscriptionEngine& engine)
+{
+    std::string topic = message->topic;
+    if (topic.rfind(SUBSCRIBE_TOPIC_PREFIX, 0) == 0)
+    {
+        std::string spec(static_cast<char*>(message->payload), message->payloadlen);
+        clientBrokers[topic.substr(std::string(SUBSCRIBE_TOPIC_PREFIX).size())] = broker;
+        handleSubscriptionRequest(engine, topic, spec);
+        return;
+    }
+
+    ReceivedMessage received;
+    received.topic = topic;
+    received.payload = std::string(static_cast<char*>(message->payload), message->payloadlen);
+    received.datagram = false;
+    received.broker = broker;
+    received.auth = AUTH_UNSIGNED;
+    receivedMessages.push_back(received);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Turns a received message into the sentences it carries.
+ *
+ * A plain NMEA payload becomes an unsequenced batch of one sentence (first sequence 0). Batches without a device ID
+ * belong to the device named by the topic.
+ *
+ * @param received The received message.
+ * @param batch Output batch.
+ *
+ * @return False if the payload looks like a batch but is malformed.
  **********************************************************************************************************************/
-void on_message (struct mosquitto* mosq, void* userdata, const struct mosquitto_message* message)
+bool unpackMessage (const ReceivedMessage& received, PayloadBatch& batch)
 {
-    receivedMessage = std::string(static_cast<char*>(message->payload), message->payloadlen);
+    const std::string& payload = received.payload;
+    if (!isBatchPayload(payload.data(), payload.size()))
+    {
+        batch.deviceId = deviceIdFromTopic(received.topic);
+        batch.firstSequence = 0;
+        batch.sentences.assign(1, payload);
+        return true;
+    }
+
+    if (!decodeBatch(payload.data(), payload.size(), batch))
+    {
+        std::cerr << "Malformed GNSS batch on " << received.topic << " dropped." << std::endl;
+        return false;
+    }
+    if (batch.deviceId.empty())
+    {
+        batch.deviceId = deviceIdFromTopic(received.topic);
+    }
+
+    return true;
 }
 
 /*******************************************************************************************************************//**
  * @brief Logs the received GNSS data with enhanced information.
  * 
  * This function logs the GNSS data with a timestamp and log level. It provides more detailed information for debugging
- * and monitoring purposes.
+ * and monitoring purposes. Only the sentence is copied into the binary log here, the timestamp and the text are
+ * rendered offline.
  * 
  * @param gnssData The GNSS data to be logged.
  **********************************************************************************************************************/
 void logGNSSData (const std::string& gnssData)
 {
-    // Get the current time for the log entry
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-    std::tm* now_tm = std::localtime(&now_time);
-
-    // Format the log entry with a timestamp and a log level
-    std::cout << "[INFO] "
-              << std::put_time(now_tm, "%Y-%m-%d %H:%M:%S")  // Timestamp in YYYY-MM-DD HH:MM:SS format
-              << " - GNSS Data Received: " 
-              << gnssData 
-              << std::endl;
+    LOG_INFO("GNSS Data Received: {}", gnssData);
 }
 
 /*******************************************************************************************************************//**
@@ -127,12 +413,12 @@ bool validateNMEAFormat (const std::string& gnssData)
     // Check if it starts with "$GPRMC"
     if (gnssData.rfind("$GPRMC", 0) == 0)
     {
-        std::cout << "Valid NMEA data" << std::endl;
+        LOG_TRACE("Valid NMEA data");
         return true;
     }
     else
     {
-        std::cout << "Invalid NMEA data" << std::endl;
+        LOG_TRACE("Invalid NMEA data");
         return false;
     }
 }
@@ -140,132 +426,1133 @@ bool validateNMEAFormat (const std::string& gnssData)
 /*******************************************************************************************************************//**
  * @brief Stores valid GNSS data in the SQLite database.
  * 
- * This function inserts the valid GNSS data into the `GNSS_DATA` table in the SQLite database.
+ * This function inserts the valid GNSS data into the `GNSS_DATA` table in the SQLite database. A sequence number
+ * already stored for the device is ignored, which makes redelivery of a batch harmless.
  * 
  * @param db Pointer to the SQLite database object.
  * @param gnssData The valid GNSS data to be stored.
+ * @param deviceId The device that sent the data.
+ * @param sequence Sequence number of the data, or a negative value for unsequenced data.
+ *
+ * @return STORE_INSERTED for a new row, STORE_DUPLICATE for a sequence number already stored, STORE_ERROR otherwise.
  **********************************************************************************************************************/
-void storeValidData (sqlite3* db, const std::string& gnssData)
+StoreResult storeValidData (sqlite3* db, const std::string& gnssData, const std::string& deviceId, int64_t sequence)
 {
-    char* errMsg = 0;
-    std::string sql = "INSERT INTO GNSS_DATA (NMEA_DATA) VALUES ('" + gnssData + "');";
+    sqlite3_reset(insertStatement);
+    sqlite3_bind_text(insertStatement, 1, gnssData.data(), (int)gnssData.size(), SQLITE_STATIC);
+    sqlite3_bind_text(insertStatement, 2, deviceId.data(), (int)deviceId.size(), SQLITE_STATIC);
+    if (sequence >= 0)
+    {
+        sqlite3_bind_int64(insertStatement, 3, sequence);
+    }
+    else
+    {
+        sqlite3_bind_null(insertStatement, 3);
+    }
 
-    int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg);
+    int rc = sqlite3_step(insertStatement);
 
-    if (rc != SQLITE_OK)
+    if (rc != SQLITE_DONE)
     {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        return STORE_ERROR;
+    }
+    else if (sqlite3_changes(db) == 0)
+    {
+        LOG_TRACE("Duplicate GNSS data {}#{} ignored.", deviceId, sequence);
+        return STORE_DUPLICATE;
     }
     else
     {
-        std::cout << "Inserted valid GNSS data into the database." << std::endl;
+        LOG_TRACE("Inserted valid GNSS data into the database.");
+        return STORE_INSERTED;
     }
 }
 
-/***********************************************************************************************************************
- * Private Functions
+/*******************************************************************************************************************//**
+ * @brief Decodes valid GNSS data into a position fix.
+ *
+ * The fix is attributed to the sending device, so recent positions can be kept in the hot store and matched against
+ * continuous queries.
+ *
+ * @param deviceId The device that sent the data.
+ * @param gnssData The valid GNSS data.
+ * @param fix Output fix.
+ *
+ * @return True if the data was decoded, false otherwise.
  **********************************************************************************************************************/
+bool decodeGNSSData (const std::string& deviceId, const std::string& gnssData, GNSSFix& fix)
+{
+    if (!parseGPRMC(gnssData, fix))
+    {
+        std::cerr << "Unable to decode GNSS data." << std::endl;
+        return false;
+    }
+
+    fix.deviceId = deviceId;
+    return true;
+}
 
 /*******************************************************************************************************************//**
- * @brief Signal handler for graceful shutdown.
- * 
- * This function is triggered by SIGINT or SIGTERM signals to set the `running` flag to false, allowing for a controlled
- * shutdown of the application.
- * 
- * @param signal The signal received (e.g., SIGINT, SIGTERM).
+ * @brief Confirms committed batches on "gnss/ack/<device>", on the broker each batch came from.
+ *
+ * Sent only after the transaction holding the batches has committed, so a sender that drops a batch on confirmation
+ * never loses data, even if the receiver crashes right after acknowledging the MQTT delivery.
+ *
+ * @param brokers The broker connections.
+ * @param qos QoS of the confirmations.
+ * @param acks Per broker and device, one line with the last sequence number of each committed batch.
  **********************************************************************************************************************/
-static void handle_signal (int signal)
+void publishCommitAcks (BrokerPool& brokers, int qos, const CommitAcks& acks)
 {
-    std::cout << "Signal received, shutting down..." << std::endl;
-    running = false;
+    for (const auto& ack : acks)
+    {
+        std::string topic = ACK_TOPIC_PREFIX + ack.first.second;
+        if (!brokers.publishTo(ack.first.first, topic, ack.second, qos))
+        {
+            std::cerr << "Failed to confirm batches of " << ack.first.second << ", no broker available." << std::endl;
+        }
+    }
 }
 
-/***********************************************************************************************************************
- * Main function
+/*******************************************************************************************************************//**
+ * @brief Applies a continuous query request received on "gnss/subscribe/<client>".
+ *
+ * The payload replaces all filters of the client; an empty payload cancels its subscription.
+ *
+ * @param engine The subscription engine.
+ * @param topic The request topic, carrying the client ID.
+ * @param spec The filter specification.
  **********************************************************************************************************************/
+void handleSubscriptionRequest (SubscriptionEngine& engine, const std::string& topic, const std::string& spec)
+{
+    std::string clientId = topic.substr(std::string(SUBSCRIBE_TOPIC_PREFIX).size());
+    std::string error;
+
+    if (clientId.empty())
+    {
+        std::cerr << "Subscription request without client ID ignored." << std::endl;
+    }
+    else if (!engine.registerClient(clientId, spec, error))
+    {
+        std::cerr << "Rejected subscription of " << clientId << ": " << error << std::endl;
+    }
+    else
+    {
+        LOG_INFO("Subscription of {} {} ({} active)", clientId, spec.empty() ? "removed" : "registered",
+                 engine.clientCount());
+    }
+}
 
 /*******************************************************************************************************************//**
- * @brief Entry point of the GNSS receiver application.
- * 
- * This function sets up signal handling, initializes the SQLite database, connects to the MQTT broker, subscribes to
- * the GNSS data topic, and enters the main loop to process incoming GNSS data.
- * 
- * @param argc Argument count (not used).
- * @param argv Argument vector (not used).
- * 
- * @return Exit status code (0 for success, -1 for failure).
+ * @brief Publishes the coalesced updates of subscribed clients on "gnss/push/<client>".
+ *
+ * @param brokers The broker connections, each client is served on the broker it subscribed on.
+ * @param engine The subscription engine.
  **********************************************************************************************************************/
-int main (int argc, char* argv[])
+void pushSubscriptionUpdates (BrokerPool& brokers, SubscriptionEngine& engine)
 {
-    // Set up signal handlers for SIGINT and SIGTERM
-    std::signal(SIGINT, handle_signal);
-    std::signal(SIGTERM, handle_signal);
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
 
-    mosquitto_lib_init();
+    engine.flush(nowMs, [&brokers](const std::string& clientId, const std::string& payload)
+    {
+        std::string topic = PUSH_TOPIC_PREFIX + clientId;
+        auto broker = clientBrokers.find(clientId);
+        if (!brokers.publishTo((broker != clientBrokers.end()) ? broker->second : BrokerPool::none, topic, payload,
+                               QOS_LEVEL))
+        {
+            std::cerr << "Failed to push updates to " << clientId << ", no broker available." << std::endl;
+        }
+    });
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the size of the hot store and its compression ratio.
+ *
+ * @param store The hot store.
+ **********************************************************************************************************************/
+void logHotStoreStats (const HotStore& store)
+{
+    HotStoreStats st = store.stats();
+    double ratio = (st.memoryBytes > 0) ? (double)st.structBytes / st.memoryBytes : 0.0;
 
-    struct mosquitto* mosq = mosquitto_new(NULL, true, NULL);
+    LOG_INFO("Hot store: {} devices, {} fixes, {} sealed chunks, {} bytes ({.1}x smaller than structs)", st.devices,
+             st.fixes, st.sealedChunks, st.memoryBytes, ratio);
+}
 
-    if (mosq == NULL)
+/*******************************************************************************************************************//**
+ * @brief Loads the rule file into the rule engine.
+ *
+ * A missing or invalid file leaves the active rules untouched.
+ *
+ * @param engine The rule engine.
+ * @param path Path of the rule file.
+ **********************************************************************************************************************/
+void loadRuleFile (RuleEngine& engine, const std::string& path)
+{
+    std::string error;
+    if (engine.loadFile(path, error))
     {
-        std::cerr << "Failed to create Mosquitto to client!" << std::endl;
-        return -1;
+        LOG_INFO("Loaded {} rules from {}", engine.current()->rules.size(), path);
+    }
+    else
+    {
+        std::cerr << "Rules not loaded: " << error << std::endl;
     }
+}
 
-    // Initialize SQLite database
-    sqlite3* db = initDatabase();
-    if (db == nullptr)
+/*******************************************************************************************************************//**
+ * @brief Loads the device keys of authenticated payloads.
+ *
+ * An invalid file leaves the active keys untouched.
+ *
+ * @param verifier The payload verifier.
+ * @param path Path of the key file.
+ *
+ * @return False if the file cannot be read or is invalid.
+ **********************************************************************************************************************/
+bool loadKeyFile (PayloadVerifier& verifier, const std::string& path)
+{
+    std::string error;
+    if (!verifier.loadKeys(path, error))
     {
-        return -1; // Exit if the database initialization fails
+        std::cerr << "Device keys not loaded: " << error << std::endl;
+        return false;
     }
 
-    // Set up message callback to receive data
-    mosquitto_message_callback_set(mosq, on_message);
+    LOG_INFO("Loaded {} device keys from {}, verifying on {} threads, SHA extensions {}", verifier.keyCount(), path,
+             verifier.workers() + 1, shaExtensions() ? "available" : "not available");
+    return true;
+}
 
-    // Connect to the MQTT broker
-    if (mosquitto_connect(mosq, "localhost", 1883, 60) != MOSQ_ERR_SUCCESS)
+/*******************************************************************************************************************//**
+ * @brief Checks the HMAC tags of all messages received during the last network loop at once.
+ *
+ * The result is kept in each message; messages from devices with a key must carry a valid tag to be stored.
+ *
+ * @param verifier The payload verifier.
+ * @param checks Scratch list of checks, reused across loops.
+ **********************************************************************************************************************/
+void authenticateMessages (PayloadVerifier& verifier, std::vector<AuthCheck>& checks)
+{
+    checks.resize(receivedMessages.size());
+    for (size_t i = 0; i < receivedMessages.size(); ++i)
     {
-        std::cerr << "Unable to connect to MQTT broker!" << std::endl;
-        return -1;
+        const ReceivedMessage& received = receivedMessages[i];
+        checks[i].data = received.payload.data();
+        checks[i].size = received.payload.size();
+        checks[i].topicDevice = deviceIdFromTopic(received.topic);
     }
 
-    // Subscribe to the topic "gnss/data"
-    if (mosquitto_subscribe(mosq, NULL, "gnss/data", QOS_LEVEL) != MOSQ_ERR_SUCCESS)
+    verifier.verify(checks);
+    for (size_t i = 0; i < receivedMessages.size(); ++i)
     {
-        std::cerr << "Failed to subscribe to topic!" << std::endl;
-        return -1;
+        receivedMessages[i].auth = checks[i].result;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Checks that the sentences of a merged batch attributed to a device with a key are vouched for.
+ *
+ * A gateway vouches for the devices behind it with its own tag, but only for those the key file lets it forward;
+ * otherwise any keyed device could sign positions for every other one through a forged source table.
+ *
+ * @param verifier The payload verifier.
+ * @param received The message.
+ * @param batch Its decoded batch.
+ *
+ * @return False if a source has a key and the batch is neither signed by it nor by a gateway allowed to forward it.
+ **********************************************************************************************************************/
+bool sourcesAuthorized (const PayloadVerifier& verifier, const ReceivedMessage& received, const PayloadBatch& batch)
+{
+    bool signedBatch = (received.auth == AUTH_VERIFIED) || (received.auth == AUTH_CACHED);
+    for (const std::string& source : batch.sources)
+    {
+        if (verifier.hasKey(source) &&
+            !(signedBatch && ((source == batch.deviceId) || verifier.mayForward(batch.deviceId, source))))
+        {
+            return false;
+        }
     }
+    return true;
+}
 
-    // Main loop to receive and process the message
-    while (running)
+/*******************************************************************************************************************//**
+ * @brief Logs the tags checked and rejected, and the verification throughput.
+ *
+ * @param verifier The payload verifier.
+ **********************************************************************************************************************/
+void logAuthStats (const PayloadVerifier& verifier)
+{
+    AuthStats st = verifier.stats();
+    LOG_INFO("Authentication: {} tags verified, {} from the cache, {} payloads rejected, {.0} tags/s, {.1} MB/s",
+             st.verified, st.cached, st.rejected, (st.seconds > 0.0) ? st.verified / st.seconds : 0.0,
+             (st.seconds > 0.0) ? st.bytes / st.seconds / 1e6 : 0.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Loads the tenants sharing the receiver.
+ *
+ * @param scheduler The tenant scheduler.
+ * @param path Path of the tenant file.
+ *
+ * @return False if the file cannot be read or is invalid.
+ **********************************************************************************************************************/
+bool loadTenantFile (TenantScheduler& scheduler, const std::string& path)
+{
+    std::string error;
+    if (!scheduler.loadFile(path, error))
     {
-        // Process the MQTT loop
-        mosquitto_loop(mosq, -1, 1);
+        std::cerr << "Tenants not loaded: " << error << std::endl;
+        return false;
+    }
 
-        // If a message is received, process it
-        if (!receivedMessage.empty())
-        {
-            // Log the GNSS data
-            logGNSSData(receivedMessage);
+    LOG_INFO("Loaded {} tenants from {}", scheduler.size(), path);
+    return true;
+}
 
-            // Validate the NMEA format of the data
-            bool isValid = validateNMEAFormat(receivedMessage);
+/*******************************************************************************************************************//**
+ * @brief Appends an accepted batch to the queue of the tenant of its device.
+ *
+ * @param scheduler The tenant scheduler.
+ * @param queues The queue of each tenant.
+ * @param queued The batch, moved into the queue.
+ * @param nowUs Arrival time on the steady clock.
+ *
+ * @return False if the queue of the tenant is full and the batch was dropped.
+ **********************************************************************************************************************/
+bool queueBatch (TenantScheduler& scheduler, std::vector<std::deque<QueuedBatch>>& queues, QueuedBatch& queued,
+                 int64_t nowUs)
+{
+    size_t tenant = scheduler.tenantOf(queued.batch.deviceId);
+    size_t cost = std::max<size_t>(1, queued.batch.sentences.size());
+    if (!scheduler.admit(tenant, cost, nowUs))
+    {
+        std::cerr << "Queue of tenant " << scheduler.stats()[tenant].name << " full, batch of "
+                  << queued.batch.deviceId << " dropped." << std::endl;
+        return false;
+    }
 
-            // If the data is valid, store it in the SQLite database
-            if (isValid)
-            {
-                storeValidData(db, receivedMessage);
-            }
+    queues[tenant].push_back(QueuedBatch());
+    std::swap(queues[tenant].back(), queued);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the fixes stored, dropped and waiting per tenant with their latency since the last call.
+ *
+ * The latency runs from the arrival of a batch to the commit of its fixes.
+ *
+ * @param scheduler The tenant scheduler.
+ **********************************************************************************************************************/
+void logTenantStats (TenantScheduler& scheduler)
+{
+    for (const TenantStats& st : scheduler.stats())
+    {
+        LOG_INFO("Tenant {}: {} fixes stored, {} dropped, {} queued, {} rounds throttled, latency p50 {.1} ms, "
+                 "p99 {.1} ms, max {.1} ms", st.name, st.stored, st.dropped, st.queued, st.throttled, st.p50Us / 1e3,
+                 st.p99Us / 1e3, st.maxUs / 1e3);
+    }
+    scheduler.resetLatency();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Evaluates the rules against a batch of fixes and raises an alert for every match.
+ *
+ * Alerts are logged and published on "gnss/alerts/<device>" as "<rule>,<timestampMs>,<lat>,<lon>,<speedKnots>", on
+ * the broker the device was last heard on.
+ *
+ * @param brokers The broker connections.
+ * @param engine The rule engine.
+ * @param fixes The batch of fixes.
+ **********************************************************************************************************************/
+void evaluateRules (BrokerPool& brokers, RuleEngine& engine, const std::vector<GNSSFix>& fixes)
+{
+    static std::vector<RuleMatch> matches;
+    std::shared_ptr<const RuleSet> rules;
+
+    engine.evaluate(fixes, matches, rules);
+    for (const RuleMatch& match : matches)
+    {
+        const GNSSFix& fix = fixes[match.fix];
+        const std::string& name = rules->rules[match.rule].name;
+
+        std::ostringstream alert;
+        alert << name << "," << fix.timestampMs << "," << std::fixed << std::setprecision(7) << fix.latitude << ","
+              << fix.longitude << "," << std::setprecision(2) << fix.speedKnots;
+        std::string payload = alert.str();
+        std::string topic = ALERT_TOPIC_PREFIX + fix.deviceId;
 
-            // Clear the message after processing
-            receivedMessage.clear();
+        LOG_ALERT("{} matched rule {}", fix.deviceId, name);
+        auto broker = deviceBrokers.find(fix.deviceId);
+        if (!brokers.publishTo((broker != deviceBrokers.end()) ? broker->second : BrokerPool::none, topic, payload,
+                               QOS_LEVEL))
+        {
+            std::cerr << "Failed to publish alert, no broker available." << std::endl;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the traffic, duplicates and disconnections of each broker.
+ *
+ * @param brokers The broker connections.
+ * @param tls Whether to log the TLS handshakes too.
+ **********************************************************************************************************************/
+void logBrokerStats (const BrokerPool& brokers, bool tls)
+{
+    for (const BrokerLinkStats& link : brokers.stats())
+    {
+        const char* down = link.connected ? "" : " (down)";
+        if (tls)
+        {
+            LOG_INFO("Broker {}{}: {} messages, {} bytes, {} duplicates, {} disconnects, {} TLS handshakes "
+                     "({} resumed)", link.name, down, link.received, link.receivedBytes, link.duplicates,
+                     link.disconnects, link.tlsHandshakes, link.tlsResumed);
+        }
+        else
+        {
+            LOG_INFO("Broker {}{}: {} messages, {} bytes, {} duplicates, {} disconnects", link.name, down,
+                     link.received, link.receivedBytes, link.duplicates, link.disconnects);
         }
     }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Queues the waiting datagrams of the UDP input for processing with the MQTT messages.
+ *
+ * Datagrams carry a plain NMEA sentence or a sequenced batch naming its device, so they are queued on the bare data
+ * topic.
+ *
+ * @param udp The UDP input.
+ **********************************************************************************************************************/
+void receiveDatagrams (UdpReceiver& udp)
+{
+    static std::vector<std::string> datagrams;
+
+    datagrams.clear();
+    udp.receive(datagrams);
+    for (std::string& datagram : datagrams)
+    {
+        ReceivedMessage received;
+        received.topic = "gnss/data";
+        received.payload.swap(datagram);
+        received.datagram = true;
+        received.broker = BrokerPool::none;
+        received.auth = AUTH_UNSIGNED;
+        receivedMessages.push_back(received);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the sequence numbers received and lost on the UDP input.
+ *
+ * @param tracker The sequence tracker of the UDP input.
+ * @param udp The UDP input.
+ **********************************************************************************************************************/
+void logSequenceStats (const SequenceTracker& tracker, const UdpReceiver& udp)
+{
+    SequenceStats st = tracker.stats();
+    LOG_INFO("UDP input: {} fixes, {} lost, {} late, {} truncated datagrams", st.received, st.lost, st.late,
+             udp.truncated());
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the clock and delay estimates over the devices and those of the DEVICE_LOG_SLOWEST slowest devices.
+ *
+ * @param registry The device registry.
+ **********************************************************************************************************************/
+void logDeviceStats (const DeviceRegistry& registry)
+{
+    DeviceRegistryStats st = registry.stats();
+    if (st.devices == 0)
+    {
+        return;
+    }
+
+    LOG_INFO("Devices: {} heard from, {} fixes, {} late, {} released early, {} held; offset p50 {} ms, delay p50 {.1} "
+             "ms p99 {.1} ms, reorder window p50 {} ms p99 {} ms", st.devices, st.fixes, st.late, st.forced, st.held,
+             st.offsetP50Ms, st.delayP50Ms, st.delayP99Ms, st.reorderP50Ms, st.reorderP99Ms);
+    for (const std::pair<std::string, DeviceClock>& device : registry.slowest(DEVICE_LOG_SLOWEST))
+    {
+        const DeviceClock& clock = device.second;
+        LOG_INFO("Device {}: offset {} ms, delay {.1} ms, jitter {.1} ms, drift {.1} ppm, reorder window {} ms, "
+                 "{} fixes, {} late", device.first, clock.offsetMs, clock.delayMs, clock.jitterMs, clock.driftPpm,
+                 clock.reorderMs, clock.fixes, clock.late);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes the events of a proximity step.
+ *
+ * Events are logged and published on "gnss/proximity" as "<event>,<device>,<device>,<timeMs>,<sinceMs>,<distanceM>",
+ * the event being near, clear, convoy or convoy_end and sinceMs the time the pair came near.
+ *
+ * @param brokers The broker connections.
+ * @param engine The proximity engine, naming the vehicles of the events.
+ * @param events The events of the step.
+ **********************************************************************************************************************/
+void publishProximityEvents (BrokerPool& brokers, const ProximityEngine& engine,
+                             const std::vector<ProximityEvent>& events)
+{
+    static const char* names[] = { "near", "clear", "convoy", "convoy_end" };
+
+    for (const ProximityEvent& event : events)
+    {
+        const std::string& a = engine.device(event.a);
+        const std::string& b = engine.device(event.b);
+        std::ostringstream payload;
+        payload << names[event.type] << "," << a << "," << b << "," << event.timeMs << "," << event.sinceMs << ","
+                << std::fixed << std::setprecision(1) << event.distanceM;
+
+        if (event.type == PROXIMITY_NEAR)
+        {
+            LOG_ALERT("{} and {} within {.1} m", a, b, event.distanceM);
+        }
+        else if (event.type == PROXIMITY_CONVOY)
+        {
+            LOG_ALERT("{} and {} in convoy for {} s", a, b, (event.timeMs - event.sinceMs) / 1000);
+        }
+        if (!brokers.publishTo(BrokerPool::none, PROXIMITY_TOPIC, payload.str(), QOS_LEVEL))
+        {
+            std::cerr << "Failed to publish proximity event, no broker available." << std::endl;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the vehicles on the proximity grid and the near pairs.
+ *
+ * @param engine The proximity engine.
+ **********************************************************************************************************************/
+void logProximityStats (const ProximityEngine& engine)
+{
+    ProximityStats st = engine.stats();
+    LOG_INFO("Proximity: {} vehicles, {} on the grid in {} cells, {} near pairs, {} convoys, {} distances in {} "
+             "steps", st.vehicles, st.active, st.cells, st.pairs, st.convoys, st.tested, st.steps);
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Signal handler for graceful shutdown.
+ * 
+ * This function is triggered by SIGINT or SIGTERM signals to set the `running` flag to false, allowing for a controlled
+ * shutdown of the application.
+ * 
+ * @param signal The signal received (e.g., SIGINT, SIGTERM).
+ **********************************************************************************************************************/
+static void handle_signal (int signal)
+{
+    running = false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Signal handler requesting a rule reload.
+ *
+ * This function is triggered by SIGHUP. The service task reloads the rule file and swaps the new rules in atomically,
+ * and reloads the device keys.
+ *
+ * @param signal The signal received (SIGHUP).
+ **********************************************************************************************************************/
+static void handle_reload (int signal)
+{
+    reloadRules = true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Authenticates the messages received since the last call and queues the accepted batches by tenant.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static void queueReceived (ReceiverState& state)
+{
+    // The messages of one wakeup are checked together, spread over the verification threads
+    if (state.verifier.enabled())
+    {
+        authenticateMessages(state.verifier, state.authChecks);
+    }
+
+    int64_t nowUs = EventLoop::nowUs();
+    int64_t receivedMs = wallClockMs();
+    QueuedBatch& queued = state.queued;
+    for (const ReceivedMessage& received : receivedMessages)
+    {
+        if (!authAccepted(received.auth))
+        {
+            std::cerr << "Unauthenticated GNSS data on " << received.topic << " rejected: "
+                      << authResultName(received.auth) << std::endl;
+            continue;
+        }
+
+        if (!unpackMessage(received, queued.batch))
+        {
+            continue;
+        }
+        if (!sourcesAuthorized(state.verifier, received, queued.batch))
+        {
+            std::cerr << "Merged batch on " << received.topic << " names a device with a key it may not forward, "
+                      << "rejected." << std::endl;
+            continue;
+        }
+
+        // Copies of unsequenced data are dropped by their hash. Sequenced batches are not: the (DEVICE, SEQ) index
+        // already stores them once and they are confirmed once stored, so a hash collision cannot lose one.
+        bool deduplicated = state.federated && !received.datagram && (queued.batch.firstSequence == 0);
+        if (deduplicated && state.duplicates.seen(received.topic, received.payload))
+        {
+            state.brokers.countDuplicate(received.broker);
+            continue;
+        }
+        if (received.datagram && (queued.batch.firstSequence != 0))
+        {
+            state.udpSequences.observe(queued.batch.deviceId, queued.batch.firstSequence,
+                                       queued.batch.sentences.size());
+        }
+        if (!received.datagram)
+        {
+            deviceBrokers[queued.batch.deviceId] = received.broker;
+        }
+
+        queued.broker = received.broker;
+        queued.datagram = received.datagram;
+        queued.receivedMs = receivedMs;
+
+        // Only a queued message is remembered, so the copy of one dropped on a full queue is still stored
+        if (queueBatch(state.tenants, state.tenantQueues, queued, nowUs) && deduplicated)
+        {
+            state.duplicates.remember(received.topic, received.payload);
+        }
+    }
+
+    receivedMessages.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Stores the batches picked by the tenant scheduler in a single transaction, confirms the sequenced ones once
+ *        durable and checks the stored fixes against the rules.
+ *
+ * The batches leave their queues only once committed; after a failed transaction they are stored again by a later
+ * call.
+ *
+ * @param state The receiver state.
+ *
+ * @return Fixes stored, 0 when the quotas hold the whole backlog back or the transaction failed.
+ **********************************************************************************************************************/
+static size_t storeBatches (ReceiverState& state)
+{
+    state.fixes.clear();
+    state.acks.clear();
+    state.uncommitted.clear();
+    size_t scheduled = state.tenants.schedule(TENANT_LOOP_FIXES, EventLoop::nowUs(), state.picks);
+    if (state.picks.empty())
+    {
+        return scheduled;
+    }
+
+    if (sqlite3_exec(state.db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(state.db) << std::endl;
+        state.tenants.completed(EventLoop::nowUs(), false);
+        return 0;
+    }
+    state.picked.assign(state.tenantQueues.size(), 0);
+    bool failed = false;
+    for (size_t tenant : state.picks)
+    {
+        QueuedBatch& next = state.tenantQueues[tenant][state.picked[tenant]++];
+        const PayloadBatch& batch = next.batch;
+
+        size_t repeated = 0;
+        for (size_t i = 0; !failed && (i < batch.sentences.size()); ++i)
+        {
+            const std::string& sentence = batch.sentences[i];
+            const std::string& deviceId = sentenceDevice(batch, i);
+
+            // Log the GNSS data
+            logGNSSData(sentence);
+
+            // Validate the NMEA format of the data
+            bool isValid = validateNMEAFormat(sentence);
+
+            // If the data is valid and new, store it in the SQLite database
+            if (isValid)
+            {
+                int64_t sequence = (batch.firstSequence != 0) ? (int64_t)(batch.firstSequence + i) : -1;
+                state.changeCapture.stage(sentence);
+                StoreResult stored = storeValidData(state.db, sentence, deviceId, sequence);
+                failed = (stored == STORE_ERROR);
+                repeated += (stored == STORE_DUPLICATE) ? 1 : 0;
+                if (stored != STORE_INSERTED)
+                {
+                    continue;
+                }
+
+                GNSSFix fix;
+                if (decodeGNSSData(deviceId, sentence, fix))
+                {
+                    state.uncommitted.push_back(std::make_pair(fix, next.receivedMs));
+                }
+            }
+        }
+
+        if ((batch.firstSequence != 0) && !next.datagram)
+        {
+            if (repeated == batch.sentences.size())
+            {
+                state.brokers.countDuplicate(next.broker);      // A copy, e.g. resent or from another broker
+            }
+            state.acks[std::make_pair(next.broker, batch.deviceId)] +=
+                std::to_string(batch.firstSequence + batch.sentences.size() - 1) + "\n";
+        }
+    }
+
+    // Confirm sequenced batches only once they are durable; unconfirmed batches are resent by the sender. SQLite would
+    // commit the other statements of a transaction in which one insert failed, so that one is rolled back instead.
+    bool committed = !failed && (sqlite3_exec(state.db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    state.tenants.completed(EventLoop::nowUs(), committed);
+    if (committed)
+    {
+        for (size_t tenant : state.picks)
+        {
+            state.tenantQueues[tenant].pop_front();
+        }
+        // Only committed fixes reach the reorder buffers, and through them the hot store, queries and rules
+        for (const auto& fix : state.uncommitted)
+        {
+            state.devices.hold(fix.first, fix.second);
+        }
+        state.changeCapture.committed();
+        publishCommitAcks(state.brokers, state.config.qos, state.acks);
+    }
+    else
+    {
+        if (!failed)
+        {
+            std::cerr << "SQL error: " << sqlite3_errmsg(state.db) << std::endl;
+        }
+        sqlite3_exec(state.db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+
+    if (releaseFixes(state) != INT64_MAX)
+    {
+        state.reorderWork.set();
+    }
+    return committed ? scheduled : 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands the fixes released by the reorder buffers to the hot store, the continuous queries and the rules.
+ *
+ * @param state The receiver state.
+ *
+ * @return Wall clock time at which the next held fix is due, INT64_MAX when none is held.
+ **********************************************************************************************************************/
+static int64_t releaseFixes (ReceiverState& state)
+{
+    state.fixes.clear();
+    int64_t nextMs = state.devices.release(wallClockMs(), state.fixes);
+    for (const GNSSFix& fix : state.fixes)
+    {
+        state.hotStore.append(fix);
+        state.latestFixMs = std::max(state.latestFixMs, fix.timestampMs);
+        state.subscriptions.match(fix);
+        if (state.config.proximity.nearM != 0.0)
+        {
+            state.proximity.update(fix);
+        }
+    }
+    if (!state.fixes.empty())
+    {
+        evaluateRules(state.brokers, state.rules, state.fixes);
+    }
+    return nextMs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The wall clock in milliseconds since the epoch, the clock of receive times and fix times.
+ **********************************************************************************************************************/
+static int64_t wallClockMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Drops the fixes that fell out of the retention window of the hot store, once per EVICTION_INTERVAL_S.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static void evictExpired (ReceiverState& state)
+{
+    int64_t retentionNowMs = state.config.fixClock ? state.latestFixMs : (int64_t)std::time(nullptr) * 1000;
+    if (retentionNowMs - state.lastEvictionMs >= EVICTION_INTERVAL_S * 1000)
+    {
+        state.hotStore.evictExpired(retentionNowMs);
+        state.lastEvictionMs = retentionNowMs;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Logs the statistics of the brokers and of the inputs, verification and tenants in use.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static void logReceiverStats (ReceiverState& state)
+{
+    logBrokerStats(state.brokers, tlsEnabled(state.config.tls));
+    if (state.udp.fd() >= 0)
+    {
+        logSequenceStats(state.udpSequences, state.udp);
+    }
+    if (state.verifier.enabled())
+    {
+        logAuthStats(state.verifier);
+    }
+    if (state.tenants.size() > 1)
+    {
+        logTenantStats(state.tenants);
+    }
+    logDeviceStats(state.devices);
+    if (state.config.proximity.nearM != 0.0)
+    {
+        logProximityStats(state.proximity);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task receiving from the brokers and the UDP input and queueing the accepted batches for the storage task.
+ *
+ * Sleeps on the epoll set of the broker pool, which also watches the UDP input, until a socket is ready or the pool
+ * has timed work such as a keep-alive or a reconnect.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task receiveTask (ReceiverState& state)
+{
+    while (running)
+    {
+        state.brokers.prepareWait();
+        co_await state.loop.readable(state.brokers.fd(),
+                                     std::max<int64_t>(state.brokers.nextDueMs() - EventLoop::nowUs() / 1000, 0));
+        state.brokers.run(0);
+        if (state.udp.fd() >= 0)
+        {
+            receiveDatagrams(state.udp);
+        }
+
+        if (!receivedMessages.empty())
+        {
+            queueReceived(state);
+            state.storeWork.set();
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task storing the queued batches, one transaction of at most TENANT_LOOP_FIXES fixes at a time.
+ *
+ * Between transactions of a backlog it lets the other tasks run, so new data keeps being received; a backlog held
+ * back by the quotas alone, or left by a failed transaction, is retried after TENANT_IDLE_WAIT_MS. Committed rows and
+ * updates are pushed at once.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task storeTask (ReceiverState& state)
+{
+    while (running)
+    {
+        co_await state.storeWork.wait();
+        while (state.tenants.backlog() > 0)
+        {
+            size_t scheduled = storeBatches(state);
+            pushSubscriptionUpdates(state.brokers, state.subscriptions);
+            state.changeCapture.service();
+            evictExpired(state);
+
+            // The receive task is already waiting, have its wait also end once the acks and pushes can be written
+            state.brokers.prepareWait();
+            if (state.tenants.backlog() == 0)
+            {
+                break;
+            }
+            if (scheduled > 0)
+            {
+                co_await state.loop.yield();
+            }
+            else
+            {
+                co_await state.loop.sleep(TENANT_IDLE_WAIT_MS);
+            }
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task releasing the fixes left in the reorder buffers once their watermarks pass, checking again at least every
+ *        LOOP_TIMEOUT_MS as the estimates move, and waiting for the storage task while none are held.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task reorderTask (ReceiverState& state)
+{
+    while (running)
+    {
+        co_await state.reorderWork.wait();
+        int64_t nextMs = releaseFixes(state);
+        while (nextMs != INT64_MAX)
+        {
+            co_await state.loop.sleep(std::clamp<int64_t>(nextMs - wallClockMs(), 1, LOOP_TIMEOUT_MS));
+            nextMs = releaseFixes(state);
+            pushSubscriptionUpdates(state.brokers, state.subscriptions);
+            state.brokers.prepareWait();
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task doing the periodic work every LOOP_TIMEOUT_MS: rule and key reloads requested by SIGHUP, coalesced pushes
+ *        to subscribed clients, the change stream and the retention of the hot store.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task serviceTask (ReceiverState& state)
+{
+    while (running)
+    {
+        co_await state.loop.sleep(LOOP_TIMEOUT_MS);
+
+        if (reloadRules.exchange(false))
+        {
+            loadRuleFile(state.rules, RULES_FILE);
+            if (std::ifstream(KEYS_FILE).good())
+            {
+                loadKeyFile(state.verifier, KEYS_FILE);
+            }
+        }
+        pushSubscriptionUpdates(state.brokers, state.subscriptions);
+        state.changeCapture.service();
+        evictExpired(state);
+        state.brokers.prepareWait();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task logging the statistics every STATS_INTERVAL_S.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task statsTask (ReceiverState& state)
+{
+    while (running)
+    {
+        co_await state.loop.sleep(STATS_INTERVAL_S * 1000);
+        logReceiverStats(state);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Task running the proximity step every PROXIMITY_STEP_MS over the latest positions, at the wall clock or with
+ *        "--clock fix" at the latest fix, and publishing its events.
+ *
+ * @param state The receiver state.
+ **********************************************************************************************************************/
+static Task proximityTask (ReceiverState& state)
+{
+    std::vector<ProximityEvent> events;
+    while (running)
+    {
+        co_await state.loop.sleep(PROXIMITY_STEP_MS);
+
+        events.clear();
+        state.proximity.step(state.config.fixClock ? state.latestFixMs : wallClockMs(), events);
+        if (!events.empty())
+        {
+            publishProximityEvents(state.brokers, state.proximity, events);
+            state.brokers.prepareWait();
+        }
+    }
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Entry point of the GNSS receiver application.
+ * 
+ * This function sets up signal handling, initializes the SQLite database, connects to the MQTT brokers, subscribes to
+ * the GNSS data topic on each of them, and runs the receiver tasks on the event loop until SIGINT or SIGTERM.
+ * 
+ * @param argc Argument count.
+ * @param argv Argument vector, see parseReceiverArgs().
+ * 
+ * @return Exit status code (0 for success, -1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    ReceiverState state;
+    ReceiverConfig& config = state.config;
+    if (!parseReceiverArgs(argc, argv, config))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--host H] [--port P] [--broker HOST:PORT]... [--qos 0|1|2]"
+                  << " [--client-id ID] [--embedded-broker PORT] [--udp ADDR:PORT] [--tls-ca FILE"
+                  << " [--tls-cert FILE --tls-key FILE] | --tls-psk HEX --tls-psk-identity ID]"
+                  << " [--tls-version tlsv1.2|tlsv1.3] [--tls-ciphers LIST] [--tls-ciphersuites LIST]"
+                  << " [--tls-resume 0|1] [--auth-workers N] [--log FILE|-] [--clock wall|fix]"
+                  << " [--proximity-m M [--proximity-clear-m M] [--convoy-s S]]" << std::endl;
+        return -1;
+    }
+
+    // Log statements only copy their arguments; the text is rendered by gnss_logdecode, or on stdout with "--log -"
+    if (!logOpen(config.logPath))
+    {
+        return -1;
+    }
+
+    // Set up signal handlers for SIGINT and SIGTERM
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    std::signal(SIGHUP, handle_reload);
+
+    // Run the broker in-process when no system broker is available; senders connect to this host on the given port.
+    // It is federated with the --broker list, if any.
+    MqttBroker broker;
+    if (config.embeddedBrokerPort != 0)
+    {
+        if (!broker.start((uint16_t)config.embeddedBrokerPort, "0.0.0.0"))
+        {
+            return -1;
+        }
+        LOG_INFO("Embedded broker listening on port {}", broker.port());
+        BrokerEndpoint local;
+        local.host = "127.0.0.1";
+        local.port = broker.port();
+        config.brokers.insert(config.brokers.begin(), local);
+    }
+    else if (config.brokers.empty())
+    {
+        BrokerEndpoint remote;
+        remote.host = config.host;
+        remote.port = config.port;
+        config.brokers.push_back(remote);
+    }
+
+    mosquitto_lib_init();
+
+    // Initialize SQLite database
+    state.db = initDatabase();
+    if (state.db == nullptr)
+    {
+        return -1; // Exit if the database initialization fails
+    }
+
+    // Stream committed rows to downstream consumers
+    if (!state.changeCapture.start(state.db))
+    {
+        std::cerr << "Change stream disabled." << std::endl;
+    }
+
+    // One client per broker, all served by the receive task. A fixed client ID keeps a persistent session on each
+    // broker, so the brokers queue QoS 1/2 data while the receiver is down.
+    SubscriptionEngine& subscriptions = state.subscriptions;
+    if (!state.brokers.start(config.brokers, config.clientId, config.clientId.empty(), config.tls,
+                             BrokerConnectHandler(),
+                             [&subscriptions](size_t source, const struct mosquitto_message* message)
+                             { on_message(source, message, subscriptions); }))
+    {
+        return -1;
+    }
+
+    // Subscribe to "gnss/data", the per-device topics "gnss/data/<device>" and continuous query requests
+    // "gnss/subscribe/<client>" on every broker, again after each reconnect
+    state.brokers.subscribe("gnss/data/#", config.qos);
+    state.brokers.subscribe(SUBSCRIBE_TOPIC_PREFIX "+", QOS_LEVEL);
+
+    // A broker that is down is retried in the background, but at least one must be reachable
+    std::time_t connectDeadline = std::time(nullptr) + CONNECT_TIMEOUT_MS / 1000;
+    while (!state.brokers.connected() && (std::time(nullptr) < connectDeadline))
+    {
+        state.brokers.run(LOOP_TIMEOUT_MS);
+    }
+    if (!state.brokers.connected())
+    {
+        std::cerr << "Unable to connect to MQTT broker!" << std::endl;
+        return -1;
+    }
+
+    // Copies of a message arriving over several brokers are dropped, e.g. from a sender that failed over
+    state.federated = (state.brokers.size() > 1);
+
+    // Payloads of devices listed in the key file must carry a valid HMAC tag; without the file nothing is checked
+    if (!state.verifier.start(config.authWorkers) ||
+        (std::ifstream(KEYS_FILE).good() && !loadKeyFile(state.verifier, KEYS_FILE)))
+    {
+        return -1;
+    }
+
+    // Business rules evaluated against every batch of fixes
+    loadRuleFile(state.rules, RULES_FILE);
+
+    // Keep the last day of fixes in memory, compressed in the background. The day ends at the wall clock, or with
+    // "--clock fix" at the latest fix stored, so a simulated fleet ages its data at the pace of the simulation.
+    state.lastEvictionMs = config.fixClock ? 0 : (int64_t)std::time(nullptr) * 1000;
+
+    // Optional UDP input for trusted local senders, with loss detection on the batch sequence numbers
+    if (!config.udpListen.empty())
+    {
+        std::string address;
+        uint16_t port;
+        parseHostPort(config.udpListen, address, port);
+        if (!state.udp.open(port, address))
+        {
+            return -1;
+        }
+        LOG_INFO("UDP input listening on {}:{}", address, state.udp.port());
+        if (!state.brokers.watch(state.udp.fd()))
+        {
+            return -1;
+        }
+    }
+
+    // Accepted batches wait in one queue per tenant and are stored in weighted fair order, so a burst of one fleet,
+    // e.g. a store-and-forward catch-up, cannot hold back the live data of the others
+    if (std::ifstream(TENANTS_FILE).good() && !loadTenantFile(state.tenants, TENANTS_FILE))
+    {
+        return -1;
+    }
+    state.tenantQueues.resize(state.tenants.size());
+
+    // Receiving, storing, the periodic work and the statistics are tasks of one event loop on this thread; each sleeps
+    // until its socket, its work or its timer is ready
+    state.loop.spawn(receiveTask(state));
+    state.loop.spawn(storeTask(state));
+    state.loop.spawn(reorderTask(state));
+    state.loop.spawn(serviceTask(state));
+    state.loop.spawn(statsTask(state));
+    if (config.proximity.nearM != 0.0)
+    {
+        state.proximity.configure(config.proximity);
+        state.loop.spawn(proximityTask(state));
+    }
+    state.loop.run(running);
+
+    LOG_TRACE("Signal received, shutting down...");
+    logHotStoreStats(state.hotStore);
+    logReceiverStats(state);
 
     // Cleanup
-    sqlite3_close(db);
-    mosquitto_destroy(mosq);
+    state.verifier.stop();
+    state.changeCapture.stop();
+    sqlite3_finalize(insertStatement);
+    sqlite3_close(state.db);
+    state.brokers.stop();
     mosquitto_lib_cleanup();
+    broker.stop();
+    logClose();
 
     return 0;
 }
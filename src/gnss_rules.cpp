@@ -0,0 +1,1113 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_rules.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <cstring>
+#include <cstdio>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define KNOTS_TO_KMH            (1.852)           /* One knot in km/h */
+#define EARTH_RADIUS_M          (6371000.0)       /* Mean Earth radius in metres */
+#define SECONDS_PER_DAY         (86400LL)
+#define DEG_TO_RAD              (0.017453292519943295)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Recursive descent compiler of one rule expression into nodes of the shared program. */
+class RuleCompiler
+{
+public:
+    RuleCompiler(const std::string& text, RuleSet& set, std::map<std::string, uint32_t>& interned)
+        : text(text), pos(0), set(set), interned(interned)
+    {
+    }
+
+    bool compile(uint32_t& root, std::string& error);
+
+private:
+    bool parseOr(uint32_t& node);
+    bool parseAnd(uint32_t& node);
+    bool parseNot(uint32_t& node);
+    bool parseComparison(uint32_t& node);
+    bool parseAdditive(uint32_t& node);
+    bool parseMultiplicative(uint32_t& node);
+    bool parseUnary(uint32_t& node);
+    bool parsePrimary(uint32_t& node);
+    bool accept(const char* token);
+    std::string peekWord();
+    void advance(const std::string& word);
+    uint32_t emit(RuleOp op, uint32_t a, uint32_t b, double imm);
+    uint32_t emitBinary(RuleOp op, uint32_t a, uint32_t b);
+    uint32_t toMask(uint32_t node);
+    uint32_t toNumber(uint32_t node);
+    bool fail(const std::string& message);
+
+    const std::string& text;
+    size_t pos;
+    RuleSet& set;
+    std::map<std::string, uint32_t>& interned;    /* Node key to node index, shared by all rules of the set */
+    std::string message;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static const char* const fieldNames[RULE_FIELD_COUNT] =
+{
+    "speed", "knots", "course", "lat", "lon", "hour", "weekday", "dt", "prev_speed", "accel", "distance"
+};
+
+static std::string trim(const std::string& value);
+static double foldConstant(RuleOp op, double a, double b);
+static void pruneNodes(RuleSet& set);
+static void allocateSlots(RuleSet& set);
+static bool readsOperandA(uint8_t op);
+static bool readsOperandB(const RuleNode& node);
+
+/*******************************************************************************************************************//**
+ * @brief Applies a binary operation element-wise over a batch, with either a column or an immediate right operand.
+ **********************************************************************************************************************/
+template <typename Fn>
+static inline void applyBinary (double* __restrict out, const double* __restrict a, const double* __restrict b,
+                                double imm, size_t n, Fn fn)
+{
+    if (b != nullptr)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = fn(a[i], b[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = fn(a[i], imm);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sets one bit per fix where the comparison of a with b (or with imm when b is null) holds.
+ **********************************************************************************************************************/
+template <typename Cmp>
+static inline void compareToMask (uint64_t* __restrict out, const double* __restrict a, const double* __restrict b,
+                                  double imm, size_t n, Cmp cmp)
+{
+    for (size_t base = 0; base < n; base += 64)
+    {
+        size_t count = std::min((size_t)64, n - base);
+        uint64_t word = 0;
+        if (b != nullptr)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                word |= (uint64_t)cmp(a[base + j], b[base + j]) << j;
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                word |= (uint64_t)cmp(a[base + j], imm) << j;
+            }
+        }
+        out[base / 64] = word;
+    }
+}
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Compiles the text of a rule file.
+ *
+ * One statement per line, '#' starts a comment:
+ *   - "utc_offset <hours>" sets the time zone of the hour and weekday fields.
+ *   - "zone <name> <minLat> <minLon> <maxLat> <maxLon>" declares a rectangle usable as in_zone(<name>).
+ *   - "rule <name>: <expression>" declares a rule that matches when the expression is true (non-zero).
+ * Expressions combine the fields (speed, knots, course, lat, lon, hour, weekday, dt, prev_speed, accel, distance),
+ * numbers and in_zone() with arithmetic, comparisons and and/or/not.
+ *
+ * @param text The rule file contents.
+ * @param error Set to a description of the first problem found.
+ *
+ * @return The compiled rule set, or nullptr on error.
+ **********************************************************************************************************************/
+std::shared_ptr<RuleSet> compileRules (const std::string& text, std::string& error)
+{
+    std::shared_ptr<RuleSet> set = std::make_shared<RuleSet>();
+    std::map<std::string, uint32_t> interned;
+    set->utcOffsetHours = 0;
+
+    // First pass collects zones and settings so rules may refer to zones declared further down
+    std::vector<std::pair<int, std::string>> ruleLines;
+    std::istringstream lines(text);
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(lines, line))
+    {
+        ++lineNo;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string keyword;
+        fields >> keyword;
+        if (keyword == "zone")
+        {
+            RuleZone zone;
+            if (!(fields >> zone.name >> zone.minLat >> zone.minLon >> zone.maxLat >> zone.maxLon))
+            {
+                error = "line " + std::to_string(lineNo) + ": malformed zone";
+                return nullptr;
+            }
+            set->zones.push_back(zone);
+        }
+        else if (keyword == "utc_offset")
+        {
+            if (!(fields >> set->utcOffsetHours) || (set->utcOffsetHours < -12) || (set->utcOffsetHours > 14))
+            {
+                error = "line " + std::to_string(lineNo) + ": malformed utc_offset";
+                return nullptr;
+            }
+        }
+        else if (keyword == "rule")
+        {
+            ruleLines.push_back(std::make_pair(lineNo, line.substr(4)));
+        }
+        else
+        {
+            error = "line " + std::to_string(lineNo) + ": unknown statement '" + keyword + "'";
+            return nullptr;
+        }
+    }
+
+    for (const auto& entry : ruleLines)
+    {
+        size_t colon = entry.second.find(':');
+        CompiledRule rule;
+        rule.name = trim(entry.second.substr(0, colon));
+        if ((colon == std::string::npos) || rule.name.empty())
+        {
+            error = "line " + std::to_string(entry.first) + ": expected 'rule <name>: <expression>'";
+            return nullptr;
+        }
+
+        std::string expression = entry.second.substr(colon + 1);
+        RuleCompiler compiler(expression, *set, interned);
+        std::string message;
+        if (!compiler.compile(rule.root, message))
+        {
+            error = "line " + std::to_string(entry.first) + ": " + message;
+            return nullptr;
+        }
+
+        set->roots.push_back(std::make_pair(rule.root, (uint32_t)set->rules.size()));
+        set->rules.push_back(rule);
+    }
+
+    pruneNodes(*set);
+    allocateSlots(*set);
+    return set;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates an engine without rules.
+ **********************************************************************************************************************/
+RuleEngine::RuleEngine ()
+{
+    std::shared_ptr<RuleSet> empty = std::make_shared<RuleSet>();
+    empty->utcOffsetHours = 0;
+    empty->numberSlots = 0;
+    empty->maskSlots = 0;
+    ruleSet = empty;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Compiles rules and atomically replaces the active rule set.
+ *
+ * The previous rule set stays active if the text does not compile. Evaluations running concurrently finish with the
+ * rule set they started with.
+ *
+ * @param text The rule file contents.
+ * @param error Set to a description of the problem on failure.
+ *
+ * @return True if the new rules are active, false otherwise.
+ **********************************************************************************************************************/
+bool RuleEngine::load (const std::string& text, std::string& error)
+{
+    std::shared_ptr<const RuleSet> compiled = compileRules(text, error);
+    if (!compiled)
+    {
+        return false;
+    }
+
+    std::atomic_store(&ruleSet, compiled);
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a rule file and activates it with load().
+ *
+ * @param path Path of the rule file.
+ * @param error Set to a description of the problem on failure.
+ *
+ * @return True if the new rules are active, false otherwise.
+ **********************************************************************************************************************/
+bool RuleEngine::loadFile (const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return load(contents.str(), error);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Returns the active rule set.
+ **********************************************************************************************************************/
+std::shared_ptr<const RuleSet> RuleEngine::current () const
+{
+    return std::atomic_load(&ruleSet);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Evaluates the active rules against a batch of fixes.
+ *
+ * The per-device state is advanced by every fix of the batch in order, so derived fields such as accel and distance
+ * are computed against the preceding fix even within the same batch.
+ *
+ * @param fixes The batch of fixes.
+ * @param matches Output list of (rule, fix) pairs that matched.
+ * @param rules Set to the rule set used, for looking up rule names.
+ *
+ * @return Number of matches.
+ **********************************************************************************************************************/
+size_t RuleEngine::evaluate (const std::vector<GNSSFix>& fixes, std::vector<RuleMatch>& matches,
+                             std::shared_ptr<const RuleSet>& rules)
+{
+    rules = current();
+    matches.clear();
+
+    const size_t n = fixes.size();
+    extractFields(fixes, rules->utcOffsetHours);
+    if ((n == 0) || rules->rules.empty())
+    {
+        return 0;
+    }
+
+    const std::vector<RuleNode>& nodes = rules->nodes;
+    const size_t words = (n + 63) / 64;
+    values.resize((size_t)rules->numberSlots * n);
+    masks.resize((size_t)rules->maskSlots * words);
+    numbers.resize(nodes.size());
+    bits.resize(nodes.size());
+    auto root = rules->roots.begin();
+
+    const double* lat = columns[RULE_FIELD_LAT].data();
+    const double* lon = columns[RULE_FIELD_LON].data();
+
+    for (size_t k = 0; k < nodes.size(); ++k)
+    {
+        const RuleNode& node = nodes[k];
+        if (node.op == RULE_OP_FIELD)
+        {
+            numbers[k] = columns[node.a].data();
+            continue;
+        }
+
+        if (!isPredicateOp(node.op))
+        {
+            double* out = &values[(size_t)node.slot * n];
+            numbers[k] = out;
+            const double* a = (node.op == RULE_OP_CONST) ? nullptr : numbers[node.a];
+            const double* b = ((node.op > RULE_OP_DIV) || (node.b == RULE_NODE_IMM)) ? nullptr : numbers[node.b];
+
+            switch (node.op)
+            {
+                case RULE_OP_CONST: std::fill(out, out + n, node.imm); break;
+                case RULE_OP_ADD: applyBinary(out, a, b, node.imm, n, [](double x, double y) { return x + y; }); break;
+                case RULE_OP_SUB: applyBinary(out, a, b, node.imm, n, [](double x, double y) { return x - y; }); break;
+                case RULE_OP_MUL: applyBinary(out, a, b, node.imm, n, [](double x, double y) { return x * y; }); break;
+                case RULE_OP_DIV: applyBinary(out, a, b, node.imm, n, [](double x, double y) { return x / y; }); break;
+                case RULE_OP_NEG: for (size_t i = 0; i < n; ++i) out[i] = -a[i]; break;
+                case RULE_OP_TO_NUM:
+                {
+                    const uint64_t* m = bits[node.a];
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        out[i] = (double)((m[i / 64] >> (i % 64)) & 1U);
+                    }
+                    break;
+                }
+                default: break;
+            }
+            continue;
+        }
+
+        uint64_t* out = &masks[(size_t)node.slot * words];
+        bits[k] = out;
+        const double* a = ((node.op == RULE_OP_IN_ZONE) || (node.op >= RULE_OP_AND && node.op <= RULE_OP_NOT))
+                          ? nullptr : numbers[node.a];
+        const double* b = ((node.op < RULE_OP_LT) || (node.op > RULE_OP_NE) || (node.b == RULE_NODE_IMM))
+                          ? nullptr : numbers[node.b];
+
+        switch (node.op)
+        {
+            case RULE_OP_IN_ZONE:
+            {
+                const RuleZone& z = rules->zones[node.a];
+                compareToMask(out, lat, lon, 0.0, n, [&z](double y, double x)
+                {
+                    return (y >= z.minLat) & (y <= z.maxLat) & (x >= z.minLon) & (x <= z.maxLon);
+                });
+                break;
+            }
+            case RULE_OP_LT: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x < y; }); break;
+            case RULE_OP_LE: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x <= y; }); break;
+            case RULE_OP_GT: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x > y; }); break;
+            case RULE_OP_GE: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x >= y; }); break;
+            case RULE_OP_EQ: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x == y; }); break;
+            case RULE_OP_NE: compareToMask(out, a, b, node.imm, n, [](double x, double y) { return x != y; }); break;
+            case RULE_OP_TO_MASK:
+                compareToMask(out, a, nullptr, 0.0, n, [](double x, double y) { return x != y; });
+                break;
+            case RULE_OP_AND:
+                for (size_t w = 0; w < words; ++w) out[w] = bits[node.a][w] & bits[node.b][w];
+                break;
+            case RULE_OP_OR:
+                for (size_t w = 0; w < words; ++w) out[w] = bits[node.a][w] | bits[node.b][w];
+                break;
+            case RULE_OP_NOT:
+                for (size_t w = 0; w < words; ++w) out[w] = ~bits[node.a][w];
+                break;
+            default: break;
+        }
+
+        // Collect the matches of rules ending here before the slot is reused
+        for (; (root != rules->roots.end()) && (root->first == k); ++root)
+        {
+            for (size_t w = 0; w < words; ++w)
+            {
+                uint64_t word = out[w];
+                if ((w == words - 1) && (n % 64 != 0))
+                {
+                    word &= (1ULL << (n % 64)) - 1;     // Bits past the end of the batch
+                }
+                while (word != 0)
+                {
+                    RuleMatch match;
+                    match.rule = root->second;
+                    match.fix = (uint32_t)(w * 64 + __builtin_ctzll(word));
+                    matches.push_back(match);
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    return matches.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tells whether an operation produces a bit mask rather than a numeric column.
+ **********************************************************************************************************************/
+bool isPredicateOp (uint8_t op)
+{
+    return op >= RULE_OP_IN_ZONE;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Fills the field columns for a batch and advances the per-device state.
+ **********************************************************************************************************************/
+void RuleEngine::extractFields (const std::vector<GNSSFix>& fixes, int utcOffsetHours)
+{
+    const size_t n = fixes.size();
+    for (std::vector<double>& column : columns)
+    {
+        column.resize(n);
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const GNSSFix& fix = fixes[i];
+        double speedKmh = fix.speedKnots * KNOTS_TO_KMH;
+        int64_t localS = fix.timestampMs / 1000 + (int64_t)utcOffsetHours * 3600;
+        int64_t secondOfDay = ((localS % SECONDS_PER_DAY) + SECONDS_PER_DAY) % SECONDS_PER_DAY;
+        int64_t day = (localS - secondOfDay) / SECONDS_PER_DAY;
+
+        columns[RULE_FIELD_SPEED][i] = speedKmh;
+        columns[RULE_FIELD_KNOTS][i] = fix.speedKnots;
+        columns[RULE_FIELD_COURSE][i] = fix.course;
+        columns[RULE_FIELD_LAT][i] = fix.latitude;
+        columns[RULE_FIELD_LON][i] = fix.longitude;
+        columns[RULE_FIELD_HOUR][i] = (double)(secondOfDay / 3600);
+        columns[RULE_FIELD_WEEKDAY][i] = (double)(((day + 4) % 7 + 7) % 7);    // 1970-01-01 was a Thursday
+
+        auto it = devices.find(fix.deviceId);
+        if (it == devices.end())
+        {
+            columns[RULE_FIELD_DT][i] = 0.0;
+            columns[RULE_FIELD_PREV_SPEED][i] = speedKmh;
+            columns[RULE_FIELD_ACCEL][i] = 0.0;
+            columns[RULE_FIELD_DISTANCE][i] = 0.0;
+            it = devices.insert(std::make_pair(fix.deviceId, DeviceState())).first;
+        }
+        else
+        {
+            const DeviceState& prev = it->second;
+            double dt = (fix.timestampMs - prev.timestampMs) / 1000.0;
+            double meanLat = (fix.latitude + prev.latitude) * 0.5 * DEG_TO_RAD;
+            double dx = (fix.longitude - prev.longitude) * DEG_TO_RAD * std::cos(meanLat);
+            double dy = (fix.latitude - prev.latitude) * DEG_TO_RAD;
+
+            columns[RULE_FIELD_DT][i] = dt;
+            columns[RULE_FIELD_PREV_SPEED][i] = prev.speedKmh;
+            columns[RULE_FIELD_ACCEL][i] = (dt > 0.0) ? (speedKmh - prev.speedKmh) / dt : 0.0;
+            columns[RULE_FIELD_DISTANCE][i] = EARTH_RADIUS_M * std::sqrt(dx * dx + dy * dy);
+        }
+
+        DeviceState& state = it->second;
+        state.timestampMs = fix.timestampMs;
+        state.latitude = fix.latitude;
+        state.longitude = fix.longitude;
+        state.speedKmh = speedKmh;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Compiles the whole expression and checks that no input is left over.
+ *
+ * @param root Output node holding the result of the expression.
+ * @param error Set to a description of the first problem found.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool RuleCompiler::compile (uint32_t& root, std::string& error)
+{
+    bool ok = parseOr(root);
+    if (ok)
+    {
+        root = toMask(root);
+    }
+    if (ok && !peekWord().empty())
+    {
+        ok = fail("unexpected '" + peekWord() + "'");
+    }
+    if (!message.empty())
+    {
+        ok = false;
+    }
+
+    error = message;
+    return ok;
+}
+
+bool RuleCompiler::parseOr (uint32_t& node)
+{
+    if (!parseAnd(node))
+    {
+        return false;
+    }
+    while (accept("or") || accept("||"))
+    {
+        uint32_t rhs;
+        if (!parseAnd(rhs))
+        {
+            return false;
+        }
+        node = emitBinary(RULE_OP_OR, node, rhs);
+    }
+    return true;
+}
+
+bool RuleCompiler::parseAnd (uint32_t& node)
+{
+    if (!parseNot(node))
+    {
+        return false;
+    }
+    while (accept("and") || accept("&&"))
+    {
+        uint32_t rhs;
+        if (!parseNot(rhs))
+        {
+            return false;
+        }
+        node = emitBinary(RULE_OP_AND, node, rhs);
+    }
+    return true;
+}
+
+bool RuleCompiler::parseNot (uint32_t& node)
+{
+    if (accept("not") || accept("!"))
+    {
+        if (!parseNot(node))
+        {
+            return false;
+        }
+        node = (set.nodes[node].op == RULE_OP_CONST)
+               ? emit(RULE_OP_CONST, 0, 0, (set.nodes[node].imm == 0.0) ? 1.0 : 0.0)
+               : emit(RULE_OP_NOT, toMask(node), 0, 0.0);
+        return true;
+    }
+    return parseComparison(node);
+}
+
+bool RuleCompiler::parseComparison (uint32_t& node)
+{
+    static const struct { const char* token; RuleOp op; } operators[] =
+    {
+        { "<=", RULE_OP_LE }, { ">=", RULE_OP_GE }, { "==", RULE_OP_EQ }, { "!=", RULE_OP_NE },
+        { "<", RULE_OP_LT }, { ">", RULE_OP_GT }
+    };
+
+    if (!parseAdditive(node))
+    {
+        return false;
+    }
+    for (const auto& entry : operators)
+    {
+        if (accept(entry.token))
+        {
+            uint32_t rhs;
+            if (!parseAdditive(rhs))
+            {
+                return false;
+            }
+            node = emitBinary(entry.op, node, rhs);
+            break;
+        }
+    }
+    return true;
+}
+
+bool RuleCompiler::parseAdditive (uint32_t& node)
+{
+    if (!parseMultiplicative(node))
+    {
+        return false;
+    }
+    while (true)
+    {
+        RuleOp op;
+        if (accept("+"))
+        {
+            op = RULE_OP_ADD;
+        }
+        else if (accept("-"))
+        {
+            op = RULE_OP_SUB;
+        }
+        else
+        {
+            return true;
+        }
+
+        uint32_t rhs;
+        if (!parseMultiplicative(rhs))
+        {
+            return false;
+        }
+        node = emitBinary(op, node, rhs);
+    }
+}
+
+bool RuleCompiler::parseMultiplicative (uint32_t& node)
+{
+    if (!parseUnary(node))
+    {
+        return false;
+    }
+    while (true)
+    {
+        RuleOp op;
+        if (accept("*"))
+        {
+            op = RULE_OP_MUL;
+        }
+        else if (accept("/"))
+        {
+            op = RULE_OP_DIV;
+        }
+        else
+        {
+            return true;
+        }
+
+        uint32_t rhs;
+        if (!parseUnary(rhs))
+        {
+            return false;
+        }
+        node = emitBinary(op, node, rhs);
+    }
+}
+
+bool RuleCompiler::parseUnary (uint32_t& node)
+{
+    if (accept("-"))
+    {
+        if (!parseUnary(node))
+        {
+            return false;
+        }
+        node = (set.nodes[node].op == RULE_OP_CONST)
+               ? emit(RULE_OP_CONST, 0, 0, -set.nodes[node].imm)
+               : emit(RULE_OP_NEG, toNumber(node), 0, 0.0);
+        return true;
+    }
+    return parsePrimary(node);
+}
+
+bool RuleCompiler::parsePrimary (uint32_t& node)
+{
+    if (accept("("))
+    {
+        if (!parseOr(node))
+        {
+            return false;
+        }
+        return accept(")") || fail("expected ')'");
+    }
+
+    std::string word = peekWord();
+    if (word.empty())
+    {
+        return fail("unexpected end of expression");
+    }
+
+    if (std::isdigit((unsigned char)word[0]) || (word[0] == '.'))
+    {
+        char* end = nullptr;
+        double value = std::strtod(word.c_str(), &end);
+        if (*end != '\0')
+        {
+            return fail("malformed number '" + word + "'");
+        }
+        advance(word);
+        node = emit(RULE_OP_CONST, 0, 0, value);
+        return true;
+    }
+
+    if (accept("in_zone"))
+    {
+        if (!accept("("))
+        {
+            return fail("expected '(' after in_zone");
+        }
+        std::string name = peekWord();
+        advance(name);
+        for (size_t z = 0; z < set.zones.size(); ++z)
+        {
+            if (set.zones[z].name == name)
+            {
+                node = emit(RULE_OP_IN_ZONE, (uint32_t)z, 0, 0.0);
+                return accept(")") || fail("expected ')' after zone name");
+            }
+        }
+        return fail("unknown zone '" + name + "'");
+    }
+
+    for (int f = 0; f < RULE_FIELD_COUNT; ++f)
+    {
+        if (word == fieldNames[f])
+        {
+            advance(word);
+            node = emit(RULE_OP_FIELD, (uint32_t)f, 0, 0.0);
+            return true;
+        }
+    }
+
+    return fail("unknown field '" + word + "'");
+}
+
+/*******************************************************************************************************************//**
+ * @brief Consumes the token if it is next in the input. Word tokens must match a whole identifier.
+ **********************************************************************************************************************/
+bool RuleCompiler::accept (const char* token)
+{
+    while ((pos < text.size()) && std::isspace((unsigned char)text[pos]))
+    {
+        ++pos;
+    }
+
+    size_t len = std::strlen(token);
+    if (text.compare(pos, len, token) != 0)
+    {
+        return false;
+    }
+
+    bool word = std::isalpha((unsigned char)token[0]) != 0;
+    if (word && (pos + len < text.size()) && (std::isalnum((unsigned char)text[pos + len]) || (text[pos + len] == '_')))
+    {
+        return false;
+    }
+
+    pos += len;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Returns the next identifier, number or operator without consuming it.
+ **********************************************************************************************************************/
+std::string RuleCompiler::peekWord ()
+{
+    size_t start = pos;
+    while ((start < text.size()) && std::isspace((unsigned char)text[start]))
+    {
+        ++start;
+    }
+
+    size_t end = start;
+    while ((end < text.size()) && (std::isalnum((unsigned char)text[end]) || (text[end] == '_') || (text[end] == '.')))
+    {
+        ++end;
+    }
+    if ((end == start) && (end < text.size()))
+    {
+        ++end;  // Single operator character
+    }
+
+    return text.substr(start, end - start);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Consumes a word previously returned by peekWord().
+ **********************************************************************************************************************/
+void RuleCompiler::advance (const std::string& word)
+{
+    while ((pos < text.size()) && std::isspace((unsigned char)text[pos]))
+    {
+        ++pos;
+    }
+    pos += word.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Returns the node computing the given operation, adding it to the program unless an identical node exists.
+ **********************************************************************************************************************/
+uint32_t RuleCompiler::emit (RuleOp op, uint32_t a, uint32_t b, double imm)
+{
+    char key[64];
+    std::snprintf(key, sizeof(key), "%d:%u:%u:%a", (int)op, a, b, imm);
+
+    auto it = interned.find(key);
+    if (it != interned.end())
+    {
+        return it->second;
+    }
+
+    if (set.nodes.size() >= RULES_MAX_NODES)
+    {
+        fail("rule set too large");
+        return 0;
+    }
+
+    RuleNode node;
+    node.op = (uint8_t)op;
+    node.a = a;
+    node.b = b;
+    node.imm = imm;
+    set.nodes.push_back(node);
+
+    uint32_t index = (uint32_t)(set.nodes.size() - 1);
+    interned[key] = index;
+    return index;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Emits a binary operation, folding constants, turning constant operands into immediates and converting
+ *        operands between numbers and predicates as the operation requires.
+ **********************************************************************************************************************/
+uint32_t RuleCompiler::emitBinary (RuleOp op, uint32_t a, uint32_t b)
+{
+    const bool logical = (op == RULE_OP_AND) || (op == RULE_OP_OR);
+    const bool lhsConst = (set.nodes[a].op == RULE_OP_CONST);
+    const bool rhsConst = (set.nodes[b].op == RULE_OP_CONST);
+
+    if (lhsConst && rhsConst)
+    {
+        return emit(RULE_OP_CONST, 0, 0, foldConstant(op, set.nodes[a].imm, set.nodes[b].imm));
+    }
+
+    if (logical)
+    {
+        if (lhsConst)
+        {
+            std::swap(a, b);
+        }
+        if (set.nodes[b].op == RULE_OP_CONST)
+        {
+            // "x and true" is x, "x or false" is x, the other two are constant
+            bool truth = (set.nodes[b].imm != 0.0);
+            if (truth == (op == RULE_OP_AND))
+            {
+                return toMask(a);
+            }
+            return toMask(b);
+        }
+        return emit(op, toMask(a), toMask(b), 0.0);
+    }
+
+    a = toNumber(a);
+    b = toNumber(b);
+    if (rhsConst)
+    {
+        return emit(op, a, RULE_NODE_IMM, set.nodes[b].imm);
+    }
+    if (lhsConst)
+    {
+        // Move the constant to the right where the operation allows it
+        RuleOp swapped = op;
+        switch (op)
+        {
+            case RULE_OP_LT: swapped = RULE_OP_GT; break;
+            case RULE_OP_LE: swapped = RULE_OP_GE; break;
+            case RULE_OP_GT: swapped = RULE_OP_LT; break;
+            case RULE_OP_GE: swapped = RULE_OP_LE; break;
+            case RULE_OP_SUB:
+            case RULE_OP_DIV: return emit(op, a, b, 0.0);
+            default: break;
+        }
+        return emit(swapped, b, RULE_NODE_IMM, set.nodes[a].imm);
+    }
+
+    return emit(op, a, b, 0.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Returns a predicate node for the given node, converting numbers with "!= 0".
+ **********************************************************************************************************************/
+uint32_t RuleCompiler::toMask (uint32_t node)
+{
+    return isPredicateOp(set.nodes[node].op) ? node : emit(RULE_OP_TO_MASK, node, 0, 0.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Returns a numeric node for the given node, converting predicates to 1 or 0.
+ **********************************************************************************************************************/
+uint32_t RuleCompiler::toNumber (uint32_t node)
+{
+    return isPredicateOp(set.nodes[node].op) ? emit(RULE_OP_TO_NUM, node, 0, 0.0) : node;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Records the first compile error.
+ *
+ * @return Always false.
+ **********************************************************************************************************************/
+bool RuleCompiler::fail (const std::string& text)
+{
+    if (message.empty())
+    {
+        message = text;
+    }
+    return false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes nodes no rule depends on, such as constants that were folded into immediates.
+ **********************************************************************************************************************/
+static void pruneNodes (RuleSet& set)
+{
+    const uint32_t count = (uint32_t)set.nodes.size();
+    std::vector<bool> live(count, false);
+    for (const CompiledRule& rule : set.rules)
+    {
+        live[rule.root] = true;
+    }
+
+    // Operands always precede their readers, so one backward pass finds every live node
+    for (uint32_t k = count; k-- > 0; )
+    {
+        if (live[k])
+        {
+            const RuleNode& node = set.nodes[k];
+            if (readsOperandA(node.op))
+            {
+                live[node.a] = true;
+            }
+            if (readsOperandB(node))
+            {
+                live[node.b] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> remap(count);
+    std::vector<RuleNode> kept;
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        if (live[k])
+        {
+            RuleNode node = set.nodes[k];
+            if (readsOperandA(node.op))
+            {
+                node.a = remap[node.a];
+            }
+            if (readsOperandB(node))
+            {
+                node.b = remap[node.b];
+            }
+            remap[k] = (uint32_t)kept.size();
+            kept.push_back(node);
+        }
+    }
+
+    set.nodes.swap(kept);
+    for (CompiledRule& rule : set.rules)
+    {
+        rule.root = remap[rule.root];
+    }
+    for (auto& root : set.roots)
+    {
+        root.first = remap[root.first];
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tells whether an operation reads node a.
+ **********************************************************************************************************************/
+static bool readsOperandA (uint8_t op)
+{
+    return (op != RULE_OP_FIELD) && (op != RULE_OP_CONST) && (op != RULE_OP_IN_ZONE);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tells whether a node reads node b.
+ **********************************************************************************************************************/
+static bool readsOperandB (const RuleNode& node)
+{
+    bool binary = ((node.op >= RULE_OP_ADD) && (node.op <= RULE_OP_DIV)) ||
+                  ((node.op >= RULE_OP_LT) && (node.op <= RULE_OP_OR));
+    return binary && (node.b != RULE_NODE_IMM);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Assigns scratch columns to nodes so that a column is reused as soon as its node has been read for the last
+ *        time. This keeps the working set of a batch in cache however many rules there are.
+ **********************************************************************************************************************/
+static void allocateSlots (RuleSet& set)
+{
+    const uint32_t count = (uint32_t)set.nodes.size();
+    std::vector<uint32_t> lastUse(count);
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        lastUse[k] = k;     // Rule results are consumed right after they are computed
+    }
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        const RuleNode& node = set.nodes[k];
+        if (readsOperandA(node.op))
+        {
+            lastUse[node.a] = k;
+        }
+        if (readsOperandB(node))
+        {
+            lastUse[node.b] = k;
+        }
+    }
+
+    std::vector<uint32_t> freeSlots[2];
+    std::vector<std::vector<std::pair<bool, uint32_t>>> releases(count);
+    uint32_t* slotCount[2] = { &set.numberSlots, &set.maskSlots };
+    set.numberSlots = 0;
+    set.maskSlots = 0;
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        RuleNode& node = set.nodes[k];
+        if (node.op != RULE_OP_FIELD)
+        {
+            bool mask = isPredicateOp(node.op);
+            if (freeSlots[mask].empty())
+            {
+                node.slot = (*slotCount[mask])++;
+            }
+            else
+            {
+                node.slot = freeSlots[mask].back();
+                freeSlots[mask].pop_back();
+            }
+            releases[lastUse[k]].push_back(std::make_pair(mask, node.slot));
+        }
+
+        // Operands read for the last time by this node release their columns after it ran
+        for (const auto& release : releases[k])
+        {
+            freeSlots[release.first].push_back(release.second);
+        }
+    }
+
+    std::sort(set.roots.begin(), set.roots.end());
+}
+
+/*******************************************************************************************************************//**
+ * @brief Evaluates a binary operation on two constants at compile time.
+ **********************************************************************************************************************/
+static double foldConstant (RuleOp op, double a, double b)
+{
+    switch (op)
+    {
+        case RULE_OP_ADD: return a + b;
+        case RULE_OP_SUB: return a - b;
+        case RULE_OP_MUL: return a * b;
+        case RULE_OP_DIV: return a / b;
+        case RULE_OP_LT:  return a < b;
+        case RULE_OP_LE:  return a <= b;
+        case RULE_OP_GT:  return a > b;
+        case RULE_OP_GE:  return a >= b;
+        case RULE_OP_EQ:  return a == b;
+        case RULE_OP_NE:  return a != b;
+        case RULE_OP_AND: return (a != 0.0) && (b != 0.0);
+        case RULE_OP_OR:  return (a != 0.0) || (b != 0.0);
+        default:          return 0.0;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Strips leading and trailing white space.
+ **********************************************************************************************************************/
+static std::string trim (const std::string& value)
+{
+    size_t first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+    size_t last = value.find_last_not_of(" \t\r\n");
+    return value.substr(first, last - first + 1);
+}
@@ -0,0 +1,229 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_runtime.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Takes a finished task, or one destroyed with its loop, off the task list of its loop.
+ **********************************************************************************************************************/
+Task::promise_type::~promise_type ()
+{
+    if (loop != nullptr)
+    {
+        loop->finished(self);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty loop.
+ **********************************************************************************************************************/
+EventLoop::EventLoop ()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)), turnCount(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Destroys the tasks that are still suspended, releasing what their frames hold.
+ **********************************************************************************************************************/
+EventLoop::~EventLoop ()
+{
+    timers.clear();
+    ready.clear();
+    while (!taskList.empty())
+    {
+        taskList.front().destroy();
+    }
+    if (epollFd >= 0)
+    {
+        close(epollFd);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Takes ownership of a task and runs it from the next turn of run() on.
+ *
+ * @param task The task, e.g. the return value of a coroutine function.
+ **********************************************************************************************************************/
+void EventLoop::spawn (Task task)
+{
+    std::coroutine_handle<Task::promise_type> handle = std::exchange(task.handle, nullptr);
+    handle.promise().loop = this;
+    handle.promise().self = taskList.insert(taskList.end(), handle);
+    ready.push_back(handle);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Runs the tasks until running is cleared or every task has returned.
+ *
+ * running is checked once per turn, so it is noticed at the latest when the next timer runs out or a descriptor
+ * becomes readable.
+ *
+ * @param running Cleared, e.g. by a signal handler, to return; the tasks stay suspended where they are.
+ **********************************************************************************************************************/
+void EventLoop::run (const std::atomic<bool>& running)
+{
+    struct epoll_event events[RUNTIME_MAX_EVENTS];
+
+    while (running && !taskList.empty())
+    {
+        int timeoutMs = -1;
+        if (!ready.empty())
+        {
+            timeoutMs = 0;
+        }
+        else if (!timers.empty())
+        {
+            timeoutMs = (int)std::max<int64_t>((timers.begin()->first - nowUs() + 999) / 1000, 0);
+        }
+
+        int count = epoll_wait(epollFd, events, RUNTIME_MAX_EVENTS, timeoutMs);
+        for (int i = 0; i < count; ++i)
+        {
+            // A descriptor whose wait timed out is disarmed without a waiter, but may still report a hang-up
+            Waiter* waiter = static_cast<Waiter*>(events[i].data.ptr);
+            if (waiter != nullptr)
+            {
+                waiter->ready = true;
+                if (waiter->timed)
+                {
+                    timers.erase(waiter->timer);
+                }
+                ready.push_back(waiter->handle);
+            }
+        }
+
+        int64_t now = nowUs();
+        while (!timers.empty() && (timers.begin()->first <= now))
+        {
+            Waiter* waiter = timers.begin()->second;
+            timers.erase(timers.begin());
+            waiter->timed = false;
+            if (waiter->fd >= 0)
+            {
+                struct epoll_event ev;
+                ev.events = EPOLLONESHOT;
+                ev.data.ptr = nullptr;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, waiter->fd, &ev);
+            }
+            ready.push_back(waiter->handle);
+        }
+
+        for (size_t n = ready.size(); n > 0; --n)
+        {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+        ++turnCount;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Resumes a suspended task in the next turn of run(), e.g. from an awaitable that was signalled.
+ **********************************************************************************************************************/
+void EventLoop::schedule (std::coroutine_handle<> handle)
+{
+    ready.push_back(handle);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tasks spawned that have not returned.
+ **********************************************************************************************************************/
+size_t EventLoop::tasks () const
+{
+    return taskList.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Turns of run() so far, each one poll of the descriptors.
+ **********************************************************************************************************************/
+uint64_t EventLoop::turns () const
+{
+    return turnCount;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in microseconds, the clock of the timers.
+ **********************************************************************************************************************/
+int64_t EventLoop::nowUs ()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parks a task on a timer and/or a descriptor.
+ *
+ * A descriptor is armed for one readiness event at a time, so only one task may wait on it. One that epoll cannot
+ * watch, e.g. a regular file, counts as readable at once.
+ *
+ * @param waiter The wait, kept in the frame of the task.
+ * @param handle The task.
+ * @param dueUs Deadline on the steady clock in microseconds, negative for none.
+ **********************************************************************************************************************/
+void EventLoop::suspend (Waiter& waiter, std::coroutine_handle<> handle, int64_t dueUs)
+{
+    waiter.handle = handle;
+    waiter.ready = false;
+    waiter.timed = (dueUs >= 0);
+    if (waiter.timed)
+    {
+        waiter.timer = timers.emplace(dueUs, &waiter);
+    }
+
+    if (waiter.fd >= 0)
+    {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = &waiter;
+        if ((epoll_ctl(epollFd, EPOLL_CTL_MOD, waiter.fd, &ev) != 0) &&
+            ((errno != ENOENT) || (epoll_ctl(epollFd, EPOLL_CTL_ADD, waiter.fd, &ev) != 0)))
+        {
+            waiter.ready = true;
+            if (waiter.timed)
+            {
+                timers.erase(waiter.timer);
+                waiter.timed = false;
+            }
+            ready.push_back(handle);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Forgets a task that returned or was destroyed.
+ **********************************************************************************************************************/
+void EventLoop::finished (std::list<std::coroutine_handle<>>::iterator task)
+{
+    taskList.erase(task);
+}
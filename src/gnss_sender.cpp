@@ -11,11 +11,17 @@
 /***********************************************************************************************************************
  * Macro definitions
  **********************************************************************************************************************/
-#define QOS_LEVEL               (0U)              /* QoS level 0 is applied in this project */
+#define QOS_LEVEL               (0U)              /* Default QoS level, raised by --qos and --exactly-once */
 #define LATITUDE_DEGREE_MAX     (90U)             /* Maximum value for latitude degrees */
 #define LONGITUDE_DEGREE_MAX    (180U)            /* Maximum value for longitude degrees */
 #define MINUTES_IN_DEGREE       (60U)             /* Conversion from degrees to minutes */
 #define PRECISION_FACTOR        (1000000U)        /* Factor for generating random precision */
+#define LOOP_TIMEOUT_MS         (100)             /* Longest network wait per loop */
+#define ACK_TIMEOUT_MS          (5000)            /* Unconfirmed batches are published again after this delay */
+#define DRAIN_TIMEOUT_MS        (10000)           /* Longest wait for outstanding messages before exiting */
+#define CONNECT_TIMEOUT_MS      (5000)            /* Longest wait for a first broker connection at startup */
+#define SEQUENCE_RESERVE        (1024U)           /* Sequence numbers recorded as used per write of the state file */
+#define ACK_TOPIC_PREFIX        "gnss/ack/"       /* Commit confirmations of the receiver, followed by the device ID */
 
 /***********************************************************************************************************************
  * Typedef definitions
@@ -24,13 +30,33 @@
 /***********************************************************************************************************************
  * Private global variables and functions
  **********************************************************************************************************************/
-static std::string getFormattedTime(const std::tm* timeStruct);
-static std::string getFormattedDate(const std::tm* timeStruct);
-static std::string calculateChecksum(const std::string& sentence);
+static unsigned calculateChecksum(const char* sentence);
+static bool parseIntArg(const char* text, int minValue, int maxValue, int& value);
+static bool reserveSequences(SenderState& state, uint64_t needed);
+static void publishPayload(SenderState& state, const std::string& topic, const std::string& payload);
+static void sendPayload(SenderState& state, const std::string& topic, const std::string& payload);
+static void releaseImpaired(SenderState& state);
+static int64_t coalesceWakeup(const SenderState& state, int64_t dueUs);
+static int64_t nextWakeup(const SenderState& state, int64_t deadlineUs);
+static void runNetwork(SenderState& state, int durationMs);
+static void waitUdp(SenderState& state, int durationMs);
+static int runUdpSender(SenderState& state);
+static bool openSpool(SenderState& state);
+static void mergePending(SenderState& state, PayloadBatch& batch);
+static void runGateway(SenderState& state);
+static uint64_t acknowledgedCount(const SenderState& state);
+static void reportBrokers(const SenderState& state, double elapsedMs);
+static void reportClock(const SenderState& state, double elapsedMs);
+static void reportImpairment(const SenderState& state);
+static void reportScheduler(const SenderState& state, double elapsedMs);
+static void handle_signal(int signal);
+static int64_t nowMs();
+static int64_t nowUs();
 
 /***********************************************************************************************************************
  * Global Variables
  **********************************************************************************************************************/
+std::atomic<bool> running(true);                // Cleared by SIGINT or SIGTERM to stop gateway mode
 
 /***********************************************************************************************************************
  * Functions
@@ -38,17 +64,18 @@ static std::string calculateChecksum(const std::string& sentence);
 
 /*******************************************************************************************************************//**
  * @brief Generates GNSS data in NMEA format.
- * 
- * @return A string containing the NMEA GPRMC sentence.
+ *
+ * The sentence is formatted in a stack buffer and copied into the caller's string, whose buffer is reused from one
+ * fix to the next, so a fix costs no allocation.
+ *
+ * @param timeMs Fix time in Unix milliseconds, from the clock of the simulation.
+ * @param out Output, replaced with the NMEA GPRMC sentence.
  **********************************************************************************************************************/
-std::string generateGNSSData ()
+void generateGNSSData (int64_t timeMs, std::string& out)
 {
-    // Get current timestamp
-    std::time_t t = std::time(0);
-    std::tm* now = std::gmtime(&t);
-
-    std::string utc = getFormattedTime(now);
-    std::string date = getFormattedDate(now);
+    std::time_t t = (std::time_t)(timeMs / 1000);
+    std::tm fixTime;
+    std::tm* now = gmtime_r(&t, &fixTime);
 
     // Generate random latitude and longitude values
     double latVal = (rand() % LATITUDE_DEGREE_MAX) + 
@@ -68,49 +95,460 @@ std::string generateGNSSData ()
     char lonDirection = (rand() % 2 == 0) ? 'E' : 'W';
     char varDirection = (rand() % 2 == 0) ? 'E' : 'W';
 
-    // Create the full NMEA GPRMC sentence
-    std::string nmeaData = "$GPRMC,";
-    nmeaData += utc + ",";
-    nmeaData += "A,";  // Fixed to active status (A = data valid, V = data invalid)
-    nmeaData += std::to_string(latDegrees) + std::to_string(latMinutes) + "," + latDirection + ",";
-    nmeaData += std::to_string(longDegrees) + std::to_string(longMinutes) + "," + lonDirection + ",";
-    nmeaData += "0.0,0.0,";  // Speed and course over ground
-    nmeaData += date + ",";
-    nmeaData += "0.0,";  // Fixed magnetic variation degree to 0.0
-    nmeaData += varDirection;
-    nmeaData += ",A";  // Fixed Positioning system mode indicator to "A" (Autonomous)
-    nmeaData += "*" + calculateChecksum(nmeaData);  // Append the checksum
+    // Zero-padded to the NMEA "ddmm.mmmmmm" and "dddmm.mmmmmm" layouts so the receiver can split degrees from minutes.
+    // Status is fixed to active (A = data valid), speed, course and magnetic variation to 0.0, and the positioning
+    // system mode indicator to "A" (Autonomous).
+    char sentence[SENDER_MAX_SENTENCE];
+    int length = std::snprintf(sentence, sizeof(sentence),
+                               "$GPRMC,%02d%02d%02d.%02d,A,%02d%09.6f,%c,%03d%09.6f,%c,0.0,0.0,%02d%02d%02d,0.0,%c,A",
+                               now->tm_hour, now->tm_min, now->tm_sec, (int)(timeMs % 1000) / 10, latDegrees,
+                               latMinutes, latDirection, longDegrees, longMinutes, lonDirection, now->tm_mday,
+                               now->tm_mon + 1, now->tm_year % 100, varDirection);
+    length += std::snprintf(sentence + length, sizeof(sentence) - length, "*%02X", calculateChecksum(sentence));
 
-    return nmeaData;
+    out.assign(sentence, length);
 }
 
 /*******************************************************************************************************************//**
- * @brief Callback function called when the message is published successfully.
- * 
- * @param mosq Pointer to the Mosquitto instance.
- * @param obj Pointer to user-defined object (not used).
- * @param mid Message ID of the published message.
+ * @brief Parses the command line options of the sender.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param config Output configuration, filled with defaults for the options not given.
+ *
+ * @return False if an option is unknown or invalid.
+ **********************************************************************************************************************/
+bool parseSenderArgs (int argc, char* argv[], SenderConfig& config)
+{
+    config.host = "localhost";
+    config.port = 1883;
+    config.qos = QOS_LEVEL;
+    config.count = SENDER_DEFAULT_COUNT;
+    config.intervalMs = SENDER_DEFAULT_INTERVAL_MS;
+    config.batchSize = 1;
+    config.vehicles = 1;
+    config.exactlyOnce = false;
+    config.speed = 1.0;
+    config.startMs = -1;
+    config.slackMs = 0;
+    initTlsConfig(config.tls);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = true;
+
+        if (option == "--exactly-once")
+        {
+            config.exactlyOnce = true;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            std::fprintf(stderr, "Missing value for %s\n", option.c_str());
+            return false;
+        }
+        ++i;
+
+        if (option == "--host")
+        {
+            config.host = value;
+        }
+        else if (option == "--port")
+        {
+            ok = parseIntArg(value, 1, 65535, config.port);
+        }
+        else if (option == "--broker")
+        {
+            BrokerEndpoint broker;
+            uint16_t port;
+            ok = parseHostPort(value, broker.host, port);
+            broker.port = port;
+            config.brokers.push_back(broker);
+        }
+        else if (option == "--qos")
+        {
+            ok = parseIntArg(value, 0, 2, config.qos);
+        }
+        else if (option == "--device")
+        {
+            config.deviceId = value;
+            ok = !config.deviceId.empty() && (config.deviceId.size() <= PAYLOAD_MAX_DEVICE_ID) &&
+                 (config.deviceId.find_first_of("/+#") == std::string::npos);
+        }
+        else if (option == "--client-id")
+        {
+            config.clientId = value;
+        }
+        else if (option == "--count")
+        {
+            ok = parseIntArg(value, 1, INT32_MAX, config.count);
+        }
+        else if (option == "--interval-ms")
+        {
+            ok = parseIntArg(value, 0, INT32_MAX, config.intervalMs);
+        }
+        else if (option == "--batch")
+        {
+            ok = parseIntArg(value, 1, PAYLOAD_MAX_SENTENCES, config.batchSize);
+        }
+        else if (option == "--vehicles")
+        {
+            ok = parseIntArg(value, 1, 1000000, config.vehicles);
+        }
+        else if (option == "--input")
+        {
+            GatewayInputSpec spec;
+            ok = parseGatewayInput(value, spec);
+            config.gatewayInputs.push_back(spec);
+        }
+        else if (option == "--udp")
+        {
+            std::string host;
+            uint16_t port;
+            config.udpTarget = value;
+            ok = parseHostPort(config.udpTarget, host, port);
+        }
+        else if (isTlsOption(option))
+        {
+            ok = setTlsOption(option, value, config.tls);
+        }
+        else if (option == "--hmac-key")
+        {
+            ok = parseHexKey(value, config.hmacKey);
+        }
+        else if (option == "--log")
+        {
+            config.logPath = value;
+            ok = !config.logPath.empty();
+        }
+        else if (option == "--speed")
+        {
+            ok = parseClockSpeed(value, config.speed);
+        }
+        else if (option == "--start")
+        {
+            ok = parseClockStart(value, config.startMs);
+        }
+        else if (option == "--slack")
+        {
+            ok = parseIntArg(value, 0, SENDER_MAX_SLACK_MS, config.slackMs);
+        }
+        else if (option == "--impair")
+        {
+            ImpairmentLayer probe;
+            std::string error;
+            config.impairSpec = value;
+            ok = probe.configure(config.impairSpec, error);
+            if (!ok)
+            {
+                std::fprintf(stderr, "Invalid impairment %s\n", error.c_str());
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", option.c_str());
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", option.c_str(), value);
+            return false;
+        }
+    }
+
+    if ((config.exactlyOnce || !config.gatewayInputs.empty()) && !config.udpTarget.empty())
+    {
+        std::fprintf(stderr, "--exactly-once and --input need the MQTT confirmations and cannot be combined with "
+                             "--udp\n");
+        return false;
+    }
+
+    // A gateway forwards the fixes of real devices, with their own times
+    if (((config.speed != 1.0) || (config.startMs >= 0)) && !config.gatewayInputs.empty())
+    {
+        std::fprintf(stderr, "--speed and --start simulate the fixes and cannot be combined with --input\n");
+        return false;
+    }
+
+    if (!checkTlsConfig(config.tls))
+    {
+        return false;
+    }
+
+    // Sequence numbers and keys are kept per device, so only unsequenced fixes can be spread over simulated vehicles
+    if ((config.vehicles > 1) && (config.exactlyOnce || (config.batchSize > 1) || !config.udpTarget.empty() ||
+                                  !config.gatewayInputs.empty() || !config.hmacKey.empty()))
+    {
+        std::fprintf(stderr, "--vehicles sends single fixes and cannot be combined with --batch, --exactly-once, "
+                             "--udp, --input or --hmac-key\n");
+        return false;
+    }
+
+    // Only batches carry a tag, and the receiver looks the key up by the device in the batch
+    if (!config.hmacKey.empty() && config.deviceId.empty())
+    {
+        config.deviceId = SENDER_DEFAULT_DEVICE;
+    }
+
+    // Several senders usually share a directory, each device gets its own log
+    if (config.logPath.empty())
+    {
+        config.logPath = config.deviceId.empty() ? SENDER_LOG_FILE ".binlog"
+                                                 : SENDER_LOG_FILE "_" + config.deviceId + ".binlog";
+    }
+
+    if (config.brokers.empty())
+    {
+        BrokerEndpoint broker;
+        broker.host = config.host;
+        broker.port = config.port;
+        config.brokers.push_back(broker);
+    }
+
+    if (!config.gatewayInputs.empty())
+    {
+        // A gateway forwards every sentence it has accepted, so its uplink always runs exactly-once
+        config.exactlyOnce = true;
+        if (config.batchSize == 1)
+        {
+            config.batchSize = GATEWAY_DEFAULT_BATCH;
+        }
+    }
+
+    if (config.exactlyOnce)
+    {
+        // Confirmations are matched per device, and the broker must keep the session while either side is away
+        if (config.deviceId.empty())
+        {
+            config.deviceId = SENDER_DEFAULT_DEVICE;
+        }
+        if (config.clientId.empty())
+        {
+            config.clientId = "gnss_sender_" + config.deviceId;
+        }
+        config.qos = std::max(config.qos, 1);
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Restores the sequence counter of the device from its state file.
+ *
+ * Sequence numbers are recorded as used in blocks before they are sent, so a restarted sender never reuses a number
+ * the receiver may already have stored; numbers reserved but not sent before a crash are skipped.
+ *
+ * @param state The sender state.
+ *
+ * @return False if the state file cannot be written.
  **********************************************************************************************************************/
-void on_publish (struct mosquitto *mosq, void *obj, int mid)
+bool loadSequence (SenderState& state)
 {
-    std::cout << "Message with mid " << mid << " published successfully." << std::endl;
+    state.sequenceFile = "gnss_sender_" + (state.config.deviceId.empty() ? std::string(SENDER_DEFAULT_DEVICE)
+                                                                          : state.config.deviceId) + ".seq";
+    state.nextSequence = 1;
+
+    FILE* file = std::fopen(state.sequenceFile.c_str(), "r");
+    if (file != nullptr)
+    {
+        unsigned long long stored;
+        if (std::fscanf(file, "%llu", &stored) == 1)
+        {
+            state.nextSequence = stored;
+        }
+        std::fclose(file);
+    }
+    state.reservedSequence = state.nextSequence;
+
+    return reserveSequences(state, state.nextSequence);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handler called when the connection to a broker is established.
+ *
+ * The pool subscribes the commit confirmations on every broker. In exactly-once mode, when the device is routed to
+ * this broker, every unconfirmed batch is published again, since it may have been lost with a previous connection.
+ *
+ * @param state The sender state.
+ * @param broker Index of the broker.
+ **********************************************************************************************************************/
+void on_connect (SenderState& state, size_t broker)
+{
+    LOG_INFO("Connected to the MQTT broker {}", state.pool.stats()[broker].name);
+    if (state.config.exactlyOnce && (state.pool.route(state.topic) == broker))
+    {
+        retransmitOutbox(state, true);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Handler of the commit confirmations of the receiver, from any broker.
+ *
+ * Each line of the payload is the last sequence number of a batch the receiver has committed; the batch is dropped
+ * from the outbox.
+ *
+ * @param state The sender state.
+ * @param message The confirmation message.
+ **********************************************************************************************************************/
+void on_message (SenderState& state, const struct mosquitto_message *message)
+{
+    const char* next = static_cast<const char*>(message->payload);
+    const char* end = next + message->payloadlen;
+
+    while (next < end)
+    {
+        uint64_t sequence = 0;
+        const char* digits = next;
+        for (; (next < end) && (*next >= '0') && (*next <= '9'); ++next)
+        {
+            sequence = sequence * 10 + (uint64_t)(*next - '0');
+        }
+        if (next == digits)
+        {
+            ++next;
+            continue;
+        }
+        state.outbox.erase(sequence);
+        state.spool.confirm(sequence);
+    }
 }
 
 /*******************************************************************************************************************//**
  * @brief Handles GNSS data and publishes it using MQTT.
- * 
- * @param mosq Pointer to the Mosquitto instance.
+ *
+ * A single fix is published as a plain NMEA sentence, on the topic of the next vehicle when several are simulated.
+ * With batching, in exactly-once mode, over UDP or with an HMAC key, fixes are collected into batches that are
+ * published once full; only the last three number them.
+ *
+ * @param state The sender state.
  **********************************************************************************************************************/
-void gnssDataHandler (struct mosquitto *mosq)
+void gnssDataHandler (SenderState& state)
 {
-    std::string gnssData = generateGNSSData();
+    generateGNSSData(state.clock.nowMs(), state.fix);
 
-    const char* topic = "gnss/data";
-    int ret = mosquitto_publish(mosq, NULL, topic, gnssData.size(), gnssData.c_str(), QOS_LEVEL, false);
+    if (!state.config.exactlyOnce && (state.config.batchSize <= 1) && state.config.udpTarget.empty() &&
+        state.config.hmacKey.empty())
+    {
+        if (state.config.vehicles > 1)
+        {
+            char number[24];
+            std::snprintf(number, sizeof(number), "-%d", (int)(state.fixesSent % state.config.vehicles));
+            state.vehicleTopic.assign("gnss/data/");
+            state.vehicleTopic.append(state.config.deviceId.empty() ? "vehicle" : state.config.deviceId);
+            state.vehicleTopic.append(number);
+            publishPayload(state, state.vehicleTopic, state.fix);
+        }
+        else
+        {
+            publishPayload(state, state.topic, state.fix);
+        }
+        ++state.fixesSent;
+        return;
+    }
 
-    if (ret != MOSQ_ERR_SUCCESS)
+    state.sentences.push_back(state.fix);
+    if ((int)state.sentences.size() >= state.config.batchSize)
     {
-        std::cerr << "Failed to publish GNSS data, error: " << ret << std::endl;
+        flushBatch(state);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes the fixes collected so far as one batch, sequenced in exactly-once, UDP and HMAC mode.
+ *
+ * In exactly-once mode the batch is spooled to disk before it is published, and stays in the outbox and the spool
+ * until the receiver confirms its commit. In gateway mode the oldest pending sentences of all inputs are merged into
+ * a compressed batch.
+ * With an HMAC key the batch is signed once, so retransmissions and spooled copies carry the same tag.
+ *
+ * @param state The sender state.
+ **********************************************************************************************************************/
+void flushBatch (SenderState& state)
+{
+    bool gateway = !state.config.gatewayInputs.empty();
+    if (state.sentences.empty() && state.pending.empty())
+    {
+        return;
+    }
+
+    PayloadBatch batch;
+    batch.deviceId = state.config.deviceId;
+    batch.firstSequence = state.sequenced ? state.nextSequence : 0;
+    if (gateway)
+    {
+        mergePending(state, batch);
+    }
+    else
+    {
+        batch.sentences.swap(state.sentences);
+    }
+
+    uint64_t lastSequence = batch.firstSequence + batch.sentences.size() - 1;
+    if (state.sequenced)
+    {
+        if ((lastSequence >= state.reservedSequence) && !reserveSequences(state, lastSequence + 1))
+        {
+            std::fprintf(stderr, "Unable to record sequence numbers, batch dropped.\n");
+            return;
+        }
+        state.nextSequence = lastSequence + 1;
+    }
+
+    std::string payload;
+    encodeBatch(batch, payload, gateway);
+    if (!state.config.hmacKey.empty())
+    {
+        signPayload(payload, state.config.hmacKey);
+    }
+    if (state.config.exactlyOnce && !state.spool.append(lastSequence, payload))
+    {
+        std::fprintf(stderr, "Batch %llu is kept in memory only.\n", (unsigned long long)lastSequence);
+    }
+    if (gateway)
+    {
+        state.uplinkBytes += payload.size();
+    }
+    publishPayload(state, state.topic, payload);
+    state.fixesSent += batch.sentences.size();
+
+    if (state.config.exactlyOnce)
+    {
+        OutboxEntry& entry = state.outbox[lastSequence];
+        entry.payload.swap(payload);
+        entry.sentAtMs = nowMs();
+    }
+
+    // Bound the store-and-forward backlog of a long uplink outage, dropping the oldest batches
+    while (gateway && (state.spool.size() > GATEWAY_SPOOL_MAX_BYTES) && (state.outbox.size() > 1))
+    {
+        state.spool.confirm(state.outbox.begin()->first);
+        state.outbox.erase(state.outbox.begin());
+        ++state.batchesDropped;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes unconfirmed batches again.
+ *
+ * The receiver stores each sequence number once, so a batch that was committed but whose confirmation was lost is
+ * harmless to resend.
+ *
+ * @param state The sender state.
+ * @param all Resend every batch instead of only those whose confirmation is overdue.
+ **********************************************************************************************************************/
+void retransmitOutbox (SenderState& state, bool all)
+{
+    int64_t now = nowMs();
+    for (auto& entry : state.outbox)
+    {
+        if (all || (now - entry.second.sentAtMs >= ACK_TIMEOUT_MS))
+        {
+            publishPayload(state, state.topic, entry.second.payload);
+            entry.second.sentAtMs = now;
+        }
     }
 }
 
@@ -119,53 +557,551 @@ void gnssDataHandler (struct mosquitto *mosq)
  **********************************************************************************************************************/
 
 /*******************************************************************************************************************//**
- * @brief Converts a given time to a string in the format of "HHMMSS".
+ * @brief Calculate the checksum for an NMEA sentence.
  * 
- * @param timeStruct A pointer to a tm structure representing the current time.
- * @return A string representing the time in "HHMMSS" format.
+ * @param sentence The NMEA sentence to calculate the checksum for, from its "$" up to the "*".
+ * @return The XOR of the characters between "$" and "*".
  **********************************************************************************************************************/
-static std::string getFormattedTime (const std::tm* timeStruct)
+static unsigned calculateChecksum (const char* sentence)
 {
-    std::stringstream ss;
-    ss << std::setw(2) << std::setfill('0') << timeStruct->tm_hour
-       << std::setw(2) << std::setfill('0') << timeStruct->tm_min
-       << std::setw(2) << std::setfill('0') << timeStruct->tm_sec
-       << ".00";
-    return ss.str();
+    unsigned char checksum = 0;
+    for (const char* c = sentence + 1; *c != '\0'; ++c)
+    {
+        checksum ^= (unsigned char)*c;
+    }
+    return checksum;
 }
 
 /*******************************************************************************************************************//**
- * @brief Converts a given date to a string in the format of "DDMMYY".
- * 
- * @param timeStruct A pointer to a tm structure representing the current time.
- * @return A string representing the date in "DDMMYY" format.
+ * @brief Parses an integer option value within a range.
  **********************************************************************************************************************/
-static std::string getFormattedDate (const std::tm* timeStruct)
+static bool parseIntArg (const char* text, int minValue, int maxValue, int& value)
 {
-    std::stringstream ss;
-    ss << std::setw(2) << std::setfill('0') << timeStruct->tm_mday
-       << std::setw(2) << std::setfill('0') << (timeStruct->tm_mon + 1)
-       << std::setw(2) << std::setfill('0') << (timeStruct->tm_year % 100);
-    return ss.str();
+    char* end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    if ((end == text) || (*end != '\0') || (parsed < minValue) || (parsed > maxValue))
+    {
+        return false;
+    }
+
+    value = (int)parsed;
+    return true;
 }
 
 /*******************************************************************************************************************//**
- * @brief Calculate the checksum for an NMEA sentence.
- * 
- * @param sentence The NMEA sentence to calculate the checksum for.
- * @return The checksum in hexadecimal string format.
+ * @brief Records a new block of sequence numbers as used before any of them is sent.
+ *
+ * The state file is replaced atomically and synced, so it survives a crash of the sender or the machine.
+ *
+ * @param state The sender state.
+ * @param needed First sequence number that must be covered by the reservation.
+ *
+ * @return False if the state file cannot be written.
  **********************************************************************************************************************/
-static std::string calculateChecksum (const std::string& sentence)
+static bool reserveSequences (SenderState& state, uint64_t needed)
 {
-    unsigned char checksum = 0;
-    for (size_t i = 1; i < sentence.length(); ++i)
+    uint64_t reserved = needed + SEQUENCE_RESERVE;
+    std::string temp = state.sequenceFile + ".tmp";
+
+    FILE* file = std::fopen(temp.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = (std::fprintf(file, "%llu\n", (unsigned long long)reserved) > 0) && (std::fflush(file) == 0) &&
+              (fsync(fileno(file)) == 0);
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || (std::rename(temp.c_str(), state.sequenceFile.c_str()) != 0))
     {
-        checksum ^= sentence[i];
+        return false;
     }
 
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << (int)checksum;
-    return ss.str();
+    state.reservedSequence = reserved;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Hands a payload to the transport, through the impairment layer when --impair is given.
+ **********************************************************************************************************************/
+static void publishPayload (SenderState& state, const std::string& topic, const std::string& payload)
+{
+    if (!state.impair.enabled())
+    {
+        sendPayload(state, topic, payload);
+        return;
+    }
+
+    std::string impairedTopic = topic;
+    std::string impairedPayload = payload;
+    if (state.impair.submit(impairedTopic, impairedPayload, nowUs()))
+    {
+        sendPayload(state, impairedTopic, impairedPayload);
+    }
+    releaseImpaired(state);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Publishes a payload through the broker pool, routed by its topic, or queues it as a datagram in UDP mode.
+ **********************************************************************************************************************/
+static void sendPayload (SenderState& state, const std::string& topic, const std::string& payload)
+{
+    if (!state.config.udpTarget.empty())
+    {
+        state.udp.queue(payload);
+        ++state.messagesQueued;
+        return;
+    }
+
+    // The topic names the device, so all messages of a vehicle go to the same broker while it is healthy
+    if (!state.pool.publish(topic, topic, payload, state.config.qos))
+    {
+        std::fprintf(stderr, "No MQTT broker available, the oldest buffered message was dropped.\n");
+    }
+    ++state.messagesQueued;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sends the messages the impairment layer holds and that are due by now.
+ **********************************************************************************************************************/
+static void releaseImpaired (SenderState& state)
+{
+    state.impair.release(nowUs(), state.released);
+    for (const ImpairedMessage& message : state.released)
+    {
+        sendPayload(state, message.topic, message.payload);
+    }
+    state.released.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Moves a wakeup to the next slot boundary when --slack is given.
+ *
+ * Slots are --slack apart on the monotonic clock, so the timed work that comes due within one slot (the next fix, a
+ * batch flush, a keep-alive check, a reconnect, a resend or a delayed message) is done at one wakeup, each job less
+ * than the slack late.
+ *
+ * @param state The sender state.
+ * @param dueUs Time the work is due, in microseconds on the monotonic clock.
+ *
+ * @return The time to wake up.
+ **********************************************************************************************************************/
+static int64_t coalesceWakeup (const SenderState& state, int64_t dueUs)
+{
+    int64_t slotUs = (int64_t)state.config.slackMs * 1000;
+    return (slotUs > 0) ? (dueUs + slotUs - 1) / slotUs * slotUs : dueUs;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Time at which the network loop next has to wake up, unless a socket or an input becomes ready first.
+ *
+ * Without --slack the loop polls the brokers and the outbox every LOOP_TIMEOUT_MS. With it, the loop sleeps until the
+ * next timed work of the broker pool or of the outbox instead, aligned to a wakeup slot.
+ *
+ * @param state The sender state.
+ * @param deadlineUs End of the current wait, e.g. the next fix, in microseconds on the monotonic clock.
+ *
+ * @return The time to wake up, in microseconds.
+ **********************************************************************************************************************/
+static int64_t nextWakeup (const SenderState& state, int64_t deadlineUs)
+{
+    int64_t wake = deadlineUs;
+    int64_t releaseUs = state.impair.nextReleaseUs();
+    if (releaseUs >= 0)
+    {
+        wake = std::min(wake, releaseUs);
+    }
+    if (state.config.slackMs == 0)
+    {
+        return std::min<int64_t>(wake, nowUs() + LOOP_TIMEOUT_MS * 1000);
+    }
+
+    // Overdue batches are only resent once a broker is connected, until then the reconnects wake the loop
+    int64_t dueMs = state.pool.nextDueMs();
+    if (state.config.exactlyOnce && state.pool.connected())
+    {
+        for (const auto& entry : state.outbox)
+        {
+            dueMs = std::min(dueMs, entry.second.sentAtMs + ACK_TIMEOUT_MS);
+        }
+    }
+    wake = std::min(wake, std::min<int64_t>(dueMs, INT64_MAX / 1000) * 1000);
+    return coalesceWakeup(state, wake);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Runs the network loop of the broker pool for a while, resending overdue batches as needed.
+ *
+ * Brokers that are down are reconnected in the background by the pool. The loop wakes up for the messages held by the
+ * impairment layer as they come due. With --slack the end of a wait longer than LOOP_TIMEOUT_MS is aligned to a
+ * wakeup slot as well, while the short waits of the unpaced sender and of the drain at exit are kept as they are.
+ *
+ * @param state The sender state.
+ * @param durationMs Time to spend in the loop; 0 services the connections once.
+ **********************************************************************************************************************/
+static void runNetwork (SenderState& state, int durationMs)
+{
+    int64_t deadlineUs = nowUs() + (int64_t)durationMs * 1000;
+    if (durationMs > LOOP_TIMEOUT_MS)
+    {
+        deadlineUs = coalesceWakeup(state, deadlineUs);
+    }
+
+    do
+    {
+        state.pool.run((int)std::max<int64_t>((nextWakeup(state, deadlineUs) - nowUs() + 999) / 1000, 0));
+        ++state.wakeups;
+        releaseImpaired(state);
+
+        if (state.config.exactlyOnce && state.pool.connected())
+        {
+            retransmitOutbox(state, false);
+        }
+    } while (nowUs() < deadlineUs);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Pauses UDP mode for a while, handing the queued datagrams to the kernel first.
+ *
+ * Wakes up to send the messages held by the impairment layer as they come due, aligned to the wakeup slots of --slack.
+ *
+ * @param state The sender state.
+ * @param durationMs Time to pause.
+ **********************************************************************************************************************/
+static void waitUdp (SenderState& state, int durationMs)
+{
+    int64_t deadline = coalesceWakeup(state, nowUs() + (int64_t)durationMs * 1000);
+    int64_t now;
+
+    do
+    {
+        releaseImpaired(state);
+        state.udp.flush();
+
+        int64_t wake = deadline;
+        int64_t releaseUs = state.impair.nextReleaseUs();
+        if (releaseUs >= 0)
+        {
+            wake = std::min(wake, coalesceWakeup(state, releaseUs));
+        }
+        now = nowUs();
+        if (wake > now)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(wake - now));
+            ++state.wakeups;
+            now = nowUs();
+        }
+    } while (now < deadline);
+    releaseImpaired(state);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sends the fixes as sequenced datagrams instead of MQTT messages.
+ *
+ * Datagrams are handed to the kernel with sendmmsg, a full batch per call, or at the end of each interval when the
+ * sender is paced. The receiver detects loss from the sequence numbers.
+ *
+ * @param state The sender state.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+static int runUdpSender (SenderState& state)
+{
+    std::string host;
+    uint16_t port;
+    parseHostPort(state.config.udpTarget, host, port);
+    if (!state.udp.open(host, port))
+    {
+        return 1;
+    }
+
+    state.clock.start(state.config.speed, state.config.startMs);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < state.config.count; ++i)
+    {
+        gnssDataHandler(state);
+        int waitMs = (int)state.clock.wait(state.config.intervalMs);
+        if (waitMs > 0)
+        {
+            waitUdp(state, waitMs);
+        }
+    }
+    flushBatch(state);
+
+    // Messages still delayed by the impairment layer are sent as they come due
+    int64_t drainDeadline = nowMs() + DRAIN_TIMEOUT_MS;
+    while ((state.impair.queued() > 0) && (nowMs() < drainDeadline))
+    {
+        waitUdp(state, 1);
+    }
+    state.udp.flush();
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Sent {} fixes in {} datagrams with {} sendmmsg calls in {.0} ms ({.0} fixes/s)", state.fixesSent,
+             state.udp.datagramsSent(), state.udp.sendCalls(), elapsedMs,
+             (elapsedMs > 0.0) ? state.fixesSent * 1000.0 / elapsedMs : 0.0);
+    reportClock(state, elapsedMs);
+    reportImpairment(state);
+    reportScheduler(state, elapsedMs);
+
+    return (state.udp.datagramsSent() == state.messagesQueued) ? 0 : 1;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Opens the spool of exactly-once mode, and the local inputs in gateway mode, and recovers the batches left
+ * unconfirmed by the previous run.
+ *
+ * @param state The sender state.
+ *
+ * @return False if an input or the spool cannot be opened.
+ **********************************************************************************************************************/
+static bool openSpool (SenderState& state)
+{
+    bool gateway = !state.config.gatewayInputs.empty();
+    std::map<uint64_t, std::string> unconfirmed;
+    if ((gateway && !state.inputs.open(state.config.gatewayInputs)) ||
+        !state.spool.open((gateway ? "gnss_gateway_" : "gnss_sender_") + state.config.deviceId + ".spool",
+                          unconfirmed))
+    {
+        return false;
+    }
+
+    // Recovered batches are published again as soon as the uplink connects
+    for (auto& batch : unconfirmed)
+    {
+        OutboxEntry& entry = state.outbox[batch.first];
+        entry.payload.swap(batch.second);
+        entry.sentAtMs = 0;
+    }
+    if (!state.outbox.empty())
+    {
+        LOG_INFO("Recovered {} unconfirmed batches from the spool", state.outbox.size());
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Moves the oldest pending sentences of gateway mode into a merged batch, ordered by time.
+ *
+ * The source table lists only the inputs that contribute to the batch.
+ *
+ * @param state The sender state.
+ * @param batch Output batch, its sentences and sources are filled.
+ **********************************************************************************************************************/
+static void mergePending (SenderState& state, PayloadBatch& batch)
+{
+    std::stable_sort(state.pending.begin(), state.pending.end(),
+                     [](const GatewaySentence& a, const GatewaySentence& b) { return a.timestampMs < b.timestampMs; });
+
+    size_t count = std::min(state.pending.size(), (size_t)state.config.batchSize);
+    int sourceIndex[GATEWAY_MAX_INPUTS];
+    std::fill(sourceIndex, sourceIndex + GATEWAY_MAX_INPUTS, -1);
+
+    batch.sentences.resize(count);
+    batch.sourceOf.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        GatewaySentence& pending = state.pending[i];
+        if (sourceIndex[pending.source] < 0)
+        {
+            sourceIndex[pending.source] = (int)batch.sources.size();
+            batch.sources.push_back(state.inputs.deviceIds()[pending.source]);
+        }
+        batch.sourceOf[i] = (uint8_t)sourceIndex[pending.source];
+        batch.sentences[i].swap(pending.sentence);
+        state.rawBytes += batch.sentences[i].size();
+    }
+    state.pending.erase(state.pending.begin(), state.pending.begin() + count);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Forwards the sentences of the local inputs over the uplink until SIGINT or SIGTERM.
+ *
+ * Inputs and the uplink socket are waited on together. A batch is published once it is full or its oldest sentence
+ * has waited --interval-ms. While the uplink is down, batches accumulate in the spool and are resent on reconnect.
+ *
+ * @param state The sender state.
+ **********************************************************************************************************************/
+static void runGateway (SenderState& state)
+{
+    std::vector<struct pollfd> fds;
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    while (running)
+    {
+        // Sleep until an input or the uplink is ready, or the open batch is due
+        int64_t deadlineUs = INT64_MAX;
+        if (!state.pending.empty())
+        {
+            deadlineUs = (state.batchStartMs + state.config.intervalMs) * 1000;
+        }
+        int64_t timeoutMs = std::max<int64_t>((nextWakeup(state, deadlineUs) - nowUs() + 999) / 1000, 0);
+
+        fds.clear();
+        state.pool.addPollFds(fds);
+        state.inputs.addPollFds(fds);
+        poll(fds.data(), fds.size(), (int)timeoutMs);
+        ++state.wakeups;
+
+        bool wasEmpty = state.pending.empty();
+        state.inputs.read(state.pending);
+        if (wasEmpty && !state.pending.empty())
+        {
+            state.batchStartMs = nowMs();
+        }
+
+        // Reconnects are non-blocking, so a broker that is down never holds up the inputs
+        state.pool.service();
+        releaseImpaired(state);
+
+        while (((int)state.pending.size() >= state.config.batchSize) ||
+               (!state.pending.empty() &&
+                (nowUs() >= coalesceWakeup(state, (state.batchStartMs + state.config.intervalMs) * 1000))))
+        {
+            flushBatch(state);
+            state.batchStartMs = nowMs();
+        }
+
+        if (state.pool.connected())
+        {
+            retransmitOutbox(state, false);
+        }
+    }
+
+    while (!state.pending.empty())
+    {
+        flushBatch(state);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Messages the brokers have acknowledged (QoS 1/2) or that were written to them (QoS 0).
+ **********************************************************************************************************************/
+static uint64_t acknowledgedCount (const SenderState& state)
+{
+    uint64_t count = 0;
+    for (const BrokerLinkStats& link : state.pool.stats())
+    {
+        count += link.acknowledged;
+    }
+    return count;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints the messages, bytes and throughput of each broker and the messages moved away from it.
+ **********************************************************************************************************************/
+static void reportBrokers (const SenderState& state, double elapsedMs)
+{
+    double seconds = std::max(elapsedMs / 1000.0, 0.001);
+    for (const BrokerLinkStats& link : state.pool.stats())
+    {
+        const char* down = link.connected ? "" : " (down)";
+        if (tlsEnabled(state.config.tls))
+        {
+            LOG_INFO("Broker {}{}: {} messages, {} bytes, {.0} msgs/s, {} acknowledged, {} failed over, "
+                     "{} disconnects, {} TLS handshakes ({} resumed)", link.name, down, link.published, link.bytes,
+                     link.published / seconds, link.acknowledged, link.failedOver, link.disconnects,
+                     link.tlsHandshakes, link.tlsResumed);
+        }
+        else
+        {
+            LOG_INFO("Broker {}{}: {} messages, {} bytes, {.0} msgs/s, {} acknowledged, {} failed over, "
+                     "{} disconnects", link.name, down, link.published, link.bytes, link.published / seconds,
+                     link.acknowledged, link.failedOver, link.disconnects);
+        }
+    }
+    if (state.pool.dropped() > 0)
+    {
+        std::fprintf(stderr, "%llu messages were dropped while no broker was available.\n",
+                     (unsigned long long)state.pool.dropped());
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints the simulated time covered by the fixes, when --speed or --start is given.
+ **********************************************************************************************************************/
+static void reportClock (const SenderState& state, double elapsedMs)
+{
+    if ((state.config.speed == 1.0) && (state.config.startMs < 0))
+    {
+        return;
+    }
+
+    double simulatedS = state.clock.elapsedMs() / 1000.0;
+    LOG_INFO("Simulated {.2} hours of fixes in {.1} s ({.0}x real time)", simulatedS / 3600.0, elapsedMs / 1000.0,
+             (elapsedMs > 0.0) ? simulatedS * 1000.0 / elapsedMs : 0.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints what the impairment layer did to the messages, when --impair is given.
+ **********************************************************************************************************************/
+static void reportImpairment (const SenderState& state)
+{
+    if (!state.impair.enabled())
+    {
+        return;
+    }
+
+    ImpairStats stats = state.impair.stats();
+    uint64_t passed = stats.delivered + state.impair.queued();
+    LOG_INFO("Impairment: {} messages submitted, {} delivered, {} lost, {} duplicated, {} reordered, "
+             "mean delay {.1} ms, {} delayed at most", stats.submitted, stats.delivered, stats.lost, stats.duplicated,
+             stats.reordered, (passed > 0) ? stats.delayMsTotal / passed : 0.0, stats.maxQueued);
+    if (stats.outages > 0)
+    {
+        LOG_INFO("Impairment: {} outages held {} messages and dropped {}", stats.outages, stats.outageHeld,
+                 stats.outageDropped);
+    }
+    if (state.impair.queued() > 0)
+    {
+        std::fprintf(stderr, "%zu messages were still delayed by the impairment layer.\n", state.impair.queued());
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Prints how often the main loop woke up and the CPU time the process used, to compare --slack settings.
+ **********************************************************************************************************************/
+static void reportScheduler (const SenderState& state, double elapsedMs)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double userMs = usage.ru_utime.tv_sec * 1000.0 + usage.ru_utime.tv_usec / 1000.0;
+    double systemMs = usage.ru_stime.tv_sec * 1000.0 + usage.ru_stime.tv_usec / 1000.0;
+
+    LOG_INFO("Scheduler: {} wakeups ({.2}/s) with {} ms slack, {.1} ms CPU ({.1} ms user, {.1} ms system)",
+             state.wakeups, (elapsedMs > 0.0) ? state.wakeups * 1000.0 / elapsedMs : 0.0, state.config.slackMs,
+             userMs + systemMs, userMs, systemMs);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Signal handler stopping gateway mode.
+ *
+ * @param signal The signal received (e.g., SIGINT, SIGTERM).
+ **********************************************************************************************************************/
+static void handle_signal (int signal)
+{
+    running = false;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in milliseconds.
+ **********************************************************************************************************************/
+static int64_t nowMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Monotonic time in microseconds, the clock of the impairment layer.
+ **********************************************************************************************************************/
+static int64_t nowUs ()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 /***********************************************************************************************************************
@@ -175,47 +1111,161 @@ static std::string calculateChecksum (const std::string& sentence)
 /*******************************************************************************************************************//**
  * @brief Entry point of the GNSS sender application.
  * 
- * Initializes the Mosquitto library and client, connects to the MQTT broker, and periodically publishes GNSS data to
- * a specified topic.
+ * Initializes the Mosquitto library, connects to the MQTT brokers, and periodically publishes GNSS data to a specified
+ * topic. At exit the achieved throughput is reported per broker, so delivery modes can be compared.
  * 
- * @param argc Argument count (not used).
- * @param argv Argument vector (not used).
+ * @param argc Argument count.
+ * @param argv Argument vector, see parseSenderArgs().
  * 
- * @return Exit status code (0 for success, -1 for failure).
+ * @return Exit status code (0 for success, 1 for failure or unconfirmed batches).
  **********************************************************************************************************************/
 int main (int argc, char* argv[])
 {
+    SenderState state;
+    if (!parseSenderArgs(argc, argv, state.config))
+    {
+        std::fprintf(stderr, "Usage: %s [--host H] [--port P] [--broker HOST:PORT]... [--qos 0|1|2]"
+                     " [--device ID] [--client-id ID] [--count N] [--interval-ms MS] [--batch N] [--vehicles N]"
+                     " [--exactly-once | --udp HOST:PORT] [--tls-ca FILE [--tls-cert FILE --tls-key FILE]"
+                     " | --tls-psk HEX --tls-psk-identity ID] [--tls-version tlsv1.2|tlsv1.3] [--tls-ciphers LIST]"
+                     " [--tls-ciphersuites LIST] [--tls-resume 0|1] [--hmac-key HEX]"
+                     " [--input DEVICE=pty:PATH|udp:ADDR:PORT|unix:PATH]... [--log FILE|-] [--speed N|max]"
+                     " [--start YYYY-MM-DD[THH:MM:SS]] [--slack MS]"
+                     " [--impair loss=P|burst:P:R,delay=MS|DIST,dup=P,reorder=P:MS,outage=..,seed=N]\n", argv[0]);
+        return 1;
+    }
+
+    // Log statements only copy their arguments; the text is rendered by gnss_logdecode, or on stdout with "--log -"
+    if (!logOpen(state.config.logPath))
+    {
+        return 1;
+    }
+    if (state.config.slackMs > 0)
+    {
+        logSetIdlePause(state.config.slackMs);
+    }
+
+    state.topic = state.config.deviceId.empty() ? "gnss/data" : "gnss/data/" + state.config.deviceId;
+    state.fixesSent = 0;
+    state.messagesQueued = 0;
+    state.batchStartMs = 0;
+    state.rawBytes = 0;
+    state.uplinkBytes = 0;
+    state.batchesDropped = 0;
+    state.wakeups = 0;
+    std::string impairError;
+    state.impair.configure(state.config.impairSpec, impairError);
+    bool gateway = !state.config.gatewayInputs.empty();
+
+    // Plain batches stay unnumbered: without a device of their own, several senders would share the counter of the
+    // default device and the receiver would drop their fixes as duplicates
+    state.sequenced = state.config.exactlyOnce || !state.config.udpTarget.empty() || !state.config.hmacKey.empty();
+    if (state.sequenced && !loadSequence(state))
+    {
+        std::fprintf(stderr, "Unable to write %s\n", state.sequenceFile.c_str());
+        return 1;
+    }
+
+    if (!state.config.udpTarget.empty())
+    {
+        return runUdpSender(state);
+    }
+    if (state.config.exactlyOnce && !openSpool(state))
+    {
+        return 1;
+    }
+
     // Initialize the Mosquitto library
     mosquitto_lib_init();
 
-    // Create a new Mosquitto client instance
-    struct mosquitto *mosq = mosquitto_new(NULL, true, NULL);
-    if (!mosq)
+    // Create one client per broker. Exactly-once mode uses persistent sessions, so the brokers keep in-flight
+    // messages and the confirmation subscription across reconnects.
+    if (!state.pool.start(state.config.brokers, state.config.clientId, !state.config.exactlyOnce, state.config.tls,
+                          [&state](size_t broker) { on_connect(state, broker); },
+                          [&state](size_t, const struct mosquitto_message* message) { on_message(state, message); }))
     {
-        std::cerr << "Failed to create Mosquitto instance!" << std::endl;
+        mosquitto_lib_cleanup();
         return 1;
     }
+    if (state.config.exactlyOnce)
+    {
+        state.pool.subscribe(ACK_TOPIC_PREFIX + state.config.deviceId, state.config.qos);
+    }
 
-    // Set the publish callback function
-    mosquitto_publish_callback_set(mosq, on_publish);
-
-    // Connect to the MQTT broker
-    if (mosquitto_connect(mosq, "localhost", 1883, 60))
+    // Wait for a first broker; a gateway starts buffering at once instead
+    int64_t connectDeadline = nowMs() + CONNECT_TIMEOUT_MS;
+    while (!gateway && !state.pool.connected() && (nowMs() < connectDeadline))
     {
-        std::cerr << "Unable to connect to the MQTT broker!" << std::endl;
+        state.pool.run(LOOP_TIMEOUT_MS);
+    }
+    if (!gateway && !state.pool.connected())
+    {
+        std::fprintf(stderr, "Unable to connect to the MQTT broker!\n");
+        state.pool.stop();
+        mosquitto_lib_cleanup();
         return 1;
     }
 
-    // Publish GNSS data periodically
-    for (int i = 0; i < 5; ++i)
+    // Publish GNSS data periodically, or forward the local inputs until stopped in gateway mode. Fix times and the
+    // pauses between them follow the clock of the simulation.
+    state.clock.start(state.config.speed, state.config.startMs);
+    auto start = std::chrono::steady_clock::now();
+    if (gateway)
+    {
+        runGateway(state);
+    }
+    else
+    {
+        for (int i = 0; i < state.config.count; ++i)
+        {
+            gnssDataHandler(state);
+            runNetwork(state, (int)state.clock.wait(state.config.intervalMs));
+
+            // Unpaced, the fixes are only held back by the brokers, so that none is dropped from a full buffer
+            while ((state.config.speed == CLOCK_AS_FAST_AS_POSSIBLE) && state.pool.connected() &&
+                   (state.pool.pending() >= SENDER_MAX_BACKLOG))
+            {
+                runNetwork(state, 1);
+            }
+        }
+    }
+    flushBatch(state);
+
+    // Wait until the brokers have taken every message and, in exactly-once mode, the receiver has committed them. A
+    // gateway without uplink leaves its batches in the spool instead.
+    int64_t drainDeadline = nowMs() + DRAIN_TIMEOUT_MS;
+    while ((nowMs() < drainDeadline) && (state.pool.connected() || !gateway) &&
+           (state.config.exactlyOnce ? !state.outbox.empty()
+                                     : ((state.impair.queued() > 0) || (state.pool.pending() > 0) ||
+                                        (acknowledgedCount(state) < state.messagesQueued))))
+    {
+        runNetwork(state, LOOP_TIMEOUT_MS);
+    }
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Sent {} fixes in {} messages at QoS {} in {.0} ms ({.0} fixes/s)", state.fixesSent,
+             state.messagesQueued, state.config.qos, elapsedMs,
+             (elapsedMs > 0.0) ? state.fixesSent * 1000.0 / elapsedMs : 0.0);
+    reportBrokers(state, elapsedMs);
+    reportClock(state, elapsedMs);
+    reportImpairment(state);
+    reportScheduler(state, elapsedMs);
+    if (gateway)
+    {
+        LOG_INFO("Gateway: {} bytes of sentences sent in {} bytes of batches, {} oversized lines discarded, "
+                 "{} unconfirmed batches dropped from a full spool", state.rawBytes, state.uplinkBytes,
+                 state.inputs.linesDiscarded(), state.batchesDropped);
+    }
+    if (state.config.exactlyOnce && !state.outbox.empty())
     {
-        gnssDataHandler(mosq);
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        std::fprintf(stderr, "%zu batches were not confirmed by the receiver and stay spooled for the next run.\n",
+                     state.outbox.size());
     }
 
-    // Cleanup and destroy the Mosquitto client instance
-    mosquitto_destroy(mosq);
+    // Disconnect and destroy the Mosquitto client instances
+    state.pool.stop();
     mosquitto_lib_cleanup();
+    logClose();
 
-    return 0;
+    return (state.outbox.empty() || gateway) ? 0 : 1;
 }
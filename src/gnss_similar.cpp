@@ -0,0 +1,600 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_archive.h"
+#include "../inc/gnss_similarity.h"
+#include "../inc/gnss_clock.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define SIMILAR_SLICE_STEPS     (16U)             /* Grid steps per time slice of the prefilter */
+#define METRES_PER_DEGREE       (111320.0)        /* Length of a degree of latitude */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Command line options of the search */
+struct SimilarConfig
+{
+    std::string archivePath;
+    std::string device;         /* Reference device of the archive, or */
+    std::string trackPath;      /* reference track file of "<time> <lat> <lon>" lines */
+    std::string outPath;        /* Empty or "-" for the standard output */
+    SimilarityMetric metric;
+    int64_t fromMs;
+    int64_t toMs;
+    int64_t stepMs;
+    int64_t bandMs;
+    int64_t maxGapMs;
+    double radiusM;
+    double minOverlap;
+    unsigned top;
+    unsigned threads;
+};
+
+/* Bounding box in degrees of the reference during one time slice, widened by the radius */
+struct SimilarSlice
+{
+    bool valid;                 /* The reference has points in the slice */
+    int32_t minLatE7, minLonE7, maxLatE7, maxLonE7;
+};
+
+/* A scored device */
+struct SimilarMatch
+{
+    uint32_t device;
+    double distanceM;
+    double overlap;             /* Grid points compared and covered by the device, over those of the reference */
+    size_t first;               /* Grid points compared */
+    size_t last;
+};
+
+/* Counters and best matches of one thread */
+struct SimilarWorker
+{
+    std::vector<SimilarMatch> best;     /* Heap of the top matches, the worst on top */
+    uint64_t candidates;                /* Devices through the prefilter */
+    uint64_t scored;                    /* Of those, overlapping enough to be aligned */
+    uint64_t abandoned;                 /* Of those, given up once certain to miss the top */
+    uint64_t fixes;                     /* Fixes decompressed */
+    bool failed;
+};
+
+/* Work shared by the threads */
+struct SimilarJob
+{
+    SimilarConfig config;
+    ArchiveReader archive;
+    uint32_t reference;                 /* Index of the reference device, UINT32_MAX for a track file */
+    SimilarityOrigin origin;
+    SimilarityTrack track;              /* The reference on the grid */
+    std::vector<SimilarSlice> slices;
+    size_t validSlices;
+    std::atomic<uint32_t> nextDevice;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool parseSimilarArgs(int argc, char* argv[], SimilarConfig& config);
+static bool parseSeconds(const std::string& text, int64_t minSeconds, int64_t maxSeconds, int64_t& valueMs);
+static bool readDevice(const SimilarJob& job, uint32_t device, int64_t fromMs, int64_t toMs,
+                       std::vector<FixSample>& samples);
+static bool readTrack(const std::string& path, std::vector<FixSample>& samples);
+static bool prepareReference(SimilarJob& job);
+static bool passesPrefilter(const SimilarJob& job, uint32_t device);
+static bool betterMatch(const SimilarMatch& a, const SimilarMatch& b);
+static void searchLoop(SimilarJob& job, SimilarWorker& worker);
+static void formatTime(int64_t timeMs, char* out, size_t size);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parses the command line options of the search.
+ *
+ * @return False if an option is unknown or invalid.
+ **********************************************************************************************************************/
+static bool parseSimilarArgs (int argc, char* argv[], SimilarConfig& config)
+{
+    config.metric = SIMILARITY_DTW;
+    config.fromMs = INT64_MIN;
+    config.toMs = INT64_MAX;
+    config.stepMs = 10000;
+    config.bandMs = 60000;
+    config.maxGapMs = 120000;
+    config.radiusM = 200.0;
+    config.minOverlap = 0.5;
+    config.top = 20;
+    config.threads = std::max(1U, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        char* end = nullptr;
+        bool ok = !value.empty();
+
+        if (option == "--archive")
+        {
+            config.archivePath = value;
+        }
+        else if (option == "--device")
+        {
+            config.device = value;
+        }
+        else if (option == "--track")
+        {
+            config.trackPath = value;
+        }
+        else if (option == "--out")
+        {
+            config.outPath = value;
+        }
+        else if (option == "--metric")
+        {
+            ok = (value == "dtw") || (value == "frechet");
+            config.metric = (value == "frechet") ? SIMILARITY_FRECHET : SIMILARITY_DTW;
+        }
+        else if (option == "--from")
+        {
+            ok = parseClockStart(value, config.fromMs);
+        }
+        else if (option == "--to")
+        {
+            ok = parseClockStart(value, config.toMs);
+        }
+        else if (option == "--step-s")
+        {
+            ok = parseSeconds(value, 1, 3600, config.stepMs);
+        }
+        else if (option == "--band-s")
+        {
+            ok = parseSeconds(value, 0, 86400, config.bandMs);
+        }
+        else if (option == "--max-gap-s")
+        {
+            ok = parseSeconds(value, 1, 86400, config.maxGapMs);
+        }
+        else if (option == "--radius-m")
+        {
+            config.radiusM = std::strtod(value.c_str(), &end);
+            ok = (*end == '\0') && (config.radiusM > 0.0) && (config.radiusM <= 1e6);
+        }
+        else if (option == "--min-overlap")
+        {
+            config.minOverlap = std::strtod(value.c_str(), &end);
+            ok = (*end == '\0') && (config.minOverlap > 0.0) && (config.minOverlap <= 1.0);
+        }
+        else if ((option == "--top") || (option == "--threads"))
+        {
+            unsigned long number = std::strtoul(value.c_str(), &end, 10);
+            ok = (*end == '\0') && (number >= 1) && (number <= ((option == "--top") ? 100000UL : 256UL));
+            ((option == "--top") ? config.top : config.threads) = (unsigned)number;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (config.archivePath.empty() || (config.device.empty() == config.trackPath.empty()))
+    {
+        std::cerr << "--archive and either --device or --track are required" << std::endl;
+        return false;
+    }
+    if (config.bandMs / config.stepMs > SIMILARITY_MAX_BAND)
+    {
+        std::cerr << "--band-s may be at most " << SIMILARITY_MAX_BAND << " steps" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses a whole number of seconds within the given bounds into milliseconds.
+ **********************************************************************************************************************/
+static bool parseSeconds (const std::string& text, int64_t minSeconds, int64_t maxSeconds, int64_t& valueMs)
+{
+    char* end = nullptr;
+    long long seconds = std::strtoll(text.c_str(), &end, 10);
+    valueMs = seconds * 1000;
+    return !text.empty() && (*end == '\0') && (seconds >= minSeconds) && (seconds <= maxSeconds);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Decompresses the fixes of a device within a time range.
+ *
+ * @return False if a chunk is corrupt.
+ **********************************************************************************************************************/
+static bool readDevice (const SimilarJob& job, uint32_t device, int64_t fromMs, int64_t toMs,
+                        std::vector<FixSample>& samples)
+{
+    const std::vector<ArchiveChunk>& chunks = job.archive.chunks();
+    auto begin = chunks.begin() + job.archive.firstChunk(device);
+    auto end = chunks.begin() + job.archive.firstChunk(device + 1);
+    std::vector<FixSample> decoded;
+
+    samples.clear();
+    auto before = [](const ArchiveChunk& c, int64_t t) { return c.lastMs < t; };
+    for (auto chunk = std::lower_bound(begin, end, fromMs, before); (chunk != end) && (chunk->firstMs <= toMs); ++chunk)
+    {
+        if (!job.archive.read(*chunk, decoded))
+        {
+            std::cerr << "Corrupt chunk of " << job.archive.devices()[device] << std::endl;
+            return false;
+        }
+        for (const FixSample& sample : decoded)
+        {
+            if ((sample.timestampMs >= fromMs) && (sample.timestampMs <= toMs))
+            {
+                samples.push_back(sample);
+            }
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads a reference track of "<time> <lat> <lon>" lines, the time in UTC as "YYYY-MM-DDTHH:MM:SS" or Unix
+ *        seconds; blank lines and lines starting with '#' are ignored.
+ **********************************************************************************************************************/
+static bool readTrack (const std::string& path, std::vector<FixSample>& samples)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        std::cerr << "Unable to open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (int lineNo = 1; std::getline(input, line); ++lineNo)
+    {
+        std::istringstream fields(line);
+        std::string time;
+        double lat, lon;
+        if (!(fields >> time) || (time[0] == '#'))
+        {
+            continue;
+        }
+        FixSample sample = {};
+        if (!parseClockStart(time, sample.timestampMs) || !(fields >> lat >> lon) || (std::fabs(lat) > 90.0) ||
+            (std::fabs(lon) > 180.0) || (!samples.empty() && (sample.timestampMs <= samples.back().timestampMs)))
+        {
+            std::cerr << path << " line " << lineNo << ": expected '<time> <lat> <lon>' in time order" << std::endl;
+            return false;
+        }
+        sample.latE7 = (int32_t)std::lround(lat * 1e7);
+        sample.lonE7 = (int32_t)std::lround(lon * 1e7);
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Loads the reference, puts it on the grid and computes the boxes of the prefilter.
+ *
+ * The grid runs over the span of the reference within --from and --to. Each slice of SIMILAR_SLICE_STEPS steps gets
+ * the bounding box of the reference during the slice, widened by --radius-m.
+ **********************************************************************************************************************/
+static bool prepareReference (SimilarJob& job)
+{
+    const SimilarConfig& config = job.config;
+    std::vector<FixSample> samples;
+    job.reference = UINT32_MAX;
+    if (!config.device.empty())
+    {
+        const std::vector<std::string>& devices = job.archive.devices();
+        job.reference = (uint32_t)(std::find(devices.begin(), devices.end(), config.device) - devices.begin());
+        if (job.reference == devices.size())
+        {
+            std::cerr << "No device " << config.device << " in " << config.archivePath << std::endl;
+            return false;
+        }
+        if (!readDevice(job, job.reference, config.fromMs, config.toMs, samples))
+        {
+            return false;
+        }
+    }
+    else if (!readTrack(config.trackPath, samples))
+    {
+        return false;
+    }
+
+    samples.erase(std::remove_if(samples.begin(), samples.end(), [&config](const FixSample& s) {
+                      return (s.timestampMs < config.fromMs) || (s.timestampMs > config.toMs);
+                  }), samples.end());
+    if ((samples.size() < 2) || (samples.back().timestampMs - samples.front().timestampMs < config.stepMs))
+    {
+        std::cerr << "The reference needs fixes over at least one step within the time range" << std::endl;
+        return false;
+    }
+
+    int64_t startMs = samples.front().timestampMs;
+    size_t count = (size_t)((samples.back().timestampMs - startMs) / config.stepMs) + 1;
+    job.origin = makeSimilarityOrigin(samples.front().latE7 * 1e-7, samples.front().lonE7 * 1e-7);
+    resampleTrack(samples, job.origin, startMs, config.stepMs, count, config.maxGapMs, job.track);
+
+    double dLat = config.radiusM / METRES_PER_DEGREE;
+    double dLon = config.radiusM / job.origin.metresPerDegLon;
+    job.slices.assign((count + SIMILAR_SLICE_STEPS - 1) / SIMILAR_SLICE_STEPS, SimilarSlice{ false, 0, 0, 0, 0 });
+    job.validSlices = 0;
+    for (size_t s = 0; s < job.slices.size(); ++s)
+    {
+        double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+        for (size_t k = s * SIMILAR_SLICE_STEPS; k < std::min(count, (s + 1) * SIMILAR_SLICE_STEPS); ++k)
+        {
+            if (!std::isnan(job.track.x[k]))
+            {
+                minX = std::min(minX, job.track.x[k]);
+                maxX = std::max(maxX, job.track.x[k]);
+                minY = std::min(minY, job.track.y[k]);
+                maxY = std::max(maxY, job.track.y[k]);
+            }
+        }
+        if (minX <= maxX)
+        {
+            SimilarSlice& slice = job.slices[s];
+            slice.valid = true;
+            slice.minLatE7 = (int32_t)std::floor((job.origin.lat + minY / METRES_PER_DEGREE - dLat) * 1e7);
+            slice.maxLatE7 = (int32_t)std::ceil((job.origin.lat + maxY / METRES_PER_DEGREE + dLat) * 1e7);
+            slice.minLonE7 = (int32_t)std::floor((job.origin.lon + minX / job.origin.metresPerDegLon - dLon) * 1e7);
+            slice.maxLonE7 = (int32_t)std::ceil((job.origin.lon + maxX / job.origin.metresPerDegLon + dLon) * 1e7);
+            ++job.validSlices;
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a device may have been near the reference often enough, from the directory of the archive alone.
+ *
+ * A slice is hit when a chunk of the device overlapping it in time has a bounding box meeting the box of the slice;
+ * the device passes when at least --min-overlap of the slices are hit.
+ **********************************************************************************************************************/
+static bool passesPrefilter (const SimilarJob& job, uint32_t device)
+{
+    const SimilarityTrack& track = job.track;
+    const std::vector<ArchiveChunk>& chunks = job.archive.chunks();
+    auto begin = chunks.begin() + job.archive.firstChunk(device);
+    auto end = chunks.begin() + job.archive.firstChunk(device + 1);
+    int64_t sliceMs = track.stepMs * SIMILAR_SLICE_STEPS;
+    int64_t endMs = track.startMs + (int64_t)job.slices.size() * sliceMs;
+    std::vector<bool> hit(job.slices.size(), false);
+    size_t hits = 0;
+
+    auto before = [](const ArchiveChunk& c, int64_t t) { return c.lastMs < t; };
+    auto chunk = std::lower_bound(begin, end, track.startMs, before);
+    for (; (chunk != end) && (chunk->firstMs < endMs); ++chunk)
+    {
+        size_t first = (size_t)(std::max<int64_t>(chunk->firstMs - track.startMs, 0) / sliceMs);
+        size_t last = std::min((size_t)((chunk->lastMs - track.startMs) / sliceMs), job.slices.size() - 1);
+        for (size_t s = first; s <= last; ++s)
+        {
+            const SimilarSlice& slice = job.slices[s];
+            if (slice.valid && !hit[s] && (chunk->minLatE7 <= slice.maxLatE7) && (slice.minLatE7 <= chunk->maxLatE7) &&
+                (chunk->minLonE7 <= slice.maxLonE7) && (slice.minLonE7 <= chunk->maxLonE7))
+            {
+                hit[s] = true;
+                ++hits;
+            }
+        }
+    }
+    return (double)hits >= job.config.minOverlap * (double)job.validSlices;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Orders matches by distance, then by device, so that the result does not depend on the threads.
+ **********************************************************************************************************************/
+static bool betterMatch (const SimilarMatch& a, const SimilarMatch& b)
+{
+    return (a.distanceM != b.distanceM) ? (a.distanceM < b.distanceM) : (a.device < b.device);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Search thread: takes the next device, prefilters it, puts it on the grid and aligns it with the reference.
+ *
+ * Each thread keeps its own top matches; once it has --top of them, an alignment is abandoned as soon as it is
+ * certain to be farther than the worst of them.
+ **********************************************************************************************************************/
+static void searchLoop (SimilarJob& job, SimilarWorker& worker)
+{
+    const SimilarConfig& config = job.config;
+    const SimilarityTrack& reference = job.track;
+    uint32_t devices = (uint32_t)job.archive.devices().size();
+    unsigned band = (unsigned)(config.bandMs / config.stepMs);
+    int64_t endMs = reference.startMs + (int64_t)(reference.x.size() - 1) * reference.stepMs;
+    std::vector<FixSample> samples;
+    SimilarityTrack track;
+
+    for (uint32_t device = job.nextDevice++; (device < devices) && !worker.failed; device = job.nextDevice++)
+    {
+        if ((device == job.reference) || !passesPrefilter(job, device))
+        {
+            continue;
+        }
+        ++worker.candidates;
+        if (!readDevice(job, device, reference.startMs - config.maxGapMs, endMs + config.maxGapMs, samples))
+        {
+            worker.failed = true;
+            break;
+        }
+        worker.fixes += samples.size();
+        resampleTrack(samples, job.origin, reference.startMs, reference.stepMs, reference.x.size(), config.maxGapMs,
+                      track);
+
+        // Compare where both are on the grid, less the points the device only bridges over a long gap
+        size_t first = std::max(reference.first, track.first);
+        size_t last = std::min(reference.last, track.last);
+        double overlap = (last <= first) ? 0.0 : (double)std::min(last - first, track.covered) /
+                                                 (double)(reference.last - reference.first);
+        if ((last < first + 2) || (overlap < config.minOverlap))
+        {
+            continue;
+        }
+        ++worker.scored;
+
+        double limitM = (worker.best.size() < config.top) ? INFINITY : worker.best.front().distanceM;
+        double distanceM = trackDistance(config.metric, &reference.x[first], &reference.y[first], &track.x[first],
+                                         &track.y[first], last - first, band, limitM);
+        if (std::isinf(distanceM))
+        {
+            ++worker.abandoned;
+            continue;
+        }
+
+        SimilarMatch match = { device, distanceM, overlap, first, last };
+        if ((worker.best.size() < config.top) || betterMatch(match, worker.best.front()))
+        {
+            worker.best.push_back(match);
+            std::push_heap(worker.best.begin(), worker.best.end(), betterMatch);
+            if (worker.best.size() > config.top)
+            {
+                std::pop_heap(worker.best.begin(), worker.best.end(), betterMatch);
+                worker.best.pop_back();
+            }
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Formats Unix milliseconds as "YYYY-MM-DDTHH:MM:SS.mmmZ".
+ **********************************************************************************************************************/
+static void formatTime (int64_t timeMs, char* out, size_t size)
+{
+    time_t seconds = (time_t)(timeMs / 1000);
+    std::tm tm;
+    gmtime_r(&seconds, &tm);
+    std::snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(timeMs % 1000));
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Finds the devices of an archive that travelled with a reference device, or along a reference track.
+ *
+ * "gnss_similar --archive FILE (--device ID | --track FILE) [--from TIME] [--to TIME] [--metric dtw|frechet]
+ * [--step-s S] [--band-s S] [--max-gap-s S] [--radius-m M] [--min-overlap F] [--top N] [--threads N] [--out FILE]"
+ * puts the reference on a grid of --step-s over its span and keeps the devices whose chunks, by their time range and
+ * bounding box alone, come within --radius-m of it in at least --min-overlap of its time slices. Those are put on the
+ * same grid and aligned with the reference on several threads, allowing one to lead or lag the other by up to
+ * --band-s: DTW gives the root mean square distance along the best alignment, Frechet the largest. It writes the --top
+ * closest as CSV, "device,distance_m,overlap,first,last", first and last bounding the compared part of the grid.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    SimilarJob job;
+    if (!parseSimilarArgs(argc, argv, job.config))
+    {
+        std::cerr << "Usage: " << argv[0] << " --archive FILE (--device ID | --track FILE) [--from TIME] [--to TIME]"
+                  << " [--metric dtw|frechet] [--step-s S] [--band-s S] [--max-gap-s S] [--radius-m M]"
+                  << " [--min-overlap F] [--top N] [--threads N] [--out FILE]" << std::endl;
+        return 1;
+    }
+    const SimilarConfig& config = job.config;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!job.archive.open(config.archivePath) || !prepareReference(job))
+    {
+        return 1;
+    }
+
+    job.nextDevice = 0;
+    std::vector<SimilarWorker> workers(config.threads, SimilarWorker{ {}, 0, 0, 0, 0, false });
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < config.threads; ++t)
+    {
+        threads.emplace_back(searchLoop, std::ref(job), std::ref(workers[t]));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    SimilarWorker total = { {}, 0, 0, 0, 0, false };
+    for (const SimilarWorker& worker : workers)
+    {
+        total.best.insert(total.best.end(), worker.best.begin(), worker.best.end());
+        total.candidates += worker.candidates;
+        total.scored += worker.scored;
+        total.abandoned += worker.abandoned;
+        total.fixes += worker.fixes;
+        total.failed = total.failed || worker.failed;
+    }
+    std::sort(total.best.begin(), total.best.end(), betterMatch);
+    total.best.resize(std::min<size_t>(total.best.size(), config.top));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool toStdout = config.outPath.empty() || (config.outPath == "-");
+    FILE* out = toStdout ? stdout : std::fopen(config.outPath.c_str(), "w");
+    if (out == nullptr)
+    {
+        std::cerr << "Unable to open " << config.outPath << std::endl;
+        return 1;
+    }
+    char first[64];
+    char last[64];
+    bool ok = (std::fputs("device,distance_m,overlap,first,last\n", out) >= 0);
+    for (const SimilarMatch& match : total.best)
+    {
+        formatTime(job.track.startMs + (int64_t)match.first * job.track.stepMs, first, sizeof(first));
+        formatTime(job.track.startMs + (int64_t)(match.last - 1) * job.track.stepMs, last, sizeof(last));
+        ok = ok && (std::fprintf(out, "%s,%.1f,%.3f,%s,%s\n", job.archive.devices()[match.device].c_str(),
+                                 match.distanceM, match.overlap, first, last) > 0);
+    }
+    ok = (toStdout ? (std::fflush(out) == 0) : (std::fclose(out) == 0)) && ok && !total.failed;
+    if (!ok)
+    {
+        std::cerr << "Unable to write " << config.outPath << std::endl;
+    }
+
+    std::cerr << "Searched " << job.archive.devices().size() << " devices against " << job.track.x.size()
+              << " grid points in " << std::fixed << std::setprecision(2) << seconds << " s on " << config.threads
+              << " threads: " << total.candidates << " through the prefilter, " << total.scored << " aligned ("
+              << total.abandoned << " abandoned), " << total.fixes << " fixes decompressed" << std::endl;
+    return ok ? 0 : 1;
+}
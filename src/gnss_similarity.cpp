@@ -0,0 +1,210 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_similarity.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define METRES_PER_DEGREE       (111320.0)        /* Length of a degree of latitude */
+#define SIMILARITY_LANES        (64U)             /* Lanes of the widest kernel, 2 * SIMILARITY_MAX_BAND + 2 */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static const double infinity = std::numeric_limits<double>::infinity();
+
+/*******************************************************************************************************************//**
+ * @brief The smaller of two costs, written as the comparison minpd implements so that fixed-length loops over it
+ *        vectorize (std::min compares the other way round).
+ **********************************************************************************************************************/
+static inline double lesser (double a, double b)
+{
+    return (a < b) ? a : b;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The larger of two costs, as maxpd implements it.
+ **********************************************************************************************************************/
+static inline double greater (double a, double b)
+{
+    return (a > b) ? a : b;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Aligns two tracks of the same length within a band, on squared distances.
+ *
+ * The dynamic programme runs in band coordinates: lane k of row i is point j = i - band + k of b, so the cell above
+ * is lane k + 1 of the previous row, the diagonal lane k and the left neighbour lane k - 1 of the same row. The
+ * squared distances of a row and the better of the cells above and diagonal are computed over all Lanes lanes, a
+ * fixed length the compiler vectorizes; only the chain through the left neighbours is walked one lane at a time, and
+ * only over the 2 * band + 1 lanes of the band. Lanes of b outside the track read +inf from the padding.
+ *
+ * @param bx Eastings of b, preceded by band and followed by Lanes values of +inf.
+ * @param limit Squared distance (Frechet) or sum of squared distances (DTW) beyond which the alignment is abandoned.
+ *
+ * @return The squared Frechet distance or the sum of squared distances along the warping path, +inf if abandoned.
+ **********************************************************************************************************************/
+template <size_t Lanes, bool Frechet>
+static double alignTracks (const double* __restrict ax, const double* __restrict ay, const double* __restrict bx,
+                           const double* __restrict by, size_t count, unsigned band, double limit)
+{
+    double rows[2][Lanes + 1];
+    double cost[Lanes];
+    double best[Lanes];
+    double* prev = rows[0];
+    double* curr = rows[1];
+    std::fill(rows[0], rows[0] + 2 * (Lanes + 1), infinity);
+    prev[band] = 0.0;               // Virtual cell before (0, 0), so that the path starts there
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double x = ax[i];
+        const double y = ay[i];
+        const double* rowX = bx + i;
+        const double* rowY = by + i;
+        for (size_t k = 0; k < Lanes; ++k)
+        {
+            double dx = rowX[k] - x;
+            double dy = rowY[k] - y;
+            cost[k] = dx * dx + dy * dy;
+        }
+        for (size_t k = 0; k < Lanes; ++k)
+        {
+            best[k] = lesser(prev[k], prev[k + 1]);
+        }
+
+        double left = infinity;
+        double rowMin = infinity;
+        for (size_t k = 0; k <= 2 * band; ++k)
+        {
+            left = Frechet ? greater(cost[k], lesser(best[k], left)) : cost[k] + lesser(best[k], left);
+            curr[k] = left;
+            rowMin = lesser(rowMin, left);
+        }
+        if (rowMin > limit)
+        {
+            return infinity;
+        }
+        std::swap(prev, curr);
+    }
+    return prev[band];
+}
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief The projection around a point, usually the first point of the reference track.
+ **********************************************************************************************************************/
+SimilarityOrigin makeSimilarityOrigin (double lat, double lon)
+{
+    return SimilarityOrigin{ lat, lon, METRES_PER_DEGREE * std::cos(lat * M_PI / 180.0) };
+}
+
+/*******************************************************************************************************************//**
+ * @brief Resamples the fixes of one device on a regular time grid.
+ *
+ * @param samples The fixes in time order.
+ * @param origin Projection to metres.
+ * @param startMs Time of the first grid point.
+ * @param stepMs Time between grid points.
+ * @param count Grid points.
+ * @param maxGapMs Largest time between the fixes around a grid point for it to count as covered.
+ * @param out The resampled track.
+ **********************************************************************************************************************/
+void resampleTrack (const std::vector<FixSample>& samples, const SimilarityOrigin& origin, int64_t startMs,
+                    int64_t stepMs, size_t count, int64_t maxGapMs, SimilarityTrack& out)
+{
+    out.startMs = startMs;
+    out.stepMs = stepMs;
+    out.x.assign(count, std::nan(""));
+    out.y.assign(count, std::nan(""));
+    out.first = count;
+    out.last = 0;
+    out.covered = 0;
+
+    size_t p = 0;
+    for (size_t k = 0; (k < count) && !samples.empty(); ++k)
+    {
+        int64_t timeMs = startMs + (int64_t)k * stepMs;
+        while ((p + 1 < samples.size()) && (samples[p + 1].timestampMs <= timeMs))
+        {
+            ++p;
+        }
+        const FixSample& a = samples[p];
+        const FixSample& b = samples[std::min(p + 1, samples.size() - 1)];
+        if ((timeMs < a.timestampMs) || (timeMs > b.timestampMs))
+        {
+            continue;
+        }
+
+        double f = (b.timestampMs > a.timestampMs) ? (double)(timeMs - a.timestampMs) / (b.timestampMs - a.timestampMs)
+                                                   : 0.0;
+        double lat = (a.latE7 + f * ((double)b.latE7 - a.latE7)) * 1e-7;
+        double lon = (a.lonE7 + f * ((double)b.lonE7 - a.lonE7)) * 1e-7;
+        out.x[k] = (lon - origin.lon) * origin.metresPerDegLon;
+        out.y[k] = (lat - origin.lat) * METRES_PER_DEGREE;
+        out.first = std::min(out.first, k);
+        out.last = k + 1;
+        out.covered += (b.timestampMs - a.timestampMs <= maxGapMs) ? 1 : 0;
+    }
+    if (out.first > out.last)
+    {
+        out.first = out.last;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Distance between two tracks on the same grid, aligned within a band so that one may lead or lag the other.
+ *
+ * @param metric DTW or discrete Frechet.
+ * @param ax Eastings of the first track in metres.
+ * @param ay Northings of the first track.
+ * @param bx Eastings of the second track.
+ * @param by Northings of the second track.
+ * @param count Points of each track, all finite.
+ * @param band Largest shift between matched points, in grid steps, up to SIMILARITY_MAX_BAND.
+ * @param limitM Distance in metres beyond which the result does not matter: the alignment is abandoned as soon as it
+ *               is certain to exceed it.
+ *
+ * @return The distance in metres, +inf if it exceeds limitM.
+ **********************************************************************************************************************/
+double trackDistance (SimilarityMetric metric, const double* ax, const double* ay, const double* bx, const double* by,
+                      size_t count, unsigned band, double limitM)
+{
+    band = std::min(band, SIMILARITY_MAX_BAND);
+    std::vector<double> paddedX(count + SIMILARITY_LANES, infinity);
+    std::vector<double> paddedY(paddedX.size(), infinity);
+    std::copy(bx, bx + count, paddedX.begin() + band);
+    std::copy(by, by + count, paddedY.begin() + band);
+
+    double result;
+    double limit = limitM * limitM;
+    if (metric == SIMILARITY_FRECHET)
+    {
+        result = (band < 8)  ? alignTracks<16, true>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit)
+               : (band < 16) ? alignTracks<32, true>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit)
+                             : alignTracks<64, true>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit);
+        return std::sqrt(result);
+    }
+
+    limit *= (double)count;
+    result = (band < 8)  ? alignTracks<16, false>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit)
+           : (band < 16) ? alignTracks<32, false>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit)
+                         : alignTracks<64, false>(ax, ay, paddedX.data(), paddedY.data(), count, band, limit);
+    return std::sqrt(result / (double)std::max<size_t>(count, 1));
+}
@@ -0,0 +1,411 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_subscriptions.h"
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define PUSH_LINE_MAX           (160U)            /* Upper bound of one formatted update line */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool validLatitude(double value);
+static bool validLongitude(double value);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty subscription engine.
+ **********************************************************************************************************************/
+SubscriptionEngine::SubscriptionEngine ()
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Registers or replaces the filters of a client.
+ *
+ * The specification holds one filter per line:
+ *   - "bbox <minLat> <minLon> <maxLat> <maxLon>" matches fixes inside the rectangle. A minLon greater than maxLon
+ *     describes a box crossing the antimeridian.
+ *   - "devices <id>[,<id>...]" matches fixes of the listed devices.
+ * An empty specification removes the client.
+ *
+ * @param clientId The client to register.
+ * @param spec The filter specification.
+ * @param error Set to a description of the problem if the specification is rejected.
+ *
+ * @return True if the filters were installed, false if the specification is invalid.
+ **********************************************************************************************************************/
+bool SubscriptionEngine::registerClient (const std::string& clientId, const std::string& spec, std::string& error)
+{
+    Client client;
+    client.lastFlushMs = 0;
+
+    std::istringstream lines(spec);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+        {
+            continue;   // Blank line
+        }
+
+        if (kind == "bbox")
+        {
+            Rect r;
+            if (!(fields >> r.minLat >> r.minLon >> r.maxLat >> r.maxLon) ||
+                !validLatitude(r.minLat) || !validLatitude(r.maxLat) || (r.minLat > r.maxLat) ||
+                !validLongitude(r.minLon) || !validLongitude(r.maxLon))
+            {
+                error = "invalid bbox: " + line;
+                return false;
+            }
+
+            if (r.minLon > r.maxLon)
+            {
+                // Split a box crossing the antimeridian into its eastern and western halves
+                Rect west = r;
+                west.minLon = -180.0;
+                r.maxLon = 180.0;
+                client.rects.push_back(west);
+            }
+            client.rects.push_back(r);
+        }
+        else if (kind == "devices")
+        {
+            std::string list;
+            fields >> list;
+            std::istringstream ids(list);
+            std::string id;
+            while (std::getline(ids, id, ','))
+            {
+                if (!id.empty())
+                {
+                    client.devices.push_back(id);
+                }
+            }
+            if (list.empty())
+            {
+                error = "empty device list";
+                return false;
+            }
+        }
+        else
+        {
+            error = "unknown filter: " + kind;
+            return false;
+        }
+    }
+
+    removeClient(clientId);
+    if (client.rects.empty() && client.devices.empty())
+    {
+        return true;
+    }
+
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        clients[slot] = client;
+        slotClients[slot] = clientId;
+    }
+    else
+    {
+        slot = (uint32_t)clients.size();
+        clients.push_back(client);
+        slotClients.push_back(clientId);
+    }
+
+    slots[clientId] = slot;
+    indexClient(slot, clients[slot]);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes all filters of a client. Updates not yet pushed are discarded.
+ *
+ * @param clientId The client to remove.
+ **********************************************************************************************************************/
+void SubscriptionEngine::removeClient (const std::string& clientId)
+{
+    auto it = slots.find(clientId);
+    if (it == slots.end())
+    {
+        return;
+    }
+
+    uint32_t slot = it->second;
+    unindexClient(slot, clients[slot]);
+    clients[slot] = Client();
+    slotClients[slot].clear();
+    dirty.erase(slot);
+    freeSlots.push_back(slot);
+    slots.erase(it);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Matches a fix against the candidate subscriptions of its grid cell and device.
+ *
+ * Matching fixes are coalesced per client, keeping only the latest fix of each device until the next flush.
+ *
+ * @param fix The incoming fix.
+ *
+ * @return Number of subscription matches of the fix.
+ **********************************************************************************************************************/
+size_t SubscriptionEngine::match (const GNSSFix& fix)
+{
+    size_t matched = 0;
+
+    auto queue = [&](uint32_t slot)
+    {
+        Client& client = clients[slot];
+        GNSSFix& pending = client.pending[fix.deviceId];
+        if (pending.deviceId.empty() || (pending.timestampMs <= fix.timestampMs))
+        {
+            pending = fix;
+        }
+        dirty.insert(slot);
+        ++matched;
+    };
+
+    auto testRects = [&](uint32_t slot)
+    {
+        for (const Rect& r : clients[slot].rects)
+        {
+            if ((fix.latitude >= r.minLat) && (fix.latitude <= r.maxLat) &&
+                (fix.longitude >= r.minLon) && (fix.longitude <= r.maxLon))
+            {
+                queue(slot);
+                return;
+            }
+        }
+    };
+
+    auto cell = cells.find(cellKey(cellOf(fix.latitude), cellOf(fix.longitude)));
+    if (cell != cells.end())
+    {
+        for (uint32_t slot : cell->second)
+        {
+            testRects(slot);
+        }
+    }
+
+    for (uint32_t slot : wideClients)
+    {
+        testRects(slot);
+    }
+
+    auto device = deviceIndex.find(fix.deviceId);
+    if (device != deviceIndex.end())
+    {
+        for (uint32_t slot : device->second)
+        {
+            queue(slot);
+        }
+    }
+
+    return matched;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Pushes the coalesced updates of every client whose window has elapsed or whose batch is full.
+ *
+ * Each batch holds one line per device: "<device>,<timestampMs>,<lat>,<lon>,<speedKnots>,<course>".
+ *
+ * @param nowMs Current time in milliseconds.
+ * @param publish Called once per client batch.
+ *
+ * @return Number of batches pushed.
+ **********************************************************************************************************************/
+size_t SubscriptionEngine::flush (int64_t nowMs, const PushPublisher& publish)
+{
+    size_t pushed = 0;
+    char line[PUSH_LINE_MAX];
+
+    for (auto it = dirty.begin(); it != dirty.end(); )
+    {
+        Client& client = clients[*it];
+        if ((nowMs - client.lastFlushMs < SUBSCRIPTION_FLUSH_MS) && (client.pending.size() < SUBSCRIPTION_MAX_BATCH))
+        {
+            ++it;
+            continue;
+        }
+
+        std::string payload;
+        payload.reserve(client.pending.size() * 64);
+        for (const auto& entry : client.pending)
+        {
+            const GNSSFix& fix = entry.second;
+            int len = std::snprintf(line, sizeof(line), ",%lld,%.7f,%.7f,%.2f,%.2f\n", (long long)fix.timestampMs,
+                                    fix.latitude, fix.longitude, fix.speedKnots, fix.course);
+            payload += fix.deviceId;
+            payload.append(line, std::min((size_t)len, sizeof(line) - 1));
+        }
+
+        publish(slotClients[*it], payload);
+        client.pending.clear();
+        client.lastFlushMs = nowMs;
+        ++pushed;
+        it = dirty.erase(it);
+    }
+
+    return pushed;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of clients with at least one filter.
+ **********************************************************************************************************************/
+size_t SubscriptionEngine::clientCount () const
+{
+    return slots.size();
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Adds a client to the grid cells its rectangles overlap and to the index of its devices.
+ **********************************************************************************************************************/
+void SubscriptionEngine::indexClient (uint32_t slot, const Client& client)
+{
+    bool wide = false;
+    for (const Rect& r : client.rects)
+    {
+        size_t latCells = (size_t)(cellOf(r.maxLat) - cellOf(r.minLat) + 1);
+        size_t lonCells = (size_t)(cellOf(r.maxLon) - cellOf(r.minLon) + 1);
+        if (latCells * lonCells > SUBSCRIPTION_MAX_CELLS)
+        {
+            wide = true;
+        }
+    }
+
+    if (wide)
+    {
+        wideClients.push_back(slot);
+    }
+    else
+    {
+        for (const Rect& r : client.rects)
+        {
+            for (int lat = cellOf(r.minLat); lat <= cellOf(r.maxLat); ++lat)
+            {
+                for (int lon = cellOf(r.minLon); lon <= cellOf(r.maxLon); ++lon)
+                {
+                    std::vector<uint32_t>& cell = cells[cellKey(lat, lon)];
+                    if (cell.empty() || (cell.back() != slot))
+                    {
+                        cell.push_back(slot);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const std::string& device : client.devices)
+    {
+        std::vector<uint32_t>& subscribers = deviceIndex[device];
+        if (std::find(subscribers.begin(), subscribers.end(), slot) == subscribers.end())
+        {
+            subscribers.push_back(slot);
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Removes a client from the grid and device indexes.
+ **********************************************************************************************************************/
+void SubscriptionEngine::unindexClient (uint32_t slot, const Client& client)
+{
+    auto dropSlot = [slot](std::vector<uint32_t>& list)
+    {
+        list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+    };
+
+    dropSlot(wideClients);
+    for (const Rect& r : client.rects)
+    {
+        for (int lat = cellOf(r.minLat); lat <= cellOf(r.maxLat); ++lat)
+        {
+            for (int lon = cellOf(r.minLon); lon <= cellOf(r.maxLon); ++lon)
+            {
+                auto cell = cells.find(cellKey(lat, lon));
+                if (cell != cells.end())
+                {
+                    dropSlot(cell->second);
+                    if (cell->second.empty())
+                    {
+                        cells.erase(cell);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const std::string& device : client.devices)
+    {
+        auto subscribers = deviceIndex.find(device);
+        if (subscribers != deviceIndex.end())
+        {
+            dropSlot(subscribers->second);
+            if (subscribers->second.empty())
+            {
+                deviceIndex.erase(subscribers);
+            }
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Packs a grid cell coordinate into a single key.
+ **********************************************************************************************************************/
+int64_t SubscriptionEngine::cellKey (int latCell, int lonCell)
+{
+    return ((int64_t)latCell << 32) ^ (uint32_t)lonCell;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Grid cell index of a coordinate.
+ **********************************************************************************************************************/
+int SubscriptionEngine::cellOf (double degrees)
+{
+    return (int)std::floor(degrees / SUBSCRIPTION_CELL_DEG);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Checks that a latitude lies in [-90, 90].
+ **********************************************************************************************************************/
+static bool validLatitude (double value)
+{
+    return (value >= -90.0) && (value <= 90.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Checks that a longitude lies in [-180, 180].
+ **********************************************************************************************************************/
+static bool validLongitude (double value)
+{
+    return (value >= -180.0) && (value <= 180.0);
+}
@@ -0,0 +1,511 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_tenants.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define LATENCY_SUB_BITS        (2U)              /* log2 of the buckets per power of two */
+#define TENANT_MAX_WEIGHT       (1000U)
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty histogram.
+ **********************************************************************************************************************/
+LatencyHistogram::LatencyHistogram ()
+{
+    reset();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Adds one latency.
+ **********************************************************************************************************************/
+void LatencyHistogram::record (int64_t us)
+{
+    ++buckets[bucketOf(us)];
+    ++samples;
+    largest = std::max(largest, us);
+}
+
+/*******************************************************************************************************************//**
+ * @brief The latency below which the given fraction of the samples falls, rounded up to its bucket.
+ *
+ * @param fraction E.g. 0.99 for the 99th percentile.
+ *
+ * @return The latency in microseconds, 0 without samples.
+ **********************************************************************************************************************/
+int64_t LatencyHistogram::percentile (double fraction) const
+{
+    uint64_t rank = (uint64_t)(fraction * samples);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKETS; ++bucket)
+    {
+        seen += buckets[bucket];
+        if ((seen > rank) && (seen > 0))
+        {
+            return std::min(bucketLimit(bucket), largest);
+        }
+    }
+    return largest;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The largest latency recorded.
+ **********************************************************************************************************************/
+int64_t LatencyHistogram::max () const
+{
+    return largest;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of latencies recorded.
+ **********************************************************************************************************************/
+uint64_t LatencyHistogram::count () const
+{
+    return samples;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Forgets all samples.
+ **********************************************************************************************************************/
+void LatencyHistogram::reset ()
+{
+    std::memset(buckets, 0, sizeof(buckets));
+    samples = 0;
+    largest = 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bucket of a latency: the power of two below it and the next two bits.
+ **********************************************************************************************************************/
+size_t LatencyHistogram::bucketOf (int64_t us)
+{
+    if (us < 1)
+    {
+        return 0;
+    }
+
+    size_t msb = 63 - __builtin_clzll((uint64_t)us);
+    uint64_t top = (msb >= LATENCY_SUB_BITS) ? ((uint64_t)us >> (msb - LATENCY_SUB_BITS))
+                                             : ((uint64_t)us << (LATENCY_SUB_BITS - msb));
+    size_t bucket = (msb << LATENCY_SUB_BITS) + (top & ((1U << LATENCY_SUB_BITS) - 1));
+    return std::min<size_t>(bucket, LATENCY_BUCKETS - 1);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Largest latency of a bucket.
+ **********************************************************************************************************************/
+int64_t LatencyHistogram::bucketLimit (size_t bucket)
+{
+    size_t msb = bucket >> LATENCY_SUB_BITS;
+    uint64_t top = (1U << LATENCY_SUB_BITS) + (bucket & ((1U << LATENCY_SUB_BITS) - 1)) + 1;
+    return (int64_t)(((top << msb) >> LATENCY_SUB_BITS) - 1);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a scheduler with the default tenant only, which serves every device in arrival order.
+ **********************************************************************************************************************/
+TenantScheduler::TenantScheduler ()
+    : visiting(false), backlogged(0)
+{
+    addTenant(TENANT_DEFAULT, 1, 0.0);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Parses the tenant configuration; '#' starts a comment.
+ *
+ * Each "tenant <name> <weight> <quota> [device prefix]..." line adds a tenant, or sets the weight and quota of the
+ * default tenant when named TENANT_DEFAULT. A quota of 0 leaves the storage rate of the tenant unlimited.
+ *
+ * @param text The configuration.
+ * @param error Set to the reason when the configuration is rejected.
+ *
+ * @return False if a line is malformed or a tenant or prefix is defined twice.
+ **********************************************************************************************************************/
+bool TenantScheduler::load (const std::string& text, std::string& error)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string keyword, name, prefix;
+        unsigned weight = 0;
+        double quota = -1.0;
+        if (!(fields >> keyword))
+        {
+            continue;
+        }
+
+        std::string where = "line " + std::to_string(number) + ": ";
+        if ((keyword != "tenant") || !(fields >> name >> weight >> quota) || (weight == 0) ||
+            (weight > TENANT_MAX_WEIGHT) || (quota < 0.0))
+        {
+            error = where + "expected \"tenant <name> <weight 1-" + std::to_string(TENANT_MAX_WEIGHT) +
+                    "> <quota fixes/s, 0 for none> [device prefix]...\"";
+            return false;
+        }
+
+        size_t tenant = tenants.size();
+        if (name == TENANT_DEFAULT)
+        {
+            tenant = 0;
+            tenants[0].weight = weight;
+            tenants[0].quota = quota;
+            tenants[0].tokens = quota;
+        }
+        else
+        {
+            for (const Tenant& other : tenants)
+            {
+                if (other.name == name)
+                {
+                    error = where + "tenant " + name + " is defined twice";
+                    return false;
+                }
+            }
+            addTenant(name, weight, quota);
+        }
+
+        while (fields >> prefix)
+        {
+            for (const auto& other : prefixes)
+            {
+                if (other.first == prefix)
+                {
+                    error = where + "prefix " + prefix + " already belongs to " + tenants[other.second].name;
+                    return false;
+                }
+            }
+            prefixes.push_back(std::make_pair(prefix, tenant));
+        }
+    }
+
+    std::stable_sort(prefixes.begin(), prefixes.end(),
+                     [](const std::pair<std::string, size_t>& a, const std::pair<std::string, size_t>& b)
+                     { return a.first.size() > b.first.size(); });
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Reads the tenant configuration from a file, see load().
+ **********************************************************************************************************************/
+bool TenantScheduler::loadFile (const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    if (!load(contents.str(), error))
+    {
+        error = path + ", " + error;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of tenants, the default one included; tenants are numbered from 0 in configuration order.
+ **********************************************************************************************************************/
+size_t TenantScheduler::size () const
+{
+    return tenants.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief The tenant of a device, by the longest configured prefix of its ID.
+ **********************************************************************************************************************/
+size_t TenantScheduler::tenantOf (const std::string& deviceId) const
+{
+    for (const auto& prefix : prefixes)
+    {
+        if (deviceId.compare(0, prefix.first.size(), prefix.first) == 0)
+        {
+            return prefix.second;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Accounts for an item the caller appends to the queue of a tenant.
+ *
+ * @param tenant The tenant, see tenantOf().
+ * @param cost Fixes of the item, at least 1.
+ * @param nowUs Arrival time, for the latency.
+ *
+ * @return False if the queue of the tenant is full; the caller drops the item.
+ **********************************************************************************************************************/
+bool TenantScheduler::admit (size_t tenant, size_t cost, int64_t nowUs)
+{
+    Tenant& t = tenants[tenant];
+    cost = std::max<size_t>(cost, 1);
+    if (t.queued + cost > TENANT_MAX_QUEUED)
+    {
+        t.dropped += cost;
+        return false;
+    }
+
+    if (t.queue.empty())
+    {
+        active.push_back(tenant);
+    }
+    Entry entry = { cost, nowUs };
+    t.queue.push_back(entry);
+    t.queued += cost;
+    backlogged += cost;
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Picks the items to store next, up to a budget of fixes.
+ *
+ * The round-robin position and the deficits carry over from one call to the next, so a budget smaller than a round
+ * does not favour the tenants at the front. A round in which every backlogged tenant is held back by its quota ends
+ * the call early; rounds in which a tenant only saves up quanta for a large batch do not.
+ *
+ * @param budget Fixes to store at most; an item larger than the whole budget is still picked on its own.
+ * @param nowUs Current time, for the quotas.
+ * @param picks Output tenant of each picked item, in storage order; the caller stores the front items of each tenant
+ *              and pops them once completed() reports them stored.
+ *
+ * @return Number of fixes picked.
+ **********************************************************************************************************************/
+size_t TenantScheduler::schedule (size_t budget, int64_t nowUs, std::vector<size_t>& picks)
+{
+    picks.clear();
+    size_t used = 0;
+    size_t idleVisits = 0;
+
+    while (!active.empty() && (used < budget) && (idleVisits < active.size()))
+    {
+        size_t index = active.front();
+        Tenant& tenant = tenants[index];
+        bool granted = !visiting;
+        if (granted)
+        {
+            tenant.deficit += (size_t)TENANT_QUANTUM_FIXES * tenant.weight;
+            visiting = true;
+        }
+
+        bool progress = false;
+        bool throttled = false;
+        bool outOfBudget = false;
+        while (!tenant.queue.empty())
+        {
+            const Entry& head = tenant.queue.front();
+            if (head.cost > tenant.deficit)
+            {
+                break;
+            }
+            if ((used > 0) && (used + head.cost > budget))
+            {
+                outOfBudget = true;
+                break;
+            }
+            if (!quotaAllows(tenant, head.cost, nowUs))
+            {
+                throttled = true;
+                break;
+            }
+
+            tenant.deficit -= head.cost;
+            tenant.queued -= head.cost;
+            backlogged -= head.cost;
+            used += head.cost;
+            inFlight.push_back(std::make_pair(index, head));
+            picks.push_back(index);
+            tenant.queue.pop_front();
+            progress = true;
+        }
+
+        if (outOfBudget)
+        {
+            break;                          // Resume this tenant, with its remaining deficit, on the next call
+        }
+
+        active.pop_front();
+        visiting = false;
+        if (tenant.queue.empty())
+        {
+            tenant.deficit = 0;             // An idle tenant does not save up credit
+        }
+        else
+        {
+            if (throttled)
+            {
+                // A tenant over its quota does not bank the rounds it sits out either
+                tenant.deficit = std::min(tenant.deficit, (size_t)TENANT_QUANTUM_FIXES * tenant.weight);
+                ++tenant.throttled;
+            }
+            active.push_back(index);
+        }
+        // A tenant saving up quanta for a batch larger than one is not idle, so a lone large batch is stored at once
+        idleVisits = (progress || (granted && !throttled)) ? 0 : idleVisits + 1;
+    }
+
+    return used;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Accounts for the items handed out since the last call once their transaction has ended.
+ *
+ * Stored items are counted with their latency. Items not stored, e.g. after a failed commit, are queued again at the
+ * front of their tenants in their order, and their fixes given back to the quotas, so they are picked again first.
+ *
+ * @param nowUs Completion time, e.g. of the commit.
+ * @param stored Whether the items were stored.
+ **********************************************************************************************************************/
+void TenantScheduler::completed (int64_t nowUs, bool stored)
+{
+    if (stored)
+    {
+        for (const auto& item : inFlight)
+        {
+            tenants[item.first].stored += item.second.cost;
+            tenants[item.first].latency.record(nowUs - item.second.arrivalUs);
+        }
+    }
+    else
+    {
+        for (auto item = inFlight.rbegin(); item != inFlight.rend(); ++item)
+        {
+            Tenant& tenant = tenants[item->first];
+            if (tenant.queue.empty())
+            {
+                active.push_back(item->first);
+            }
+            tenant.queue.push_front(item->second);
+            tenant.queued += item->second.cost;
+            backlogged += item->second.cost;
+            if (tenant.quota > 0.0)
+            {
+                tenant.tokens += item->second.cost;
+            }
+        }
+    }
+    inFlight.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Fixes queued over all tenants.
+ **********************************************************************************************************************/
+size_t TenantScheduler::backlog () const
+{
+    return backlogged;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Counters and latency percentiles of each tenant.
+ **********************************************************************************************************************/
+std::vector<TenantStats> TenantScheduler::stats () const
+{
+    std::vector<TenantStats> result;
+    for (const Tenant& tenant : tenants)
+    {
+        TenantStats st;
+        st.name = tenant.name;
+        st.weight = tenant.weight;
+        st.quota = tenant.quota;
+        st.stored = tenant.stored;
+        st.dropped = tenant.dropped;
+        st.throttled = tenant.throttled;
+        st.queued = tenant.queued;
+        st.p50Us = tenant.latency.percentile(0.50);
+        st.p99Us = tenant.latency.percentile(0.99);
+        st.maxUs = tenant.latency.max();
+        result.push_back(st);
+    }
+    return result;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Starts a new latency measurement period for every tenant.
+ **********************************************************************************************************************/
+void TenantScheduler::resetLatency ()
+{
+    for (Tenant& tenant : tenants)
+    {
+        tenant.latency.reset();
+    }
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Appends a tenant with an empty queue and a full quota.
+ **********************************************************************************************************************/
+void TenantScheduler::addTenant (const std::string& name, unsigned weight, double quota)
+{
+    Tenant tenant;
+    tenant.name = name;
+    tenant.weight = weight;
+    tenant.quota = quota;
+    tenant.tokens = quota;
+    tenant.refilledUs = 0;
+    tenant.deficit = 0;
+    tenant.queued = 0;
+    tenant.stored = 0;
+    tenant.dropped = 0;
+    tenant.throttled = 0;
+    tenants.push_back(tenant);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether the quota of a tenant lets it store an item now, taking the fixes from the quota if so.
+ *
+ * An item larger than one second's worth of quota waits for a full bucket and then leaves it in debt, so it still
+ * goes through and the long-term rate is kept.
+ **********************************************************************************************************************/
+bool TenantScheduler::quotaAllows (Tenant& tenant, size_t cost, int64_t nowUs)
+{
+    if (tenant.quota <= 0.0)
+    {
+        return true;
+    }
+
+    if (tenant.refilledUs != 0)
+    {
+        tenant.tokens = std::min(tenant.quota, tenant.tokens + tenant.quota * (nowUs - tenant.refilledUs) / 1e6);
+    }
+    tenant.refilledUs = nowUs;
+
+    if (tenant.tokens < std::min((double)cost, tenant.quota))
+    {
+        return false;
+    }
+    tenant.tokens -= cost;
+    return true;
+}
@@ -0,0 +1,346 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_tls.h"
+#include <iostream>
+#include <cctype>
+#include <openssl/err.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define TLS_VERIFY_PEER         (1)               /* cert_reqs of mosquitto_tls_opts_set(), SSL_VERIFY_PEER */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static void logTlsError(const char* what);
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates a context without TLS, see init().
+ **********************************************************************************************************************/
+TlsSession::TlsSession ()
+    : ctx(NULL), session(NULL), handshakeCount(0), resumedCount(0)
+{
+    initTlsConfig(config);
+}
+
+/*******************************************************************************************************************//**
+ * @brief Releases the SSL context and the kept session; libmosquitto holds its own reference to the context.
+ **********************************************************************************************************************/
+TlsSession::~TlsSession ()
+{
+    if (session != NULL)
+    {
+        SSL_SESSION_free(session);
+    }
+    if (ctx != NULL)
+    {
+        SSL_CTX_free(ctx);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates the SSL context of the connection when TLS is configured.
+ *
+ * @param tls The TLS options, see checkTlsConfig().
+ *
+ * @return False if the context cannot be created or the ciphers are invalid.
+ **********************************************************************************************************************/
+bool TlsSession::init (const TlsConfig& tls)
+{
+    config = tls;
+    if (!tlsEnabled(config))
+    {
+        return true;
+    }
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == NULL)
+    {
+        logTlsError("cannot create SSL context");
+        return false;
+    }
+    SSL_CTX_set_app_data(ctx, this);
+
+    if (!config.ciphersuites.empty() && (SSL_CTX_set_ciphersuites(ctx, config.ciphersuites.c_str()) != 1))
+    {
+        logTlsError("invalid --tls-ciphersuites");
+        return false;
+    }
+
+    // The client keeps no cache of its own: the one ticket it needs is stored here, and handed back on reconnect
+    if (config.resume)
+    {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+    }
+    SSL_CTX_set_info_callback(ctx, onInfo);
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Configures TLS on a Mosquitto client, before it connects.
+ *
+ * The context is handed over with MOSQ_OPT_SSL_CTX_WITH_DEFAULTS, so libmosquitto still loads the certificates or the
+ * PSK and verifies the broker as it would with its own context.
+ *
+ * @param mosq The Mosquitto client.
+ *
+ * @return False if libmosquitto rejects the settings, e.g. when it was built without TLS.
+ **********************************************************************************************************************/
+bool TlsSession::apply (struct mosquitto* mosq) const
+{
+    if (ctx == NULL)
+    {
+        return true;
+    }
+
+    const char* ciphers = config.ciphers.empty() ? NULL : config.ciphers.c_str();
+    int rc = mosquitto_void_option(mosq, MOSQ_OPT_SSL_CTX, ctx);
+    if (rc == MOSQ_ERR_SUCCESS)
+    {
+        rc = mosquitto_int_option(mosq, MOSQ_OPT_SSL_CTX_WITH_DEFAULTS, 1);
+    }
+    if (rc == MOSQ_ERR_SUCCESS)
+    {
+        if (!config.psk.empty())
+        {
+            rc = mosquitto_tls_psk_set(mosq, config.psk.c_str(), config.pskIdentity.c_str(), ciphers);
+        }
+        else
+        {
+            rc = mosquitto_tls_set(mosq, config.caFile.c_str(), NULL,
+                                   config.certFile.empty() ? NULL : config.certFile.c_str(),
+                                   config.keyFile.empty() ? NULL : config.keyFile.c_str(), NULL);
+        }
+    }
+    if (rc == MOSQ_ERR_SUCCESS)
+    {
+        rc = mosquitto_tls_opts_set(mosq, TLS_VERIFY_PEER, config.version.c_str(), ciphers);
+    }
+
+    if (rc != MOSQ_ERR_SUCCESS)
+    {
+        std::cerr << "Unable to set up TLS: " << mosquitto_strerror(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The SSL context, NULL without TLS.
+ **********************************************************************************************************************/
+SSL_CTX* TlsSession::context () const
+{
+    return ctx;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Completed handshakes, full and resumed.
+ **********************************************************************************************************************/
+uint64_t TlsSession::handshakes () const
+{
+    return handshakeCount;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Completed handshakes that resumed a previous session.
+ **********************************************************************************************************************/
+uint64_t TlsSession::resumed () const
+{
+    return resumedCount;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Keeps the latest session ticket the broker sent.
+ *
+ * @return 1, the reference to the session is taken over.
+ **********************************************************************************************************************/
+int TlsSession::onNewSession (SSL* ssl, SSL_SESSION* session)
+{
+    TlsSession* self = static_cast<TlsSession*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    if (self->session != NULL)
+    {
+        SSL_SESSION_free(self->session);
+    }
+    self->session = session;
+    return 1;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Attaches the kept session when a handshake starts and counts the completed handshakes.
+ *
+ * The handshake-start notification comes before the ClientHello is built, which is the last point at which a
+ * session can be attached to an SSL object that libmosquitto created.
+ **********************************************************************************************************************/
+void TlsSession::onInfo (const SSL* ssl, int where, int ret)
+{
+    SSL* connection = const_cast<SSL*>(ssl);
+    TlsSession* self = static_cast<TlsSession*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+
+    if ((where & SSL_CB_HANDSHAKE_START) && self->config.resume && (self->session != NULL) &&
+        SSL_SESSION_is_resumable(self->session) && (SSL_get_session(ssl) == NULL))
+    {
+        SSL_set_session(connection, self->session);
+    }
+    else if (where & SSL_CB_HANDSHAKE_DONE)
+    {
+        ++self->handshakeCount;
+        if (SSL_session_reused(connection))
+        {
+            ++self->resumedCount;
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether the options enable TLS.
+ **********************************************************************************************************************/
+bool tlsEnabled (const TlsConfig& config)
+{
+    return !config.caFile.empty() || !config.psk.empty();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Fills the TLS options with their defaults, TLS disabled.
+ **********************************************************************************************************************/
+void initTlsConfig (TlsConfig& config)
+{
+    config = TlsConfig();
+    config.version = TLS_DEFAULT_VERSION;
+    config.resume = true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Whether a command line option is one of the TLS options.
+ **********************************************************************************************************************/
+bool isTlsOption (const std::string& option)
+{
+    return option.rfind("--tls-", 0) == 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Applies one TLS command line option.
+ *
+ * @param option The option, see isTlsOption().
+ * @param value Its value.
+ * @param config The TLS options.
+ *
+ * @return False if the option is unknown or the value invalid.
+ **********************************************************************************************************************/
+bool setTlsOption (const std::string& option, const std::string& value, TlsConfig& config)
+{
+    if (option == "--tls-ca")
+    {
+        config.caFile = value;
+    }
+    else if (option == "--tls-cert")
+    {
+        config.certFile = value;
+    }
+    else if (option == "--tls-key")
+    {
+        config.keyFile = value;
+    }
+    else if (option == "--tls-psk")
+    {
+        config.psk = value;
+        for (char c : value)
+        {
+            if (!std::isxdigit((unsigned char)c))
+            {
+                return false;
+            }
+        }
+    }
+    else if (option == "--tls-psk-identity")
+    {
+        config.pskIdentity = value;
+    }
+    else if (option == "--tls-version")
+    {
+        config.version = value;
+        return (value == "tlsv1.2") || (value == "tlsv1.3");
+    }
+    else if (option == "--tls-ciphers")
+    {
+        config.ciphers = value;
+    }
+    else if (option == "--tls-ciphersuites")
+    {
+        config.ciphersuites = value;
+    }
+    else if (option == "--tls-resume")
+    {
+        config.resume = (value == "1");
+        return (value == "0") || (value == "1");
+    }
+    else
+    {
+        return false;
+    }
+
+    return !value.empty();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Checks that the TLS options fit together.
+ *
+ * @return False, after logging the reason, if they do not.
+ **********************************************************************************************************************/
+bool checkTlsConfig (const TlsConfig& config)
+{
+    const char* error = NULL;
+    if (!config.psk.empty() && !config.caFile.empty())
+    {
+        error = "--tls-psk and --tls-ca cannot be combined";
+    }
+    else if (config.psk.empty() != config.pskIdentity.empty())
+    {
+        error = "--tls-psk and --tls-psk-identity go together";
+    }
+    else if (config.certFile.empty() != config.keyFile.empty())
+    {
+        error = "--tls-cert and --tls-key go together";
+    }
+    else if (!config.certFile.empty() && config.caFile.empty())
+    {
+        error = "--tls-cert needs --tls-ca";
+    }
+
+    if (error != NULL)
+    {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Logs an error with the reason from the OpenSSL error queue.
+ **********************************************************************************************************************/
+static void logTlsError (const char* what)
+{
+    char reason[256];
+    ERR_error_string_n(ERR_get_error(), reason, sizeof(reason));
+    std::cerr << "TLS: " << what << ": " << reason << std::endl;
+}
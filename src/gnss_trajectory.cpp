@@ -0,0 +1,137 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_trajectory.h"
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define METRES_PER_DEGREE       (111320.0)        /* Length of a degree of latitude */
+#define KNOTS_PER_MS            (1.943844)        /* Knots in one metre per second */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/* Centres the vehicles are spread over, in turn */
+static const double cities[][2] = {
+    { 10.7769, 106.7009 },      // Ho Chi Minh City
+    { 21.0278, 105.8342 },      // Hanoi
+    { 52.5200, 13.4050 },       // Berlin
+    { 40.7128, -74.0060 },      // New York
+    { -33.8688, 151.2093 },     // Sydney
+    { 35.6762, 139.6503 },      // Tokyo
+    { 48.1351, 11.5820 },       // Munich
+    { -23.5505, -46.6333 },     // Sao Paulo
+};
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Places a vehicle at rest at a random point near its city, heading in a random direction.
+ *
+ * @param seed Seed of the whole fleet.
+ * @param vehicle Number of the vehicle in the fleet.
+ * @param startMs Time of the first fix in Unix milliseconds.
+ **********************************************************************************************************************/
+TrajectoryModel::TrajectoryModel (uint64_t seed, uint64_t vehicle, int64_t startMs)
+    : random(seed ^ (vehicle * 0xD1B54A32D192ED03ULL)), timeMs(startMs), speedMs(0.0), stopS(0.0), stopping(false)
+{
+    const double* city = cities[vehicle % (sizeof(cities) / sizeof(cities[0]))];
+    double distance = TRAJECTORY_CITY_RADIUS_M * std::sqrt(random.uniform());
+    double bearing = 2.0 * M_PI * random.uniform();
+    latitude = city[0] + distance * std::cos(bearing) / METRES_PER_DEGREE;
+    longitude = city[1] + distance * std::sin(bearing) / (METRES_PER_DEGREE * std::cos(city[0] * M_PI / 180.0));
+    course = 360.0 * random.uniform();
+    cruiseMs = TRAJECTORY_MIN_CRUISE_MS + (TRAJECTORY_MAX_CRUISE_MS - TRAJECTORY_MIN_CRUISE_MS) * random.uniform();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Moves the vehicle on and reports its new position.
+ *
+ * @param dtMs Time since the previous fix.
+ * @param fix Output fix; the device ID is left untouched.
+ **********************************************************************************************************************/
+void TrajectoryModel::step (int64_t dtMs, GNSSFix& fix)
+{
+    double dt = dtMs / 1000.0;
+    timeMs += dtMs;
+
+    if (stopping && (speedMs == 0.0))
+    {
+        // Standing; drive off towards a new cruising speed once the stop is over
+        stopS -= dt;
+        if (stopS <= 0.0)
+        {
+            stopping = false;
+            cruiseMs = TRAJECTORY_MIN_CRUISE_MS + (TRAJECTORY_MAX_CRUISE_MS - TRAJECTORY_MIN_CRUISE_MS) *
+                                                  random.uniform();
+        }
+    }
+    else
+    {
+        if (!stopping && (random.uniform() < dt / TRAJECTORY_MEAN_DRIVE_S))
+        {
+            stopping = true;
+            stopS = TRAJECTORY_MAX_STOP_S * random.uniform();
+        }
+        else if (!stopping && (random.uniform() < dt / TRAJECTORY_MEAN_CRUISE_S))
+        {
+            cruiseMs = TRAJECTORY_MIN_CRUISE_MS + (TRAJECTORY_MAX_CRUISE_MS - TRAJECTORY_MIN_CRUISE_MS) *
+                                                  random.uniform();
+        }
+
+        // Accelerate or brake towards the target, with some noise from the traffic while moving
+        double target = stopping ? 0.0 : cruiseMs;
+        double change = std::max(-TRAJECTORY_ACCEL_MS2 * dt, std::min(TRAJECTORY_ACCEL_MS2 * dt, target - speedMs));
+        speedMs += change;
+        if (!stopping)
+        {
+            speedMs = std::max(0.0, speedMs + 0.2 * std::sqrt(dt) * random.normal());
+        }
+
+        // Drift along the road and turn at junctions now and then
+        course += TRAJECTORY_HEADING_NOISE * std::sqrt(dt) * random.normal();
+        if (random.uniform() < dt / TRAJECTORY_MEAN_TURN_S)
+        {
+            course += (random.uniform() < 0.5) ? -90.0 : 90.0;
+        }
+        course = std::fmod(course + 360.0, 360.0);
+        if (course < 0.0)
+        {
+            course += 360.0;
+        }
+
+        double distance = speedMs * dt;
+        double radians = course * M_PI / 180.0;
+        latitude = std::max(-85.0, std::min(85.0, latitude + distance * std::cos(radians) / METRES_PER_DEGREE));
+        longitude += distance * std::sin(radians) / (METRES_PER_DEGREE * std::cos(latitude * M_PI / 180.0));
+        if (longitude > 180.0)
+        {
+            longitude -= 360.0;
+        }
+        else if (longitude < -180.0)
+        {
+            longitude += 360.0;
+        }
+    }
+
+    fix.timestampMs = timeMs;
+    fix.latitude = latitude;
+    fix.longitude = longitude;
+    fix.speedKnots = speedMs * KNOTS_PER_MS;
+    fix.course = course;
+}
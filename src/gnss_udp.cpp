@@ -0,0 +1,397 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_udp.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates a closed UDP input.
+ **********************************************************************************************************************/
+UdpReceiver::UdpReceiver ()
+    : sock(-1), boundPort(0), truncatedCount(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the socket.
+ **********************************************************************************************************************/
+UdpReceiver::~UdpReceiver ()
+{
+    close();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Binds the UDP input.
+ *
+ * @param port UDP port to listen on, 0 for an ephemeral port (see port()).
+ * @param bindAddress IPv4 address to listen on.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool UdpReceiver::open (uint16_t port, const std::string& bindAddress)
+{
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress.c_str(), &addr.sin_addr) != 1)
+    {
+        std::cerr << "UDP: invalid bind address " << bindAddress << std::endl;
+        return false;
+    }
+
+    int bufferSize = UDP_SOCKET_BUFFER;
+    socklen_t addrLength = sizeof(addr);
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((sock < 0) || (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) ||
+        (getsockname(sock, (struct sockaddr*)&addr, &addrLength) != 0))
+    {
+        std::cerr << "UDP: cannot bind " << bindAddress << ":" << port << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    boundPort = ntohs(addr.sin_port);
+
+    // One receive slot per datagram of a recvmmsg batch
+    buffers.resize((size_t)UDP_BATCH * UDP_MAX_DATAGRAM);
+    headers.resize(UDP_BATCH);
+    iovecs.resize(UDP_BATCH);
+    for (size_t i = 0; i < UDP_BATCH; ++i)
+    {
+        iovecs[i].iov_base = &buffers[i * UDP_MAX_DATAGRAM];
+        iovecs[i].iov_len = UDP_MAX_DATAGRAM;
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the socket.
+ **********************************************************************************************************************/
+void UdpReceiver::close ()
+{
+    if (sock >= 0)
+    {
+        ::close(sock);
+        sock = -1;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief The socket, for waiting on input together with other descriptors.
+ **********************************************************************************************************************/
+int UdpReceiver::fd () const
+{
+    return sock;
+}
+
+/*******************************************************************************************************************//**
+ * @brief The port the input is bound to.
+ **********************************************************************************************************************/
+uint16_t UdpReceiver::port () const
+{
+    return boundPort;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Drains waiting datagrams, up to UDP_BATCH per system call. Never blocks.
+ *
+ * @param datagrams Output, received datagrams are appended.
+ *
+ * @return Number of datagrams appended.
+ **********************************************************************************************************************/
+size_t UdpReceiver::receive (std::vector<std::string>& datagrams)
+{
+    size_t received = 0;
+
+    while ((sock >= 0) && (received < UDP_MAX_PER_RECEIVE))
+    {
+        for (size_t i = 0; i < UDP_BATCH; ++i)
+        {
+            std::memset(&headers[i], 0, sizeof(headers[i]));
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = recvmmsg(sock, headers.data(), UDP_BATCH, MSG_DONTWAIT, nullptr);
+        if (n <= 0)
+        {
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                ++truncatedCount;
+                continue;
+            }
+            datagrams.push_back(std::string(&buffers[i * UDP_MAX_DATAGRAM], headers[i].msg_len));
+            ++received;
+        }
+
+        if ((unsigned)n < UDP_BATCH)
+        {
+            break;
+        }
+    }
+
+    return received;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of datagrams dropped because they did not fit the receive buffer.
+ **********************************************************************************************************************/
+uint64_t UdpReceiver::truncated () const
+{
+    return truncatedCount;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a closed UDP output.
+ **********************************************************************************************************************/
+UdpSender::UdpSender ()
+    : sock(-1), sent(0), calls(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the socket. Queued datagrams are discarded.
+ **********************************************************************************************************************/
+UdpSender::~UdpSender ()
+{
+    close();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Connects the UDP output to its destination.
+ *
+ * @param host Host name or IPv4 address of the receiver.
+ * @param port UDP port of the receiver.
+ *
+ * @return True on success, false otherwise.
+ **********************************************************************************************************************/
+bool UdpSender::open (const std::string& host, uint16_t port)
+{
+    struct addrinfo hints;
+    struct addrinfo* result = nullptr;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0)
+    {
+        std::cerr << "UDP: cannot resolve " << host << std::endl;
+        return false;
+    }
+
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    bool ok = (sock >= 0) && (connect(sock, result->ai_addr, result->ai_addrlen) == 0);
+    freeaddrinfo(result);
+    if (!ok)
+    {
+        std::cerr << "UDP: cannot connect to " << host << ":" << port << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Closes the socket.
+ **********************************************************************************************************************/
+void UdpSender::close ()
+{
+    if (sock >= 0)
+    {
+        ::close(sock);
+        sock = -1;
+    }
+    queued.clear();
+}
+
+/*******************************************************************************************************************//**
+ * @brief Queues a datagram, sending the queue once a full batch is collected.
+ *
+ * @param datagram The datagram, at most UDP_MAX_DATAGRAM bytes.
+ **********************************************************************************************************************/
+void UdpSender::queue (const std::string& datagram)
+{
+    queued.push_back(datagram);
+    if (queued.size() >= UDP_BATCH)
+    {
+        flush();
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Sends all queued datagrams, up to UDP_BATCH per system call.
+ *
+ * A datagram the kernel refuses (e.g. the receiver port is closed) is dropped, as UDP would drop it in flight.
+ *
+ * @return False if any datagram was dropped.
+ **********************************************************************************************************************/
+bool UdpSender::flush ()
+{
+    struct mmsghdr headers[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    bool ok = true;
+    size_t next = 0;
+
+    while ((sock >= 0) && (next < queued.size()))
+    {
+        unsigned count = 0;
+        for (; (count < UDP_BATCH) && (next + count < queued.size()); ++count)
+        {
+            std::string& datagram = queued[next + count];
+            iov[count].iov_base = &datagram[0];
+            iov[count].iov_len = datagram.size();
+            std::memset(&headers[count], 0, sizeof(headers[count]));
+            headers[count].msg_hdr.msg_iov = &iov[count];
+            headers[count].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = sendmmsg(sock, headers, count, 0);
+        ++calls;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ok = false;
+            n = 1;      // Drop the datagram the kernel refused and carry on with the rest
+        }
+        else
+        {
+            sent += n;
+        }
+        next += n;
+    }
+
+    queued.clear();
+    return ok;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of datagrams handed to the kernel.
+ **********************************************************************************************************************/
+uint64_t UdpSender::datagramsSent () const
+{
+    return sent;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of sendmmsg calls made.
+ **********************************************************************************************************************/
+uint64_t UdpSender::sendCalls () const
+{
+    return calls;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Creates a tracker without history.
+ **********************************************************************************************************************/
+SequenceTracker::SequenceTracker ()
+{
+    totals.received = 0;
+    totals.lost = 0;
+    totals.late = 0;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Records the arrival of a sequenced batch.
+ *
+ * @param deviceId The device that sent the batch.
+ * @param firstSequence Sequence number of the first element of the batch.
+ * @param count Number of elements in the batch.
+ **********************************************************************************************************************/
+void SequenceTracker::observe (const std::string& deviceId, uint64_t firstSequence, uint64_t count)
+{
+    totals.received += count;
+
+    auto it = expected.find(deviceId);
+    if (it == expected.end())
+    {
+        expected[deviceId] = firstSequence + count;
+        return;
+    }
+
+    if (firstSequence >= it->second)
+    {
+        totals.lost += firstSequence - it->second;
+        it->second = firstSequence + count;
+    }
+    else
+    {
+        totals.late += count;
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Totals over all devices.
+ **********************************************************************************************************************/
+SequenceStats SequenceTracker::stats () const
+{
+    return totals;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Splits a "host:port" argument.
+ *
+ * @param text The argument.
+ * @param host Output host.
+ * @param port Output port.
+ *
+ * @return False if the argument is malformed.
+ **********************************************************************************************************************/
+bool parseHostPort (const std::string& text, std::string& host, uint16_t& port)
+{
+    size_t colon = text.rfind(':');
+    if ((colon == std::string::npos) || (colon == 0))
+    {
+        return false;
+    }
+
+    char* end = nullptr;
+    long value = std::strtol(text.c_str() + colon + 1, &end, 10);
+    if ((*end != '\0') || (value <= 0) || (value > 65535))
+    {
+        return false;
+    }
+
+    host = text.substr(0, colon);
+    port = (uint16_t)value;
+    return true;
+}
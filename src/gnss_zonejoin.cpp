@@ -0,0 +1,431 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_archive.h"
+#include "../inc/gnss_zones.h"
+#include "../inc/gnss_clock.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+#define ZONEJOIN_DEFAULT_GAP_S  (600U)            /* Silence after which a device is no longer taken to be inside */
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/* Command line options of the join */
+struct JoinConfig
+{
+    std::string archivePath;
+    std::string zonesPath;
+    std::string outPath;        /* Empty or "-" for the standard output */
+    unsigned threads;
+    int64_t fromMs;
+    int64_t toMs;
+    int64_t maxGapMs;
+};
+
+/* How a stay in a zone ended */
+enum ZoneEnd
+{
+    ZONE_END_EXIT,              /* At a fix outside the zone */
+    ZONE_END_GAP,               /* At the last fix inside, the device was then silent for longer than the gap */
+    ZONE_END_OPEN               /* Still inside at the last fix of the device in the time range */
+};
+
+/* One stay of one device in one zone */
+struct ZoneInterval
+{
+    uint32_t device;
+    uint32_t zone;
+    int64_t entryMs;            /* First fix inside */
+    int64_t exitMs;             /* First fix outside, or the last fix inside unless the end is an exit */
+    uint64_t fixes;             /* Fixes inside */
+    ZoneEnd end;
+};
+
+/* Counters and results of one thread */
+struct JoinWorker
+{
+    std::vector<ZoneInterval> intervals;
+    uint64_t chunks;            /* In the time range */
+    uint64_t decoded;           /* Of those, with a candidate zone, decompressed and tested */
+    uint64_t fixes;             /* Fixes in the chunks in the time range */
+    uint64_t tests;             /* Batches of points tested against a polygon */
+    bool failed;
+};
+
+/* Work shared by the threads: whole devices are taken in turn, so each is followed in time order */
+struct JoinJob
+{
+    JoinConfig config;
+    ArchiveReader archive;
+    ZoneSet zones;
+    std::atomic<uint32_t> nextDevice;
+};
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool parseJoinArgs(int argc, char* argv[], JoinConfig& config);
+static void joinLoop(JoinJob& job, JoinWorker& worker);
+static bool joinDevice(JoinJob& job, uint32_t device, JoinWorker& worker);
+static void formatTime(int64_t timeMs, char* out, size_t size);
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Parses the command line options of the join.
+ *
+ * @return False if an option is unknown or invalid.
+ **********************************************************************************************************************/
+static bool parseJoinArgs (int argc, char* argv[], JoinConfig& config)
+{
+    config.threads = std::max(1U, std::thread::hardware_concurrency());
+    config.fromMs = INT64_MIN;
+    config.toMs = INT64_MAX;
+    config.maxGapMs = ZONEJOIN_DEFAULT_GAP_S * 1000LL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        char* end = nullptr;
+        bool ok = true;
+
+        if (option == "--archive")
+        {
+            config.archivePath = value;
+        }
+        else if (option == "--zones")
+        {
+            config.zonesPath = value;
+        }
+        else if (option == "--out")
+        {
+            config.outPath = value;
+            ok = !value.empty();
+        }
+        else if (option == "--threads")
+        {
+            unsigned long threads = std::strtoul(value.c_str(), &end, 10);
+            ok = (*end == '\0') && (threads >= 1) && (threads <= 256);
+            config.threads = (unsigned)threads;
+        }
+        else if (option == "--from")
+        {
+            ok = parseClockStart(value, config.fromMs);
+        }
+        else if (option == "--to")
+        {
+            ok = parseClockStart(value, config.toMs);
+        }
+        else if (option == "--max-gap-s")
+        {
+            long long seconds = std::strtoll(value.c_str(), &end, 10);
+            ok = (*end == '\0') && (seconds >= 1) && (seconds <= 366LL * 86400);
+            config.maxGapMs = seconds * 1000;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+
+        if (!ok || value.empty())
+        {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (config.archivePath.empty() || config.zonesPath.empty())
+    {
+        std::cerr << "--archive and --zones are required" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Join thread: takes the next device until all are done.
+ **********************************************************************************************************************/
+static void joinLoop (JoinJob& job, JoinWorker& worker)
+{
+    uint32_t devices = (uint32_t)job.archive.devices().size();
+    for (uint32_t device = job.nextDevice++; (device < devices) && !worker.failed; device = job.nextDevice++)
+    {
+        worker.failed = !joinDevice(job, device, worker);
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Follows one device through its chunks in time order and records its stays in the zones.
+ *
+ * The bounding box of each chunk is looked up in the R-tree. A stay in a zone that is not a candidate of the chunk
+ * ends at its first fix without decompressing it, and a chunk without candidates is not decompressed at all. The
+ * fixes of the others are tested against each candidate as one batch, then walked in time order.
+ *
+ * @return False if a chunk is corrupt.
+ **********************************************************************************************************************/
+static bool joinDevice (JoinJob& job, uint32_t device, JoinWorker& worker)
+{
+    const JoinConfig& config = job.config;
+    const std::vector<ArchiveChunk>& chunks = job.archive.chunks();
+    std::vector<ZoneInterval> stays;        /* Zones the device is in, at most a few */
+    std::vector<uint32_t> candidates;
+    std::vector<uint8_t> inside;
+    std::vector<FixSample> samples;
+    double lat[ZONE_BATCH_POINTS];
+    double lon[ZONE_BATCH_POINTS];
+    int64_t previousMs = INT64_MIN;         /* Time of the last fix in the range */
+
+    auto close = [&worker, &stays](size_t index, int64_t exitMs, ZoneEnd end)
+    {
+        stays[index].exitMs = exitMs;
+        stays[index].end = end;
+        worker.intervals.push_back(stays[index]);
+        stays[index] = stays.back();
+        stays.pop_back();
+    };
+
+    for (size_t c = job.archive.firstChunk(device); c < job.archive.firstChunk(device + 1); ++c)
+    {
+        const ArchiveChunk& chunk = chunks[c];
+        if (chunk.lastMs < config.fromMs)
+        {
+            continue;
+        }
+        if (chunk.firstMs > config.toMs)
+        {
+            break;
+        }
+        ++worker.chunks;
+        worker.fixes += chunk.count;
+
+        ZoneBox box = { chunk.minLatE7 * 1e-7, chunk.minLonE7 * 1e-7, chunk.maxLatE7 * 1e-7, chunk.maxLonE7 * 1e-7 };
+        job.zones.query(box, candidates);
+
+        // Stays open before the chunk are in the range already, so its first fix is too
+        bool gap = (chunk.firstMs - previousMs > config.maxGapMs);
+        for (size_t s = stays.size(); s-- > 0;)
+        {
+            if (std::find(candidates.begin(), candidates.end(), stays[s].zone) == candidates.end())
+            {
+                close(s, gap ? stays[s].exitMs : chunk.firstMs, gap ? ZONE_END_GAP : ZONE_END_EXIT);
+            }
+        }
+        if (candidates.empty())
+        {
+            previousMs = chunk.lastMs;
+            continue;
+        }
+
+        if (!job.archive.read(chunk, samples))
+        {
+            std::cerr << "Corrupt chunk " << c << " of " << job.archive.devices()[device] << std::endl;
+            return false;
+        }
+        ++worker.decoded;
+        for (size_t i = 0; i < ZONE_BATCH_POINTS; ++i)
+        {
+            lat[i] = (i < samples.size()) ? samples[i].latE7 * 1e-7 : ZONE_UNUSED_LAT;
+            lon[i] = (i < samples.size()) ? samples[i].lonE7 * 1e-7 : 0.0;
+        }
+        inside.resize(candidates.size() * ZONE_BATCH_POINTS);
+        for (size_t k = 0; k < candidates.size(); ++k)
+        {
+            job.zones.contains(candidates[k], lat, lon, &inside[k * ZONE_BATCH_POINTS]);
+        }
+        worker.tests += candidates.size();
+
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            int64_t timeMs = samples[i].timestampMs;
+            if ((timeMs < config.fromMs) || (timeMs > config.toMs))
+            {
+                continue;
+            }
+            if (timeMs - previousMs > config.maxGapMs)
+            {
+                while (!stays.empty())
+                {
+                    close(stays.size() - 1, stays.back().exitMs, ZONE_END_GAP);
+                }
+            }
+
+            for (size_t k = 0; k < candidates.size(); ++k)
+            {
+                size_t s = 0;
+                while ((s < stays.size()) && (stays[s].zone != candidates[k]))
+                {
+                    ++s;
+                }
+                if (inside[k * ZONE_BATCH_POINTS + i] != 0)
+                {
+                    if (s == stays.size())
+                    {
+                        stays.push_back(ZoneInterval{ device, candidates[k], timeMs, timeMs, 0, ZONE_END_OPEN });
+                    }
+                    stays[s].exitMs = timeMs;
+                    ++stays[s].fixes;
+                }
+                else if (s < stays.size())
+                {
+                    close(s, timeMs, ZONE_END_EXIT);
+                }
+            }
+            previousMs = timeMs;
+        }
+    }
+
+    while (!stays.empty())
+    {
+        close(stays.size() - 1, stays.back().exitMs, ZONE_END_OPEN);
+    }
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Formats Unix milliseconds as "YYYY-MM-DDTHH:MM:SS.mmmZ".
+ **********************************************************************************************************************/
+static void formatTime (int64_t timeMs, char* out, size_t size)
+{
+    time_t seconds = (time_t)(timeMs / 1000);
+    std::tm tm;
+    gmtime_r(&seconds, &tm);
+    std::snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(timeMs % 1000));
+}
+
+/***********************************************************************************************************************
+ * Main function
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Lists every stay of every device of an archive in a set of polygons, for audits over months of fixes.
+ *
+ * "gnss_zonejoin --archive FILE --zones FILE [--out FILE] [--threads N] [--from TIME] [--to TIME] [--max-gap-s S]"
+ * streams the chunks of the archive, device by device on several threads, prunes them against the R-tree of the
+ * zones by their bounding box and tests the fixes of the rest against the candidate polygons in batches. It writes
+ * one CSV line per stay, "device,zone,entry,exit,fixes,end", sorted by device, entry time and zone. end is "exit" when
+ * the stay ended at a fix outside, "gap" when the device was silent for longer than --max-gap-s while inside, the exit
+ * time being then its last fix inside, and "open" when it was still inside at its last fix in the range.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ *
+ * @return Exit status code (0 for success, 1 for failure).
+ **********************************************************************************************************************/
+int main (int argc, char* argv[])
+{
+    JoinJob job;
+    if (!parseJoinArgs(argc, argv, job.config))
+    {
+        std::cerr << "Usage: " << argv[0] << " --archive FILE --zones FILE [--out FILE] [--threads N]"
+                  << " [--from YYYY-MM-DD[THH:MM:SS]] [--to YYYY-MM-DD[THH:MM:SS]] [--max-gap-s S]" << std::endl;
+        return 1;
+    }
+    const JoinConfig& config = job.config;
+
+    std::string error;
+    if (!job.zones.load(config.zonesPath, error))
+    {
+        std::cerr << "Invalid zone file: " << error << std::endl;
+        return 1;
+    }
+    if (!job.archive.open(config.archivePath))
+    {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    job.nextDevice = 0;
+    std::vector<JoinWorker> workers(config.threads, JoinWorker{ {}, 0, 0, 0, 0, false });
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < config.threads; ++t)
+    {
+        threads.emplace_back(joinLoop, std::ref(job), std::ref(workers[t]));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Merge in a fixed order, so the output is the same whatever the number of threads
+    JoinWorker total = { {}, 0, 0, 0, 0, false };
+    for (JoinWorker& worker : workers)
+    {
+        total.intervals.insert(total.intervals.end(), worker.intervals.begin(), worker.intervals.end());
+        total.chunks += worker.chunks;
+        total.decoded += worker.decoded;
+        total.fixes += worker.fixes;
+        total.tests += worker.tests;
+        total.failed = total.failed || worker.failed;
+        worker.intervals = std::vector<ZoneInterval>();
+    }
+    std::sort(total.intervals.begin(), total.intervals.end(), [](const ZoneInterval& a, const ZoneInterval& b) {
+        return (a.device != b.device) ? (a.device < b.device)
+             : (a.entryMs != b.entryMs) ? (a.entryMs < b.entryMs) : (a.zone < b.zone);
+    });
+    double joinSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool toStdout = config.outPath.empty() || (config.outPath == "-");
+    FILE* out = toStdout ? stdout : std::fopen(config.outPath.c_str(), "w");
+    if (out == nullptr)
+    {
+        std::cerr << "Unable to open " << config.outPath << std::endl;
+        return 1;
+    }
+    static const char* const endNames[] = { "exit", "gap", "open" };
+    char entry[64];
+    char exit[64];
+    bool ok = (std::fputs("device,zone,entry,exit,fixes,end\n", out) >= 0);
+    for (size_t i = 0; ok && (i < total.intervals.size()); ++i)
+    {
+        const ZoneInterval& interval = total.intervals[i];
+        formatTime(interval.entryMs, entry, sizeof(entry));
+        formatTime(interval.exitMs, exit, sizeof(exit));
+        ok = (std::fprintf(out, "%s,%s,%s,%s,%llu,%s\n", job.archive.devices()[interval.device].c_str(),
+                           job.zones.zone(interval.zone).name.c_str(), entry, exit,
+                           (unsigned long long)interval.fixes, endNames[interval.end]) > 0);
+    }
+    ok = (toStdout ? (std::fflush(out) == 0) : (std::fclose(out) == 0)) && ok && !total.failed;
+    if (!ok)
+    {
+        std::cerr << "Unable to write " << config.outPath << std::endl;
+    }
+
+    std::cerr << "Joined " << total.fixes << " fixes of " << job.archive.devices().size() << " devices with "
+              << job.zones.size() << " zones (R-tree of " << job.zones.depth() << " levels) in " << std::fixed
+              << std::setprecision(2) << joinSeconds << " s (" << std::setprecision(0) << total.fixes / joinSeconds
+              << " fixes/s) on " << config.threads << " threads: " << total.decoded << " of " << total.chunks
+              << " chunks tested, " << total.tests << " chunk-polygon tests, " << total.intervals.size()
+              << " stays" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+/*
+ * @author Duy Tran
+ * @date 2026-10-18
+*/
+
+/***********************************************************************************************************************
+ * Includes
+ **********************************************************************************************************************/
+#include "../inc/gnss_zones.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/***********************************************************************************************************************
+ * Macro definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Typedef definitions
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Private global variables and functions
+ **********************************************************************************************************************/
+static bool overlaps(const ZoneBox& a, const ZoneBox& b);
+static ZoneBox boxUnion(const ZoneBox& a, const ZoneBox& b);
+
+/*******************************************************************************************************************//**
+ * @brief 1 if the sign bit of a value is set, i.e. a difference a - b is below zero for a < b.
+ *
+ * Taken from the bits rather than by comparing, which GCC does not vectorize for doubles without AVX and would not
+ * if-convert at all under the default -ftrapping-math.
+ **********************************************************************************************************************/
+static inline uint64_t signBit (double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits >> 63;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Orders items for sort-tile-recursive packing: vertical slices of about the square root of the number of
+ *        nodes, by longitude, each sorted by latitude, so that consecutive runs of ZONE_NODE_ENTRIES are compact.
+ **********************************************************************************************************************/
+template <typename T, typename BoxOf>
+static void sortTileRecursive (std::vector<T>& items, BoxOf boxOf)
+{
+    size_t pages = (items.size() + ZONE_NODE_ENTRIES - 1) / ZONE_NODE_ENTRIES;
+    size_t slice = (size_t)std::ceil(std::sqrt((double)pages)) * ZONE_NODE_ENTRIES;
+    auto byLon = [&boxOf](const T& a, const T& b)
+    {
+        return boxOf(a).minLon + boxOf(a).maxLon < boxOf(b).minLon + boxOf(b).maxLon;
+    };
+    auto byLat = [&boxOf](const T& a, const T& b)
+    {
+        return boxOf(a).minLat + boxOf(a).maxLat < boxOf(b).minLat + boxOf(b).maxLat;
+    };
+
+    std::sort(items.begin(), items.end(), byLon);
+    for (size_t begin = 0; begin < items.size(); begin += slice)
+    {
+        std::sort(items.begin() + begin, items.begin() + std::min(begin + slice, items.size()), byLat);
+    }
+}
+
+/***********************************************************************************************************************
+ * Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Creates an empty set.
+ **********************************************************************************************************************/
+ZoneSet::ZoneSet ()
+    : leafNodes(0), levels(0)
+{
+}
+
+/*******************************************************************************************************************//**
+ * @brief Loads the polygons of a zone file and builds the R-tree over them.
+ *
+ * @param path The zone file.
+ * @param error Set to a description of the first problem when the file is rejected.
+ *
+ * @return False if the file cannot be read or a line is malformed; the set is then left empty.
+ **********************************************************************************************************************/
+bool ZoneSet::load (const std::string& path, std::string& error)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        error = "unable to open " + path;
+        return false;
+    }
+
+    zones.clear();
+    edges.clear();
+    std::string line;
+    std::vector<double> coordinates;    /* Latitude and longitude of each vertex */
+    for (int lineNo = 1; std::getline(input, line); ++lineNo)
+    {
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword) || (keyword[0] == '#'))
+        {
+            continue;
+        }
+        Zone zone;
+        if ((keyword != "zone") || !(fields >> zone.name))
+        {
+            error = "line " + std::to_string(lineNo) + ": expected 'zone <name> <lat> <lon> ...'";
+            zones.clear();
+            return false;
+        }
+
+        coordinates.clear();
+        double value;
+        while ((coordinates.size() < 2 * ZONE_MAX_VERTICES) && (fields >> value) &&
+               (std::fabs(value) <= ((coordinates.size() % 2 == 0) ? 90.0 : 180.0)))
+        {
+            coordinates.push_back(value);
+        }
+        if (!fields.eof() || (coordinates.size() % 2 != 0) || (coordinates.size() < 6))
+        {
+            error = "line " + std::to_string(lineNo) + ": zone " + zone.name + " needs 3 to " +
+                    std::to_string(ZONE_MAX_VERTICES) + " vertices as latitude and longitude pairs in degrees";
+            zones.clear();
+            return false;
+        }
+
+        zone.box = ZoneBox{ 90.0, 180.0, -90.0, -180.0 };
+        zone.firstEdge = (uint32_t)edges.size();
+        zone.edgeCount = (uint32_t)(coordinates.size() / 2);
+        for (size_t i = 0; i < coordinates.size(); i += 2)
+        {
+            size_t j = (i + 2) % coordinates.size();
+            double lat0 = coordinates[i], lon0 = coordinates[i + 1], lat1 = coordinates[j], lon1 = coordinates[j + 1];
+            double slope = (lat0 != lat1) ? (lon1 - lon0) / (lat1 - lat0) : 0.0;
+            edges.push_back(ZoneEdge{ lat0, lat1, lon0, slope });
+            zone.box = boxUnion(zone.box, ZoneBox{ lat0, lon0, lat0, lon0 });
+        }
+        zones.push_back(zone);
+    }
+
+    build();
+    return true;
+}
+
+/*******************************************************************************************************************//**
+ * @brief Number of polygons.
+ **********************************************************************************************************************/
+size_t ZoneSet::size () const
+{
+    return zones.size();
+}
+
+/*******************************************************************************************************************//**
+ * @brief One polygon, by its index in the order of the file.
+ **********************************************************************************************************************/
+const Zone& ZoneSet::zone (uint32_t index) const
+{
+    return zones[index];
+}
+
+/*******************************************************************************************************************//**
+ * @brief Finds the polygons whose bounding box overlaps a box.
+ *
+ * @param box The box, e.g. of a chunk of fixes.
+ * @param out Output list, replaced with the indexes of the polygons in no particular order.
+ **********************************************************************************************************************/
+void ZoneSet::query (const ZoneBox& box, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    // Each level adds at most ZONE_NODE_ENTRIES to the stack, and 16 levels hold more polygons than memory
+    uint32_t stack[ZONE_NODE_ENTRIES * 16];
+    size_t top = 0;
+    stack[top++] = (uint32_t)(nodes.size() - 1);
+    while (top > 0)
+    {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (!overlaps(node.box, box))
+        {
+            continue;
+        }
+        if (index < leafNodes)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (overlaps(zones[order[i]].box, box))
+                {
+                    out.push_back(order[i]);
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                stack[top++] = i;
+            }
+        }
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Tests ZONE_BATCH_POINTS points against one polygon by the crossing number of a ray towards the east.
+ *
+ * Unused points are set to ZONE_UNUSED_LAT by the caller, north of every edge, so they are never inside. A point on
+ * an edge may be counted on either side.
+ *
+ * @param index The polygon.
+ * @param lat Latitudes of the points in degrees.
+ * @param lon Longitudes of the points in degrees.
+ * @param inside Set to 1 for each point inside the polygon, 0 otherwise.
+ **********************************************************************************************************************/
+void ZoneSet::contains (uint32_t index, const double* __restrict lat, const double* __restrict lon,
+                        uint8_t* __restrict inside) const
+{
+    // Crossing parity in lanes as wide as the coordinates, so that the inner loop is a plain vector loop: an edge is
+    // crossed if one end is north of the point and the other not, and it passes east of the point at its latitude
+    uint64_t odd[ZONE_BATCH_POINTS] = {};
+    const Zone& zone = zones[index];
+    for (uint32_t e = zone.firstEdge; e < zone.firstEdge + zone.edgeCount; ++e)
+    {
+        const double lat0 = edges[e].lat0;
+        const double lat1 = edges[e].lat1;
+        const double lon0 = edges[e].lon0;
+        const double slope = edges[e].slope;
+        for (size_t i = 0; i < ZONE_BATCH_POINTS; ++i)
+        {
+            uint64_t straddles = signBit(lat[i] - lat0) ^ signBit(lat[i] - lat1);
+            odd[i] ^= straddles & signBit(lon[i] - (lon0 + (lat[i] - lat0) * slope));
+        }
+    }
+    for (size_t i = 0; i < ZONE_BATCH_POINTS; ++i)
+    {
+        inside[i] = (uint8_t)odd[i];
+    }
+}
+
+/*******************************************************************************************************************//**
+ * @brief Levels of the R-tree, 0 when the set is empty.
+ **********************************************************************************************************************/
+size_t ZoneSet::depth () const
+{
+    return levels;
+}
+
+/***********************************************************************************************************************
+ * Private Functions
+ **********************************************************************************************************************/
+
+/*******************************************************************************************************************//**
+ * @brief Whether two boxes share at least a point.
+ **********************************************************************************************************************/
+static bool overlaps (const ZoneBox& a, const ZoneBox& b)
+{
+    return (a.minLat <= b.maxLat) && (b.minLat <= a.maxLat) && (a.minLon <= b.maxLon) && (b.minLon <= a.maxLon);
+}
+
+/*******************************************************************************************************************//**
+ * @brief The smallest box holding two boxes.
+ **********************************************************************************************************************/
+static ZoneBox boxUnion (const ZoneBox& a, const ZoneBox& b)
+{
+    return ZoneBox{ std::min(a.minLat, b.minLat), std::min(a.minLon, b.minLon), std::max(a.maxLat, b.maxLat),
+                    std::max(a.maxLon, b.maxLon) };
+}
+
+/*******************************************************************************************************************//**
+ * @brief Bulk loads the R-tree: packs the polygons into leaves, then each level into the next until one node is
+ *        left.
+ **********************************************************************************************************************/
+void ZoneSet::build ()
+{
+    nodes.clear();
+    order.resize(zones.size());
+    for (uint32_t i = 0; i < zones.size(); ++i)
+    {
+        order[i] = i;
+    }
+    sortTileRecursive(order, [this](uint32_t i) -> const ZoneBox& { return zones[i].box; });
+
+    std::vector<Node> level;
+    for (uint32_t first = 0; first < order.size(); first += ZONE_NODE_ENTRIES)
+    {
+        Node node = { zones[order[first]].box, first, std::min<uint32_t>(ZONE_NODE_ENTRIES, order.size() - first) };
+        for (uint32_t i = first + 1; i < first + node.count; ++i)
+        {
+            node.box = boxUnion(node.box, zones[order[i]].box);
+        }
+        level.push_back(node);
+    }
+    leafNodes = level.size();
+    levels = level.empty() ? 0 : 1;
+
+    while (level.size() > 1)
+    {
+        sortTileRecursive(level, [](const Node& n) -> const ZoneBox& { return n.box; });
+        uint32_t base = (uint32_t)nodes.size();
+        nodes.insert(nodes.end(), level.begin(), level.end());
+
+        std::vector<Node> parents;
+        for (uint32_t first = 0; first < level.size(); first += ZONE_NODE_ENTRIES)
+        {
+            Node node = { level[first].box, base + first,
+                          std::min<uint32_t>(ZONE_NODE_ENTRIES, level.size() - first) };
+            for (uint32_t i = first + 1; i < first + node.count; ++i)
+            {
+                node.box = boxUnion(node.box, level[i].box);
+            }
+            parents.push_back(node);
+        }
+        level.swap(parents);
+        ++levels;
+    }
+    nodes.insert(nodes.end(), level.begin(), level.end());
+}